@@ -35,7 +35,7 @@ namespace UnrealEngine.Framework {
 	// Automatically generated
 
 	internal static class Shared {
-		internal const int checksum = 0x2F0;
+		internal const int checksum = 0x2B;
 		internal static Dictionary<int, IntPtr> userFunctions = new();
 		private const string dynamicTypesAssemblyName = "UnrealEngine.DynamicTypes";
 		private static readonly ModuleBuilder moduleBuilder = AssemblyBuilder.DefineDynamicAssembly(new(dynamicTypesAssemblyName), AssemblyBuilderAccess.RunAndCollect).DefineDynamicModule(dynamicTypesAssemblyName);
@@ -109,6 +109,16 @@ namespace UnrealEngine.Framework {
 				Object.setText = (delegate* unmanaged[Cdecl]<IntPtr, byte[], byte[], Bool>)objectFunctions[head++];
 			}
 
+			unchecked {
+				int head = 0;
+				IntPtr* inprocFunctions = (IntPtr*)buffer[position++];
+
+				Inproc.open = (delegate* unmanaged[Cdecl]<byte[], IntPtr>)inprocFunctions[head++];
+				Inproc.send = (delegate* unmanaged[Cdecl]<IntPtr, byte*, int, Bool>)inprocFunctions[head++];
+				Inproc.receive = (delegate* unmanaged[Cdecl]<IntPtr, ref int, byte*>)inprocFunctions[head++];
+				Inproc.close = (delegate* unmanaged[Cdecl]<IntPtr, void>)inprocFunctions[head++];
+			}
+
 			unchecked {
 				Type[] types = pluginAssembly.GetTypes();
 
@@ -348,5 +358,12 @@ namespace UnrealEngine.Framework {
 		internal static delegate* unmanaged[Cdecl]<IntPtr, byte[], byte[], Bool> setString;
 		internal static delegate* unmanaged[Cdecl]<IntPtr, byte[], byte[], Bool> setText;
 	}
+
+	static unsafe partial class Inproc {
+		internal static delegate* unmanaged[Cdecl]<byte[], IntPtr> open;
+		internal static delegate* unmanaged[Cdecl]<IntPtr, byte*, int, Bool> send;
+		internal static delegate* unmanaged[Cdecl]<IntPtr, ref int, byte*> receive;
+		internal static delegate* unmanaged[Cdecl]<IntPtr, void> close;
+	}
 	
 }
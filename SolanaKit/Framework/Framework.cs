@@ -1495,5 +1495,57 @@ namespace UnrealEngine.Framework {
 		/// </summary>
 		public static void FlushPersistentLines() => flushPersistentLines();
 	}
+
+	/// <summary>
+	/// In-process LinkStream endpoints, reached from Blueprint by connecting to <c>inproc://name</c> instead of a socket address
+	/// </summary>
+	public static unsafe partial class Inproc {
+		/// <summary>
+		/// Returns the endpoint with the specified name, creating it on first use, the handle stays valid until the engine shuts down
+		/// </summary>
+		public static IntPtr Open(string name) {
+			if (name == null)
+				throw new ArgumentNullException(nameof(name));
+
+			return open(name.StringToBytes());
+		}
+
+		/// <summary>
+		/// Queues a message for the connection attached to the endpoint, returns false if the message exceeds its maximum frame size
+		/// </summary>
+		public static bool Send(IntPtr endpoint, ReadOnlySpan<byte> message) {
+			if (endpoint == IntPtr.Zero)
+				throw new ArgumentNullException(nameof(endpoint));
+
+			fixed (byte* data = message) {
+				return send(endpoint, data, message.Length);
+			}
+		}
+
+		/// <summary>
+		/// Dequeues the next message sent from Blueprint, the span is valid until the next call to <see cref="TryReceive"/> or <see cref="Close"/> and must be consumed from a single thread
+		/// </summary>
+		public static bool TryReceive(IntPtr endpoint, out ReadOnlySpan<byte> message) {
+			if (endpoint == IntPtr.Zero)
+				throw new ArgumentNullException(nameof(endpoint));
+
+			int size = 0;
+			byte* data = receive(endpoint, ref size);
+
+			message = data != null ? new(data, size) : ReadOnlySpan<byte>.Empty;
+
+			return data != null;
+		}
+
+		/// <summary>
+		/// Disconnects the connection attached to the endpoint, which raises its disconnect event in Blueprint
+		/// </summary>
+		public static void Close(IntPtr endpoint) {
+			if (endpoint == IntPtr.Zero)
+				throw new ArgumentNullException(nameof(endpoint));
+
+			close(endpoint);
+		}
+	}
 	
 }
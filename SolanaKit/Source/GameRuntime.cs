@@ -38,6 +38,8 @@ namespace Game
     {
         public static ChainClient ChainClient { get; set; }
        public static LinkNetwork _LinkNetwork { get; set; }
+        //Port for pipelined sessions (VarInt framing and envelopes, many requests per connection). 0 leaves the pipeline closed
+        public static Int32 PipelinePort { get; set; } = 0;
         public static async void OnWorldBegin()
         {
             Debug.AddOnScreenMessage(-1, 20.0f, Color.PowderBlue, "UnrealSOLNET is initialized");
@@ -53,11 +55,16 @@ namespace Game
             Byte[] bytes = new Byte[1400];
             _LinkNetwork.isOnline = true;
             _LinkNetwork.LinkServer.Start();
+            _LinkNetwork.OpenInproc();
+            if (PipelinePort > 0)
+                _LinkNetwork.StartPipeline(PipelinePort);
             Debug.AddOnScreenMessage(-1, 20.0f, Color.PowderBlue, "Linkstream Module online!");
         }
         public static void OnWorldEnd()
         {
             _LinkNetwork.isOnline = false;
+            _LinkNetwork.CloseInproc();
+            _LinkNetwork.StopPipeline();
             _LinkNetwork.LinkServer.Stop();
             _LinkNetwork = null;
         }
@@ -71,6 +78,10 @@ namespace Game
                 {
                     RailGun();
                 }
+                //Blueprint connected through inproc://linkstream is served without touching the TCP stack
+                _LinkNetwork.ServeInproc(HandleRequestEvent);
+                //Pipelined sessions on PipelinePort keep their connection and may have many requests in flight
+                _LinkNetwork.ServePipeline(HandleRequestEvent);
                 bool? hasPending = _LinkNetwork.LinkServer.Pending();
                
                 if (hasPending != null && hasPending == true)
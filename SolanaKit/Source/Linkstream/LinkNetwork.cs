@@ -31,6 +31,10 @@ using System.Diagnostics;
 
 using System.Security.Cryptography;
 using System.Drawing;
+using System.Collections.Concurrent;
+using System.Net.Security;
+using System.Security.Authentication;
+using System.Security.Cryptography.X509Certificates;
 
 namespace LinkStream.Server
 {
@@ -43,8 +47,87 @@ namespace LinkStream.Server
 
         public string Message { get; set; }
     }
+    //A request read from a pipelined session, answered from the game tick
+    public class PipelineRequest
+    {
+        public PipelineRequest(PipelineSession _session, byte _kind, uint _correlationId, byte[] _payload)
+        {
+            Session = _session;
+            Kind = _kind;
+            CorrelationId = _correlationId;
+            Payload = _payload;
+        }
+
+        public PipelineSession Session { get; }
+        public byte Kind { get; }
+        public uint CorrelationId { get; }
+        public byte[] Payload { get; }
+    }
+    //An accepted pipelined connection. Replies are queued here and written by one async drain at a time,
+    //so the game tick never blocks on a slow peer and pongs never interleave with replies
+    public class PipelineSession
+    {
+        private readonly TcpClient Client;
+        private readonly ConcurrentQueue<byte[]> Outgoing = new ConcurrentQueue<byte[]>();
+        private int isDraining;
+
+        public PipelineSession(TcpClient _client)
+        {
+            Client = _client;
+            Stream = _client.GetStream();
+        }
+
+        public Stream Stream { get; set; }
+
+        public void Send(byte[] _message)
+        {
+            Outgoing.Enqueue(_message);
+            if (Interlocked.CompareExchange(ref isDraining, 1, 0) == 0)
+                _ = Task.Run(Drain);
+        }
+        private async Task Drain()
+        {
+            try
+            {
+                do
+                {
+                    while (Outgoing.TryDequeue(out byte[]? message))
+                    {
+                        await Stream.WriteAsync(LinkNetwork.EncodeVarInt((uint)message.Length));
+                        await Stream.WriteAsync(message);
+                    }
+                    Volatile.Write(ref isDraining, 0);
+                    //A reply queued after the last dequeue but before the flag dropped would otherwise wait for the next one
+                } while (!Outgoing.IsEmpty && Interlocked.CompareExchange(ref isDraining, 1, 0) == 0);
+            }
+            catch (Exception)
+            {
+                //Session closed while replies were queued; the reader's finally tears it down
+                Close();
+            }
+        }
+        public void Close()
+        {
+            Outgoing.Clear();
+            Stream.Close();
+            Client.Close();
+        }
+    }
     public class LinkNetwork
     {
+        //Envelope kinds, see FLinkStreamEnvelope on the native side
+        public const byte EnvelopeMarker = 0x80;
+        public const byte KindMessage = 0;
+        public const byte KindRequest = 1;
+        public const byte KindResponse = 2;
+        public const byte KindPing = 3;
+        public const byte KindPong = 4;
+        public const byte KindHello = 5;
+        public const byte KindResync = 6;
+        //Envelope bits between the marker and the kind, compression and delta flags on the native side
+        public const byte EnvelopeFlags = 0x78;
+        public const byte EnvelopeKindMask = 0x07;
+
         public string? LinkServiceName { get; set; }
         public bool isOnline { get; set; }
         public bool isLocal { get; set; }
@@ -53,6 +136,14 @@ namespace LinkStream.Server
         public Int32 LinkPort { get; set; }
         public TcpListener? LinkServer { get; set; }
         public TcpClient? LinkClient { get; set; }
+        //In-process endpoint Blueprint reaches through inproc://<name>, no socket involved
+        public IntPtr InprocEndpoint { get; set; }
+        //Persistent sessions speaking VarInt framing and the LinkStream envelope, so many requests can be in flight per connection
+        public TcpListener? PipelineServer { get; set; }
+        //Set to speak TLS on pipelined sessions, for clients with bTls set; remote clients can then skip IP whitelisting
+        public X509Certificate2? PipelineCertificate { get; set; }
+        private ConcurrentQueue<PipelineRequest> PipelineRequests { get; } = new ConcurrentQueue<PipelineRequest>();
+        private ConcurrentDictionary<PipelineSession, bool> PipelineSessions { get; } = new ConcurrentDictionary<PipelineSession, bool>();
         private IPAddress LinkServerIP { get; }
         private IDataProtector Protector { get; set; }
 
@@ -67,7 +158,8 @@ namespace LinkStream.Server
             IDataProtectionProvider provider = DataProtectionProvider.Create("LinkStream");
             Protector = provider.CreateProtector("GateKeeper");
             //KEEP IT LOCAL for maximum security - Make sure ports being used are not open on your network.
-            //If you are using LinkStream for a remote connection between dapps make sure to whitelist IP access to specific ports.
+            //If you are using LinkStream for a remote connection between dapps make sure to whitelist IP access to specific ports,
+            //or give StartPipeline a certificate so pipelined sessions are encrypted with TLS.
             if (_LinkServerIP == "127.0.0.1")
                 isLocal= true;
             else
@@ -85,6 +177,207 @@ namespace LinkStream.Server
             if (SignEvent != null)
                 SignEvent(this, e);
         }
+        public void OpenInproc(string _endpointName = "linkstream")
+        {
+            InprocEndpoint = UnrealEngine.Framework.Inproc.Open(_endpointName);
+        }
+        public void CloseInproc()
+        {
+            if (InprocEndpoint == IntPtr.Zero)
+                return;
+            UnrealEngine.Framework.Inproc.Close(InprocEndpoint);
+            InprocEndpoint = IntPtr.Zero;
+        }
+        //Answers every queued inproc request with the handler's reply. Call from one thread only, the game tick does
+        public void ServeInproc(Func<string, string> _requestHandler)
+        {
+            if (InprocEndpoint == IntPtr.Zero)
+                return;
+            while (UnrealEngine.Framework.Inproc.TryReceive(InprocEndpoint, out ReadOnlySpan<byte> request))
+            {
+                //Connections with bUseEnvelope set prefix every message; answer requests with a response carrying the same ID
+                if (TryReadEnvelope(request, out byte kind, out uint correlationId, out int envelopeSize))
+                {
+                    //Negotiation and resync envelopes are for the native worker, which never sends them in process anyway
+                    if (kind >= KindHello || (request[0] & EnvelopeFlags) != 0)
+                        continue;
+                    string reply = _requestHandler(System.Text.Encoding.ASCII.GetString(request.Slice(envelopeSize)));
+                    byte replyKind = kind == KindRequest ? KindResponse : KindMessage;
+                    UnrealEngine.Framework.Inproc.Send(InprocEndpoint, BuildEnvelopedMessage(replyKind, correlationId, System.Text.Encoding.ASCII.GetBytes(reply)));
+                    continue;
+                }
+                string response = _requestHandler(System.Text.Encoding.ASCII.GetString(request));
+                UnrealEngine.Framework.Inproc.Send(InprocEndpoint, System.Text.Encoding.ASCII.GetBytes(response));
+            }
+        }
+        public void StartPipeline(Int32 _pipelinePort, X509Certificate2? _certificate = null)
+        {
+            PipelineCertificate = _certificate;
+            PipelineServer = new TcpListener(LinkServerIP, _pipelinePort);
+            PipelineServer.Start();
+            AcceptPipelineSessions();
+        }
+        public void StopPipeline()
+        {
+            PipelineServer?.Stop();
+            PipelineServer = null;
+            //Closing the sessions ends their readers, which remove them from the set
+            foreach (PipelineSession session in PipelineSessions.Keys)
+                session.Close();
+            PipelineRequests.Clear();
+        }
+        private async void AcceptPipelineSessions()
+        {
+            while (PipelineServer != null)
+            {
+                try
+                {
+                    TcpClient session = await PipelineServer.AcceptTcpClientAsync();
+                    session.NoDelay = true;
+                    _ = ReadPipelineSession(session);
+                }
+                catch (Exception)
+                {
+                    return;
+                }
+            }
+        }
+        //Reads frames until the client closes; requests are queued for ServePipeline so the handler always runs on the game thread
+        private async Task ReadPipelineSession(TcpClient _client)
+        {
+            PipelineSession session = new PipelineSession(_client);
+            PipelineSessions.TryAdd(session, true);
+            Stream stream = session.Stream;
+            try
+            {
+                //The handshake runs here, off the game thread
+                if (PipelineCertificate != null)
+                {
+                    SslStream sslStream = new SslStream(stream, false);
+                    stream = sslStream;
+                    session.Stream = sslStream;
+                    await sslStream.AuthenticateAsServerAsync(PipelineCertificate, false, SslProtocols.Tls12 | SslProtocols.Tls13, false);
+                }
+                while (true)
+                {
+                    int length = 0;
+                    for (int shift = 0; ; shift += 7)
+                    {
+                        byte[]? lengthByte = await ReadExactly(stream, 1);
+                        if (lengthByte == null || shift > 28)
+                            return;
+                        length |= (lengthByte[0] & 0x7F) << shift;
+                        if ((lengthByte[0] & 0x80) == 0)
+                            break;
+                    }
+                    if (length > 1024 * 1024)
+                        return;
+                    byte[]? frame = await ReadExactly(stream, length);
+                    if (frame == null)
+                        return;
+                    if (!TryReadEnvelope(frame, out byte kind, out uint correlationId, out int envelopeSize))
+                        continue;
+                    //Heartbeats are answered here rather than queued, so a busy game thread doesn't look like a dead peer
+                    if (kind == KindPing)
+                    {
+                        session.Send(BuildEnvelopedMessage(KindPong, correlationId, Array.Empty<byte>()));
+                        continue;
+                    }
+                    if (kind == KindPong)
+                        continue;
+                    //Native clients with Compression or bDeltaEncoding set say hello on link-up; answering with an empty
+                    //hello tells them this side decodes neither, so every later payload arrives plain
+                    if (kind == KindHello)
+                    {
+                        session.Send(BuildEnvelopedMessage(KindHello, correlationId, new byte[] { 0, 0, 0 }));
+                        continue;
+                    }
+                    //Resyncs, and compressed or delta payloads this side never asked for, can't be answered
+                    if (kind > KindHello || (frame[0] & EnvelopeFlags) != 0)
+                        continue;
+                    PipelineRequests.Enqueue(new PipelineRequest(session, kind, correlationId, frame.AsSpan(envelopeSize).ToArray()));
+                }
+            }
+            catch (Exception)
+            {
+            }
+            finally
+            {
+                PipelineSessions.TryRemove(session, out _);
+                session.Close();
+            }
+        }
+        private static async Task<byte[]?> ReadExactly(Stream _stream, int _count)
+        {
+            byte[] buffer = new byte[_count];
+            int read = 0;
+            while (read < _count)
+            {
+                int n = await _stream.ReadAsync(buffer, read, _count - read);
+                if (n == 0)
+                    return null;
+                read += n;
+            }
+            return buffer;
+        }
+        //Answers every request queued by the pipelined sessions. Call from the game tick; replies are only queued here
+        //and written by the session off the tick
+        public void ServePipeline(Func<string, string> _requestHandler)
+        {
+            while (PipelineRequests.TryDequeue(out PipelineRequest? request))
+            {
+                string reply = _requestHandler(System.Text.Encoding.ASCII.GetString(request.Payload));
+                byte replyKind = request.Kind == KindRequest ? KindResponse : KindMessage;
+                request.Session.Send(BuildEnvelopedMessage(replyKind, request.CorrelationId, System.Text.Encoding.ASCII.GetBytes(reply)));
+            }
+        }
+        public static bool TryReadEnvelope(ReadOnlySpan<byte> _message, out byte _kind, out uint _correlationId, out int _size)
+        {
+            _kind = 0;
+            _correlationId = 0;
+            _size = 0;
+            if (_message.Length < 1 || (_message[0] & EnvelopeMarker) == 0)
+                return false;
+            //Flag bits are masked off, kinds compare on the low three bits only
+            _kind = (byte)(_message[0] & EnvelopeKindMask);
+            if (_kind == KindMessage)
+            {
+                _size = 1;
+                return true;
+            }
+            for (int i = 1; i < 6 && i < _message.Length; i++)
+            {
+                _correlationId |= (uint)(_message[i] & 0x7F) << (7 * (i - 1));
+                if ((_message[i] & 0x80) == 0)
+                {
+                    _size = i + 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+        public static byte[] BuildEnvelopedMessage(byte _kind, uint _correlationId, byte[] _payload)
+        {
+            byte[] id = _kind != KindMessage ? EncodeVarInt(_correlationId) : Array.Empty<byte>();
+            byte[] message = new byte[1 + id.Length + _payload.Length];
+            message[0] = (byte)(EnvelopeMarker | _kind);
+            id.CopyTo(message, 1);
+            _payload.CopyTo(message, 1 + id.Length);
+            return message;
+        }
+        public static byte[] EncodeVarInt(uint _value)
+        {
+            List<byte> bytes = new List<byte>(5);
+            do
+            {
+                byte b = (byte)(_value & 0x7F);
+                _value >>= 7;
+                if (_value != 0)
+                    b |= 0x80;
+                bytes.Add(b);
+            } while (_value != 0);
+            return bytes.ToArray();
+        }
         public async void LinkStream()
         {
             try
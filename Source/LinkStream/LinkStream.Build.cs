@@ -47,9 +47,18 @@ public class LinkStream : ModuleRules
 				"Slate",
 				"SlateCore",
                 "Sockets",
-                "Networking"
+                "Networking",
+                "SSL"
 			}
 			);
 
+		// AES-GCM, X25519 and HKDF for encrypted connections, and TLS through the SSL module's contexts.
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "OpenSSL");
+
+		if (Target.Platform == UnrealTargetPlatform.Win64)
+		{
+			PublicSystemLibraries.Add("ws2_32.lib");
+		}
+
 	}
 }
@@ -25,12 +25,40 @@
 
 #include "LinkStream.h"
 #include "LinkStreamSettings.h"
+#include "LinkStreamReactor.h"
+#include "LinkStreamBuffer.h"
+#include "LinkStreamInproc.h"
+#include "LinkStreamSocket.h"
+#if WITH_SSL
+#include "Ssl.h"
+#include "Interfaces/ISslManager.h"
+#endif
 #include "Developer/Settings/Public/ISettingsModule.h"
 
 #define LOCTEXT_NAMESPACE "FLinkStreamModule"
 
+DEFINE_LOG_CATEGORY(LogLinkStream);
+
+FLinkStreamModule::FLinkStreamModule()
+{
+}
+
+FLinkStreamModule::~FLinkStreamModule()
+{
+}
+
 void FLinkStreamModule::StartupModule()
 {
+	FLinkStreamSocket::StartupPlatform();
+
+#if WITH_SSL
+	// Loaded here so the I/O threads that set up TLS connections never have to load it.
+	FSslModule::Get().GetSslManager().InitializeSsl();
+#endif
+
+	BufferPool = MakeUnique<FLinkStreamBufferPool>();
+	FLinkStreamBufferPool::Instance = BufferPool.Get();
+
 	if (ISettingsModule* SettingsModule = FModuleManager::GetModulePtr<ISettingsModule>("Settings"))
 	{
 		SettingsModule->RegisterSettings("Project", "Plugins", "LinkStream",
@@ -46,6 +74,54 @@ void FLinkStreamModule::ShutdownModule()
 	{
 		SettingsModule->UnregisterSettings("Project", "Plugins", "LinkStream");
 	}
+
+	{
+		FScopeLock Lock(&ReactorPoolLock);
+		ReactorPool.Reset();
+	}
+
+	{
+		FScopeLock Lock(&InprocLock);
+		InprocEndpoints.Empty();
+	}
+
+	// Buffers still alive after this point are freed normally instead of returned to the pool.
+	FLinkStreamBufferPool::Instance = nullptr;
+	BufferPool.Reset();
+#if WITH_SSL
+	if (FModuleManager::Get().IsModuleLoaded("SSL"))
+	{
+		FSslModule::Get().GetSslManager().ShutdownSsl();
+	}
+#endif
+	FLinkStreamSocket::ShutdownPlatform();
+}
+
+FLinkStreamModule& FLinkStreamModule::Get()
+{
+	return FModuleManager::LoadModuleChecked<FLinkStreamModule>("LinkStream");
+}
+
+FLinkStreamReactorPool& FLinkStreamModule::GetReactorPool()
+{
+	FScopeLock Lock(&ReactorPoolLock);
+	if (!ReactorPool)
+	{
+		const ULinkStreamSettings* Settings = GetDefault<ULinkStreamSettings>();
+		ReactorPool = MakeUnique<FLinkStreamReactorPool>(Settings->ReactorThreadCount);
+	}
+	return *ReactorPool;
+}
+
+FLinkStreamInprocEndpoint& FLinkStreamModule::FindOrCreateInprocEndpoint(const FString& Name)
+{
+	FScopeLock Lock(&InprocLock);
+	TUniquePtr<FLinkStreamInprocEndpoint>& Endpoint = InprocEndpoints.FindOrAdd(Name);
+	if (!Endpoint)
+	{
+		Endpoint = MakeUnique<FLinkStreamInprocEndpoint>(Name);
+	}
+	return *Endpoint;
 }
 
 #undef LOCTEXT_NAMESPACE
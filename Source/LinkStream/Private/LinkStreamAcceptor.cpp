@@ -0,0 +1,114 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamAcceptor.h"
+#include "LinkStream.h"
+
+FLinkStreamAcceptor::FLinkStreamAcceptor(ILinkStreamWorkerOwner* InOwner, const FTcpSocketWorkerSettings& InSettings, int32 InMaxSessions, TSharedPtr<FThreadSafeCounter> InLiveSessions, int32 FirstSessionId, FOnAccepted&& InOnAccepted)
+	: Owner(InOwner)
+	, Settings(InSettings)
+	, MaxSessions(InMaxSessions)
+	, OnAccepted(MoveTemp(InOnAccepted))
+	, LiveSessions(InLiveSessions.IsValid() ? InLiveSessions.ToSharedRef() : MakeShared<FThreadSafeCounter>())
+	, NextSessionId(FirstSessionId)
+{
+	Settings.Backend = ELinkStreamBackend::Reactor;
+}
+
+bool FLinkStreamAcceptor::Start(const FString& BindAddress, int32 InPort, int32 Backlog)
+{
+	if (!Listener.Create() || !Listener.Listen(BindAddress, InPort, Backlog) || !Listener.SetNonBlocking(true))
+	{
+		Listener.Close();
+		return false;
+	}
+
+	Port = Listener.GetLocalPort();
+	bRun = true;
+	Reactor = FLinkStreamModule::Get().GetReactorPool().Register(AsShared());
+	return true;
+}
+
+void FLinkStreamAcceptor::Stop()
+{
+	bRun = false;
+	if (Reactor)
+	{
+		Reactor->Wake(this);
+	}
+}
+
+void FLinkStreamAcceptor::OnReactorAttach(FLinkStreamReactor& InReactor)
+{
+	Reactor = &InReactor;
+	if (bRun)
+	{
+		Reactor->Watch(this, Listener, false);
+	}
+}
+
+void FLinkStreamAcceptor::OnReactorEvent(bool bReadable, bool bWritable, bool bError)
+{
+	// Drain the backlog; every pending connection is accepted in this one wakeup.
+	while (bRun)
+	{
+		FLinkStreamSocket* Client = new FLinkStreamSocket();
+		FLinkStreamSocketAddress Peer;
+		if (!Listener.Accept(*Client, &Peer))
+		{
+			delete Client;
+			break;
+		}
+
+		if (MaxSessions > 0 && LiveSessions->GetValue() >= MaxSessions)
+		{
+			// Closing straight away refuses the client.
+			delete Client;
+			continue;
+		}
+
+		LiveSessions->Increment();
+		AcceptedCount.Increment();
+
+		const int32 SessionId = NextSessionId.Increment() - 1;
+		TSharedRef<FTcpSocketWorker> Session(new FTcpSocketWorker(Peer.IpToString(), Peer.Port, Owner, SessionId, Settings));
+		if (OnAccepted)
+		{
+			OnAccepted(SessionId, Session);
+		}
+		Session->StartAccepted(Client);
+	}
+}
+
+bool FLinkStreamAcceptor::OnReactorTick()
+{
+	return bRun;
+}
+
+void FLinkStreamAcceptor::OnReactorDetach()
+{
+	bRun = false;
+	Listener.Close();
+}
@@ -0,0 +1,82 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "LinkStreamConnection.h"
+#include "LinkStreamReactor.h"
+#include "LinkStreamSocket.h"
+
+/**
+ * Accepts connections on a reactor thread and hands each accepted socket to a new reactor-backed FTcpSocketWorker.
+ * Used by ALinkStreamListener. The benchmarks drive it directly.
+ */
+class FLinkStreamAcceptor : public ILinkStreamReactorHandler, public TSharedFromThis<FLinkStreamAcceptor>
+{
+public:
+	/** Called on the reactor thread for every accepted session, before the session is started. */
+	typedef TFunction<void(int32 SessionId, const TSharedRef<FTcpSocketWorker>& Session)> FOnAccepted;
+
+	/**
+	 * InOwner receives the sessions' events and may be null. MaxSessions of 0 means no limit. Session ids start at FirstSessionId.
+	 * InLiveSessions is the owner's count of live sessions, checked against MaxSessions; the acceptor adds one per session and the
+	 * owner subtracts one as each ends, so sessions outliving this acceptor are still counted. Null counts this acceptor's only.
+	 */
+	FLinkStreamAcceptor(ILinkStreamWorkerOwner* InOwner, const FTcpSocketWorkerSettings& InSettings, int32 InMaxSessions, TSharedPtr<FThreadSafeCounter> InLiveSessions, int32 FirstSessionId, FOnAccepted&& InOnAccepted);
+
+	/** Binds, listens and registers with the reactor pool. Port 0 picks an ephemeral port, see GetPort. */
+	bool Start(const FString& BindAddress, int32 InPort, int32 Backlog);
+
+	/** Stops accepting. Sessions already accepted keep running. */
+	void Stop();
+
+	int32 GetPort() const { return Port; }
+	int32 GetNumSessions() const { return LiveSessions->GetValue(); }
+	int64 GetAcceptedCount() const { return AcceptedCount.GetValue(); }
+	int32 GetNextSessionId() const { return NextSessionId.GetValue(); }
+
+	virtual void OnReactorAttach(FLinkStreamReactor& InReactor) override;
+	virtual void OnReactorEvent(bool bReadable, bool bWritable, bool bError) override;
+	virtual bool OnReactorTick() override;
+	virtual void OnReactorDetach() override;
+
+private:
+	FLinkStreamSocket Listener;
+	ILinkStreamWorkerOwner* Owner;
+	FTcpSocketWorkerSettings Settings;
+	int32 MaxSessions;
+	FOnAccepted OnAccepted;
+	int32 Port = 0;
+
+	FLinkStreamReactor* Reactor = nullptr;
+	FThreadSafeBool bRun = false;
+	TSharedRef<FThreadSafeCounter> LiveSessions;
+	FThreadSafeCounter64 AcceptedCount;
+	FThreadSafeCounter NextSessionId;
+};
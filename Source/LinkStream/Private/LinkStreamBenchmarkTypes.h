@@ -0,0 +1,96 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LinkStreamBenchmarkTypes.generated.h"
+
+/** A 20-field game-state update for LinkStream.Bench.StructCodec, limited to the types the Conv and Message_Read nodes handle. */
+USTRUCT()
+struct FLinkStreamBenchState
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 PlayerId = 0;
+
+	UPROPERTY()
+	int32 Health = 0;
+
+	UPROPERTY()
+	int32 Mana = 0;
+
+	UPROPERTY()
+	int32 Score = 0;
+
+	UPROPERTY()
+	int32 Level = 0;
+
+	UPROPERTY()
+	int32 Experience = 0;
+
+	UPROPERTY()
+	int32 Gold = 0;
+
+	UPROPERTY()
+	int32 TeamId = 0;
+
+	UPROPERTY()
+	float PositionX = 0.f;
+
+	UPROPERTY()
+	float PositionY = 0.f;
+
+	UPROPERTY()
+	float PositionZ = 0.f;
+
+	UPROPERTY()
+	float Yaw = 0.f;
+
+	UPROPERTY()
+	float Pitch = 0.f;
+
+	UPROPERTY()
+	float Speed = 0.f;
+
+	UPROPERTY()
+	uint8 State = 0;
+
+	UPROPERTY()
+	uint8 Weapon = 0;
+
+	UPROPERTY()
+	uint8 Ammo = 0;
+
+	UPROPERTY()
+	uint8 Flags = 0;
+
+	UPROPERTY()
+	FString Name;
+
+	UPROPERTY()
+	FString Guild;
+};
@@ -0,0 +1,1680 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformProcess.h"
+#include "Async/Async.h"
+#include "LinkStream.h"
+#include "LinkStreamConnection.h"
+#include "LinkStreamSocket.h"
+#include "LinkStreamPoller.h"
+#include "LinkStreamAcceptor.h"
+#include "LinkStreamInproc.h"
+#include "LinkStreamMpscQueue.h"
+#include "LinkStreamUdp.h"
+#include "LinkStreamStructCodec.h"
+#include "LinkStreamCipher.h"
+#include "LinkStreamTls.h"
+#include "LinkStreamBenchmarkTypes.h"
+#include "Misc/ScopeLock.h"
+
+#define UI UI_ST
+THIRD_PARTY_INCLUDES_START
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+THIRD_PARTY_INCLUDES_END
+#undef UI
+
+/**
+ * Loopback measurements for the LinkStream transport, run from the console:
+ *   LinkStream.Bench.RoundTrip [Count] [PayloadSize]
+ *   LinkStream.Bench.Priority [BulkCount] [BulkSize]
+ *   LinkStream.Bench.Contention [MaxProducers] [MessagesPerProducer] [BatchSize]
+ *   LinkStream.Bench.Lossy [LossPercent] [LatencyMs] [Count] [IntervalMs] [JitterMs]
+ *   LinkStream.Bench.Broadcast [PayloadSize] [Rounds]
+ *   LinkStream.Bench.StructCodec [Iterations]
+ *   LinkStream.Bench.Encryption [MegabytesPerSize]
+ *   LinkStream.Bench.Tls [Handshakes]
+ * Every benchmark blocks the calling thread until it is done and reports through LogLinkStream.
+ */
+namespace LinkStreamBenchmarks
+{
+	/** Queues Message on Worker, yielding while its lane is full, as a producer that must not drop would. */
+	static void QueueOrWait(FTcpSocketWorker& Worker, FLinkStreamBuffer&& Message, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive)
+	{
+		while (!Worker.AddToOutbox(MoveTemp(Message), Priority))
+		{
+			FPlatformProcess::YieldThread();
+		}
+	}
+
+	/** Echoes every byte it receives back to the sender. Serves one client at a time on 127.0.0.1. */
+	class FEchoServer : public FRunnable
+	{
+	public:
+		virtual ~FEchoServer()
+		{
+			bRun = false;
+			if (Thread)
+			{
+				Thread->WaitForCompletion();
+				delete Thread;
+			}
+		}
+
+		bool Start()
+		{
+			if (!Listener.Create() || !Listener.Listen(TEXT("127.0.0.1"), 0, 16) || !Poller.Init())
+			{
+				return false;
+			}
+			Listener.SetNonBlocking(true);
+			Poller.Add(Listener.GetNative(), &Listener, false);
+
+			bRun = true;
+			Thread = FRunnableThread::Create(this, TEXT("LinkStreamEchoServer"), 128 * 1024, TPri_Normal);
+			return Thread != nullptr;
+		}
+
+		int32 GetPort() const { return Listener.GetLocalPort(); }
+
+		virtual uint32 Run() override
+		{
+			TArray<FLinkStreamPollEvent> Events;
+			uint8 Buffer[16384];
+
+			while (bRun)
+			{
+				Poller.Wait(Events, 50);
+				for (const FLinkStreamPollEvent& Event : Events)
+				{
+					if (Event.UserData == &Listener)
+					{
+						if (Listener.Accept(Client))
+						{
+							Client.SetNoDelay(true);
+							Poller.Add(Client.GetNative(), &Client, false);
+						}
+						continue;
+					}
+
+					int32 BytesRead = 0;
+					const ELinkStreamSocketResult Result = Client.Recv(Buffer, sizeof(Buffer), BytesRead);
+					if (Result == ELinkStreamSocketResult::Closed || Result == ELinkStreamSocketResult::Error)
+					{
+						Poller.Remove(Client.GetNative());
+						Client.Close();
+						continue;
+					}
+
+					int32 Offset = 0;
+					while (Offset < BytesRead)
+					{
+						int32 BytesSent = 0;
+						if (Client.Send(Buffer + Offset, BytesRead - Offset, BytesSent) == ELinkStreamSocketResult::Error)
+						{
+							break;
+						}
+						Offset += BytesSent;
+					}
+				}
+			}
+			return 0;
+		}
+
+	private:
+		FLinkStreamSocket Listener;
+		FLinkStreamSocket Client;
+		FLinkStreamPoller Poller;
+		FRunnableThread* Thread = nullptr;
+		FThreadSafeBool bRun = false;
+	};
+
+	/** Stands in for the managed runtime on an inproc endpoint: echoes every message through the managed-side calls. */
+	class FInprocEcho : public FRunnable
+	{
+	public:
+		explicit FInprocEcho(FLinkStreamInprocEndpoint& InEndpoint)
+			: Endpoint(InEndpoint)
+		{
+		}
+
+		virtual ~FInprocEcho()
+		{
+			bRun = false;
+			if (Thread)
+			{
+				Thread->WaitForCompletion();
+				delete Thread;
+			}
+		}
+
+		bool Start()
+		{
+			bRun = true;
+			Thread = FRunnableThread::Create(this, TEXT("LinkStreamInprocEcho"), 128 * 1024, TPri_Normal);
+			return Thread != nullptr;
+		}
+
+		virtual uint32 Run() override
+		{
+			while (bRun)
+			{
+				int32 Size = 0;
+				const uint8* Data = Endpoint.ManagedReceive(Size);
+				if (Data)
+				{
+					Endpoint.ManagedSend(Data, Size);
+				}
+				else
+				{
+					FPlatformProcess::YieldThread();
+				}
+			}
+			return 0;
+		}
+
+	private:
+		FLinkStreamInprocEndpoint& Endpoint;
+		FRunnableThread* Thread = nullptr;
+		FThreadSafeBool bRun = false;
+	};
+
+	static double Percentile(const TArray<double>& SortedSamples, double Fraction)
+	{
+		if (SortedSamples.Num() == 0)
+		{
+			return 0.0;
+		}
+		const int32 Index = FMath::Clamp(FMath::FloorToInt(Fraction * SortedSamples.Num()), 0, SortedSamples.Num() - 1);
+		return SortedSamples[Index];
+	}
+
+	/** Sends Count messages one at a time through Worker, waiting for each echo, and logs the latency distribution. */
+	static void RunRoundTrips(const TCHAR* Label, const TSharedRef<FTcpSocketWorker>& Worker, int32 Count, int32 PayloadSize)
+	{
+		Worker->Start();
+
+		const double ConnectDeadline = FPlatformTime::Seconds() + 5.0;
+		while (!Worker->isConnected() && FPlatformTime::Seconds() < ConnectDeadline)
+		{
+			FPlatformProcess::Sleep(0.001f);
+		}
+		if (!Worker->isConnected())
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: %s could not connect."), Label);
+			Worker->Stop();
+			return;
+		}
+
+		TArray<uint8> Payload;
+		Payload.SetNumZeroed(PayloadSize);
+
+		TArray<double> Samples;
+		Samples.Reserve(Count);
+		const FLinkStreamSyscallStats SyscallsBefore = ALinkStreamConnection::GetSyscallStats();
+		for (int32 Index = 0; Index < Count; Index++)
+		{
+			const double Start = FPlatformTime::Seconds();
+			FLinkStreamBuffer Outgoing = FLinkStreamBuffer::Acquire(PayloadSize);
+			Outgoing.GetArray().Append(Payload);
+			QueueOrWait(*Worker, MoveTemp(Outgoing));
+
+			const double Deadline = Start + 1.0;
+			FLinkStreamBuffer Echo;
+			while (!Worker->TryReadFromInbox(Echo))
+			{
+				if (FPlatformTime::Seconds() > Deadline)
+				{
+					UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: %s timed out waiting for an echo."), Label);
+					Worker->Stop();
+					return;
+				}
+				FPlatformProcess::YieldThread();
+			}
+			Samples.Add((FPlatformTime::Seconds() - Start) * 1000000.0);
+		}
+		const FLinkStreamSyscallStats SyscallsAfter = ALinkStreamConnection::GetSyscallStats();
+		Worker->Stop();
+
+		Samples.Sort();
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %-22s %d round trips of %d bytes  p50 %8.1f us  p99 %8.1f us  max %8.1f us"),
+			Label, Count, PayloadSize, Percentile(Samples, 0.50), Percentile(Samples, 0.99), Samples.Last());
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %-22s syscalls per round trip, client and echo server: recv %.1f  send %.1f  control %.1f  poll %.1f"),
+			Label,
+			(double)(SyscallsAfter.Recv - SyscallsBefore.Recv) / Count,
+			(double)(SyscallsAfter.Send - SyscallsBefore.Send) / Count,
+			(double)(SyscallsAfter.Control - SyscallsBefore.Control) / Count,
+			(double)(SyscallsAfter.Poll - SyscallsBefore.Poll) / Count);
+	}
+
+	static void MeasureRoundTrip(const TCHAR* Label, const FTcpSocketWorkerSettings& Settings, int32 Count, int32 PayloadSize)
+	{
+		FEchoServer Server;
+		if (!Server.Start())
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: could not start the echo server."));
+			return;
+		}
+
+		TSharedRef<FTcpSocketWorker> Worker(new FTcpSocketWorker(TEXT("127.0.0.1"), Server.GetPort(), nullptr, 0, Settings));
+		RunRoundTrips(Label, Worker, Count, PayloadSize);
+	}
+
+	static void MeasureInprocRoundTrip(const FTcpSocketWorkerSettings& Settings, int32 Count, int32 PayloadSize)
+	{
+		const FString Address = TEXT("inproc://linkstream-bench");
+		FInprocEcho Echo(*FLinkStreamInprocEndpoint::FindOrCreate(Address));
+		if (!Echo.Start())
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: could not start the inproc echo."));
+			return;
+		}
+
+		TSharedRef<FTcpSocketWorker> Worker(new FTcpSocketWorker(Address, 0, nullptr, 0, Settings));
+		RunRoundTrips(TEXT("Inproc"), Worker, Count, PayloadSize);
+	}
+
+	static void RoundTrip(const TArray<FString>& Args)
+	{
+		const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200;
+		const int32 PayloadSize = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 64;
+
+		FTcpSocketWorkerSettings Settings;
+		Settings.Framing = ELinkStreamFraming::UInt32;
+
+		Settings.Backend = ELinkStreamBackend::Thread;
+		Settings.WakeMode = ELinkStreamWakeMode::Polled;
+		MeasureRoundTrip(TEXT("Thread, polled"), Settings, Count, PayloadSize);
+
+		Settings.WakeMode = ELinkStreamWakeMode::EventDriven;
+		MeasureRoundTrip(TEXT("Thread, event driven"), Settings, Count, PayloadSize);
+
+		Settings.Backend = ELinkStreamBackend::Reactor;
+		MeasureRoundTrip(TEXT("Reactor"), Settings, Count, PayloadSize);
+
+		MeasureInprocRoundTrip(Settings, Count, PayloadSize);
+
+		const FLinkStreamBufferPoolStats Pool = ALinkStreamConnection::GetBufferPoolStats();
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: buffer pool  hits %lld  misses %lld  discarded %lld  high water %lld bytes"),
+			Pool.Hits, Pool.Misses, Pool.Discarded, Pool.HighWaterBytes);
+	}
+
+	static FAutoConsoleCommand RoundTripCommand(
+		TEXT("LinkStream.Bench.RoundTrip"),
+		TEXT("Measures loopback round-trip latency (p50/p99) for polled, event-driven and inproc LinkStream workers. Args: [Count=200] [PayloadSize=64]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RoundTrip));
+
+	/** Collects the sessions an acceptor creates so the benchmark can read and stop them. */
+	struct FSessionSink
+	{
+		FCriticalSection Lock;
+		TArray<TSharedRef<FTcpSocketWorker>> Sessions;
+
+		FLinkStreamAcceptor::FOnAccepted MakeCallback()
+		{
+			return [this](int32 SessionId, const TSharedRef<FTcpSocketWorker>& Session) {
+				FScopeLock ScopeLock(&Lock);
+				Sessions.Add(Session);
+			};
+		}
+
+		void StopAll()
+		{
+			FScopeLock ScopeLock(&Lock);
+			for (const TSharedRef<FTcpSocketWorker>& Session : Sessions)
+			{
+				Session->Stop();
+			}
+			Sessions.Empty();
+		}
+	};
+
+	static void Accept(const TArray<FString>& Args)
+	{
+		const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200;
+
+		FTcpSocketWorkerSettings Settings;
+		Settings.Framing = ELinkStreamFraming::UInt32;
+		Settings.DispatchMode = ELinkStreamDispatchMode::Batched;
+
+		FSessionSink Sink;
+		TSharedRef<FLinkStreamAcceptor> Acceptor(new FLinkStreamAcceptor(nullptr, Settings, 0, nullptr, 0, Sink.MakeCallback()));
+		if (!Acceptor->Start(TEXT("127.0.0.1"), 0, 1024))
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: could not start the acceptor."));
+			return;
+		}
+
+		TArray<TUniquePtr<FLinkStreamSocket>> Clients;
+		Clients.Reserve(Count);
+
+		const double Start = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Count; Index++)
+		{
+			TUniquePtr<FLinkStreamSocket> Client = MakeUnique<FLinkStreamSocket>();
+			if (!Client->Create() || !Client->Connect(TEXT("127.0.0.1"), Acceptor->GetPort()))
+			{
+				UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: client %d could not connect."), Index);
+				break;
+			}
+			Clients.Add(MoveTemp(Client));
+		}
+
+		const double Deadline = FPlatformTime::Seconds() + 10.0;
+		while (Acceptor->GetAcceptedCount() < Clients.Num() && FPlatformTime::Seconds() < Deadline)
+		{
+			FPlatformProcess::YieldThread();
+		}
+		const double Elapsed = FPlatformTime::Seconds() - Start;
+
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: accepted %lld of %d connections in %.1f ms  (%.0f accepts/s)"),
+			Acceptor->GetAcceptedCount(), Count, Elapsed * 1000.0, Acceptor->GetAcceptedCount() / Elapsed);
+
+		Acceptor->Stop();
+		Clients.Empty();
+		Sink.StopAll();
+	}
+
+	static void Messages(const TArray<FString>& Args)
+	{
+		const int32 NumClients = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 8;
+		const int32 MessagesPerClient = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 10000;
+		const int32 PayloadSize = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 64;
+
+		FTcpSocketWorkerSettings Settings;
+		Settings.Backend = ELinkStreamBackend::Reactor;
+		Settings.Framing = ELinkStreamFraming::UInt32;
+		Settings.DispatchMode = ELinkStreamDispatchMode::Batched;
+		Settings.bNoDelay = true;
+
+		FSessionSink Sink;
+		TSharedRef<FLinkStreamAcceptor> Acceptor(new FLinkStreamAcceptor(nullptr, Settings, 0, nullptr, 0, Sink.MakeCallback()));
+		if (!Acceptor->Start(TEXT("127.0.0.1"), 0, 1024))
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: could not start the acceptor."));
+			return;
+		}
+
+		TArray<TSharedRef<FTcpSocketWorker>> Clients;
+		for (int32 Index = 0; Index < NumClients; Index++)
+		{
+			TSharedRef<FTcpSocketWorker> Client(new FTcpSocketWorker(TEXT("127.0.0.1"), Acceptor->GetPort(), nullptr, Index, Settings));
+			Client->Start();
+			Clients.Add(Client);
+		}
+
+		TArray<TSharedRef<FTcpSocketWorker>> Sessions;
+		const double ConnectDeadline = FPlatformTime::Seconds() + 5.0;
+		while (Sessions.Num() < NumClients && FPlatformTime::Seconds() < ConnectDeadline)
+		{
+			FPlatformProcess::Sleep(0.001f);
+			FScopeLock ScopeLock(&Sink.Lock);
+			Sessions = Sink.Sessions;
+		}
+
+		const double Start = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < MessagesPerClient; Index++)
+		{
+			for (const TSharedRef<FTcpSocketWorker>& Client : Clients)
+			{
+				FLinkStreamBuffer Message = FLinkStreamBuffer::Acquire(PayloadSize);
+				Message.GetArray().SetNumZeroed(PayloadSize);
+				QueueOrWait(*Client, MoveTemp(Message));
+			}
+		}
+
+		const int64 Expected = (int64)NumClients * MessagesPerClient;
+		int64 Received = 0;
+		const double Deadline = Start + 30.0;
+		while (Received < Expected && FPlatformTime::Seconds() < Deadline)
+		{
+			bool bAny = false;
+			for (const TSharedRef<FTcpSocketWorker>& Session : Sessions)
+			{
+				FLinkStreamBuffer Message;
+				while (Session->TryReadFromInbox(Message))
+				{
+					Received++;
+					bAny = true;
+				}
+			}
+			if (!bAny)
+			{
+				FPlatformProcess::YieldThread();
+			}
+		}
+		const double Elapsed = FPlatformTime::Seconds() - Start;
+
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %d clients, received %lld of %lld messages of %d bytes in %.1f ms  (%.0f msg/s, %.1f MB/s)"),
+			NumClients, Received, Expected, PayloadSize, Elapsed * 1000.0, Received / Elapsed, Received * PayloadSize / Elapsed / (1024.0 * 1024.0));
+
+		for (const TSharedRef<FTcpSocketWorker>& Client : Clients)
+		{
+			Client->Stop();
+		}
+		Acceptor->Stop();
+		Sink.StopAll();
+	}
+
+	/** Queues a bulk backlog, then one small probe on ProbePriority, and logs how long the probe took to reach the session. */
+	static void MeasurePriority(const TCHAR* Label, ELinkStreamPriority ProbePriority, int32 BulkCount, int32 BulkSize)
+	{
+		FTcpSocketWorkerSettings Settings;
+		Settings.Backend = ELinkStreamBackend::Reactor;
+		Settings.Framing = ELinkStreamFraming::UInt32;
+		Settings.DispatchMode = ELinkStreamDispatchMode::Batched;
+		Settings.MaxFrameSize = FMath::Max(Settings.MaxFrameSize, BulkSize);
+		Settings.SendHighWatermark = 0;
+		Settings.bNoDelay = true;
+
+		FSessionSink Sink;
+		TSharedRef<FLinkStreamAcceptor> Acceptor(new FLinkStreamAcceptor(nullptr, Settings, 0, nullptr, 0, Sink.MakeCallback()));
+		if (!Acceptor->Start(TEXT("127.0.0.1"), 0, 16))
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: could not start the acceptor."));
+			return;
+		}
+
+		TSharedRef<FTcpSocketWorker> Client(new FTcpSocketWorker(TEXT("127.0.0.1"), Acceptor->GetPort(), nullptr, 0, Settings));
+		Client->Start();
+
+		TSharedPtr<FTcpSocketWorker> Session;
+		const double ConnectDeadline = FPlatformTime::Seconds() + 5.0;
+		while (!Session.IsValid() && FPlatformTime::Seconds() < ConnectDeadline)
+		{
+			FPlatformProcess::Sleep(0.001f);
+			FScopeLock ScopeLock(&Sink.Lock);
+			if (Sink.Sessions.Num() > 0)
+			{
+				Session = Sink.Sessions[0];
+			}
+		}
+		if (!Session.IsValid())
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: %s could not connect."), Label);
+			Client->Stop();
+			Acceptor->Stop();
+			return;
+		}
+
+		// Bulk payloads are zeros; the probe is the only one-byte message.
+		for (int32 Index = 0; Index < BulkCount; Index++)
+		{
+			FLinkStreamBuffer Message = FLinkStreamBuffer::Acquire(BulkSize);
+			Message.GetArray().SetNumZeroed(BulkSize);
+			QueueOrWait(*Client, MoveTemp(Message), ELinkStreamPriority::Bulk);
+		}
+		FPlatformProcess::Sleep(0.01f);
+
+		const double Start = FPlatformTime::Seconds();
+		FLinkStreamBuffer Probe = FLinkStreamBuffer::Acquire(1);
+		Probe.GetArray().Add(1);
+		QueueOrWait(*Client, MoveTemp(Probe), ProbePriority);
+
+		int32 BulkAhead = 0;
+		double Latency = -1.0;
+		const double Deadline = Start + 30.0;
+		while (Latency < 0.0 && FPlatformTime::Seconds() < Deadline)
+		{
+			FLinkStreamBuffer Message;
+			if (!Session->TryReadFromInbox(Message))
+			{
+				FPlatformProcess::YieldThread();
+				continue;
+			}
+			if (Message.Num() == 1)
+			{
+				Latency = (FPlatformTime::Seconds() - Start) * 1000.0;
+			}
+			else
+			{
+				BulkAhead++;
+			}
+		}
+
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: probe on %-12s %8.2f ms after it was queued, behind %d of %d bulk messages of %d bytes"),
+			Label, Latency, BulkAhead, BulkCount, BulkSize);
+
+		Client->Stop();
+		Acceptor->Stop();
+		Sink.StopAll();
+	}
+
+	static void Priority(const TArray<FString>& Args)
+	{
+		const int32 BulkCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000;
+		const int32 BulkSize = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 64 * 1024;
+
+		MeasurePriority(TEXT("Bulk lane"), ELinkStreamPriority::Bulk, BulkCount, BulkSize);
+		MeasurePriority(TEXT("Control lane"), ELinkStreamPriority::Control, BulkCount, BulkSize);
+	}
+
+	static FAutoConsoleCommand PriorityCommand(
+		TEXT("LinkStream.Bench.Priority"),
+		TEXT("Measures how long a small message takes to overtake a bulk backlog on its lane, compared with queuing it behind the backlog. Args: [BulkCount=1000] [BulkSize=65536]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Priority));
+
+	/**
+	 * Starts NumProducers threads that each call Push(PerProducer) at once, drains on the calling thread with Pop,
+	 * which returns how many messages it took, and returns messages per second.
+	 */
+	template<typename PushType, typename PopType>
+	static double RunContention(int32 NumProducers, int32 PerProducer, PushType Push, PopType Pop)
+	{
+		std::atomic<int32> Ready{ 0 };
+		std::atomic<bool> bGo{ false };
+		TArray<TFuture<void>> Producers;
+		for (int32 Index = 0; Index < NumProducers; Index++)
+		{
+			Producers.Add(Async(EAsyncExecution::Thread, [&Ready, &bGo, &Push, PerProducer]() {
+				Ready++;
+				while (!bGo)
+				{
+					FPlatformProcess::YieldThread();
+				}
+				Push(PerProducer);
+			}));
+		}
+		while (Ready < NumProducers)
+		{
+			FPlatformProcess::YieldThread();
+		}
+
+		const double Start = FPlatformTime::Seconds();
+		bGo = true;
+		const int64 Expected = (int64)NumProducers * PerProducer;
+		int64 Received = 0;
+		while (Received < Expected)
+		{
+			const int32 Taken = Pop();
+			if (Taken == 0)
+			{
+				FPlatformProcess::YieldThread();
+			}
+			Received += Taken;
+		}
+		const double Elapsed = FPlatformTime::Seconds() - Start;
+
+		for (TFuture<void>& Producer : Producers)
+		{
+			Producer.Wait();
+		}
+		return Expected / FMath::Max(Elapsed, 1e-9);
+	}
+
+	static void Contention(const TArray<FString>& Args)
+	{
+		const int32 MaxProducers = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16;
+		const int32 PerProducer = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 200000;
+		const int32 BatchSize = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 16;
+		constexpr int32 Capacity = 4096;
+		constexpr int32 MaxPerPop = 256;
+
+		TArray<FLinkStreamOutgoingMessage> Drained;
+		Drained.Reserve(MaxPerPop);
+
+		for (int32 NumProducers = 1; NumProducers <= MaxProducers; NumProducers *= 2)
+		{
+			TLinkStreamMpscQueue<FLinkStreamOutgoingMessage> Bounded;
+			Bounded.Init(Capacity);
+			const double Single = RunContention(NumProducers, PerProducer,
+				[&Bounded](int32 Count) {
+					for (int32 Index = 0; Index < Count; Index++)
+					{
+						FLinkStreamOutgoingMessage Message;
+						Message.HeaderSize = Index;
+						while (!Bounded.Enqueue(MoveTemp(Message)))
+						{
+							FPlatformProcess::YieldThread();
+						}
+					}
+				},
+				[&Bounded, &Drained]() { Drained.Reset(); return Bounded.DequeueBatch(Drained, MaxPerPop); });
+
+			TLinkStreamMpscQueue<FLinkStreamOutgoingMessage> Batched;
+			Batched.Init(Capacity);
+			const double Batch = RunContention(NumProducers, PerProducer,
+				[&Batched, BatchSize](int32 Count) {
+					TArray<FLinkStreamOutgoingMessage> Messages;
+					for (int32 Index = 0; Index < Count; Index += BatchSize)
+					{
+						Messages.SetNum(FMath::Min(BatchSize, Count - Index));
+						while (!Batched.EnqueueBatch(Messages.GetData(), Messages.Num()))
+						{
+							FPlatformProcess::YieldThread();
+						}
+					}
+				},
+				[&Batched, &Drained]() { Drained.Reset(); return Batched.DequeueBatch(Drained, MaxPerPop); });
+
+			// The engine's unbounded queue, which allocates a node per message.
+			TQueue<FLinkStreamOutgoingMessage, EQueueMode::Mpsc> Unbounded;
+			const double Baseline = RunContention(NumProducers, PerProducer,
+				[&Unbounded](int32 Count) {
+					for (int32 Index = 0; Index < Count; Index++)
+					{
+						FLinkStreamOutgoingMessage Message;
+						Message.HeaderSize = Index;
+						Unbounded.Enqueue(MoveTemp(Message));
+					}
+				},
+				[&Unbounded]() {
+					int32 Taken = 0;
+					FLinkStreamOutgoingMessage Message;
+					while (Taken < MaxPerPop && Unbounded.Dequeue(Message))
+					{
+						Taken++;
+					}
+					return Taken;
+				});
+
+			UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %2d producers: bounded MPSC %7.2f M msg/s, batches of %d %7.2f M msg/s, TQueue Mpsc %7.2f M msg/s"),
+				NumProducers, Single / 1e6, BatchSize, Batch / 1e6, Baseline / 1e6);
+		}
+	}
+
+	static FAutoConsoleCommand ContentionCommand(
+		TEXT("LinkStream.Bench.Contention"),
+		TEXT("Measures outbox throughput with 1 to MaxProducers threads queuing at once, single and batched, against the engine's TQueue. Args: [MaxProducers=16] [MessagesPerProducer=200000] [BatchSize=16]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Contention));
+
+	static FAutoConsoleCommand AcceptCommand(
+		TEXT("LinkStream.Bench.Accept"),
+		TEXT("Measures how many loopback connections per second the reactor-based listener accepts. Args: [Count=200]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Accept));
+
+	static FAutoConsoleCommand MessagesCommand(
+		TEXT("LinkStream.Bench.Messages"),
+		TEXT("Measures messages per second received by listener sessions from reactor clients on loopback. Args: [Clients=8] [MessagesPerClient=10000] [PayloadSize=64]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Messages));
+
+	/**
+	 * Loopback relay that impairs the link between one client and 127.0.0.1:TargetPort in both directions: every
+	 * datagram, or every chunk read from a stream, is held back LatencyMs plus up to JitterMs and lost with
+	 * probability LossPercent.
+	 *
+	 * Datagrams are really dropped. A stream cannot lose bytes in user space, so a lost chunk is modelled as TCP
+	 * recovers it at best, by a fast retransmit one round trip later, and everything read after it waits behind it.
+	 * Real TCP does no better, and much worse when the loss hits the tail of a burst and only the retransmission
+	 * timer can recover it.
+	 */
+	class FLossyRelay : public FRunnable
+	{
+	public:
+		FLossyRelay(bool bInDatagram, float InLossPercent, float InLatencyMs, float InJitterMs)
+			: bDatagram(bInDatagram)
+			, LossPercent(InLossPercent)
+			, LatencyMs(InLatencyMs)
+			, JitterMs(InJitterMs)
+			, Random((int32)FPlatformTime::Cycles())
+		{
+			ToTarget.To = &Back;
+			ToClient.To = bDatagram ? &Front : &Client;
+		}
+
+		virtual ~FLossyRelay()
+		{
+			bRun = false;
+			if (Thread)
+			{
+				Thread->WaitForCompletion();
+				delete Thread;
+			}
+		}
+
+		bool Start(int32 InTargetPort)
+		{
+			TargetPort = InTargetPort;
+			if (!Poller.Init())
+			{
+				return false;
+			}
+
+			if (bDatagram)
+			{
+				if (!Front.CreateDatagram() || !Front.Bind(TEXT("127.0.0.1"), 0) || !Back.CreateDatagram() || !Back.Connect(TEXT("127.0.0.1"), TargetPort))
+				{
+					return false;
+				}
+				Front.SetNonBlocking(true);
+				Back.SetNonBlocking(true);
+				Poller.Add(Front.GetNative(), &Front, false);
+				Poller.Add(Back.GetNative(), &Back, false);
+			}
+			else
+			{
+				if (!Front.Create() || !Front.Listen(TEXT("127.0.0.1"), 0, 1))
+				{
+					return false;
+				}
+				Front.SetNonBlocking(true);
+				Poller.Add(Front.GetNative(), &Front, false);
+			}
+
+			bRun = true;
+			Thread = FRunnableThread::Create(this, TEXT("LinkStreamLossyRelay"), 128 * 1024, TPri_Normal);
+			return Thread != nullptr;
+		}
+
+		int32 GetPort() const { return Front.GetLocalPort(); }
+
+		int64 GetLost() const { return Lost.load(); }
+
+		virtual uint32 Run() override
+		{
+			TArray<FLinkStreamPollEvent> Events;
+			while (bRun)
+			{
+				const double NextDue = FMath::Min(ToTarget.GetNextDue(), ToClient.GetNextDue());
+				const double Wait = NextDue == MAX_dbl ? 0.05 : FMath::Clamp(NextDue - FPlatformTime::Seconds(), 0.0, 0.05);
+				Poller.Wait(Events, FMath::CeilToInt(Wait * 1000.0));
+
+				for (const FLinkStreamPollEvent& Event : Events)
+				{
+					if (!bDatagram && Event.UserData == &Front)
+					{
+						AcceptClient();
+					}
+					else if (Event.UserData == &Front || Event.UserData == &Client)
+					{
+						Receive(*(FLinkStreamSocket*)Event.UserData, ToTarget);
+					}
+					else
+					{
+						Receive(Back, ToClient);
+					}
+				}
+
+				const double Now = FPlatformTime::Seconds();
+				Deliver(ToTarget, Now);
+				Deliver(ToClient, Now);
+			}
+			return 0;
+		}
+
+	private:
+		struct FDelayed
+		{
+			double DueAt = 0.0;
+			TArray<uint8> Data;
+		};
+
+		struct FDirection
+		{
+			FLinkStreamSocket* To = nullptr;
+			TArray<FDelayed> Queue;
+			double LastDueAt = 0.0;
+
+			double GetNextDue() const
+			{
+				double Next = MAX_dbl;
+				for (const FDelayed& Delayed : Queue)
+				{
+					Next = FMath::Min(Next, Delayed.DueAt);
+				}
+				return Next;
+			}
+		};
+
+		void AcceptClient()
+		{
+			if (Client.IsValid() || !Front.Accept(Client))
+			{
+				return;
+			}
+			if (!Back.Create() || !Back.Connect(TEXT("127.0.0.1"), TargetPort))
+			{
+				Client.Close();
+				return;
+			}
+			Client.SetNoDelay(true);
+			Back.SetNoDelay(true);
+			Client.SetNonBlocking(true);
+			Back.SetNonBlocking(true);
+			Poller.Add(Client.GetNative(), &Client, false);
+			Poller.Add(Back.GetNative(), &Back, false);
+		}
+
+		void Receive(FLinkStreamSocket& From, FDirection& Direction)
+		{
+			uint8 Buffer[16384];
+			for (;;)
+			{
+				int32 BytesRead = 0;
+				ELinkStreamSocketResult Result;
+				if (&From == &Front && bDatagram)
+				{
+					Result = Front.RecvFrom(Buffer, sizeof(Buffer), BytesRead, ClientAddress);
+				}
+				else
+				{
+					Result = From.Recv(Buffer, sizeof(Buffer), BytesRead);
+				}
+
+				if (Result == ELinkStreamSocketResult::WouldBlock || (bDatagram && Result != ELinkStreamSocketResult::Ok))
+				{
+					return;
+				}
+				if (Result != ELinkStreamSocketResult::Ok)
+				{
+					// Either end closing ends the relay's part; the other end notices when its socket closes too.
+					Poller.Remove(Client.GetNative());
+					Poller.Remove(Back.GetNative());
+					Client.Close();
+					Back.Close();
+					return;
+				}
+				Schedule(Direction, Buffer, BytesRead);
+			}
+		}
+
+		void Schedule(FDirection& Direction, const uint8* Data, int32 Size)
+		{
+			double DueAt = FPlatformTime::Seconds() + (LatencyMs + JitterMs * Random.FRand()) / 1000.0;
+			if (Random.FRand() * 100.f < LossPercent)
+			{
+				Lost++;
+				if (bDatagram)
+				{
+					return;
+				}
+				DueAt += 2.0 * LatencyMs / 1000.0;
+			}
+
+			// A stream is delivered in order, so nothing overtakes a chunk waiting for its retransmission.
+			if (!bDatagram)
+			{
+				DueAt = FMath::Max(DueAt, Direction.LastDueAt);
+				Direction.LastDueAt = DueAt;
+			}
+
+			FDelayed& Delayed = Direction.Queue.AddDefaulted_GetRef();
+			Delayed.DueAt = DueAt;
+			Delayed.Data.Append(Data, Size);
+		}
+
+		void Deliver(FDirection& Direction, double Now)
+		{
+			for (int32 Index = 0; Index < Direction.Queue.Num(); )
+			{
+				FDelayed& Delayed = Direction.Queue[Index];
+				if (Delayed.DueAt > Now)
+				{
+					if (!bDatagram)
+					{
+						return;
+					}
+					Index++;
+					continue;
+				}
+
+				if (bDatagram)
+				{
+					if (Direction.To == &Front)
+					{
+						Front.SendTo(Delayed.Data.GetData(), Delayed.Data.Num(), ClientAddress);
+					}
+					else
+					{
+						int32 BytesSent = 0;
+						Back.Send(Delayed.Data.GetData(), Delayed.Data.Num(), BytesSent);
+					}
+				}
+				else
+				{
+					int32 BytesSent = 0;
+					Direction.To->Send(Delayed.Data.GetData(), Delayed.Data.Num(), BytesSent);
+					if (BytesSent < Delayed.Data.Num())
+					{
+						Delayed.Data.RemoveAt(0, BytesSent, false);
+						return;
+					}
+				}
+				Direction.Queue.RemoveAt(Index, 1, false);
+			}
+		}
+
+		bool bDatagram;
+		float LossPercent;
+		float LatencyMs;
+		float JitterMs;
+		FRandomStream Random;
+		int32 TargetPort = 0;
+
+		/** The port the client talks to: a datagram socket, or a listener. */
+		FLinkStreamSocket Front;
+		FLinkStreamSocket Client;
+		FLinkStreamSocket Back;
+		FLinkStreamSocketAddress ClientAddress;
+		FLinkStreamPoller Poller;
+
+		FDirection ToTarget;
+		FDirection ToClient;
+		std::atomic<int64> Lost{ 0 };
+
+		FRunnableThread* Thread = nullptr;
+		FThreadSafeBool bRun = false;
+	};
+
+	/** Payload of the lossy benchmark: the time it was queued, padded to PayloadSize. */
+	static double ReadSentAt(const FLinkStreamBuffer& Message)
+	{
+		double SentAt = 0.0;
+		if (Message.Num() >= (int32)sizeof(SentAt))
+		{
+			FMemory::Memcpy(&SentAt, Message.GetData(), sizeof(SentAt));
+		}
+		return SentAt;
+	}
+
+	/** The passive end of the UDP runs: a responder session on a bound socket, timing every message as it is raised. */
+	class FUdpLatencySink : public FRunnable
+	{
+	public:
+		FUdpLatencySink()
+			: Session(false, 64 * 1024,
+				[this](const uint8* Data, int32 Size) { Socket.SendTo(Data, Size, Peer); },
+				[this](FLinkStreamBuffer&& Message) {
+					Samples.Add((FPlatformTime::Seconds() - ReadSentAt(Message)) * 1000.0);
+					Received++;
+				})
+		{
+		}
+
+		virtual ~FUdpLatencySink()
+		{
+			StopAndWait();
+		}
+
+		bool Start()
+		{
+			if (!Socket.CreateDatagram() || !Socket.Bind(TEXT("127.0.0.1"), 0) || !Poller.Init())
+			{
+				return false;
+			}
+			Socket.SetNonBlocking(true);
+			Poller.Add(Socket.GetNative(), &Socket, false);
+			Session.Start(FPlatformTime::Seconds());
+
+			bRun = true;
+			Thread = FRunnableThread::Create(this, TEXT("LinkStreamUdpSink"), 128 * 1024, TPri_Normal);
+			return Thread != nullptr;
+		}
+
+		int32 GetPort() const { return Socket.GetLocalPort(); }
+
+		int32 GetReceived() const { return Received.load(); }
+
+		/** One-way latencies in milliseconds. Only valid once stopped. */
+		TArray<double>& StopAndGetSamples()
+		{
+			StopAndWait();
+			return Samples;
+		}
+
+		virtual uint32 Run() override
+		{
+			TArray<FLinkStreamPollEvent> Events;
+			uint8 Datagram[2048];
+			while (bRun)
+			{
+				const double NextTimer = Session.GetNextTimer();
+				const double Wait = NextTimer == MAX_dbl ? 0.01 : FMath::Clamp(NextTimer - FPlatformTime::Seconds(), 0.0, 0.01);
+				Poller.Wait(Events, FMath::CeilToInt(Wait * 1000.0));
+
+				int32 BytesRead = 0;
+				FLinkStreamSocketAddress From;
+				while (Socket.RecvFrom(Datagram, sizeof(Datagram), BytesRead, From) == ELinkStreamSocketResult::Ok)
+				{
+					Peer = From;
+					Session.ReceiveDatagram(Datagram, BytesRead, FPlatformTime::Seconds());
+				}
+				Session.Service(FPlatformTime::Seconds());
+			}
+			return 0;
+		}
+
+	private:
+		void StopAndWait()
+		{
+			bRun = false;
+			if (Thread)
+			{
+				Thread->WaitForCompletion();
+				delete Thread;
+				Thread = nullptr;
+			}
+		}
+
+		FLinkStreamSocket Socket;
+		FLinkStreamPoller Poller;
+		FLinkStreamSocketAddress Peer;
+		FLinkStreamUdpSession Session;
+		TArray<double> Samples;
+		std::atomic<int32> Received{ 0 };
+
+		FRunnableThread* Thread = nullptr;
+		FThreadSafeBool bRun = false;
+	};
+
+	struct FLossyArgs
+	{
+		float LossPercent = 2.f;
+		float LatencyMs = 20.f;
+		float JitterMs = 0.f;
+		int32 Count = 2000;
+		int32 IntervalMs = 1;
+		int32 PayloadSize = 64;
+	};
+
+	/**
+	 * Streams timestamped messages through a lossy relay, over TCP or over UDP with the given delivery mode, from
+	 * a sender thread at one per IntervalMs, and logs the one-way latency distribution of those that arrived.
+	 */
+	static void MeasureLossy(const TCHAR* Label, bool bUdp, ELinkStreamDelivery Delivery, const FLossyArgs& Args)
+	{
+		FTcpSocketWorkerSettings Settings;
+		Settings.Backend = ELinkStreamBackend::Reactor;
+		Settings.Framing = ELinkStreamFraming::UInt32;
+		Settings.DispatchMode = ELinkStreamDispatchMode::Batched;
+		Settings.bNoDelay = true;
+
+		FSessionSink TcpSink;
+		TSharedPtr<FLinkStreamAcceptor> Acceptor;
+		TUniquePtr<FUdpLatencySink> UdpSink;
+		int32 TargetPort = 0;
+		if (bUdp)
+		{
+			UdpSink = MakeUnique<FUdpLatencySink>();
+			TargetPort = UdpSink->Start() ? UdpSink->GetPort() : 0;
+		}
+		else
+		{
+			Acceptor = MakeShareable(new FLinkStreamAcceptor(nullptr, Settings, 0, nullptr, 0, TcpSink.MakeCallback()));
+			TargetPort = Acceptor->Start(TEXT("127.0.0.1"), 0, 16) ? Acceptor->GetPort() : 0;
+		}
+
+		FLossyRelay Relay(bUdp, Args.LossPercent, Args.LatencyMs, Args.JitterMs);
+		if (TargetPort == 0 || !Relay.Start(TargetPort))
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: %s could not start its peer or relay."), Label);
+			if (Acceptor.IsValid())
+			{
+				Acceptor->Stop();
+			}
+			return;
+		}
+
+		TSharedRef<FTcpSocketWorker> Client(new FTcpSocketWorker(bUdp ? TEXT("udp://127.0.0.1") : TEXT("127.0.0.1"), Relay.GetPort(), nullptr, 0, Settings));
+		Client->Start();
+
+		TSharedPtr<FTcpSocketWorker> Session;
+		const double ConnectDeadline = FPlatformTime::Seconds() + 5.0;
+		while (FPlatformTime::Seconds() < ConnectDeadline && !(Client->isConnected() && (bUdp || Session.IsValid())))
+		{
+			FPlatformProcess::Sleep(0.001f);
+			FScopeLock ScopeLock(&TcpSink.Lock);
+			if (TcpSink.Sessions.Num() > 0)
+			{
+				Session = TcpSink.Sessions[0];
+			}
+		}
+		if (!Client->isConnected() || (!bUdp && !Session.IsValid()))
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: %s could not connect."), Label);
+			Client->Stop();
+			if (Acceptor.IsValid())
+			{
+				Acceptor->Stop();
+			}
+			TcpSink.StopAll();
+			return;
+		}
+
+		// The sender has a thread of its own, so that the receiving side below never waits on its sleeps.
+		TFuture<void> Sender = Async(EAsyncExecution::Thread, [&Client, &Args, Delivery]() {
+			for (int32 Index = 0; Index < Args.Count; Index++)
+			{
+				FLinkStreamBuffer Message = FLinkStreamBuffer::Acquire(Args.PayloadSize);
+				Message.GetArray().SetNumZeroed(FMath::Max(Args.PayloadSize, (int32)sizeof(double)));
+				const double SentAt = FPlatformTime::Seconds();
+				FMemory::Memcpy(Message.GetData(), &SentAt, sizeof(SentAt));
+				while (!Client->AddToOutbox(MoveTemp(Message), ELinkStreamPriority::Interactive, FLinkStreamEnvelope(), Delivery))
+				{
+					FPlatformProcess::YieldThread();
+				}
+				FPlatformProcess::Sleep(Args.IntervalMs / 1000.f);
+			}
+		});
+
+		// Done once everything arrived, or once nothing has for a while after the last send, as with unreliable losses.
+		TArray<double> TcpSamples;
+		int32 Received = 0;
+		double LastProgress = FPlatformTime::Seconds();
+		const double Patience = FMath::Max(1.0, 20.0 * Args.LatencyMs / 1000.0);
+		while (Received < Args.Count && (!Sender.IsReady() || FPlatformTime::Seconds() - LastProgress < Patience))
+		{
+			int32 Arrived = Received;
+			if (bUdp)
+			{
+				Arrived = UdpSink->GetReceived();
+			}
+			else
+			{
+				FLinkStreamBuffer Message;
+				while (Session->TryReadFromInbox(Message))
+				{
+					TcpSamples.Add((FPlatformTime::Seconds() - ReadSentAt(Message)) * 1000.0);
+					Arrived++;
+				}
+			}
+
+			if (Arrived != Received)
+			{
+				Received = Arrived;
+				LastProgress = FPlatformTime::Seconds();
+			}
+			else
+			{
+				FPlatformProcess::YieldThread();
+			}
+		}
+		Sender.Wait();
+
+		TArray<double>& Samples = bUdp ? UdpSink->StopAndGetSamples() : TcpSamples;
+		Samples.Sort();
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %-28s delivered %5d of %d  p50 %7.1f ms  p99 %7.1f ms  max %7.1f ms  (relay lost %lld)"),
+			Label, Samples.Num(), Args.Count, Percentile(Samples, 0.50), Percentile(Samples, 0.99), Samples.Num() > 0 ? Samples.Last() : 0.0, Relay.GetLost());
+
+		Client->Stop();
+		if (Acceptor.IsValid())
+		{
+			Acceptor->Stop();
+		}
+		TcpSink.StopAll();
+	}
+
+	static void Lossy(const TArray<FString>& Args)
+	{
+		FLossyArgs LossyArgs;
+		LossyArgs.LossPercent = Args.Num() > 0 ? FCString::Atof(*Args[0]) : LossyArgs.LossPercent;
+		LossyArgs.LatencyMs = Args.Num() > 1 ? FCString::Atof(*Args[1]) : LossyArgs.LatencyMs;
+		LossyArgs.Count = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : LossyArgs.Count;
+		LossyArgs.IntervalMs = Args.Num() > 3 ? FCString::Atoi(*Args[3]) : LossyArgs.IntervalMs;
+		LossyArgs.JitterMs = Args.Num() > 4 ? FCString::Atof(*Args[4]) : LossyArgs.JitterMs;
+
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %.1f%% loss, %.0f ms (+%.0f ms jitter) each way, one %d-byte message every %d ms"),
+			LossyArgs.LossPercent, LossyArgs.LatencyMs, LossyArgs.JitterMs, LossyArgs.PayloadSize, LossyArgs.IntervalMs);
+
+		MeasureLossy(TEXT("TCP"), false, ELinkStreamDelivery::ReliableOrdered, LossyArgs);
+		MeasureLossy(TEXT("UDP, reliable ordered"), true, ELinkStreamDelivery::ReliableOrdered, LossyArgs);
+		MeasureLossy(TEXT("UDP, reliable unordered"), true, ELinkStreamDelivery::ReliableUnordered, LossyArgs);
+		MeasureLossy(TEXT("UDP, unreliable"), true, ELinkStreamDelivery::Unreliable, LossyArgs);
+	}
+
+	static FAutoConsoleCommand LossyCommand(
+		TEXT("LinkStream.Bench.Lossy"),
+		TEXT("Measures one-way latency (p50/p99) of a message stream across a relay that drops and delays packets, over TCP and over UDP in each delivery mode. Args: [LossPercent=2] [LatencyMs=20] [Count=2000] [IntervalMs=1] [JitterMs=0]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Lossy));
+
+	/**
+	 * Queues Rounds messages of PayloadSize bytes on each of NumRecipients workers, first as one copy per recipient as
+	 * repeated SendData calls would, then as one shared buffer, and logs the time and payload memory of each.
+	 * The workers are never started and flush per frame, so only the fan-out itself is measured.
+	 */
+	static void MeasureBroadcast(int32 NumRecipients, int32 PayloadSize, int32 Rounds)
+	{
+		FTcpSocketWorkerSettings Settings;
+		Settings.Framing = ELinkStreamFraming::UInt32;
+		Settings.FlushMode = ELinkStreamFlushMode::PerFrame;
+		Settings.OutboxCapacity = Rounds;
+		Settings.SendHighWatermark = 0;
+
+		TArray<uint8> Source;
+		Source.SetNumZeroed(PayloadSize);
+
+		double CopyTime = 0.0;
+		double SharedTime = 0.0;
+		for (int32 Pass = 0; Pass < 2; Pass++)
+		{
+			const bool bShared = Pass == 1;
+			TArray<TSharedRef<FTcpSocketWorker>> Workers;
+			for (int32 Index = 0; Index < NumRecipients; Index++)
+			{
+				Workers.Add(MakeShareable(new FTcpSocketWorker(TEXT("127.0.0.1"), 0, nullptr, Index, Settings)));
+			}
+
+			const double Start = FPlatformTime::Seconds();
+			for (int32 Round = 0; Round < Rounds; Round++)
+			{
+				if (bShared)
+				{
+					FLinkStreamBuffer Payload = FLinkStreamBuffer::Acquire(PayloadSize);
+					Payload.GetArray().Append(Source);
+					const FLinkStreamSharedBuffer Shared = FLinkStreamBuffer::Share(MoveTemp(Payload));
+					for (const TSharedRef<FTcpSocketWorker>& Worker : Workers)
+					{
+						Worker->AddSharedToOutbox(Shared);
+					}
+				}
+				else
+				{
+					for (const TSharedRef<FTcpSocketWorker>& Worker : Workers)
+					{
+						FLinkStreamBuffer Payload = FLinkStreamBuffer::Acquire(PayloadSize);
+						Payload.GetArray().Append(Source);
+						Worker->AddToOutbox(MoveTemp(Payload));
+					}
+				}
+			}
+			(bShared ? SharedTime : CopyTime) = FPlatformTime::Seconds() - Start;
+		}
+
+		const int64 CopyBytes = (int64)NumRecipients * Rounds * PayloadSize;
+		const int64 SharedBytes = (int64)Rounds * PayloadSize;
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %4d recipients: per-recipient copies %8.1f us and %7.1f MB per broadcast, shared %8.1f us and %7.3f MB  (%.1fx faster)"),
+			NumRecipients, CopyTime * 1e6 / Rounds, CopyBytes / (1024.0 * 1024.0) / Rounds, SharedTime * 1e6 / Rounds, SharedBytes / (1024.0 * 1024.0) / Rounds,
+			CopyTime / FMath::Max(SharedTime, 1e-9));
+	}
+
+	static void Broadcast(const TArray<FString>& Args)
+	{
+		const int32 PayloadSize = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16 * 1024;
+		const int32 Rounds = Args.Num() > 1 ? FMath::Max(2, FCString::Atoi(*Args[1])) : 4;
+
+		for (int32 NumRecipients = 10; NumRecipients <= 1000; NumRecipients *= 10)
+		{
+			MeasureBroadcast(NumRecipients, PayloadSize, Rounds);
+		}
+	}
+
+	static FAutoConsoleCommand BroadcastCommand(
+		TEXT("LinkStream.Bench.Broadcast"),
+		TEXT("Measures the cost of queuing one message to 10, 100 and 1000 connections, copied per recipient and shared. Args: [PayloadSize=16384] [Rounds=4]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Broadcast));
+
+	/** The message a Blueprint graph builds for State out of Conv and Append Bytes nodes: strings go as an int length and the bytes. */
+	static TArray<uint8> EncodeWithNodes(const FLinkStreamBenchState& State)
+	{
+		TArray<uint8> Message;
+		for (int32 Value : { State.PlayerId, State.Health, State.Mana, State.Score, State.Level, State.Experience, State.Gold, State.TeamId })
+		{
+			Message = ALinkStreamConnection::Concat_BytesBytes(Message, ALinkStreamConnection::Conv_IntToBytes(Value));
+		}
+		for (float Value : { State.PositionX, State.PositionY, State.PositionZ, State.Yaw, State.Pitch, State.Speed })
+		{
+			Message = ALinkStreamConnection::Concat_BytesBytes(Message, ALinkStreamConnection::Conv_FloatToBytes(Value));
+		}
+		for (uint8 Value : { State.State, State.Weapon, State.Ammo, State.Flags })
+		{
+			Message = ALinkStreamConnection::Concat_BytesBytes(Message, ALinkStreamConnection::Conv_ByteToBytes(Value));
+		}
+		for (const FString* Value : { &State.Name, &State.Guild })
+		{
+			Message = ALinkStreamConnection::Concat_BytesBytes(Message, ALinkStreamConnection::Conv_IntToBytes(FLinkStreamWriter::GetUTF8Length(*Value)));
+			Message = ALinkStreamConnection::Concat_BytesBytes(Message, ALinkStreamConnection::Conv_StringToBytes(*Value));
+		}
+		return Message;
+	}
+
+	/** The matching chain of Message_Read nodes, which advance a read offset through the message. */
+	static void DecodeWithNodes(TArray<uint8>& Message, FLinkStreamBenchState& OutState)
+	{
+		int32 ReadOffset = 0;
+		for (int32* Value : { &OutState.PlayerId, &OutState.Health, &OutState.Mana, &OutState.Score, &OutState.Level, &OutState.Experience, &OutState.Gold, &OutState.TeamId })
+		{
+			*Value = ALinkStreamConnection::Message_ReadInt(Message, ReadOffset);
+		}
+		for (float* Value : { &OutState.PositionX, &OutState.PositionY, &OutState.PositionZ, &OutState.Yaw, &OutState.Pitch, &OutState.Speed })
+		{
+			*Value = ALinkStreamConnection::Message_ReadFloat(Message, ReadOffset);
+		}
+		for (uint8* Value : { &OutState.State, &OutState.Weapon, &OutState.Ammo, &OutState.Flags })
+		{
+			*Value = ALinkStreamConnection::Message_ReadByte(Message, ReadOffset);
+		}
+		for (FString* Value : { &OutState.Name, &OutState.Guild })
+		{
+			const int32 Length = ALinkStreamConnection::Message_ReadInt(Message, ReadOffset);
+			*Value = ALinkStreamConnection::Message_ReadString(Message, ReadOffset, Length);
+		}
+	}
+
+	static bool StatesMatch(const FLinkStreamBenchState& A, const FLinkStreamBenchState& B)
+	{
+		return A.PlayerId == B.PlayerId && A.Health == B.Health && A.Mana == B.Mana && A.Score == B.Score && A.Level == B.Level
+			&& A.Experience == B.Experience && A.Gold == B.Gold && A.TeamId == B.TeamId && A.PositionX == B.PositionX
+			&& A.PositionY == B.PositionY && A.PositionZ == B.PositionZ && A.Yaw == B.Yaw && A.Pitch == B.Pitch && A.Speed == B.Speed
+			&& A.State == B.State && A.Weapon == B.Weapon && A.Ammo == B.Ammo && A.Flags == B.Flags && A.Name == B.Name && A.Guild == B.Guild;
+	}
+
+	/**
+	 * Encodes and decodes a 20-field struct Iterations times, once through the same functions the Conv and Message_Read
+	 * nodes call and once through FLinkStreamStructCodec. Both run as native calls, so the node chain is measured without
+	 * the Blueprint VM's own cost per node; in a graph the gap is wider.
+	 */
+	static void StructCodec(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+
+		FLinkStreamBenchState Source;
+		Source.PlayerId = 4711;
+		Source.Health = 87;
+		Source.Mana = 240;
+		Source.Score = 125000;
+		Source.Level = 42;
+		Source.Experience = 9876543;
+		Source.Gold = 31337;
+		Source.TeamId = 2;
+		Source.PositionX = 1024.5f;
+		Source.PositionY = -377.25f;
+		Source.PositionZ = 88.f;
+		Source.Yaw = 271.5f;
+		Source.Pitch = -12.75f;
+		Source.Speed = 600.f;
+		Source.State = 3;
+		Source.Weapon = 7;
+		Source.Ammo = 30;
+		Source.Flags = 0x5A;
+		Source.Name = TEXT("Validator-07");
+		Source.Guild = TEXT("Bifrost");
+
+		FLinkStreamBenchState Decoded;
+		bool bMatches = true;
+
+		int32 NodeBytes = 0;
+		double Start = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			TArray<uint8> Message = EncodeWithNodes(Source);
+			NodeBytes = Message.Num();
+			DecodeWithNodes(Message, Decoded);
+		}
+		const double NodeTime = FPlatformTime::Seconds() - Start;
+		bMatches &= StatesMatch(Source, Decoded);
+
+		Decoded = FLinkStreamBenchState();
+		int32 CodecBytes = 0;
+		Start = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			FLinkStreamWriter Writer(128);
+			FLinkStreamStructCodec::Serialize(Source, Writer);
+			CodecBytes = Writer.Num();
+			FLinkStreamReader Reader(Writer.Release());
+			FLinkStreamStructCodec::Deserialize(Reader, Decoded);
+		}
+		const double CodecTime = FPlatformTime::Seconds() - Start;
+		bMatches &= StatesMatch(Source, Decoded);
+
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: 20-field struct, encode + decode: Conv/Read node chain %7.0f ns and %d bytes, struct codec %6.0f ns and %d bytes  (%.1fx faster)%s"),
+			NodeTime * 1e9 / Iterations, NodeBytes, CodecTime * 1e9 / Iterations, CodecBytes, NodeTime / FMath::Max(CodecTime, 1e-9),
+			bMatches ? TEXT("") : TEXT("  DECODED VALUES DIFFER"));
+	}
+
+	static FAutoConsoleCommand StructCodecCommand(
+		TEXT("LinkStream.Bench.StructCodec"),
+		TEXT("Measures encoding and decoding a 20-field struct with the Conv and Message_Read node functions against the compiled struct codec. Args: [Iterations=100000]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&StructCodec));
+
+	/**
+	 * Pushes MegabytesPerSize of 64 B, 1 KB and 64 KB messages through the frame layer's per-message work, once in
+	 * plaintext (fill the send buffer, copy it out of the receive ring) and once sealed and opened by two ciphers that
+	 * completed a handshake with each other. The socket is left out, so the difference is the cost encryption adds.
+	 */
+	static void Encryption(const TArray<FString>& Args)
+	{
+		const int64 BytesPerSize = (int64)(Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 256) * 1024 * 1024;
+
+		FLinkStreamCipher Sender(TEXT("bench"));
+		FLinkStreamCipher Receiver(TEXT("bench"));
+		uint8 SenderHandshake[FLinkStreamCipher::HandshakeSize];
+		uint8 ReceiverHandshake[FLinkStreamCipher::HandshakeSize];
+		if (!Sender.BeginHandshake(SenderHandshake) || !Receiver.BeginHandshake(ReceiverHandshake)
+			|| !Sender.CompleteHandshake(ReceiverHandshake, sizeof(ReceiverHandshake)) || !Receiver.CompleteHandshake(SenderHandshake, sizeof(SenderHandshake)))
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: the cipher handshake failed."));
+			return;
+		}
+
+		for (const int32 PayloadSize : { 64, 1024, 64 * 1024 })
+		{
+			const int32 Iterations = (int32)FMath::Max<int64>(1, BytesPerSize / PayloadSize);
+			const int32 FrameSize = FLinkStreamCipher::SequenceSize + 1 + PayloadSize + FLinkStreamCipher::TagSize;
+			TArray<uint8> Source;
+			Source.SetNumUninitialized(1 + PayloadSize);
+			for (int32 Index = 0; Index < Source.Num(); Index++)
+			{
+				Source[Index] = (uint8)(Index * 31 + 7);
+			}
+			TArray<uint8> SendFrame;
+			SendFrame.SetNumZeroed(FrameSize);
+			TArray<uint8> RecvFrame;
+			RecvFrame.SetNumZeroed(FrameSize);
+			uint8* Sequence = SendFrame.GetData();
+			uint8* Plain = Sequence + FLinkStreamCipher::SequenceSize;
+
+			double Start = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+			{
+				FMemory::Memcpy(Plain, Source.GetData(), Source.Num());
+				FMemory::Memcpy(RecvFrame.GetData(), SendFrame.GetData(), FrameSize);
+			}
+			const double PlainTime = FPlatformTime::Seconds() - Start;
+
+			bool bAuthentic = true;
+			Start = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+			{
+				FMemory::Memcpy(Plain, Source.GetData(), Source.Num());
+				Sender.Seal(Sequence, Plain, 1, Plain + 1, PayloadSize, Plain + Source.Num());
+				FMemory::Memcpy(RecvFrame.GetData(), SendFrame.GetData(), FrameSize);
+				bAuthentic &= Receiver.Open(RecvFrame.GetData(), FrameSize);
+			}
+			const double SealedTime = FPlatformTime::Seconds() - Start;
+			const bool bMatches = bAuthentic && FMemory::Memcmp(RecvFrame.GetData() + FLinkStreamCipher::SequenceSize, Source.GetData(), Source.Num()) == 0;
+
+			const double MegaBytes = (double)Iterations * PayloadSize / (1024.0 * 1024.0);
+			UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %6d B messages x %8d: plaintext %8.0f MB/s, AES-GCM %7.0f MB/s (%6.0f ns per message added, +%d bytes)%s"),
+				PayloadSize, Iterations, MegaBytes / FMath::Max(PlainTime, 1e-9), MegaBytes / FMath::Max(SealedTime, 1e-9),
+				(SealedTime - PlainTime) * 1e9 / Iterations, FLinkStreamCipher::Overhead, bMatches ? TEXT("") : TEXT("  DECRYPTED BYTES DIFFER"));
+		}
+	}
+
+	static FAutoConsoleCommand EncryptionCommand(
+		TEXT("LinkStream.Bench.Encryption"),
+		TEXT("Measures the throughput of sealing and opening 64 B, 1 KB and 64 KB frames with AES-GCM against plaintext copies. Args: [MegabytesPerSize=256]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Encryption));
+
+	static FString ReadPem(BIO* Bio)
+	{
+		char* Data = nullptr;
+		const long Size = BIO_get_mem_data(Bio, &Data);
+		const FUTF8ToTCHAR Converted(Data, (int32)Size);
+		return FString(Converted.Length(), Converted.Get());
+	}
+
+	/** Makes a throwaway P-256 key and a certificate for it, self-signed for 127.0.0.1 and valid for a day, as PEM. */
+	static bool MakeSelfSignedCertificate(FString& OutCertificatePem, FString& OutPrivateKeyPem)
+	{
+		EVP_PKEY* Key = nullptr;
+		EVP_PKEY_CTX* KeyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+		const bool bKey = KeyContext && EVP_PKEY_keygen_init(KeyContext) == 1
+			&& EVP_PKEY_CTX_set_ec_paramgen_curve_nid(KeyContext, NID_X9_62_prime256v1) == 1
+			&& EVP_PKEY_keygen(KeyContext, &Key) == 1;
+		EVP_PKEY_CTX_free(KeyContext);
+		if (!bKey)
+		{
+			EVP_PKEY_free(Key);
+			return false;
+		}
+
+		X509* Certificate = X509_new();
+		X509_set_version(Certificate, 2);
+		ASN1_INTEGER_set(X509_get_serialNumber(Certificate), 1);
+		X509_gmtime_adj(X509_getm_notBefore(Certificate), -60);
+		X509_gmtime_adj(X509_getm_notAfter(Certificate), 24 * 60 * 60);
+		X509_set_pubkey(Certificate, Key);
+		X509_NAME* Name = X509_get_subject_name(Certificate);
+		X509_NAME_add_entry_by_txt(Name, "CN", MBSTRING_ASC, (const unsigned char*)"127.0.0.1", -1, -1, 0);
+		X509_set_issuer_name(Certificate, Name);
+
+		// Clients match an IP address against the subject alternative names only.
+		X509_EXTENSION* AltName = X509V3_EXT_conf_nid(nullptr, nullptr, NID_subject_alt_name, "IP:127.0.0.1");
+		const bool bSigned = AltName && X509_add_ext(Certificate, AltName, -1) == 1 && X509_sign(Certificate, Key, EVP_sha256()) > 0;
+		X509_EXTENSION_free(AltName);
+
+		if (bSigned)
+		{
+			BIO* CertificateBio = BIO_new(BIO_s_mem());
+			PEM_write_bio_X509(CertificateBio, Certificate);
+			OutCertificatePem = ReadPem(CertificateBio);
+			BIO_free(CertificateBio);
+
+			BIO* KeyBio = BIO_new(BIO_s_mem());
+			PEM_write_bio_PrivateKey(KeyBio, Key, nullptr, nullptr, 0, nullptr, nullptr);
+			OutPrivateKeyPem = ReadPem(KeyBio);
+			BIO_free(KeyBio);
+		}
+		X509_free(Certificate);
+		EVP_PKEY_free(Key);
+		return bSigned;
+	}
+
+	/**
+	 * Connects Handshakes clients one after the other to a TLS acceptor on loopback that presents a certificate made
+	 * for the run, each verifying it, and logs how long the handshakes took from link-up. The first half forget every
+	 * session first, so they run in full; the second half resume the one before, as a reconnect does. Samples are
+	 * split by what actually happened, since a ticket can arrive just after a session was forgotten.
+	 */
+	static void Tls(const TArray<FString>& Args)
+	{
+		const int32 Count = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 20;
+
+		FString CertificatePem;
+		FString PrivateKeyPem;
+		if (!MakeSelfSignedCertificate(CertificatePem, PrivateKeyPem))
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: could not make a self-signed certificate."));
+			return;
+		}
+
+		FString Error;
+		FTcpSocketWorkerSettings ServerSettings;
+		ServerSettings.Framing = ELinkStreamFraming::UInt32;
+		ServerSettings.bTls = true;
+		ServerSettings.TlsServerContext = FLinkStreamTlsContext::CreateServer(CertificatePem, PrivateKeyPem, Error);
+		if (!ServerSettings.TlsServerContext.IsValid())
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: the server certificate does not load: %s"), *Error);
+			return;
+		}
+
+		// Held here so the sessions it keeps survive from one client to the next, as they do across a connection's reconnects.
+		const TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> ClientContext = FLinkStreamTlsContext::FindOrCreateClient(true, CertificatePem, Error);
+		if (!ClientContext.IsValid())
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: the client context could not be created: %s"), *Error);
+			return;
+		}
+
+		FSessionSink Sink;
+		TSharedRef<FLinkStreamAcceptor> Acceptor(new FLinkStreamAcceptor(nullptr, ServerSettings, 0, nullptr, 0, Sink.MakeCallback()));
+		if (!Acceptor->Start(TEXT("127.0.0.1"), 0, 16))
+		{
+			UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: could not start the acceptor."));
+			return;
+		}
+
+		FTcpSocketWorkerSettings ClientSettings;
+		ClientSettings.Backend = ELinkStreamBackend::Reactor;
+		ClientSettings.Framing = ELinkStreamFraming::UInt32;
+		ClientSettings.bTls = true;
+		ClientSettings.TlsTrustedCertificates = CertificatePem;
+		const FString SessionKey = FString::Printf(TEXT("127.0.0.1:%d"), Acceptor->GetPort());
+
+		TArray<double> FullSamples;
+		TArray<double> ResumedSamples;
+		FLinkStreamTlsStats LastStats;
+		for (int32 Index = 0; Index < 2 * Count; Index++)
+		{
+			if (Index < Count)
+			{
+				ClientContext->ForgetSessions();
+			}
+
+			TSharedRef<FTcpSocketWorker> Client(new FTcpSocketWorker(TEXT("127.0.0.1"), Acceptor->GetPort(), nullptr, Index, ClientSettings));
+			Client->Start();
+			const double Deadline = FPlatformTime::Seconds() + 5.0;
+			FLinkStreamTlsStats Stats = Client->GetTlsStats();
+			while (!Stats.bEstablished && FPlatformTime::Seconds() < Deadline)
+			{
+				FPlatformProcess::YieldThread();
+				Stats = Client->GetTlsStats();
+			}
+
+			// Tickets follow the server's last handshake message, so the next client can only resume once one arrived.
+			while (Stats.bEstablished && !ClientContext->HasSession(SessionKey) && FPlatformTime::Seconds() < Deadline)
+			{
+				FPlatformProcess::YieldThread();
+			}
+			Client->Stop();
+
+			if (!Stats.bEstablished)
+			{
+				UE_LOG(LogLinkStream, Error, TEXT("LinkStream bench: TLS handshake %d did not complete."), Index);
+				break;
+			}
+			(Stats.bResumed ? ResumedSamples : FullSamples).Add(Stats.HandshakeTimeMs);
+			LastStats = Stats;
+		}
+
+		Acceptor->Stop();
+		Sink.StopAll();
+
+		for (TArray<double>* Samples : { &FullSamples, &ResumedSamples })
+		{
+			if (Samples->Num() == 0)
+			{
+				continue;
+			}
+			Samples->Sort();
+			UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: %-7s TLS handshakes x %3d  p50 %7.2f ms  p99 %7.2f ms  max %7.2f ms"),
+				Samples == &FullSamples ? TEXT("full") : TEXT("resumed"), Samples->Num(), Percentile(*Samples, 0.50), Percentile(*Samples, 0.99), Samples->Last());
+		}
+		UE_LOG(LogLinkStream, Display, TEXT("LinkStream bench: negotiated %s with %s"), *LastStats.Protocol, *LastStats.CipherSuite);
+	}
+
+	static FAutoConsoleCommand TlsCommand(
+		TEXT("LinkStream.Bench.Tls"),
+		TEXT("Measures full and resumed TLS handshake times on loopback against a self-signed certificate. Args: [Handshakes=20]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Tls));
+}
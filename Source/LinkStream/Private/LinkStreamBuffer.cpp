@@ -0,0 +1,162 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamBuffer.h"
+#include "Misc/ScopeLock.h"
+
+FLinkStreamBufferPool* FLinkStreamBufferPool::Instance = nullptr;
+
+/** Keep at most this many idle bytes per size class, and never fewer than four buffers. */
+static constexpr int32 LinkStreamBytesPerClass = 4 * 1024 * 1024;
+
+FLinkStreamBufferPool::FLinkStreamBufferPool()
+{
+	for (int32 Index = 0; Index < NumClasses; Index++)
+	{
+		Classes[Index].MaxFree = FMath::Max(4, LinkStreamBytesPerClass >> (MinClassShift + Index));
+	}
+}
+
+FLinkStreamBufferPool::~FLinkStreamBufferPool()
+{
+	if (Instance == this)
+	{
+		Instance = nullptr;
+	}
+}
+
+TArray<uint8> FLinkStreamBufferPool::AcquireArray(int32 MinCapacity)
+{
+	MinCapacity = FMath::Max(MinCapacity, 1);
+	const int32 Shift = FMath::Max<int32>(MinClassShift, FMath::CeilLogTwo((uint32)MinCapacity));
+	if (Shift > MaxClassShift)
+	{
+		Misses++;
+		TArray<uint8> Array;
+		Array.Reserve(MinCapacity);
+		return Array;
+	}
+
+	FSizeClass& SizeClass = Classes[Shift - MinClassShift];
+	{
+		FScopeLock Lock(&SizeClass.Lock);
+		if (SizeClass.Free.Num() > 0)
+		{
+			TArray<uint8> Array = SizeClass.Free.Pop(false);
+			Hits++;
+			PooledBytes -= Array.Max();
+			return Array;
+		}
+	}
+
+	Misses++;
+	TArray<uint8> Array;
+	Array.Reserve(1 << Shift);
+	return Array;
+}
+
+void FLinkStreamBufferPool::ReleaseArray(TArray<uint8>&& Array)
+{
+	const int32 Capacity = Array.Max();
+	if (Capacity < (1 << MinClassShift))
+	{
+		if (Capacity > 0)
+		{
+			Discarded++;
+		}
+		Array.Empty();
+		return;
+	}
+
+	const int32 Shift = FMath::FloorLog2((uint32)Capacity);
+	if (Shift > MaxClassShift)
+	{
+		Discarded++;
+		Array.Empty();
+		return;
+	}
+
+	Array.Reset();
+	FSizeClass& SizeClass = Classes[Shift - MinClassShift];
+	{
+		FScopeLock Lock(&SizeClass.Lock);
+		if (SizeClass.Free.Num() < SizeClass.MaxFree)
+		{
+			SizeClass.Free.Add(MoveTemp(Array));
+		}
+	}
+
+	if (Array.Max() != 0)
+	{
+		Discarded++;
+		Array.Empty();
+		return;
+	}
+
+	Returned++;
+	const int64 NowPooled = (PooledBytes += Capacity);
+	int64 Peak = HighWaterBytes.load();
+	while (NowPooled > Peak && !HighWaterBytes.compare_exchange_weak(Peak, NowPooled))
+	{
+	}
+}
+
+FLinkStreamBufferPoolStats FLinkStreamBufferPool::GetStats() const
+{
+	FLinkStreamBufferPoolStats Stats;
+	Stats.Hits = Hits.load();
+	Stats.Misses = Misses.load();
+	Stats.Returned = Returned.load();
+	Stats.Discarded = Discarded.load();
+	Stats.PooledBytes = PooledBytes.load();
+	Stats.HighWaterBytes = HighWaterBytes.load();
+	return Stats;
+}
+
+TArray<uint8> FLinkStreamBuffer::AcquireArray(int32 MinCapacity)
+{
+	if (FLinkStreamBufferPool* Pool = FLinkStreamBufferPool::Get())
+	{
+		return Pool->AcquireArray(MinCapacity);
+	}
+
+	TArray<uint8> Array;
+	Array.Reserve(MinCapacity);
+	return Array;
+}
+
+void FLinkStreamBuffer::Release()
+{
+	if (Data.Max() == 0)
+	{
+		return;
+	}
+
+	if (FLinkStreamBufferPool* Pool = FLinkStreamBufferPool::Get())
+	{
+		Pool->ReleaseArray(MoveTemp(Data));
+	}
+	Data.Empty();
+}
@@ -0,0 +1,296 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamCipher.h"
+
+#define UI UI_ST
+THIRD_PARTY_INCLUDES_START
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+THIRD_PARTY_INCLUDES_END
+#undef UI
+
+namespace LinkStreamCipher
+{
+	static constexpr uint8 Magic[4] = { 'L', 'S', 'E', 1 };
+
+	/** Bytes of key material per direction: the AES-256 key, then the nonce salt. */
+	static constexpr int32 DirectionKeySize = 32 + 4;
+
+	static void WriteSequence(uint8* Out, uint64 Sequence)
+	{
+		for (int32 Index = 0; Index < FLinkStreamCipher::SequenceSize; Index++)
+		{
+			Out[Index] = (uint8)(Sequence >> (8 * Index));
+		}
+	}
+
+	static uint64 ReadSequence(const uint8* Bytes)
+	{
+		uint64 Sequence = 0;
+		for (int32 Index = FLinkStreamCipher::SequenceSize - 1; Index >= 0; Index--)
+		{
+			Sequence = (Sequence << 8) | Bytes[Index];
+		}
+		return Sequence;
+	}
+}
+
+FLinkStreamCipher::FLinkStreamCipher(const FString& PreSharedKey)
+	: SendContext(EVP_CIPHER_CTX_new())
+	, RecvContext(EVP_CIPHER_CTX_new())
+{
+	const FTCHARToUTF8 Utf8(*PreSharedKey);
+	unsigned int HashSize = sizeof(PreSharedKeyHash);
+	EVP_Digest(Utf8.Get(), Utf8.Length(), PreSharedKeyHash, &HashSize, EVP_sha256(), nullptr);
+	ResetSession();
+}
+
+FLinkStreamCipher::~FLinkStreamCipher()
+{
+	ResetSession();
+	EVP_CIPHER_CTX_free(SendContext);
+	EVP_CIPHER_CTX_free(RecvContext);
+}
+
+void FLinkStreamCipher::ResetSession()
+{
+	if (KeyPair)
+	{
+		EVP_PKEY_free(KeyPair);
+		KeyPair = nullptr;
+	}
+	bReady = false;
+	NextSendSequence = 1;
+	HighestReceived = 0;
+	FMemory::Memzero(ReceivedBits, sizeof(ReceivedBits));
+}
+
+bool FLinkStreamCipher::BeginHandshake(uint8 OutHandshake[HandshakeSize])
+{
+	ResetSession();
+
+	EVP_PKEY_CTX* KeyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, nullptr);
+	const bool bGenerated = KeyContext && EVP_PKEY_keygen_init(KeyContext) > 0 && EVP_PKEY_keygen(KeyContext, &KeyPair) > 0;
+	EVP_PKEY_CTX_free(KeyContext);
+	size_t PublicKeySize = sizeof(PublicKey);
+	if (!bGenerated || EVP_PKEY_get_raw_public_key(KeyPair, PublicKey, &PublicKeySize) <= 0)
+	{
+		return false;
+	}
+
+	FMemory::Memcpy(OutHandshake, LinkStreamCipher::Magic, sizeof(LinkStreamCipher::Magic));
+	FMemory::Memcpy(OutHandshake + sizeof(LinkStreamCipher::Magic), PublicKey, sizeof(PublicKey));
+	return true;
+}
+
+bool FLinkStreamCipher::QueueHandshake(ELinkStreamFraming Framing)
+{
+	uint8 Handshake[HandshakeSize];
+	if (!BeginHandshake(Handshake))
+	{
+		DiscardHandshake();
+		return false;
+	}
+
+	uint8 Header[FLinkStreamFraming::MaxHeaderSize];
+	const int32 HeaderSize = FLinkStreamFraming::EncodeHeader(Framing, HandshakeSize, Header);
+	HandshakeOut.Reset(HeaderSize + HandshakeSize);
+	HandshakeOut.Append(Header, HeaderSize);
+	HandshakeOut.Append(Handshake, HandshakeSize);
+	HandshakeOutOffset = 0;
+	return true;
+}
+
+ELinkStreamSocketResult FLinkStreamCipher::SendHandshake(FLinkStreamSocket& Socket)
+{
+	while (HandshakeOutOffset < HandshakeOut.Num())
+	{
+		int32 BytesSent = 0;
+		const ELinkStreamSocketResult Result = Socket.Send(HandshakeOut.GetData() + HandshakeOutOffset, HandshakeOut.Num() - HandshakeOutOffset, BytesSent);
+		if (Result != ELinkStreamSocketResult::Ok)
+		{
+			return Result;
+		}
+		HandshakeOutOffset += BytesSent;
+	}
+	return ELinkStreamSocketResult::Ok;
+}
+
+void FLinkStreamCipher::DiscardHandshake()
+{
+	HandshakeOut.Reset();
+	HandshakeOutOffset = 0;
+}
+
+bool FLinkStreamCipher::CompleteHandshake(const uint8* Data, int32 Size)
+{
+	if (!KeyPair || Size != HandshakeSize || FMemory::Memcmp(Data, LinkStreamCipher::Magic, sizeof(LinkStreamCipher::Magic)) != 0)
+	{
+		return false;
+	}
+	const uint8* PeerKey = Data + sizeof(LinkStreamCipher::Magic);
+	const int32 Order = FMemory::Memcmp(PublicKey, PeerKey, sizeof(PublicKey));
+	if (Order == 0)
+	{
+		// Our own key reflected back, which no genuine peer can send.
+		return false;
+	}
+
+	// X25519 rejects the low-order points that would force a known shared secret.
+	uint8 Shared[32];
+	size_t SharedSize = sizeof(Shared);
+	EVP_PKEY* Peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr, PeerKey, sizeof(PublicKey));
+	EVP_PKEY_CTX* DeriveContext = Peer ? EVP_PKEY_CTX_new(KeyPair, nullptr) : nullptr;
+	const bool bShared = DeriveContext && EVP_PKEY_derive_init(DeriveContext) > 0 && EVP_PKEY_derive_set_peer(DeriveContext, Peer) > 0
+		&& EVP_PKEY_derive(DeriveContext, Shared, &SharedSize) > 0;
+	EVP_PKEY_CTX_free(DeriveContext);
+	EVP_PKEY_free(Peer);
+	if (!bShared)
+	{
+		return false;
+	}
+
+	// Both public keys go into the info, lowest first, so the two sides agree on it and on which half each sends with.
+	uint8 Info[11 + 64] = { 'L', 'i', 'n', 'k', 'S', 't', 'r', 'e', 'a', 'm', ' ' };
+	FMemory::Memcpy(Info + 11, Order < 0 ? PublicKey : PeerKey, 32);
+	FMemory::Memcpy(Info + 43, Order < 0 ? PeerKey : PublicKey, 32);
+
+	uint8 Keys[2 * LinkStreamCipher::DirectionKeySize];
+	size_t KeysSize = sizeof(Keys);
+	EVP_PKEY_CTX* KdfContext = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+	const bool bDerived = KdfContext && EVP_PKEY_derive_init(KdfContext) > 0 && EVP_PKEY_CTX_set_hkdf_md(KdfContext, EVP_sha256()) > 0
+		&& EVP_PKEY_CTX_set1_hkdf_salt(KdfContext, PreSharedKeyHash, sizeof(PreSharedKeyHash)) > 0
+		&& EVP_PKEY_CTX_set1_hkdf_key(KdfContext, Shared, (int)SharedSize) > 0
+		&& EVP_PKEY_CTX_add1_hkdf_info(KdfContext, Info, sizeof(Info)) > 0
+		&& EVP_PKEY_derive(KdfContext, Keys, &KeysSize) > 0;
+	EVP_PKEY_CTX_free(KdfContext);
+	FMemory::Memzero(Shared, sizeof(Shared));
+	if (!bDerived)
+	{
+		return false;
+	}
+
+	const uint8* SendKeys = Keys + (Order < 0 ? 0 : LinkStreamCipher::DirectionKeySize);
+	const uint8* RecvKeys = Keys + (Order < 0 ? LinkStreamCipher::DirectionKeySize : 0);
+	const bool bKeyed = EVP_EncryptInit_ex(SendContext, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) > 0
+		&& EVP_CIPHER_CTX_ctrl(SendContext, EVP_CTRL_GCM_SET_IVLEN, 12, nullptr) > 0
+		&& EVP_EncryptInit_ex(SendContext, nullptr, nullptr, SendKeys, nullptr) > 0
+		&& EVP_DecryptInit_ex(RecvContext, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) > 0
+		&& EVP_CIPHER_CTX_ctrl(RecvContext, EVP_CTRL_GCM_SET_IVLEN, 12, nullptr) > 0
+		&& EVP_DecryptInit_ex(RecvContext, nullptr, nullptr, RecvKeys, nullptr) > 0;
+	FMemory::Memcpy(SendSalt, SendKeys + 32, sizeof(SendSalt));
+	FMemory::Memcpy(RecvSalt, RecvKeys + 32, sizeof(RecvSalt));
+	FMemory::Memzero(Keys, sizeof(Keys));
+
+	EVP_PKEY_free(KeyPair);
+	KeyPair = nullptr;
+	bReady = bKeyed;
+	return bKeyed;
+}
+
+void FLinkStreamCipher::Crypt(evp_cipher_ctx_st* Context, bool bEncrypt, const uint8* Salt, uint64 Sequence, uint8* A, int32 ASize, uint8* B, int32 BSize)
+{
+	uint8 Nonce[12];
+	FMemory::Memcpy(Nonce, Salt, 4);
+	LinkStreamCipher::WriteSequence(Nonce + 4, Sequence);
+
+	// The key schedule stays in the context; only the nonce changes per message.
+	int32 Written = 0;
+	if (bEncrypt)
+	{
+		EVP_EncryptInit_ex(Context, nullptr, nullptr, nullptr, Nonce);
+		if (ASize > 0)
+		{
+			EVP_EncryptUpdate(Context, A, &Written, A, ASize);
+		}
+		if (BSize > 0)
+		{
+			EVP_EncryptUpdate(Context, B, &Written, B, BSize);
+		}
+	}
+	else
+	{
+		EVP_DecryptInit_ex(Context, nullptr, nullptr, nullptr, Nonce);
+		if (ASize > 0)
+		{
+			EVP_DecryptUpdate(Context, A, &Written, A, ASize);
+		}
+		if (BSize > 0)
+		{
+			EVP_DecryptUpdate(Context, B, &Written, B, BSize);
+		}
+	}
+}
+
+void FLinkStreamCipher::Seal(uint8 OutSequence[SequenceSize], uint8* Header, int32 HeaderSize, uint8* Payload, int32 PayloadSize, uint8 OutTag[TagSize])
+{
+	check(bReady);
+	const uint64 Sequence = NextSendSequence++;
+	LinkStreamCipher::WriteSequence(OutSequence, Sequence);
+	Crypt(SendContext, true, SendSalt, Sequence, Header, HeaderSize, Payload, PayloadSize);
+
+	int32 Written = 0;
+	EVP_EncryptFinal_ex(SendContext, OutTag, &Written);
+	EVP_CIPHER_CTX_ctrl(SendContext, EVP_CTRL_GCM_GET_TAG, TagSize, OutTag);
+}
+
+void FLinkStreamCipher::Unseal(const uint8 Sequence[SequenceSize], uint8* Header, int32 HeaderSize, uint8* Payload, int32 PayloadSize)
+{
+	Crypt(SendContext, true, SendSalt, LinkStreamCipher::ReadSequence(Sequence), Header, HeaderSize, Payload, PayloadSize);
+}
+
+bool FLinkStreamCipher::Open(uint8* Frame, int32 Size)
+{
+	if (!bReady || Size < Overhead)
+	{
+		return false;
+	}
+
+	const uint64 Sequence = LinkStreamCipher::ReadSequence(Frame);
+	uint64& Word = ReceivedBits[(Sequence / 64) % (ReplayWindow / 64)];
+	const uint64 Bit = 1ull << (Sequence % 64);
+	if (Sequence == 0 || (Sequence <= HighestReceived && (HighestReceived - Sequence >= ReplayWindow || (Word & Bit) != 0)))
+	{
+		return false;
+	}
+
+	Crypt(RecvContext, false, RecvSalt, Sequence, Frame + SequenceSize, Size - Overhead, nullptr, 0);
+	int32 Written = 0;
+	if (EVP_CIPHER_CTX_ctrl(RecvContext, EVP_CTRL_GCM_SET_TAG, TagSize, Frame + Size - TagSize) <= 0
+		|| EVP_DecryptFinal_ex(RecvContext, Frame + Size - TagSize, &Written) <= 0)
+	{
+		return false;
+	}
+
+	// Only an authentic frame moves the window; the numbers it skips over become unseen.
+	for (uint64 Skipped = HighestReceived + 1; Skipped <= Sequence && Skipped - HighestReceived <= ReplayWindow; Skipped++)
+	{
+		ReceivedBits[(Skipped / 64) % (ReplayWindow / 64)] &= ~(1ull << (Skipped % 64));
+	}
+	HighestReceived = FMath::Max(HighestReceived, Sequence);
+	Word |= Bit;
+	return true;
+}
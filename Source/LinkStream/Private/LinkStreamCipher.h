@@ -0,0 +1,122 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LinkStreamFraming.h"
+#include "LinkStreamSocket.h"
+
+struct evp_cipher_ctx_st;
+struct evp_pkey_st;
+
+/**
+ * Authenticated encryption of one connection's frames: AES-256-GCM through OpenSSL, which uses the CPU's AES and
+ * carry-less multiply instructions where it has them.
+ *
+ * On link-up each side sends a plain handshake frame, magic:u32 public:32, carrying a fresh X25519 key. Both derive
+ * the session keys from the shared secret with HKDF-SHA256, salted with the hash of the pre-shared key, so every link
+ * gets its own keys and a peer without the pre-shared key fails the first frame. Every later frame is
+ *
+ *   sequence:u64 ciphertext tag:16
+ *
+ * where the nonce is a 4-byte salt from the key schedule followed by the sequence number. Sequence numbers are
+ * explicit so frames may be sealed slightly ahead of the order the lanes finally write them in; a sliding window of
+ * ReplayWindow numbers rejects any frame seen before or too old to tell.
+ *
+ * Not thread-safe: only the worker servicing the connection calls it.
+ */
+class FLinkStreamCipher
+{
+public:
+	static constexpr int32 HandshakeSize = 4 + 32;
+	static constexpr int32 SequenceSize = 8;
+	static constexpr int32 TagSize = 16;
+	static constexpr int32 Overhead = SequenceSize + TagSize;
+	static constexpr int32 ReplayWindow = 256;
+
+	explicit FLinkStreamCipher(const FString& PreSharedKey);
+	~FLinkStreamCipher();
+
+	FLinkStreamCipher(const FLinkStreamCipher&) = delete;
+	FLinkStreamCipher& operator=(const FLinkStreamCipher&) = delete;
+
+	/** Forgets the previous session and writes the handshake payload for a new one. Returns false if no key could be made. */
+	bool BeginHandshake(uint8 OutHandshake[HandshakeSize]);
+
+	/** Begins a handshake and keeps its payload, framed with Framing, for SendHandshake. Returns false if no key could be made. */
+	bool QueueHandshake(ELinkStreamFraming Framing);
+
+	/** Writes what Socket has not taken yet of the queued handshake frame. Ok once all of it is out. */
+	ELinkStreamSocketResult SendHandshake(FLinkStreamSocket& Socket);
+
+	/** Forgets the unwritten handshake of a link that went down. */
+	void DiscardHandshake();
+
+	/** Derives the session keys from the peer's handshake payload. Returns false if it is not one. */
+	bool CompleteHandshake(const uint8* Data, int32 Size);
+
+	bool IsReady() const { return bReady; }
+
+	/**
+	 * Encrypts Header and then Payload in place as one message, writing its sequence number to OutSequence and its tag
+	 * to OutTag. The two parts let the envelope stay in the message's inline header while the payload stays in its buffer.
+	 */
+	void Seal(uint8 OutSequence[SequenceSize], uint8* Header, int32 HeaderSize, uint8* Payload, int32 PayloadSize, uint8 OutTag[TagSize]);
+
+	/** Restores the plaintext of a message sealed in this session, for one the link went down before writing. */
+	void Unseal(const uint8 Sequence[SequenceSize], uint8* Header, int32 HeaderSize, uint8* Payload, int32 PayloadSize);
+
+	/**
+	 * Decrypts a received frame in place, leaving the plaintext between the sequence number and the tag. Returns false
+	 * if the frame is not authentic, is a replay, or is too short.
+	 */
+	bool Open(uint8* Frame, int32 Size);
+
+private:
+	/** Runs the GCM keystream for Sequence over A and then B. Encryption and decryption are the same XOR. */
+	void Crypt(struct evp_cipher_ctx_st* Context, bool bEncrypt, const uint8* Salt, uint64 Sequence, uint8* A, int32 ASize, uint8* B, int32 BSize);
+
+	void ResetSession();
+
+	struct evp_cipher_ctx_st* SendContext = nullptr;
+	struct evp_cipher_ctx_st* RecvContext = nullptr;
+	struct evp_pkey_st* KeyPair = nullptr;
+	uint8 PublicKey[32];
+	uint8 PreSharedKeyHash[32];
+	uint8 SendSalt[4];
+	uint8 RecvSalt[4];
+	bool bReady = false;
+
+	uint64 NextSendSequence = 1;
+
+	/** Highest sequence number accepted, and one bit per number of the window below it, indexed modulo ReplayWindow. */
+	uint64 HighestReceived = 0;
+	uint64 ReceivedBits[ReplayWindow / 64];
+
+	/** The framed handshake this side sends on link-up, and how much of it is written. */
+	TArray<uint8> HandshakeOut;
+	int32 HandshakeOutOffset = 0;
+};
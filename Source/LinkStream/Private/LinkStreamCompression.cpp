@@ -0,0 +1,178 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamCompression.h"
+#include "LinkStreamFraming.h"
+#include "LinkStreamReader.h"
+#include "Misc/Compression.h"
+#include "HAL/PlatformTime.h"
+
+static FName GetCompressionFormatName(ELinkStreamCompression Format)
+{
+	switch (Format)
+	{
+	case ELinkStreamCompression::LZ4:
+		return NAME_LZ4;
+	case ELinkStreamCompression::Zlib:
+		return NAME_Zlib;
+	case ELinkStreamCompression::Oodle:
+		return NAME_Oodle;
+	default:
+		return NAME_None;
+	}
+}
+
+uint8 FLinkStreamCompression::GetDecodableFormats()
+{
+	uint8 Formats = 0;
+	for (ELinkStreamCompression Format : { ELinkStreamCompression::LZ4, ELinkStreamCompression::Zlib, ELinkStreamCompression::Oodle })
+	{
+		if (FCompression::IsFormatValid(GetCompressionFormatName(Format)))
+		{
+			Formats |= 1 << (uint8)Format;
+		}
+	}
+	return Formats;
+}
+
+bool FLinkStreamCompression::Compress(ELinkStreamCompression Format, const uint8* Data, int32 Size, FLinkStreamBuffer& OutPayload)
+{
+	const FName FormatName = GetCompressionFormatName(Format);
+	if (FormatName.IsNone() || Size <= 0)
+	{
+		return false;
+	}
+
+	uint8 Prefix[FLinkStreamFraming::MaxHeaderSize];
+	const int32 PrefixSize = FLinkStreamFraming::EncodeHeader(ELinkStreamFraming::VarInt, (uint32)Size, Prefix);
+	int32 CompressedSize = FCompression::CompressMemoryBound(FormatName, Size);
+
+	FLinkStreamBuffer Payload = FLinkStreamBuffer::Acquire(PrefixSize + CompressedSize);
+	TArray<uint8>& Bytes = Payload.GetArray();
+	Bytes.SetNumUninitialized(PrefixSize + CompressedSize, false);
+	FMemory::Memcpy(Bytes.GetData(), Prefix, PrefixSize);
+	if (!FCompression::CompressMemory(FormatName, Bytes.GetData() + PrefixSize, CompressedSize, Data, Size) || PrefixSize + CompressedSize >= Size)
+	{
+		return false;
+	}
+
+	Bytes.SetNum(PrefixSize + CompressedSize, false);
+	OutPayload = MoveTemp(Payload);
+	return true;
+}
+
+bool FLinkStreamCompression::Decompress(ELinkStreamCompression Format, const uint8* Data, int32 Size, int32 MaxSize, TArray<uint8>& OutMessage)
+{
+	const FName FormatName = GetCompressionFormatName(Format);
+	FLinkStreamReader Reader(MakeArrayView(Data, Size));
+	uint64 OriginalSize = 0;
+	if (FormatName.IsNone() || !Reader.ReadVarUInt(OriginalSize) || OriginalSize > (uint64)MaxSize)
+	{
+		return false;
+	}
+
+	const int32 Start = OutMessage.Num();
+	OutMessage.AddUninitialized((int32)OriginalSize);
+	if (!FCompression::UncompressMemory(FormatName, OutMessage.GetData() + Start, (int32)OriginalSize, Data + Reader.GetOffset(), Reader.GetRemaining()))
+	{
+		OutMessage.SetNum(Start, false);
+		return false;
+	}
+	return true;
+}
+
+void FLinkStreamCompressor::Configure(ELinkStreamCompression InFormat, int32 InThreshold)
+{
+	Format = InFormat;
+	Threshold = InThreshold;
+}
+
+FLinkStreamBuffer FLinkStreamCompressor::Compress(const FLinkStreamBuffer& Message, FLinkStreamEnvelope& InOutEnvelope)
+{
+	FLinkStreamBuffer compressed;
+	if (Message.Num() < Threshold || !IsNegotiated())
+	{
+		return compressed;
+	}
+
+	const uint64 startCycles = FPlatformTime::Cycles64();
+	const bool bShrunk = FLinkStreamCompression::Compress(Format, Message.GetData(), Message.Num(), compressed);
+	CompressCycles.Add((int64)(FPlatformTime::Cycles64() - startCycles));
+	if (!bShrunk)
+	{
+		IncompressibleMessages.Increment();
+		return FLinkStreamBuffer();
+	}
+
+	CompressedMessages.Increment();
+	UncompressedBytes.Add(Message.Num());
+	CompressedBytes.Add(compressed.Num());
+	InOutEnvelope.Flags = (InOutEnvelope.Flags & ~FLinkStreamEnvelope::CompressionFlags) | (uint8)Format;
+	return compressed;
+}
+
+bool FLinkStreamCompressor::Decompress(FLinkStreamBuffer& Message, int32 MaxSize)
+{
+	FLinkStreamEnvelope envelope;
+	const int32 envelopeSize = FLinkStreamEnvelope::Decode(Message.GetData(), Message.Num(), envelope);
+	const ELinkStreamCompression format = (ELinkStreamCompression)(envelope.Flags & FLinkStreamEnvelope::CompressionFlags);
+	if (envelopeSize == 0 || format == ELinkStreamCompression::None)
+	{
+		return true;
+	}
+
+	const uint64 startCycles = FPlatformTime::Cycles64();
+	envelope.Flags &= ~FLinkStreamEnvelope::CompressionFlags;
+	uint8 envelopeBytes[FLinkStreamEnvelope::MaxSize];
+	const int32 newEnvelopeSize = envelope.Encode(envelopeBytes);
+	FLinkStreamBuffer restored;
+	restored.GetArray().Append(envelopeBytes, newEnvelopeSize);
+	if (!FLinkStreamCompression::Decompress(format, Message.GetData() + envelopeSize, Message.Num() - envelopeSize, MaxSize, restored.GetArray()))
+	{
+		return false;
+	}
+	DecompressCycles.Add((int64)(FPlatformTime::Cycles64() - startCycles));
+	DecompressedMessages.Increment();
+	Message = MoveTemp(restored);
+	return true;
+}
+
+FLinkStreamCompressionStats FLinkStreamCompressor::GetStats() const
+{
+	FLinkStreamCompressionStats stats;
+	stats.bNegotiated = IsNegotiated();
+	stats.CompressedMessages = CompressedMessages.GetValue();
+	stats.IncompressibleMessages = IncompressibleMessages.GetValue();
+	stats.UncompressedBytes = UncompressedBytes.GetValue();
+	stats.CompressedBytes = CompressedBytes.GetValue();
+	if (stats.UncompressedBytes > 0)
+	{
+		stats.Ratio = (float)((double)stats.CompressedBytes / (double)stats.UncompressedBytes);
+	}
+	stats.CompressTimeMs = (float)(FPlatformTime::ToMilliseconds64((uint64)CompressCycles.GetValue()));
+	stats.DecompressedMessages = DecompressedMessages.GetValue();
+	stats.DecompressTimeMs = (float)(FPlatformTime::ToMilliseconds64((uint64)DecompressCycles.GetValue()));
+	return stats;
+}
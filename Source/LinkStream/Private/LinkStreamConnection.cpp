@@ -24,30 +24,58 @@
  */
 
 #include "LinkStreamConnection.h"
-#include "SocketSubsystem.h"
-#include "Interfaces/IPv4/IPv4Address.h"
-#include "IPAddress.h"
-#include "Sockets.h"
+#include "LinkStream.h"
+#include "LinkStreamSocket.h"
+#include "LinkStreamPoller.h"
 #include "HAL/RunnableThread.h"
+#include "HAL/PlatformTime.h"
 #include "Async/Async.h"
-#include <string>
+#include "Engine/World.h"
+#include "LatentActions.h"
 #include "Logging/MessageLog.h"
+#include "Misc/ScopeRWLock.h"
 #include "HAL/UnrealMemory.h"
 #include "LinkStreamSettings.h"
+#include "LinkStreamReader.h"
+#include "LinkStreamUdp.h"
+#include "LinkStreamCipher.h"
+#include "LinkStreamTls.h"
+
+/** Every message needs up to two regions in a vectored write, its header and its payload. */
+static constexpr int32 MaxMessagesPerWrite = FLinkStreamSocket::MaxIoVecs / 2;
+
+/** The settings a worker runs with: udp:// is serviced by a reactor, and every lane gets a share. */
+static FTcpSocketWorkerSettings NormalizeWorkerSettings(const FTcpSocketWorkerSettings& InSettings, bool bUdp)
+{
+	FTcpSocketWorkerSettings settings = InSettings;
+	if (bUdp)
+	{
+		settings.Backend = ELinkStreamBackend::Reactor;
+	}
+	for (int32& weight : settings.LaneWeights)
+	{
+		weight = FMath::Max(1, weight);
+	}
+	return settings;
+}
 
 ALinkStreamConnection::ALinkStreamConnection()
 {
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
 }
 
 void ALinkStreamConnection::BeginPlay()
 {
 	Super::BeginPlay();	
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ALinkStreamConnection::OnWorldPostActorTick);
 }
 
 void ALinkStreamConnection::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
 	TArray<int32> keys;
 	TcpWorkers.GetKeys(keys);
 
@@ -60,6 +88,139 @@ void ALinkStreamConnection::EndPlay(const EEndPlayReason::Type EndPlayReason)
 void ALinkStreamConnection::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	if (DispatchMode == ELinkStreamDispatchMode::Batched)
+	{
+		DispatchInboxes();
+	}
+
+	if (NextRequestDeadline <= FPlatformTime::Seconds())
+	{
+		ExpirePendingRequests();
+	}
+}
+
+void ALinkStreamConnection::DispatchInboxes()
+{
+	if (DispatchWorkerInboxes(TcpWorkers, [this](int32 ConnectionId, FLinkStreamBuffer& Message) { DeliverMessage(ConnectionId, Message); },
+		MaxMessagesPerFrame, MaxDispatchTimeMs, NextDispatchIndex))
+	{
+		DeferredMessageCount += GetPendingInboxCount();
+	}
+}
+
+void ALinkStreamConnection::DeliverMessage(int32 ConnectionId, FLinkStreamBuffer& Message)
+{
+	const TSharedRef<FTcpSocketWorker>* worker = TcpWorkers.Find(ConnectionId);
+	if (!worker || !(*worker)->UsesEnvelope())
+	{
+		MessageReceivedDelegate.ExecuteIfBound(ConnectionId, Message.GetArray());
+		return;
+	}
+
+	FLinkStreamEnvelope envelope;
+	const int32 envelopeSize = FLinkStreamEnvelope::Decode(Message.GetData(), Message.Num(), envelope);
+	if (envelopeSize == 0)
+	{
+		PrintToConsole(FString::Printf(TEXT("Connection %d: dropped a message of %d bytes without a valid envelope."), ConnectionId, Message.Num()), true);
+		return;
+	}
+	ConsumeMessageFront(Message.GetArray(), envelopeSize);
+
+	switch (envelope.Kind)
+	{
+	case ELinkStreamMessageKind::Request:
+		OnRequestReceived.Broadcast(ConnectionId, (int32)envelope.CorrelationId, Message.GetArray());
+		break;
+
+	case ELinkStreamMessageKind::Response:
+		// Late responses to requests that already timed out are dropped here.
+		if (const FPendingRequest* request = PendingRequests.Find((int32)envelope.CorrelationId))
+		{
+			if (request->ConnectionId == ConnectionId)
+			{
+				CompleteRequest((int32)envelope.CorrelationId, ELinkStreamRequestResult::Success, Message.Detach());
+			}
+		}
+		break;
+
+	default:
+		MessageReceivedDelegate.ExecuteIfBound(ConnectionId, Message.GetArray());
+		break;
+	}
+}
+
+bool ALinkStreamConnection::DispatchWorkerInboxes(TMap<int32, TSharedRef<FTcpSocketWorker>>& Workers, TFunctionRef<void(int32, FLinkStreamBuffer&)> Deliver,
+	int32 MaxMessages, float MaxTimeMs, int32& InOutNextIndex)
+{
+	if (Workers.Num() == 0)
+	{
+		return false;
+	}
+
+	// Handlers may connect or disconnect, so walk a snapshot of the ids.
+	TArray<int32> keys;
+	Workers.GetKeys(keys);
+
+	const double deadline = MaxTimeMs > 0.f ? FPlatformTime::Seconds() + MaxTimeMs / 1000.0 : 0.0;
+	int32 dispatched = 0;
+
+	// Round robin, one message per connection per pass, starting where the previous frame stopped.
+	const int32 firstIndex = InOutNextIndex % keys.Num();
+	bool bAnyDispatched = true;
+	while (bAnyDispatched)
+	{
+		bAnyDispatched = false;
+		for (int32 offset = 0; offset < keys.Num(); offset++)
+		{
+			const int32 keyIndex = (firstIndex + offset) % keys.Num();
+			TSharedRef<FTcpSocketWorker>* worker = Workers.Find(keys[keyIndex]);
+			if (!worker)
+			{
+				continue;
+			}
+
+			FLinkStreamBuffer msg;
+			if (!(*worker)->TryReadFromInbox(msg))
+			{
+				continue;
+			}
+
+			Deliver(keys[keyIndex], msg);
+			bAnyDispatched = true;
+			dispatched++;
+
+			if ((MaxMessages > 0 && dispatched >= MaxMessages) || (deadline > 0.0 && FPlatformTime::Seconds() >= deadline))
+			{
+				InOutNextIndex = keyIndex + 1;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ALinkStreamConnection::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld() || FlushMode != ELinkStreamFlushMode::PerFrame)
+	{
+		return;
+	}
+
+	for (auto& worker : TcpWorkers)
+	{
+		worker.Value->RequestFlush();
+	}
+}
+
+int32 ALinkStreamConnection::GetPendingInboxCount() const
+{
+	int32 count = 0;
+	for (const TPair<int32, TSharedRef<FTcpSocketWorker>>& worker : TcpWorkers)
+	{
+		count += worker.Value->GetInboxCount();
+	}
+	return count;
 }
 
 void ALinkStreamConnection::Connect(const FString& ipAddress, int32 port, const FTcpSocketDisconnectDelegate& OnDisconnected, const FTcpSocketConnectDelegate& OnConnected,
@@ -72,484 +233,2766 @@ void ALinkStreamConnection::Connect(const FString& ipAddress, int32 port, const
 	ConnectionId = NextConnectionId;
 	NextConnectionId++;
 
-	TWeakObjectPtr<ALinkStreamConnection> thisWeakObjPtr = TWeakObjectPtr<ALinkStreamConnection>(this);
-	TSharedRef<FTcpSocketWorker> worker(new FTcpSocketWorker(ipAddress, port, thisWeakObjPtr, ConnectionId, ReceiveBufferSize, SendBufferSize, TimeBetweenTicks));
-	TcpWorkers.Add(ConnectionId, worker);
+	FTcpSocketWorkerSettings settings;
+	settings.RecvBufferSize = ReceiveBufferSize;
+	settings.SendBufferSize = SendBufferSize;
+	settings.TimeBetweenTicks = TimeBetweenTicks;
+	settings.Backend = Backend;
+	settings.WakeMode = WakeMode;
+	settings.DispatchMode = DispatchMode;
+	settings.Framing = Framing;
+	settings.MaxFrameSize = MaxFrameSize;
+	settings.FlushMode = FlushMode;
+	settings.bNoDelay = bNoDelay;
+	settings.bCork = bCork;
+	settings.SendHighWatermark = SendHighWatermark;
+	settings.SendLowWatermark = FMath::Min(SendLowWatermark, SendHighWatermark);
+	settings.ConnectTimeout = ConnectTimeout;
+	settings.bAutoReconnect = bAutoReconnect;
+	settings.ReconnectInitialDelay = ReconnectInitialDelay;
+	settings.ReconnectMaxDelay = FMath::Max(ReconnectMaxDelay, ReconnectInitialDelay);
+	settings.ReconnectJitter = FMath::Clamp(ReconnectJitter, 0.f, 1.f);
+	settings.MaxReconnectAttempts = MaxReconnectAttempts;
+	settings.ReconnectOutbox = ReconnectOutbox;
+	settings.bUseEnvelope = bUseEnvelope;
+	settings.LaneWeights[(int32)ELinkStreamPriority::Control] = ControlLaneWeight;
+	settings.LaneWeights[(int32)ELinkStreamPriority::Interactive] = InteractiveLaneWeight;
+	settings.LaneWeights[(int32)ELinkStreamPriority::Bulk] = BulkLaneWeight;
+	settings.OutboxCapacity = OutboxCapacity;
+	settings.MaxPendingSendBytes = MaxPendingSendBytes;
+	settings.HeartbeatInterval = HeartbeatInterval;
+	settings.IdleTimeout = IdleTimeout;
+	settings.bTcpKeepAlive = bTcpKeepAlive;
+	settings.TcpKeepAliveIdle = TcpKeepAliveIdle;
+	settings.TcpKeepAliveInterval = TcpKeepAliveInterval;
+	settings.TcpKeepAliveProbes = TcpKeepAliveProbes;
+	settings.InboxLimit = InboxLimit;
+	settings.InboxOverflow = InboxOverflow;
+	settings.CoalesceKeySize = CoalesceKeySize;
+	settings.Compression = Compression;
+	settings.CompressionThreshold = FMath::Max(1, CompressionThreshold);
+	settings.bDeltaEncoding = bDeltaEncoding;
+	settings.DeltaKeySize = DeltaKeySize;
+	settings.DeltaKeyframeInterval = DeltaKeyframeInterval;
+	settings.bEncrypt = bEncrypt;
+	settings.EncryptionKey = EncryptionKey;
+	settings.bTls = bTls;
+	settings.TlsServerName = TlsServerName;
+	settings.bTlsVerifyPeer = bTlsVerifyPeer;
+	if (bTls && !TlsTrustedCertificateFile.IsEmpty() && !FLinkStreamTlsContext::LoadPemFile(TlsTrustedCertificateFile, settings.TlsTrustedCertificates))
+	{
+		PrintToConsole(FString::Printf(TEXT("Connect: could not read TlsTrustedCertificateFile %s; only the engine's certificate bundle is trusted."), *TlsTrustedCertificateFile), true);
+	}
+
+	if (Compression != ELinkStreamCompression::None && !bUseEnvelope && !FLinkStreamInprocEndpoint::IsInprocAddress(ipAddress))
+	{
+		PrintToConsole(TEXT("Connect: compression needs bUseEnvelope; messages will be sent uncompressed."), true);
+	}
+	// A link asked to be secured is never opened in the clear instead.
+	if (bTls && (FLinkStreamInprocEndpoint::IsInprocAddress(ipAddress) || FLinkStreamUdpSession::IsUdpAddress(ipAddress)))
+	{
+		FailConnect(ConnectionId, TEXT("Connect: bTls needs a TCP connection; the connection was not opened."));
+		return;
+	}
+	if (bTls && bEncrypt)
+	{
+		PrintToConsole(TEXT("Connect: bTls already encrypts the connection; bEncrypt is ignored."), true);
+	}
+	else if (bEncrypt && (Framing == ELinkStreamFraming::None || FLinkStreamInprocEndpoint::IsInprocAddress(ipAddress) || FLinkStreamUdpSession::IsUdpAddress(ipAddress)))
+	{
+		FailConnect(ConnectionId, TEXT("Connect: bEncrypt needs a framed TCP connection; the connection was not opened."));
+		return;
+	}
+	if (bDeltaEncoding && !bUseEnvelope && !FLinkStreamInprocEndpoint::IsInprocAddress(ipAddress))
+	{
+		PrintToConsole(TEXT("Connect: delta encoding needs bUseEnvelope; messages will be sent whole."), true);
+	}
+	if (HeartbeatInterval > 0.f && !bUseEnvelope && !FLinkStreamInprocEndpoint::IsInprocAddress(ipAddress))
+	{
+		PrintToConsole(TEXT("Connect: heartbeats need bUseEnvelope; no pings will be sent, only IdleTimeout applies."), true);
+	}
+	if (IdleTimeout > 0.f && IdleTimeout < 2.f * HeartbeatInterval)
+	{
+		PrintToConsole(FString::Printf(TEXT("Connect: IdleTimeout (%.1f s) is shorter than two heartbeat intervals (%.1f s); quiet links may be closed between pings."), IdleTimeout, HeartbeatInterval), true);
+	}
+
+	if (bUseEnvelope && Framing == ELinkStreamFraming::None && !FLinkStreamInprocEndpoint::IsInprocAddress(ipAddress) && !FLinkStreamUdpSession::IsUdpAddress(ipAddress))
+	{
+		PrintToConsole(TEXT("Connect: bUseEnvelope needs a framed stream; set Framing, or messages may be split or merged before their envelope is read."), true);
+	}
+
+	TSharedRef<FTcpSocketWorker> worker(new FTcpSocketWorker(ipAddress, port, this, ConnectionId, settings));
+	{
+		FWriteScopeLock writeLock(TcpWorkersLock);
+		TcpWorkers.Add(ConnectionId, worker);
+	}
 	worker->Start();
 }
 
+void ALinkStreamConnection::FailConnect(int32 ConnectionId, const FString& Reason)
+{
+	PrintToConsole(Reason, true);
+
+	// Raised on a later tick, like any other failed connect, so the caller has its ConnectionId first.
+	TWeakObjectPtr<ALinkStreamConnection> weakThis(this);
+	AsyncTask(ENamedThreads::GameThread, [weakThis, ConnectionId]() {
+		if (weakThis.IsValid())
+		{
+			weakThis->ExecuteOnConnectionStateChanged(ConnectionId, ELinkStreamConnectionState::Failed, weakThis);
+			weakThis->ExecuteOnDisconnected(ConnectionId, weakThis);
+		}
+	});
+}
+
 void ALinkStreamConnection::Disconnect(int32 ConnectionId)
 {	
 	auto worker = TcpWorkers.Find(ConnectionId);
 	if (worker)
 	{
-		UE_LOG(LogTemp, Log, TEXT("Tcp Socket: Disconnected from server."));
+		UE_LOG(LogLinkStream, Log, TEXT("Tcp Socket: Disconnected from server."));
 		worker->Get().Stop();
-		TcpWorkers.Remove(ConnectionId);
+		{
+			FWriteScopeLock writeLock(TcpWorkersLock);
+			TcpWorkers.Remove(ConnectionId);
+		}
+		FailPendingRequests(ConnectionId);
 	}
 }
 
-bool ALinkStreamConnection::SendData(int32 ConnectionId /*= 0*/, TArray<uint8> DataToSend)
+bool ALinkStreamConnection::SendData(int32 ConnectionId /*= 0*/, TArray<uint8> DataToSend, ELinkStreamPriority Priority, ELinkStreamDelivery Delivery)
 {
-	if (TcpWorkers.Contains(ConnectionId))
+	return QueueMessage(ConnectionId, MoveTemp(DataToSend), Priority, FLinkStreamEnvelope(), Delivery);
+}
+
+bool ALinkStreamConnection::QueueMessage(int32 ConnectionId, TArray<uint8>&& DataToSend, ELinkStreamPriority Priority, const FLinkStreamEnvelope& Envelope,
+	ELinkStreamDelivery Delivery)
+{
+	const TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	if (worker.IsValid())
 	{
-		if (TcpWorkers[ConnectionId]->isConnected())
+		// Messages sent while connecting or waiting to reconnect are queued and go out once connected.
+		if (worker->IsRunning())
 		{
-			TcpWorkers[ConnectionId]->AddToOutbox(DataToSend);
+			uint8 envelopeBytes[FLinkStreamEnvelope::MaxSize];
+			const int32 messageSize = DataToSend.Num() + (worker->UsesEnvelope() ? Envelope.Encode(envelopeBytes) : 0);
+			if (!CanQueue(ConnectionId, *worker, messageSize))
+			{
+				return false;
+			}
+			if (!worker->AddToOutbox(FLinkStreamBuffer(MoveTemp(DataToSend)), Priority, Envelope, Delivery))
+			{
+				PrintToConsole(FString::Printf(TEXT("SendData: lane %d of connection %d is full (OutboxCapacity %d)."), (int32)Priority, ConnectionId, worker->GetOutboxCapacity()), true);
+				return false;
+			}
 			return true;
 		}
 		else
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Log: Socket %d isn't connected"), ConnectionId);
+			UE_LOG(LogLinkStream, Warning, TEXT("Log: Socket %d isn't connected"), ConnectionId);
 		}
 	}
 	else
 	{
-		UE_LOG(LogTemp, Log, TEXT("Log: SocketId %d doesn't exist"), ConnectionId);
+		UE_LOG(LogLinkStream, Log, TEXT("Log: SocketId %d doesn't exist"), ConnectionId);
 	}
 	return false;
 }
 
-void ALinkStreamConnection::ExecuteOnMessageReceived(int32 ConnectionId, TWeakObjectPtr<ALinkStreamConnection> thisObj)
+bool ALinkStreamConnection::SendDataBatch(int32 ConnectionId, TArrayView<FLinkStreamBuffer> Messages, ELinkStreamPriority Priority, ELinkStreamDelivery Delivery)
 {
-	if (!thisObj.IsValid())
-		return;	
-		
-	if (!TcpWorkers.Contains(ConnectionId)) {
-		return;
+	const TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	if (!worker.IsValid() || !worker->IsRunning())
+	{
+		UE_LOG(LogLinkStream, Warning, TEXT("Log: Socket %d isn't connected"), ConnectionId);
+		return false;
 	}
 
-	TArray<uint8> msg = TcpWorkers[ConnectionId]->ReadFromInbox();
-	MessageReceivedDelegate.ExecuteIfBound(ConnectionId, msg);
-}
-
-TArray<uint8> ALinkStreamConnection::Concat_BytesBytes(TArray<uint8> A, TArray<uint8> B)
-{
-	TArray<uint8> ArrayResult;
-
-	for (int i = 0; i < A.Num(); i++)
+	uint8 envelopeBytes[FLinkStreamEnvelope::MaxSize];
+	const int32 envelopeSize = worker->UsesEnvelope() ? FLinkStreamEnvelope().Encode(envelopeBytes) : 0;
+	int64 batchSize = 0;
+	for (const FLinkStreamBuffer& message : Messages)
 	{
-		ArrayResult.Add(A[i]);
+		if (!CanQueue(ConnectionId, *worker, envelopeSize + message.Num(), batchSize))
+		{
+			return false;
+		}
+		batchSize += envelopeSize + message.Num();
 	}
 
-	for (int i = 0; i < B.Num(); i++)
+	if (!worker->AddBatchToOutbox(Messages, Priority, Delivery))
 	{
-		ArrayResult.Add(B[i]);
+		PrintToConsole(FString::Printf(TEXT("SendDataBatch: lane %d of connection %d has no room for %d messages (OutboxCapacity %d)."), (int32)Priority, ConnectionId, Messages.Num(), worker->GetOutboxCapacity()), true);
+		return false;
 	}
+	return true;
+}
 
-	return ArrayResult;
+int32 ALinkStreamConnection::BroadcastData(const TArray<int32>& ConnectionIds, TArray<uint8> DataToSend, ELinkStreamPriority Priority, ELinkStreamDelivery Delivery)
+{
+	return BroadcastShared(ConnectionIds, FLinkStreamBuffer::Share(FLinkStreamBuffer(MoveTemp(DataToSend))), Priority, Delivery);
 }
 
-TArray<uint8> ALinkStreamConnection::Conv_IntToBytes(int32 InInt)
+int32 ALinkStreamConnection::BroadcastShared(TArrayView<const int32> ConnectionIds, const FLinkStreamSharedBuffer& Payload, ELinkStreamPriority Priority, ELinkStreamDelivery Delivery)
 {
-	TArray<uint8> result;
-	for (int i = 0; i < 4; i++)
+	int32 queued = 0;
+	for (const int32 connectionId : ConnectionIds)
 	{
-		result.Add(InInt >> i * 8);
+		const TSharedPtr<FTcpSocketWorker> worker = FindWorker(connectionId);
+		if (!worker.IsValid() || !worker->IsRunning())
+		{
+			UE_LOG(LogLinkStream, Warning, TEXT("Log: Socket %d isn't connected"), connectionId);
+			continue;
+		}
+
+		uint8 envelopeBytes[FLinkStreamEnvelope::MaxSize];
+		const int32 messageSize = Payload->Num() + (worker->UsesEnvelope() ? FLinkStreamEnvelope().Encode(envelopeBytes) : 0);
+		if (!CanQueue(connectionId, *worker, messageSize))
+		{
+			continue;
+		}
+		if (!worker->AddSharedToOutbox(Payload, Priority, Delivery))
+		{
+			PrintToConsole(FString::Printf(TEXT("BroadcastData: lane %d of connection %d is full (OutboxCapacity %d)."), (int32)Priority, connectionId, worker->GetOutboxCapacity()), true);
+			continue;
+		}
+		queued++;
 	}
-	return result;
+	return queued;
 }
 
-TArray<uint8> ALinkStreamConnection::Conv_StringToBytes(const FString& InStr)
+bool ALinkStreamConnection::CanQueue(int32 ConnectionId, const FTcpSocketWorker& Worker, int32 MessageSize, int64 PendingBytes) const
 {
-	FTCHARToUTF8 Convert(*InStr);
-	int BytesLength = Convert.Length();
-	uint8* messageBytes = static_cast<uint8*>(FMemory::Malloc(BytesLength));
-	FMemory::Memcpy(messageBytes, (uint8*)TCHAR_TO_UTF8(InStr.GetCharArray().GetData()), BytesLength);
-
-	TArray<uint8> result;
-	for (int i = 0; i < BytesLength; i++)
+	// The worker's copies, not the properties: those may have been edited since Connect.
+	const int32 maxMessageSize = Worker.GetMaxMessageSize();
+	if (maxMessageSize > 0 && MessageSize > maxMessageSize)
 	{
-		result.Add(messageBytes[i]);
+		PrintToConsole(FString::Printf(TEXT("SendData: message of %d bytes exceeds MaxFrameSize (%d)."), MessageSize, maxMessageSize), true);
+		return false;
 	}
-
-	FMemory::Free(messageBytes);	
-
-	return result;
+	const int32 maxPending = Worker.GetMaxPendingSendBytes();
+	const int64 pending = Worker.GetPendingSendBytes() + PendingBytes;
+	if (maxPending > 0 && pending + MessageSize > maxPending)
+	{
+		PrintToConsole(FString::Printf(TEXT("SendData: connection %d already has %lld unsent bytes (MaxPendingSendBytes %d)."), ConnectionId, pending, maxPending), true);
+		return false;
+	}
+	return true;
 }
 
-TArray<uint8> ALinkStreamConnection::Conv_FloatToBytes(float InFloat)
+TSharedPtr<FTcpSocketWorker> ALinkStreamConnection::FindWorker(int32 ConnectionId) const
 {
-	TArray<uint8> result;
+	FReadScopeLock readLock(TcpWorkersLock);
+	const TSharedRef<FTcpSocketWorker>* worker = TcpWorkers.Find(ConnectionId);
+	return worker ? TSharedPtr<FTcpSocketWorker>(*worker) : TSharedPtr<FTcpSocketWorker>();
+}
 
-	unsigned char const * p = reinterpret_cast<unsigned char const *>(&InFloat);
-	for (int i = 0; i != sizeof(float); i++)
-	{
-		result.Add((uint8)p[i]);
-	}
-	return result;		
+bool ALinkStreamConnection::SendWriter(int32 ConnectionId, FLinkStreamWriter& Writer, ELinkStreamPriority Priority, ELinkStreamDelivery Delivery)
+{
+	return SendData(ConnectionId, Writer.Release(), Priority, Delivery);
 }
 
-TArray<uint8> ALinkStreamConnection::Conv_ByteToBytes(uint8 InByte)
+int32 ALinkStreamConnection::SendRequest(int32 ConnectionId, TArray<uint8> Data, float TimeoutSeconds, ELinkStreamPriority Priority)
 {
-	TArray<uint8> result{ InByte };
-	return result;
+	return BeginRequest(ConnectionId, MoveTemp(Data), TimeoutSeconds, Priority, nullptr);
 }
 
-int32 ALinkStreamConnection::Message_ReadInt(TArray<uint8>& Message)
+TFuture<FLinkStreamResponse> ALinkStreamConnection::SendRequestAsync(int32 ConnectionId, TArray<uint8> Data, float TimeoutSeconds, ELinkStreamPriority Priority, int32* OutRequestId)
 {
-	if (Message.Num() < 4)
+	TFuture<FLinkStreamResponse> future;
+	const int32 requestId = BeginRequest(ConnectionId, MoveTemp(Data), TimeoutSeconds, Priority, &future);
+	if (OutRequestId)
 	{
-		PrintToConsole("Error in the ReadInt node. Not enough bytes in the Message.", true);
-		return -1;
+		*OutRequestId = requestId;
 	}
+	return future;
+}
 
-	int result;
-	unsigned char byteArray[4];
+/** Resumes a SendRequestAndWait node once its future is fulfilled. */
+class FLinkStreamRequestAction : public FPendingLatentAction
+{
+public:
+	FLinkStreamRequestAction(TFuture<FLinkStreamResponse>&& InFuture, TArray<uint8>& InResponse, ELinkStreamRequestResult& InResult, const FLatentActionInfo& LatentInfo)
+		: Future(MoveTemp(InFuture))
+		, Response(InResponse)
+		, Result(InResult)
+		, ExecutionFunction(LatentInfo.ExecutionFunction)
+		, OutputLink(LatentInfo.Linkage)
+		, CallbackTarget(LatentInfo.CallbackTarget)
+	{
+	}
 
-	for (int i = 0; i < 4; i++)
+	virtual void UpdateOperation(FLatentResponse& LatentResponse) override
 	{
-		byteArray[i] = Message[0];		
-		Message.RemoveAt(0);
+		if (!Future.IsReady())
+		{
+			return;
+		}
+
+		FLinkStreamResponse response = Future.Get();
+		Result = response.Result;
+		Response = MoveTemp(response.Payload);
+		LatentResponse.FinishAndTriggerIf(true, ExecutionFunction, OutputLink, CallbackTarget);
 	}
 
-	FMemory::Memcpy(&result, byteArray, 4);
-	
-	return result;
-}
+private:
+	TFuture<FLinkStreamResponse> Future;
+	TArray<uint8>& Response;
+	ELinkStreamRequestResult& Result;
+	FName ExecutionFunction;
+	int32 OutputLink;
+	FWeakObjectPtr CallbackTarget;
+};
 
-uint8 ALinkStreamConnection::Message_ReadByte(TArray<uint8>& Message)
+void ALinkStreamConnection::SendRequestAndWait(int32 ConnectionId, TArray<uint8> Data, float TimeoutSeconds, ELinkStreamPriority Priority, TArray<uint8>& Response, ELinkStreamRequestResult& Result, FLatentActionInfo LatentInfo)
 {
-	if (Message.Num() < 1)
+	UWorld* world = GetWorld();
+	if (!world)
 	{
-		PrintToConsole("Error in the ReadByte node. Not enough bytes in the Message.", true);
-		return 255;
+		Result = ELinkStreamRequestResult::SendFailed;
+		return;
 	}
 
-	uint8 result = Message[0];
-	Message.RemoveAt(0);
-	return result;
-}
-
-bool ALinkStreamConnection::Message_ReadBytes(int32 NumBytes, TArray<uint8>& Message, TArray<uint8>& returnArray)
-{
-	for (int i = 0; i < NumBytes; i++) {
-		if (Message.Num() >= 1)
-			returnArray.Add(Message_ReadByte(Message));
-		else
-			return false;
+	FLatentActionManager& latentManager = world->GetLatentActionManager();
+	if (latentManager.FindExistingAction<FLinkStreamRequestAction>(LatentInfo.CallbackTarget, LatentInfo.UUID))
+	{
+		return;
 	}
-	return true;
+
+	TFuture<FLinkStreamResponse> future;
+	BeginRequest(ConnectionId, MoveTemp(Data), TimeoutSeconds, Priority, &future);
+	latentManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID, new FLinkStreamRequestAction(MoveTemp(future), Response, Result, LatentInfo));
 }
 
-float ALinkStreamConnection::Message_ReadFloat(TArray<uint8>& Message)
+int32 ALinkStreamConnection::BeginRequest(int32 ConnectionId, TArray<uint8>&& Data, float TimeoutSeconds, ELinkStreamPriority Priority, TFuture<FLinkStreamResponse>* OutFuture)
 {
-	if (Message.Num() < 4)
+	const TSharedRef<FTcpSocketWorker>* worker = TcpWorkers.Find(ConnectionId);
+	if (worker && !(*worker)->UsesEnvelope())
 	{
-		PrintToConsole("Error in the ReadFloat node. Not enough bytes in the Message.", true);
-		return -1.f;
+		PrintToConsole(FString::Printf(TEXT("SendRequest: connection %d was opened without bUseEnvelope."), ConnectionId), true);
+		worker = nullptr;
 	}
 
-	float result;
-	unsigned char byteArray[4];
+	// Skip 0, which callers treat as failure, when the counter wraps.
+	const int32 requestId = NextRequestId;
+	NextRequestId = NextRequestId == MAX_int32 ? 1 : NextRequestId + 1;
 
-	for (int i = 0; i < 4; i++)
+	if (!worker || !QueueMessage(ConnectionId, MoveTemp(Data), Priority, FLinkStreamEnvelope(ELinkStreamMessageKind::Request, (uint32)requestId)))
 	{
-		byteArray[i] = Message[0];
-		Message.RemoveAt(0);
+		FLinkStreamResponse response;
+		response.ConnectionId = ConnectionId;
+		response.Result = ELinkStreamRequestResult::SendFailed;
+		if (OutFuture)
+		{
+			*OutFuture = MakeFulfilledPromise<FLinkStreamResponse>(response).GetFuture();
+		}
+		OnResponseReceived.Broadcast(response);
+		return 0;
 	}
 
-	FMemory::Memcpy(&result, byteArray, 4);
+	FPendingRequest& request = PendingRequests.Add(requestId);
+	request.ConnectionId = ConnectionId;
+	request.Deadline = TimeoutSeconds > 0.f ? FPlatformTime::Seconds() + TimeoutSeconds : MAX_dbl;
+	NextRequestDeadline = FMath::Min(NextRequestDeadline, request.Deadline);
+	if (OutFuture)
+	{
+		*OutFuture = request.Promise.GetFuture();
+	}
+	return requestId;
+}
 
-	return result;
+bool ALinkStreamConnection::SendResponse(int32 ConnectionId, int32 RequestId, TArray<uint8> Data, ELinkStreamPriority Priority)
+{
+	return QueueMessage(ConnectionId, MoveTemp(Data), Priority, FLinkStreamEnvelope(ELinkStreamMessageKind::Response, (uint32)RequestId));
 }
 
-FString ALinkStreamConnection::Message_ReadString(TArray<uint8>& Message, int32 BytesLength)
+void ALinkStreamConnection::CompleteRequest(int32 RequestId, ELinkStreamRequestResult Result, TArray<uint8>&& Payload)
 {
-	if (BytesLength <= 0)
-	{
-		if (BytesLength < 0)
-			PrintToConsole("Error in the ReadString node. BytesLength isn't a positive number.", true);
-		return FString("");
-	}
-	if (Message.Num() < BytesLength)
+	if (!PendingRequests.Contains(RequestId))
 	{
-		PrintToConsole("Error in the ReadString node. Message isn't as long as BytesLength.", true);
-		return FString("");
+		return;
 	}
+	FPendingRequest request = PendingRequests.FindAndRemoveChecked(RequestId);
 
-	TArray<uint8> StringAsArray;
-	StringAsArray.Reserve(BytesLength);
-
-	for (int i = 0; i < BytesLength; i++)
-	{
-		StringAsArray.Add(Message[0]);
-		Message.RemoveAt(0);
-	}
+	FLinkStreamResponse response;
+	response.ConnectionId = request.ConnectionId;
+	response.RequestId = RequestId;
+	response.Result = Result;
+	response.Payload = MoveTemp(Payload);
 
-	std::string cstr(reinterpret_cast<const char*>(StringAsArray.GetData()), StringAsArray.Num());	
-	return FString(UTF8_TO_TCHAR(cstr.c_str()));
+	OnResponseReceived.Broadcast(response);
+	request.Promise.SetValue(MoveTemp(response));
 }
 
-bool ALinkStreamConnection::isConnected(int32 ConnectionId)
+void ALinkStreamConnection::FailPendingRequests(int32 ConnectionId)
 {
-	if (TcpWorkers.Contains(ConnectionId))
-		return TcpWorkers[ConnectionId]->isConnected();
-	return false;
+	TArray<int32> failed;
+	for (const TPair<int32, FPendingRequest>& request : PendingRequests)
+	{
+		if (request.Value.ConnectionId == ConnectionId)
+		{
+			failed.Add(request.Key);
+		}
+	}
+
+	for (int32 requestId : failed)
+	{
+		CompleteRequest(requestId, ELinkStreamRequestResult::Disconnected);
+	}
 }
 
-void ALinkStreamConnection::PrintToConsole(FString Str, bool Error)
+void ALinkStreamConnection::ExpirePendingRequests()
 {
-	if (auto LinkStreamSettings = GetDefault<ULinkStreamSettings>())
+	const double now = FPlatformTime::Seconds();
+	TArray<int32> expired;
+	NextRequestDeadline = MAX_dbl;
+	for (const TPair<int32, FPendingRequest>& request : PendingRequests)
 	{
-		if (Error && LinkStreamSettings->bPostErrorsToMessageLog)
+		if (request.Value.Deadline <= now)
 		{
-			auto messageLog = FMessageLog("Tcp Socket Plugin");
-			messageLog.Open(EMessageSeverity::Error, true);
-			messageLog.Message(EMessageSeverity::Error, FText::AsCultureInvariant(Str));
+			expired.Add(request.Key);
 		}
 		else
 		{
-			UE_LOG(LogTemp, Log, TEXT("Log: %s"), *Str);
+			NextRequestDeadline = FMath::Min(NextRequestDeadline, request.Value.Deadline);
 		}
 	}
+
+	for (int32 requestId : expired)
+	{
+		CompleteRequest(requestId, ELinkStreamRequestResult::TimedOut);
+	}
 }
 
-void ALinkStreamConnection::ExecuteOnConnected(int32 WorkerId, TWeakObjectPtr<ALinkStreamConnection> thisObj)
+void ALinkStreamConnection::ExecuteOnMessageReceived(int32 ConnectionId, TWeakObjectPtr<ALinkStreamConnection> thisObj)
 {
 	if (!thisObj.IsValid())
+		return;	
+		
+	if (!TcpWorkers.Contains(ConnectionId)) {
 		return;
+	}
 
-	ConnectedDelegate.ExecuteIfBound(WorkerId);
+	FLinkStreamBuffer msg;
+	if (TcpWorkers[ConnectionId]->TryReadFromInbox(msg))
+	{
+		DeliverMessage(ConnectionId, msg);
+	}
 }
 
-void ALinkStreamConnection::ExecuteOnDisconnected(int32 WorkerId, TWeakObjectPtr<ALinkStreamConnection> thisObj)
+void ALinkStreamConnection::ExecuteOnSendBackpressure(int32 ConnectionId, bool bBackpressured, TWeakObjectPtr<ALinkStreamConnection> thisObj)
 {
 	if (!thisObj.IsValid())
 		return;
 
-	if (TcpWorkers.Contains(WorkerId))
-	{		
-		TcpWorkers.Remove(WorkerId);		
-	}
-	DisconnectedDelegate.ExecuteIfBound(WorkerId);
+	OnSendBackpressure.Broadcast(ConnectionId, bBackpressured);
 }
 
-bool FTcpSocketWorker::isConnected()
+void ALinkStreamConnection::ExecuteOnConnectionStateChanged(int32 ConnectionId, ELinkStreamConnectionState State, TWeakObjectPtr<ALinkStreamConnection> thisObj)
 {
-	///FScopeLock ScopeLock(&SendCriticalSection);
-	return bConnected;
+	if (!thisObj.IsValid())
+		return;
+
+	OnConnectionStateChanged.Broadcast(ConnectionId, State);
 }
 
-FTcpSocketWorker::FTcpSocketWorker(FString inIp, const int32 inPort, TWeakObjectPtr<ALinkStreamConnection> InOwner, int32 inId, int32 inRecvBufferSize, int32 inSendBufferSize, float inTimeBetweenTicks)
-	: ipAddress(inIp)
-	, port(inPort)
-	, ThreadSpawnerActor(InOwner)
-	, id(inId)
-	, RecvBufferSize(inRecvBufferSize)
-	, SendBufferSize(inSendBufferSize)
-	, TimeBetweenTicks(inTimeBetweenTicks)
+ELinkStreamConnectionState ALinkStreamConnection::GetConnectionState(int32 ConnectionId) const
 {
-	
+	const TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	return worker.IsValid() ? worker->GetState() : ELinkStreamConnectionState::Failed;
 }
 
-FTcpSocketWorker::~FTcpSocketWorker()
+int64 ALinkStreamConnection::GetPendingSendBytes(int32 ConnectionId) const
 {
-	AsyncTask(ENamedThreads::GameThread, []() {	ALinkStreamConnection::PrintToConsole("Tcp socket thread was destroyed.", false); });
+	const TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	return worker.IsValid() ? worker->GetPendingSendBytes() : 0;
+}
+
+FLinkStreamHeartbeatStats ALinkStreamConnection::GetHeartbeatStats(int32 ConnectionId) const
+{
+	const TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	return worker.IsValid() ? worker->GetHeartbeatStats() : FLinkStreamHeartbeatStats();
+}
+
+FLinkStreamInboxStats ALinkStreamConnection::GetInboxStats(int32 ConnectionId) const
+{
+	const TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	return worker.IsValid() ? worker->GetInboxStats() : FLinkStreamInboxStats();
+}
+
+FLinkStreamCompressionStats ALinkStreamConnection::GetCompressionStats(int32 ConnectionId) const
+{
+	TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	return worker.IsValid() ? worker->GetCompressionStats() : FLinkStreamCompressionStats();
+}
+
+FLinkStreamDeltaStats ALinkStreamConnection::GetDeltaStats(int32 ConnectionId) const
+{
+	TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	return worker.IsValid() ? worker->GetDeltaStats() : FLinkStreamDeltaStats();
+}
+
+FLinkStreamTlsStats ALinkStreamConnection::GetTlsStats(int32 ConnectionId) const
+{
+	TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	return worker.IsValid() ? worker->GetTlsStats() : FLinkStreamTlsStats();
+}
+
+TArray<FLinkStreamLaneStats> ALinkStreamConnection::GetLaneStats(int32 ConnectionId) const
+{
+	TArray<FLinkStreamLaneStats> stats;
+	const TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	if (worker.IsValid() && !worker->IsInproc())
+	{
+		for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+		{
+			stats.Add(worker->GetLaneStats((ELinkStreamPriority)lane));
+		}
+	}
+	return stats;
+}
+
+FLinkStreamSyscallStats ALinkStreamConnection::GetSyscallStats()
+{
+	FLinkStreamSyscallStats stats;
+	stats.Recv = FLinkStreamSocket::Syscalls.Recv.load(std::memory_order_relaxed);
+	stats.Send = FLinkStreamSocket::Syscalls.Send.load(std::memory_order_relaxed);
+	stats.Control = FLinkStreamSocket::Syscalls.Control.load(std::memory_order_relaxed);
+	stats.Poll = FLinkStreamSocket::Syscalls.Poll.load(std::memory_order_relaxed);
+	return stats;
+}
+
+FLinkStreamBufferPoolStats ALinkStreamConnection::GetBufferPoolStats()
+{
+	FLinkStreamBufferPool* pool = FLinkStreamBufferPool::Get();
+	return pool ? pool->GetStats() : FLinkStreamBufferPoolStats();
+}
+
+TArray<uint8> ALinkStreamConnection::Concat_BytesBytes(const TArray<uint8>& A, const TArray<uint8>& B)
+{
+	TArray<uint8> ArrayResult;
+	ArrayResult.Reserve(A.Num() + B.Num());
+	ArrayResult.Append(A);
+	ArrayResult.Append(B);
+	return ArrayResult;
+}
+
+TArray<uint8> ALinkStreamConnection::Conv_IntToBytes(int32 InInt)
+{
+	FLinkStreamWriter writer(sizeof(int32));
+	writer.WriteInteger(InInt);
+	return writer.Release();
+}
+
+TArray<uint8> ALinkStreamConnection::Conv_StringToBytes(const FString& InStr)
+{
+	FLinkStreamWriter writer(FLinkStreamWriter::GetUTF8Length(InStr));
+	writer.WriteString(InStr);
+	return writer.Release();
+}
+
+TArray<uint8> ALinkStreamConnection::Conv_FloatToBytes(float InFloat)
+{
+	FLinkStreamWriter writer(sizeof(float));
+	writer.WriteFloat(InFloat);
+	return writer.Release();
+}
+
+TArray<uint8> ALinkStreamConnection::Conv_ByteToBytes(uint8 InByte)
+{
+	TArray<uint8> result{ InByte };
+	return result;
+}
+
+int32 ALinkStreamConnection::Message_ReadInt(TArray<uint8>& Message, int32& ReadOffset)
+{
+	FLinkStreamReader reader(MakeArrayView(Message));
+	int32 result;
+	if (!reader.Seek(ReadOffset) || !reader.ReadInteger(result))
+	{
+		PrintToConsole("Error in the ReadInt node. Not enough bytes in the Message.", true);
+		return -1;
+	}
+
+	AdvanceMessageRead(Message, ReadOffset, reader.GetOffset());
+	return result;
+}
+
+uint8 ALinkStreamConnection::Message_ReadByte(TArray<uint8>& Message, int32& ReadOffset)
+{
+	FLinkStreamReader reader(MakeArrayView(Message));
+	uint8 result;
+	if (!reader.Seek(ReadOffset) || !reader.ReadInteger(result))
+	{
+		PrintToConsole("Error in the ReadByte node. Not enough bytes in the Message.", true);
+		return 255;
+	}
+
+	AdvanceMessageRead(Message, ReadOffset, reader.GetOffset());
+	return result;
+}
+
+bool ALinkStreamConnection::Message_ReadBytes(int32 NumBytes, TArray<uint8>& Message, int32& ReadOffset, TArray<uint8>& returnArray)
+{
+	if (ReadOffset < 0 || ReadOffset > Message.Num())
+	{
+		PrintToConsole("Error in the ReadBytes node. ReadOffset is outside the Message.", true);
+		return false;
+	}
+
+	// Like the byte-by-byte version this replaces, a short message still hands over what it has.
+	const int32 available = FMath::Clamp(NumBytes, 0, Message.Num() - ReadOffset);
+	returnArray.Append(Message.GetData() + ReadOffset, available);
+	AdvanceMessageRead(Message, ReadOffset, ReadOffset + available);
+	return available == NumBytes || NumBytes <= 0;
+}
+
+float ALinkStreamConnection::Message_ReadFloat(TArray<uint8>& Message, int32& ReadOffset)
+{
+	FLinkStreamReader reader(MakeArrayView(Message));
+	float result;
+	if (!reader.Seek(ReadOffset) || !reader.ReadFloat(result))
+	{
+		PrintToConsole("Error in the ReadFloat node. Not enough bytes in the Message.", true);
+		return -1.f;
+	}
+
+	AdvanceMessageRead(Message, ReadOffset, reader.GetOffset());
+	return result;
+}
+
+FString ALinkStreamConnection::Message_ReadString(TArray<uint8>& Message, int32& ReadOffset, int32 BytesLength)
+{
+	if (BytesLength <= 0)
+	{
+		if (BytesLength < 0)
+			PrintToConsole("Error in the ReadString node. BytesLength isn't a positive number.", true);
+		return FString("");
+	}
+
+	FLinkStreamReader reader(MakeArrayView(Message));
+	FString result;
+	if (!reader.Seek(ReadOffset) || !reader.ReadString(result, BytesLength))
+	{
+		PrintToConsole("Error in the ReadString node. Message isn't as long as BytesLength.", true);
+		return FString("");
+	}
+
+	AdvanceMessageRead(Message, ReadOffset, reader.GetOffset());
+	return result;
+}
+
+void ALinkStreamConnection::ConsumeMessageFront(TArray<uint8>& Message, int32 NumBytes)
+{
+	if (NumBytes > 0)
+	{
+		Message.RemoveAt(0, NumBytes, false);
+	}
+}
+
+void ALinkStreamConnection::AdvanceMessageRead(TArray<uint8>& Message, int32& ReadOffset, int32 NewOffset)
+{
+	// Nothing moves until the message is used up; then it is emptied once, keeping the allocation for the next message.
+	ReadOffset = NewOffset;
+	if (ReadOffset >= Message.Num())
+	{
+		Message.Reset();
+		ReadOffset = 0;
+	}
+}
+
+bool ALinkStreamConnection::isConnected(int32 ConnectionId)
+{
+	const TSharedPtr<FTcpSocketWorker> worker = FindWorker(ConnectionId);
+	if (worker.IsValid())
+		return worker->isConnected();
+	return false;
+}
+
+void ALinkStreamConnection::PrintToConsole(FString Str, bool Error)
+{
+	if (auto LinkStreamSettings = GetDefault<ULinkStreamSettings>())
+	{
+		if (Error && LinkStreamSettings->bPostErrorsToMessageLog && IsInGameThread())
+		{
+			auto messageLog = FMessageLog("Tcp Socket Plugin");
+			messageLog.Open(EMessageSeverity::Error, true);
+			messageLog.Message(EMessageSeverity::Error, FText::AsCultureInvariant(Str));
+		}
+		else
+		{
+			UE_LOG(LogLinkStream, Log, TEXT("Log: %s"), *Str);
+		}
+	}
+}
+
+void ALinkStreamConnection::OnWorkerConnected(int32 WorkerId)
+{
+	ExecuteOnConnected(WorkerId, this);
+}
+
+void ALinkStreamConnection::OnWorkerDisconnected(int32 WorkerId)
+{
+	ExecuteOnDisconnected(WorkerId, this);
+}
+
+void ALinkStreamConnection::OnWorkerMessage(int32 WorkerId)
+{
+	ExecuteOnMessageReceived(WorkerId, this);
+}
+
+void ALinkStreamConnection::OnWorkerSendBackpressure(int32 WorkerId, bool bBackpressured)
+{
+	ExecuteOnSendBackpressure(WorkerId, bBackpressured, this);
+}
+
+void ALinkStreamConnection::OnWorkerStateChanged(int32 WorkerId, ELinkStreamConnectionState State)
+{
+	// Requests on a dropped link will not be answered, even if auto-reconnect brings it back.
+	if (State == ELinkStreamConnectionState::Reconnecting)
+	{
+		FailPendingRequests(WorkerId);
+	}
+	ExecuteOnConnectionStateChanged(WorkerId, State, this);
+}
+
+void ALinkStreamConnection::ExecuteOnConnected(int32 WorkerId, TWeakObjectPtr<ALinkStreamConnection> thisObj)
+{
+	if (!thisObj.IsValid())
+		return;
+
+	ConnectedDelegate.ExecuteIfBound(WorkerId);
+}
+
+void ALinkStreamConnection::ExecuteOnDisconnected(int32 WorkerId, TWeakObjectPtr<ALinkStreamConnection> thisObj)
+{
+	if (!thisObj.IsValid())
+		return;
+
+	if (TcpWorkers.Contains(WorkerId))
+	{		
+		FWriteScopeLock writeLock(TcpWorkersLock);
+		TcpWorkers.Remove(WorkerId);		
+	}
+	FailPendingRequests(WorkerId);
+	DisconnectedDelegate.ExecuteIfBound(WorkerId);
+}
+
+bool FTcpSocketWorker::isConnected()
+{
+	///FScopeLock ScopeLock(&SendCriticalSection);
+	if (Inproc)
+	{
+		return Inproc->IsAttachedTo(Owner, id);
+	}
+	return bConnected;
+}
+
+ELinkStreamConnectionState FTcpSocketWorker::GetState() const
+{
+	// The managed side can close an inproc connection without going through the worker.
+	if (Inproc && State == ELinkStreamConnectionState::Connected && !Inproc->IsAttachedTo(Owner, id))
+	{
+		return ELinkStreamConnectionState::Disconnected;
+	}
+	return State;
+}
+
+bool FTcpSocketWorker::IsRunning() const
+{
+	if (Inproc)
+	{
+		return Inproc->IsAttachedTo(Owner, id);
+	}
+	return bRun;
+}
+
+FTcpSocketWorker::FTcpSocketWorker(FString inIp, const int32 inPort, ILinkStreamWorkerOwner* InOwner, int32 inId, const FTcpSocketWorkerSettings& InSettings)
+	: ipAddress(FLinkStreamUdpSession::GetHost(inIp))
+	, port(inPort)
+	, OwnerObject(InOwner ? InOwner->GetWorkerOwnerObject() : nullptr)
+	, Owner(InOwner)
+	, id(inId)
+	, Settings(NormalizeWorkerSettings(InSettings, FLinkStreamUdpSession::IsUdpAddress(inIp)))
+	, ReconnectRandom((int32)FPlatformTime::Cycles() ^ inId)
+	, Inproc(FLinkStreamInprocEndpoint::FindOrCreate(inIp))
+	, bUdp(FLinkStreamUdpSession::IsUdpAddress(inIp))
+{
+	if (Inproc)
+	{
+		return;
+	}
+	for (TLinkStreamMpscQueue<FLinkStreamOutgoingMessage>& outbox : Outboxes)
+	{
+		outbox.Init(Settings.OutboxCapacity);
+	}
+	Inbox.Configure(Settings.InboxLimit, Settings.InboxOverflow, Settings.CoalesceKeySize);
+	Heartbeat.Configure(Settings.bUseEnvelope ? Settings.HeartbeatInterval : 0.f, Settings.IdleTimeout);
+	Compressor.Configure(Settings.Compression, Settings.CompressionThreshold);
+	Delta.Configure(Settings.bDeltaEncoding, Settings.DeltaKeySize, Settings.DeltaKeyframeInterval);
+	if (Settings.bTls && !bUdp)
+	{
+		Tls = MakeUnique<FLinkStreamTlsConnection>(Settings.TlsServerContext, Settings.bTlsVerifyPeer, Settings.TlsTrustedCertificates, Settings.TlsServerName);
+	}
+	else if (Settings.bEncrypt && !bUdp && Settings.Framing != ELinkStreamFraming::None)
+	{
+		Cipher = MakeUnique<FLinkStreamCipher>(Settings.EncryptionKey);
+	}
+	if (!bUdp)
+	{
+		const int32 maxFrame = Settings.MaxFrameSize + (Cipher ? FLinkStreamCipher::Overhead : 0);
+		RecvRing.Init(Settings.Framing != ELinkStreamFraming::None ? FMath::Max(Settings.RecvBufferSize, maxFrame + FLinkStreamFraming::MaxHeaderSize) : Settings.RecvBufferSize);
+	}
+}
+
+FTcpSocketWorker::~FTcpSocketWorker()
+{
+	AsyncTask(ENamedThreads::GameThread, []() {	ALinkStreamConnection::PrintToConsole("Tcp socket thread was destroyed.", false); });
 	Stop();
 	if (Thread)
 	{
-		Thread->WaitForCompletion();
-		delete Thread;
-		Thread = nullptr;
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+}
+
+void FTcpSocketWorker::Start()
+{
+	if (Inproc)
+	{
+		bRun = true;
+		bConnected = Inproc->Attach(Owner, id, Settings);
+		if (!bConnected)
+		{
+			const FString name = Inproc->GetName();
+			AsyncTask(ENamedThreads::GameThread, [name]() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Couldn't connect: inproc endpoint %s already has a connection."), *name), true); });
+			bRun = false;
+			SetState(ELinkStreamConnectionState::Failed);
+			return;
+		}
+		SetState(ELinkStreamConnectionState::Connected);
+		PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerConnected(workerId); });
+		return;
+	}
+
+	if (Settings.Backend == ELinkStreamBackend::Reactor)
+	{
+		bRun = true;
+		bConnected = false;
+		Reactor = FLinkStreamModule::Get().GetReactorPool().Register(AsShared());
+		return;
+	}
+
+	// Without a poller the thread falls back to polling every TimeBetweenTicks.
+	if (Settings.WakeMode == ELinkStreamWakeMode::EventDriven)
+	{
+		Poller = MakeUnique<FLinkStreamPoller>();
+		Wakeup = MakeUnique<FLinkStreamWakeup>();
+		if (!Poller->Init() || !Wakeup->Init() || !Poller->Add(Wakeup->GetNative(), Wakeup.Get(), false))
+		{
+			UE_LOG(LogLinkStream, Warning, TEXT("Log: Could not create the wakeup primitive, falling back to polling."));
+			Poller.Reset();
+			Wakeup.Reset();
+		}
+	}
+
+	check(!Thread && "Thread wasn't null at the start!");
+	check(FPlatformProcess::SupportsMultithreading() && "This platform doesn't support multithreading!");	
+	if (Thread)
+	{
+		UE_LOG(LogLinkStream, Log, TEXT("Log: Thread isn't null. It's: %s"), *Thread->GetThreadName());
+	}
+	Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("FTcpSocketWorker %s:%d"), *ipAddress, port), 128 * 1024, TPri_Normal);
+	UE_LOG(LogLinkStream, Log, TEXT("Log: Created thread"));
+}
+
+void FTcpSocketWorker::StartAccepted(FLinkStreamSocket* InSocket)
+{
+	check(Settings.Backend == ELinkStreamBackend::Reactor);
+	Socket = InSocket;
+	bRun = true;
+	bConnected = false;
+	Reactor = FLinkStreamModule::Get().GetReactorPool().Register(AsShared());
+}
+
+void FTcpSocketWorker::PostToOwner(TUniqueFunction<void(ILinkStreamWorkerOwner&, int32)>&& Call)
+{
+	if (!Owner)
+	{
+		return;
+	}
+
+	TWeakObjectPtr<UObject> ownerObject = OwnerObject;
+	ILinkStreamWorkerOwner* owner = Owner;
+	const int32 workerId = id;
+	AsyncTask(ENamedThreads::GameThread, [ownerObject, owner, workerId, Call = MoveTemp(Call)]() {
+		if (ownerObject.IsValid())
+		{
+			Call(*owner, workerId);
+		}
+	});
+}
+
+bool FTcpSocketWorker::AddToOutbox(TArray<uint8> Message)
+{
+	return AddToOutbox(FLinkStreamBuffer(MoveTemp(Message)));
+}
+
+bool FTcpSocketWorker::AddToOutbox(FLinkStreamBuffer&& Message, ELinkStreamPriority Priority, const FLinkStreamEnvelope& Envelope, ELinkStreamDelivery Delivery)
+{
+	if (Inproc)
+	{
+		if (!Inproc->Reserve(1))
+		{
+			return false;
+		}
+		SendInproc(MoveTemp(Message), Envelope);
+		return true;
+	}
+
+	if (Settings.bUseEnvelope && Envelope.Kind == ELinkStreamMessageKind::Message && Delivery == ELinkStreamDelivery::ReliableOrdered
+		&& Delta.IsNegotiated() && Message.Num() >= Delta.Encoder.GetKeySize())
+	{
+		return AddDeltaToOutbox(Message, Priority, Envelope);
+	}
+	return EnqueueOutgoing(Message, Priority, Envelope, Delivery);
+}
+
+void FTcpSocketWorker::SendInproc(FLinkStreamBuffer&& Message, const FLinkStreamEnvelope& Envelope)
+{
+	// Inproc messages are a single buffer, so the envelope costs a copy here.
+	uint8 envelopeBytes[FLinkStreamEnvelope::MaxSize];
+	const int32 envelopeSize = Settings.bUseEnvelope ? Envelope.Encode(envelopeBytes) : 0;
+	if (envelopeSize > 0)
+	{
+		FLinkStreamBuffer enveloped = FLinkStreamBuffer::Acquire(envelopeSize + Message.Num());
+		enveloped.GetArray().Append(envelopeBytes, envelopeSize);
+		enveloped.GetArray().Append(Message.GetArray());
+		Message = MoveTemp(enveloped);
+	}
+	Inproc->Send(MoveTemp(Message));
+}
+
+bool FTcpSocketWorker::AddDeltaToOutbox(FLinkStreamBuffer& Message, ELinkStreamPriority Priority, const FLinkStreamEnvelope& Envelope)
+{
+	// Deltas have to reach the outbox in the order they were encoded, or the peer applies them to the wrong baseline.
+	FScopeLock lock(&Delta.Lock);
+	const int32 rawSize = Message.Num();
+	const uint8 lane = (uint8)FMath::Clamp((int32)Priority, 0, LinkStreamNumLanes - 1);
+	uint64 key = 0;
+	FLinkStreamDeltaEncoder::ReadKey(Message.GetData(), rawSize, Delta.Encoder.GetKeySize(), key);
+	FLinkStreamEnvelope envelope = Envelope;
+	FLinkStreamBuffer delta;
+	if (Delta.Encoder.Encode(Message.GetData(), rawSize, delta))
+	{
+		const int32 deltaSize = delta.Num();
+		envelope.Flags |= FLinkStreamEnvelope::DeltaFlag;
+		if (!EnqueueOutgoing(delta, Priority, envelope, ELinkStreamDelivery::ReliableOrdered, key))
+		{
+			return false;
+		}
+		Delta.Encoder.Commit(Message.Detach(), false, lane);
+		Delta.CountDelta(rawSize, deltaSize);
+		return true;
+	}
+
+	// The keyframe itself goes to the outbox, so the baseline is a copy.
+	TArray<uint8> baseline(Message.GetData(), rawSize);
+	envelope.Flags |= FLinkStreamEnvelope::KeyframeFlag;
+	if (!EnqueueOutgoing(Message, Priority, envelope, ELinkStreamDelivery::ReliableOrdered, key))
+	{
+		return false;
+	}
+	Delta.Encoder.Commit(MoveTemp(baseline), true, lane);
+	Delta.CountKeyframe(rawSize);
+	return true;
+}
+
+bool FTcpSocketWorker::EnqueueOutgoing(FLinkStreamBuffer& Message, ELinkStreamPriority Priority, const FLinkStreamEnvelope& Envelope, ELinkStreamDelivery Delivery, uint64 DeltaKey)
+{
+	// A compressed copy is queued instead, so a full lane still leaves Message as it was.
+	FLinkStreamBuffer compressed;
+	FLinkStreamEnvelope envelope = Envelope;
+	if (Settings.bUseEnvelope)
+	{
+		compressed = Compressor.Compress(Message, envelope);
+	}
+	const bool bCompressed = compressed.Num() > 0;
+
+	FLinkStreamOutgoingMessage outgoing;
+	outgoing.Payload = bCompressed ? MoveTemp(compressed) : MoveTemp(Message);
+	outgoing.DeltaFlags = envelope.Flags & (FLinkStreamEnvelope::DeltaFlag | FLinkStreamEnvelope::KeyframeFlag);
+	outgoing.DeltaKey = DeltaKey;
+	PrepareOutgoing(envelope, Delivery, outgoing);
+	const int64 messageSize = outgoing.GetWireSize();
+	const int32 lane = FMath::Clamp((int32)Priority, 0, LinkStreamNumLanes - 1);
+	if (!Outboxes[lane].Enqueue(MoveTemp(outgoing)))
+	{
+		if (!bCompressed)
+		{
+			Message = MoveTemp(outgoing.Payload);
+		}
+		return false;
+	}
+
+	OnQueued(lane, 1, messageSize);
+	return true;
+}
+
+bool FTcpSocketWorker::AddBatchToOutbox(TArrayView<FLinkStreamBuffer> Messages, ELinkStreamPriority Priority, ELinkStreamDelivery Delivery)
+{
+	if (Inproc)
+	{
+		// All or nothing, as on a socket.
+		if (!Inproc->Reserve(Messages.Num()))
+		{
+			return false;
+		}
+		for (FLinkStreamBuffer& message : Messages)
+		{
+			SendInproc(MoveTemp(message), FLinkStreamEnvelope());
+		}
+		return true;
+	}
+
+	TArray<FLinkStreamOutgoingMessage, TInlineAllocator<16>> batch;
+	batch.SetNum(Messages.Num());
+	int64 batchSize = 0;
+	for (int32 index = 0; index < Messages.Num(); index++)
+	{
+		batch[index].Payload = MoveTemp(Messages[index]);
+		PrepareOutgoing(FLinkStreamEnvelope(), Delivery, batch[index]);
+		batchSize += batch[index].GetWireSize();
+	}
+
+	const int32 lane = FMath::Clamp((int32)Priority, 0, LinkStreamNumLanes - 1);
+	if (!Outboxes[lane].EnqueueBatch(batch.GetData(), batch.Num()))
+	{
+		for (int32 index = 0; index < Messages.Num(); index++)
+		{
+			Messages[index] = MoveTemp(batch[index].Payload);
+		}
+		return false;
+	}
+
+	OnQueued(lane, batch.Num(), batchSize);
+	return true;
+}
+
+bool FTcpSocketWorker::AddSharedToOutbox(const FLinkStreamSharedBuffer& Payload, ELinkStreamPriority Priority, ELinkStreamDelivery Delivery)
+{
+	if (Inproc)
+	{
+		FLinkStreamBuffer copy = FLinkStreamBuffer::Acquire(Payload->Num());
+		copy.GetArray().Append(Payload->GetArray());
+		return AddToOutbox(MoveTemp(copy), Priority, FLinkStreamEnvelope(), Delivery);
+	}
+
+	FLinkStreamOutgoingMessage outgoing;
+	outgoing.SharedPayload = Payload;
+	PrepareOutgoing(FLinkStreamEnvelope(), Delivery, outgoing);
+	const int64 messageSize = outgoing.GetWireSize();
+	const int32 lane = FMath::Clamp((int32)Priority, 0, LinkStreamNumLanes - 1);
+	if (!Outboxes[lane].Enqueue(MoveTemp(outgoing)))
+	{
+		return false;
+	}
+
+	OnQueued(lane, 1, messageSize);
+	return true;
+}
+
+void FTcpSocketWorker::PrepareOutgoing(const FLinkStreamEnvelope& Envelope, ELinkStreamDelivery Delivery, FLinkStreamOutgoingMessage& InOutOutgoing) const
+{
+	uint8 envelopeBytes[FLinkStreamEnvelope::MaxSize];
+	const int32 envelopeSize = Settings.bUseEnvelope ? Envelope.Encode(envelopeBytes) : 0;
+
+	// The UDP session delimits messages itself, so they need no length prefix.
+	const int32 sealSize = Cipher ? FLinkStreamCipher::Overhead : 0;
+	InOutOutgoing.HeaderSize = bUdp ? 0 : FLinkStreamFraming::EncodeHeader(Settings.Framing, (uint32)(sealSize + envelopeSize + InOutOutgoing.GetPayloadSize()), InOutOutgoing.Header);
+	if (Cipher)
+	{
+		InOutOutgoing.SealOffset = InOutOutgoing.HeaderSize;
+		InOutOutgoing.HeaderSize += FLinkStreamCipher::SequenceSize;
+	}
+	FMemory::Memcpy(InOutOutgoing.Header + InOutOutgoing.HeaderSize, envelopeBytes, envelopeSize);
+	InOutOutgoing.HeaderSize += envelopeSize;
+	InOutOutgoing.Delivery = Delivery;
+}
+
+void FTcpSocketWorker::OnQueued(int32 Lane, int32 NumMessages, int64 NumBytes)
+{
+	FLaneCounters& counters = LaneCounters[Lane];
+	counters.QueuedBytes.Add(NumBytes);
+	const int32 queued = counters.QueuedMessages.Add(NumMessages) + NumMessages;
+	int32 peak = counters.PeakQueuedMessages.load(std::memory_order_relaxed);
+	while (queued > peak && !counters.PeakQueuedMessages.compare_exchange_weak(peak, queued, std::memory_order_relaxed))
+	{
+	}
+
+	const int64 pending = PendingSendBytes.Add(NumBytes) + NumBytes;
+	if (Settings.SendHighWatermark > 0 && pending >= Settings.SendHighWatermark && !bSendBackpressured.AtomicSet(true))
+	{
+		NotifySendBackpressure(true);
+	}
+
+	if (Settings.FlushMode == ELinkStreamFlushMode::Immediate)
+	{
+		WakeWorker();
+	}
+}
+
+void FTcpSocketWorker::RequestFlush()
+{
+	bFlushRequested = true;
+	WakeWorker();
+}
+
+void FTcpSocketWorker::NotifySendBackpressure(bool bBackpressured)
+{
+	PostToOwner([bBackpressured](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerSendBackpressure(workerId, bBackpressured); });
+}
+
+bool FTcpSocketWorker::ConsumeFlushRequest()
+{
+	if (Settings.FlushMode == ELinkStreamFlushMode::Immediate)
+	{
+		return true;
+	}
+	return bFlushRequested.AtomicSet(false);
+}
+
+TArray<uint8> FTcpSocketWorker::ReadFromInbox()
+{
+	FLinkStreamBuffer msg;
+	TryReadFromInbox(msg);
+	return msg.Detach();
+}
+
+bool FTcpSocketWorker::TryReadFromInbox(FLinkStreamBuffer& OutMessage)
+{
+	if (Inproc)
+	{
+		return Inproc->Receive(OutMessage);
+	}
+
+	bool bResumed = false;
+	if (!Inbox.Pop(OutMessage, bResumed))
+	{
+		return false;
+	}
+	if (bResumed)
+	{
+		WakeWorker();
+	}
+	return true;
+}
+
+bool FTcpSocketWorker::Init()
+{
+	bRun = true;
+	bConnected = false;
+	return true;
+}
+
+uint32 FTcpSocketWorker::Run()
+{
+	AsyncTask(ENamedThreads::GameThread, []() {	ALinkStreamConnection::PrintToConsole("Starting Tcp socket thread.", false); });
+
+	while (bRun)
+	{
+		FDateTime timeBeginningOfTick = FDateTime::UtcNow();
+
+		if (!bConnected)
+		{
+			// Wakeups from queued messages must not cut the backoff short.
+			const double now = FPlatformTime::Seconds();
+			if (ReconnectAt > now)
+			{
+				WaitFor(ReconnectAt - now);
+				continue;
+			}
+			ReconnectAt = 0.0;
+
+			if (ConnectWithTimeout())
+			{
+				bConnected = true;
+				ReconnectAttempts = 0;
+				Heartbeat.Reset(FPlatformTime::Seconds());
+				StartTls();
+				StartEncryption();
+				StartNegotiation();
+				SetState(ELinkStreamConnectionState::Connected);
+				PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerConnected(workerId); });
+			}
+			else if (bRun && !HandleConnectionLost())
+			{
+				bRun = false;
+			}
+			continue;
+		}
+
+		if (!Socket)
+		{
+			AsyncTask(ENamedThreads::GameThread, []() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Socket is null. TcpSocketConnection.cpp: line %d"), __LINE__), true); });
+			bRun = false;
+			continue;
+		}
+
+
+		// Sends never block: when the kernel buffer is full the unwritten part of the batch waits for the next pass.
+		const ELinkStreamSocketResult sendResult = SendQueued(ConsumeFlushRequest());
+		if (sendResult != ELinkStreamSocketResult::Ok && sendResult != ELinkStreamSocketResult::WouldBlock)
+		{
+			UE_LOG(LogLinkStream, Log, TEXT("TCP send data failed !"));
+			if (!HandleConnectionLost())
+			{
+				bRun = false;
+			}
+			continue;
+		}
+
+		const bool bWantWrite = sendResult == ELinkStreamSocketResult::WouldBlock;
+		if (Poller && bWantWrite != bPollingForWrite)
+		{
+			Poller->Modify(Socket->GetNative(), Socket, bWantWrite, !bReceivePaused);
+			bPollingForWrite = bWantWrite;
+		}
+
+		const bool bReceiveOk = UpdateReceivePause() || ReceivePending();
+		if (!bReceiveOk || !ServiceHeartbeat(FPlatformTime::Seconds()))
+		{
+			if (bRun && !HandleConnectionLost())
+			{
+				bRun = false;
+			}
+			continue;
+		}
+
+
+		if (Poller)
+		{
+			const double nextHeartbeat = Heartbeat.GetNextTime();
+			WaitForActivity(nextHeartbeat == MAX_dbl ? -1 : FMath::Max(1, FMath::CeilToInt((nextHeartbeat - FPlatformTime::Seconds()) * 1000.0)));
+			continue;
+		}
+
+		FDateTime timeEndOfTick = FDateTime::UtcNow();
+		FTimespan tickDuration = timeEndOfTick - timeBeginningOfTick;
+		float secondsThisTickTook = tickDuration.GetTotalSeconds();
+		float timeToSleep = Settings.TimeBetweenTicks - secondsThisTickTook;
+		if (timeToSleep > 0.f)
+		{
+			//AsyncTask(ENamedThreads::GameThread, [timeToSleep]() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Sleeping: %f seconds"), timeToSleep), false); });
+			FPlatformProcess::Sleep(timeToSleep);
+		}
+	}
+
+	bConnected = false;
+	if (State != ELinkStreamConnectionState::Failed)
+	{
+		SetState(ELinkStreamConnectionState::Disconnected);
+	}
+
+	PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerDisconnected(workerId); });
+
+	SocketShutdown();
+	if (Socket)
+	{
+		delete Socket;
+		Socket = nullptr;
+	}
+	
+	return 0;
+}
+
+void FTcpSocketWorker::Stop()
+{
+	bRun = false;
+	if (Inproc)
+	{
+		if (Inproc->IsAttachedTo(Owner, id))
+		{
+			Inproc->Detach(Owner, id);
+			bConnected = false;
+			SetState(ELinkStreamConnectionState::Disconnected);
+			PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerDisconnected(workerId); });
+		}
+		return;
+	}
+	WakeWorker();
+}
+
+void FTcpSocketWorker::WakeWorker()
+{
+	if (Reactor)
+	{
+		Reactor->Wake(this);
+	}
+	else if (Wakeup)
+	{
+		Wakeup->Signal();
+	}
+}
+
+void FTcpSocketWorker::WaitForActivity(int32 TimeoutMs)
+{
+	TArray<FLinkStreamPollEvent> events;
+	Poller->Wait(events, TimeoutMs);
+	for (const FLinkStreamPollEvent& event : events)
+	{
+		if (event.UserData == Wakeup.Get())
+		{
+			Wakeup->Drain();
+		}
+	}
+}
+
+void FTcpSocketWorker::WaitFor(double Seconds)
+{
+	if (Poller)
+	{
+		WaitForActivity(FMath::Max(1, FMath::CeilToInt(Seconds * 1000.0)));
+		return;
+	}
+	FPlatformProcess::Sleep(FMath::Min((float)Seconds, FMath::Max(Settings.TimeBetweenTicks, 0.001f)));
+}
+
+void FTcpSocketWorker::Exit() 
+{
+	
+}
+
+void FTcpSocketWorker::SetState(ELinkStreamConnectionState NewState)
+{
+	if (State.exchange(NewState) != NewState)
+	{
+		PostToOwner([NewState](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerStateChanged(workerId, NewState); });
+	}
+}
+
+bool FTcpSocketWorker::ConnectWithTimeout()
+{
+	if (!OpenSocket())
+	{
+		return false;
+	}
+
+	// The socket stays non-blocking from here on; reads and writes report WouldBlock instead of stalling the loop.
+	Socket->SetNonBlocking(true);
+	if (!Socket->Connect(ipAddress, port))
+	{
+		ResetConnection();
+		return false;
+	}
+
+	const double deadline = Settings.ConnectTimeout > 0.f ? FPlatformTime::Seconds() + Settings.ConnectTimeout : MAX_dbl;
+	if (Poller)
+	{
+		Poller->Add(Socket->GetNative(), Socket, true);
+	}
+
+	ELinkStreamSocketResult result = Socket->FinishConnect();
+	while (result == ELinkStreamSocketResult::WouldBlock && bRun)
+	{
+		const double remaining = deadline - FPlatformTime::Seconds();
+		if (remaining <= 0.0)
+		{
+			break;
+		}
+		WaitFor(FMath::Min(remaining, 1.0));
+		result = Socket->FinishConnect();
+	}
+
+	if (result != ELinkStreamSocketResult::Ok)
+	{
+		if (bRun)
+		{
+			const FString reason = result == ELinkStreamSocketResult::WouldBlock ? FString::Printf(TEXT("timed out after %.1f s"), Settings.ConnectTimeout) : TEXT("was refused");
+			AsyncTask(ENamedThreads::GameThread, [reason]() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Couldn't connect to server: connect %s."), *reason), true); });
+		}
+		ResetConnection();
+		return false;
+	}
+
+	if (Poller)
+	{
+		Poller->Modify(Socket->GetNative(), Socket, false);
+		bPollingForWrite = false;
+	}
+	return true;
+}
+
+void FTcpSocketWorker::ResetConnection()
+{
+	if (Udp)
+	{
+		Udp->Close();
+		Udp.Reset();
+	}
+	if (Socket)
+	{
+		if (Reactor)
+		{
+			Reactor->Unwatch(this);
+		}
+		else if (Poller)
+		{
+			Poller->Remove(Socket->GetNative());
+		}
+		Socket->Close();
+		delete Socket;
+		Socket = nullptr;
+	}
+	bConnected = false;
+	bReceivePaused = false;
+	bConnecting = false;
+	bPollingForWrite = false;
+	ConnectDeadline = 0.0;
+	RecvRing.Reset();
+
+	// Plaintext TLS already took counts as sent; whatever it had not written yet is lost with the link, as with the kernel's buffer.
+	if (Tls)
+	{
+		Tls->Reset();
+	}
+
+	// A partially written message is resent whole: the new stream has not seen any of it.
+	if (Cipher)
+	{
+		UnsealStagedMessages();
+		Cipher->DiscardHandshake();
+	}
+	PartialLane = INDEX_NONE;
+	SendBatchOffset = 0;
+	if (Settings.ReconnectOutbox == ELinkStreamReconnectOutbox::Drop)
+	{
+		DropQueuedMessages();
+	}
+}
+
+bool FTcpSocketWorker::HandleConnectionLost()
+{
+	const bool bWasConnected = State == ELinkStreamConnectionState::Connected;
+	ResetConnection();
+
+	if (!Settings.bAutoReconnect || !bRun || (Settings.MaxReconnectAttempts > 0 && ReconnectAttempts >= Settings.MaxReconnectAttempts))
+	{
+		SetState(bWasConnected ? ELinkStreamConnectionState::Disconnected : ELinkStreamConnectionState::Failed);
+		return false;
+	}
+
+	// Exponential backoff with jitter, so every client of a restarted server does not come back in the same instant.
+	const double backoff = FMath::Min((double)Settings.ReconnectMaxDelay, Settings.ReconnectInitialDelay * FMath::Pow(2.0, (double)FMath::Min(ReconnectAttempts, 30)));
+	const double delay = backoff * (1.0 - Settings.ReconnectJitter * ReconnectRandom.FRand());
+	ReconnectAttempts++;
+	ReconnectAt = FPlatformTime::Seconds() + delay;
+	SetState(ELinkStreamConnectionState::Reconnecting);
+	return true;
+}
+
+bool FTcpSocketWorker::OpenSocket()
+{
+	Socket = new FLinkStreamSocket();
+	if (!(bUdp ? Socket->CreateDatagram() : Socket->Create()))
+	{
+		delete Socket;
+		Socket = nullptr;
+		return false;
+	}
+
+	ConfigureSocket();
+	return true;
+}
+
+void FTcpSocketWorker::ConfigureSocket()
+{
+	Socket->SetBufferSizes(Settings.RecvBufferSize, Settings.SendBufferSize, ActualRecvBufferSize, ActualSendBufferSize);
+	if (bUdp)
+	{
+		return;
+	}
+	Socket->SetNoDelay(Settings.bNoDelay);
+	if (Settings.bTcpKeepAlive)
+	{
+		Socket->SetKeepAlive(Settings.TcpKeepAliveIdle, Settings.TcpKeepAliveInterval, Settings.TcpKeepAliveProbes);
+	}
+}
+
+void FTcpSocketWorker::OnReactorAttach(FLinkStreamReactor& InReactor)
+{
+	Reactor = &InReactor;
+
+	// A socket handed over by a listener is already connected.
+	if (Socket)
+	{
+		if (!bRun)
+		{
+			// Stopped before it started; the listener still counts the session until it hears it ended.
+			PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerDisconnected(workerId); });
+			return;
+		}
+		ConfigureSocket();
+		Socket->SetNonBlocking(true);
+		bConnected = true;
+		Heartbeat.Reset(FPlatformTime::Seconds());
+		StartTls();
+		StartEncryption();
+		StartNegotiation();
+		Reactor->Watch(this, *Socket, false);
+		SetState(ELinkStreamConnectionState::Connected);
+		PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerConnected(workerId); });
+		return;
+	}
+
+	if (bRun)
+	{
+		StartConnecting();
+	}
+}
+
+void FTcpSocketWorker::StartConnecting()
+{
+	ReconnectAt = 0.0;
+	SetState(ELinkStreamConnectionState::Connecting);
+	if (!OpenSocket())
+	{
+		if (!HandleConnectionLost())
+		{
+			bRun = false;
+		}
+		return;
+	}
+
+	Socket->SetNonBlocking(true);
+	if (!Socket->Connect(ipAddress, port))
+	{
+		AsyncTask(ENamedThreads::GameThread, []() { ALinkStreamConnection::PrintToConsole(TEXT("Couldn't connect to server: connect was refused."), true); });
+		if (!HandleConnectionLost())
+		{
+			bRun = false;
+		}
+		return;
+	}
+	if (bUdp)
+	{
+		StartUdpSession();
+		return;
+	}
+
+	// Completion of a non-blocking connect is reported as writability; the timeout is checked on tick.
+	bConnecting = true;
+	ConnectDeadline = Settings.ConnectTimeout > 0.f ? FPlatformTime::Seconds() + Settings.ConnectTimeout : 0.0;
+	Reactor->Watch(this, *Socket, true);
+	if (ConnectDeadline > 0.0)
+	{
+		Reactor->WakeAt(this, ConnectDeadline);
+	}
+}
+
+void FTcpSocketWorker::OnReactorEvent(bool bReadable, bool bWritable, bool bError)
+{
+	if (bUdp)
+	{
+		if (bError || (bReadable && !UpdateReceivePause()))
+		{
+			ReceiveDatagrams();
+		}
+		if (!ServiceUdp() && bRun && !HandleConnectionLost())
+		{
+			bRun = false;
+		}
+		return;
+	}
+
+	if (bConnecting)
+	{
+		if (bWritable || bError)
+		{
+			FinishConnecting();
+		}
+		return;
+	}
+
+	// A paused socket reports errors and hang-ups only; reading it then surfaces them.
+	if ((bError || (bReadable && !UpdateReceivePause())) && !ReceivePending())
+	{
+		if (bRun && !HandleConnectionLost())
+		{
+			bRun = false;
+		}
+		return;
+	}
+
+	if (bWritable && !FlushOutboxNonBlocking() && !HandleConnectionLost())
+	{
+		bRun = false;
+	}
+}
+
+bool FTcpSocketWorker::OnReactorTick()
+{
+	if (!bRun)
+	{
+		return false;
+	}
+
+	const double now = FPlatformTime::Seconds();
+	if (bConnecting && ConnectDeadline > 0.0 && now >= ConnectDeadline)
+	{
+		AsyncTask(ENamedThreads::GameThread, [Timeout = Settings.ConnectTimeout]() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Couldn't connect to server: connect timed out after %.1f s."), Timeout), true); });
+		if (!HandleConnectionLost())
+		{
+			bRun = false;
+			return false;
+		}
+	}
+
+	// Woken by the game thread once it drained the inbox. Reads resume with the next loop, as the socket is still readable,
+	// except for records TLS already took off it, which are read here.
+	if (bReceivePaused && !UpdateReceivePause() && Tls && Tls->GetSession() && Tls->GetSession()->HasBufferedInput() && !ReceivePending())
+	{
+		if (!HandleConnectionLost())
+		{
+			bRun = false;
+			return false;
+		}
+	}
+
+	// Idle links are reaped here, by the reactor that services them, rather than by a timer per connection.
+	if (bConnected)
+	{
+		if (!ServiceHeartbeat(now))
+		{
+			if (!HandleConnectionLost())
+			{
+				bRun = false;
+				return false;
+			}
+		}
+		else if (Heartbeat.GetNextTime() != MAX_dbl)
+		{
+			Reactor->WakeAt(this, Heartbeat.GetNextTime());
+		}
+	}
+
+	if (ReconnectAt > 0.0)
+	{
+		if (now >= ReconnectAt)
+		{
+			StartConnecting();
+		}
+		else
+		{
+			Reactor->WakeAt(this, ReconnectAt);
+		}
+	}
+
+	if (bConnecting && ConnectDeadline > 0.0)
+	{
+		Reactor->WakeAt(this, ConnectDeadline);
+	}
+
+	if (bRun && bUdp)
+	{
+		if (!ServiceUdp() && !HandleConnectionLost())
+		{
+			bRun = false;
+		}
+	}
+	else if (bRun && bConnected && !FlushOutboxNonBlocking())
+	{
+		UE_LOG(LogLinkStream, Log, TEXT("TCP send data failed !"));
+		if (!HandleConnectionLost())
+		{
+			bRun = false;
+		}
+	}
+	return bRun;
+}
+
+void FTcpSocketWorker::OnReactorDetach()
+{
+	const bool bWasStarted = bConnected || bConnecting || ReconnectAt > 0.0;
+	bConnected = false;
+	bConnecting = false;
+	ReconnectAt = 0.0;
+	bRun = false;
+	if (State != ELinkStreamConnectionState::Failed)
+	{
+		SetState(ELinkStreamConnectionState::Disconnected);
+	}
+
+	if (bWasStarted)
+	{
+		PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerDisconnected(workerId); });
+	}
+
+	if (Udp)
+	{
+		Udp->Close();
+		Udp.Reset();
+	}
+	SocketShutdown();
+	if (Socket)
+	{
+		delete Socket;
+		Socket = nullptr;
+	}
+}
+
+void FTcpSocketWorker::FinishConnecting()
+{
+	const ELinkStreamSocketResult result = Socket->FinishConnect();
+	if (result == ELinkStreamSocketResult::WouldBlock)
+	{
+		return;
+	}
+
+	bConnecting = false;
+	if (result != ELinkStreamSocketResult::Ok)
+	{
+		AsyncTask(ENamedThreads::GameThread, []() { ALinkStreamConnection::PrintToConsole(TEXT("Couldn't connect to server: connect was refused."), true); });
+		if (!HandleConnectionLost())
+		{
+			bRun = false;
+		}
+		return;
+	}
+
+	bConnected = true;
+	ConnectDeadline = 0.0;
+	ReconnectAttempts = 0;
+	Heartbeat.Reset(FPlatformTime::Seconds());
+	StartTls();
+	StartEncryption();
+	StartNegotiation();
+	Reactor->Watch(this, *Socket, false);
+	SetState(ELinkStreamConnectionState::Connected);
+
+	PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerConnected(workerId); });
+}
+
+void FTcpSocketWorker::StartUdpSession()
+{
+	// The handshake stands in for the TCP connect, so ConnectTimeout and reconnects apply to it the same way.
+	Udp = MakeUnique<FLinkStreamUdpSession>(true, Settings.MaxFrameSize + FLinkStreamEnvelope::MaxSize,
+		[this](const uint8* Data, int32 Size) {
+			int32 bytesSent = 0;
+			Socket->Send(Data, Size, bytesSent);
+		},
+		[this](FLinkStreamBuffer&& Message) { DeliverMessage(MoveTemp(Message)); });
+
+	const double now = FPlatformTime::Seconds();
+	Udp->Start(now);
+	bConnecting = true;
+	ConnectDeadline = Settings.ConnectTimeout > 0.f ? now + Settings.ConnectTimeout : 0.0;
+	Reactor->Watch(this, *Socket, false);
+	Reactor->WakeAt(this, Udp->GetNextTimer());
+	if (ConnectDeadline > 0.0)
+	{
+		Reactor->WakeAt(this, ConnectDeadline);
+	}
+}
+
+void FTcpSocketWorker::ReceiveDatagrams()
+{
+	uint8 datagram[2048];
+	bool bReceived = false;
+	const double now = FPlatformTime::Seconds();
+	while (bRun && Udp && !Inbox.IsReceivePaused())
+	{
+		int32 bytesRead = 0;
+		const ELinkStreamSocketResult result = Socket->Recv(datagram, sizeof(datagram), bytesRead);
+
+		// Errors on a connected datagram socket report ICMP messages, such as port unreachable while the peer starts.
+		// They say nothing for certain about the peer, so the session's own timeouts decide when it is gone.
+		if (result == ELinkStreamSocketResult::WouldBlock || result == ELinkStreamSocketResult::Error)
+		{
+			break;
+		}
+		if (bytesRead > 0)
+		{
+			Udp->ReceiveDatagram(datagram, bytesRead, now);
+			bReceived = true;
+		}
+	}
+
+	if (bReceived)
+	{
+		Heartbeat.MarkReceived(now);
+	}
+}
+
+bool FTcpSocketWorker::ServiceUdp()
+{
+	if (!Udp)
+	{
+		return true;
+	}
+
+	if (bConnecting && Udp->IsConnected())
+	{
+		bConnecting = false;
+		bConnected = true;
+		ConnectDeadline = 0.0;
+		ReconnectAttempts = 0;
+		Heartbeat.Reset(FPlatformTime::Seconds());
+		StartNegotiation();
+		SetState(ELinkStreamConnectionState::Connected);
+		PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerConnected(workerId); });
+	}
+
+	if (bConnected)
+	{
+		StageUdpMessages(ConsumeFlushRequest());
+	}
+	if (!Udp->Service(FPlatformTime::Seconds()))
+	{
+		const int32 workerId = id;
+		AsyncTask(ENamedThreads::GameThread, [workerId]() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: the UDP peer closed the session or stopped answering."), workerId), true); });
+		return false;
+	}
+
+	const double nextTimer = Udp->GetNextTimer();
+	if (nextTimer != MAX_dbl)
+	{
+		Reactor->WakeAt(this, nextTimer);
+	}
+	return true;
+}
+
+void FTcpSocketWorker::StageUdpMessages(bool bTakeFromOutbox)
+{
+	int64 handedOver = 0;
+	while (Udp->WantsMore())
+	{
+		if (bTakeFromOutbox)
+		{
+			StageQueuedMessages();
+		}
+
+		int32 planLanes[MaxMessagesPerWrite];
+		const int32 numPlanned = PlanBatch(planLanes);
+		if (numPlanned == 0)
+		{
+			break;
+		}
+
+		// The lanes pick the order; the congestion window decides how far down the plan the session takes.
+		int32 laneDone[LinkStreamNumLanes] = {};
+		for (int32 planIndex = 0; planIndex < numPlanned && Udp->WantsMore(); planIndex++)
+		{
+			const int32 lane = planLanes[planIndex];
+			FLinkStreamOutgoingMessage& message = LaneBatches[lane][laneDone[lane]++];
+			const int32 messageSize = message.GetWireSize();
+			const ELinkStreamDelivery delivery = message.Delivery;
+			if (!Udp->Queue(MoveTemp(message), delivery))
+			{
+				AsyncTask(ENamedThreads::GameThread, [messageSize]() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Dropped a UDP message of %d bytes: it exceeds MaxFrameSize."), messageSize), true); });
+			}
+			handedOver += messageSize;
+
+			LaneVirtualTime[lane] += 1.0 / Settings.LaneWeights[lane];
+			FLaneCounters& counters = LaneCounters[lane];
+			counters.QueuedMessages.Decrement();
+			counters.QueuedBytes.Subtract(messageSize);
+			counters.SentMessages.Increment();
+		}
+
+		for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+		{
+			LaneBatches[lane].RemoveAt(0, laneDone[lane], false);
+		}
+	}
+
+	if (handedOver == 0)
+	{
+		return;
+	}
+	const int64 pending = PendingSendBytes.Subtract(handedOver) - handedOver;
+	if (pending <= Settings.SendLowWatermark && bSendBackpressured && bSendBackpressured.AtomicSet(false))
+	{
+		NotifySendBackpressure(false);
+	}
+}
+
+bool FTcpSocketWorker::FlushOutboxNonBlocking()
+{
+	const ELinkStreamSocketResult result = SendQueued(ConsumeFlushRequest());
+	if (result == ELinkStreamSocketResult::WouldBlock)
+	{
+		Reactor->Watch(this, *Socket, true);
+		return true;
+	}
+	if (result != ELinkStreamSocketResult::Ok)
+	{
+		return false;
+	}
+
+	Reactor->Watch(this, *Socket, false);
+	return true;
+}
+
+ELinkStreamSocketResult FTcpSocketWorker::SendQueued(bool bTakeFromOutbox)
+{
+	// Likewise nothing but the TLS handshake is written until it completes, and a link whose TLS could not start is closed.
+	FLinkStreamTls* tls = Tls ? Tls->GetSession() : nullptr;
+	if (Tls)
+	{
+		if (!tls)
+		{
+			return ELinkStreamSocketResult::Error;
+		}
+		const ELinkStreamSocketResult result = tls->Flush(*Socket);
+		if (result != ELinkStreamSocketResult::Ok || !tls->IsEstablished())
+		{
+			return result;
+		}
+	}
+
+	// Until both handshakes are through there are no keys, so queued messages wait.
+	if (Cipher)
+	{
+		const ELinkStreamSocketResult result = Cipher->SendHandshake(*Socket);
+		if (result != ELinkStreamSocketResult::Ok || !Cipher->IsReady())
+		{
+			return result;
+		}
+	}
+
+	bool bAnyQueued = false;
+	for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+	{
+		bAnyQueued |= LaneBatches[lane].Num() > 0 || (bTakeFromOutbox && !Outboxes[lane].IsEmpty());
+	}
+	const bool bCorked = Settings.bCork && bAnyQueued && Socket->SetCork(true);
+
+	ELinkStreamSocketResult result = ELinkStreamSocketResult::Ok;
+	for (;;)
+	{
+		if (bTakeFromOutbox)
+		{
+			StageQueuedMessages();
+		}
+
+		int32 planLanes[MaxMessagesPerWrite];
+		const int32 numPlanned = PlanBatch(planLanes);
+		if (numPlanned == 0)
+		{
+			break;
+		}
+
+		FLinkStreamIoVec vecs[FLinkStreamSocket::MaxIoVecs];
+		int32 numVecs = 0;
+		int32 skip = SendBatchOffset;
+		int32 laneNext[LinkStreamNumLanes] = {};
+		for (int32 planIndex = 0; planIndex < numPlanned; planIndex++)
+		{
+			const int32 lane = planLanes[planIndex];
+			FLinkStreamOutgoingMessage& message = LaneBatches[lane][laneNext[lane]++];
+			if (message.SealOffset != INDEX_NONE && !message.bSealed)
+			{
+				SealOutgoing(message);
+			}
+			if (skip < message.HeaderSize)
+			{
+				vecs[numVecs].Data = message.Header + skip;
+				vecs[numVecs].Size = message.HeaderSize - skip;
+				numVecs++;
+				skip = 0;
+			}
+			else
+			{
+				skip -= message.HeaderSize;
+			}
+
+			if (skip < message.GetPayloadSize())
+			{
+				vecs[numVecs].Data = message.GetPayloadData() + skip;
+				vecs[numVecs].Size = message.GetPayloadSize() - skip;
+				numVecs++;
+				skip = 0;
+			}
+			else
+			{
+				skip -= message.GetPayloadSize();
+			}
+		}
+
+		int32 bytesSent = 0;
+		result = tls ? tls->SendVectored(*Socket, vecs, numVecs, bytesSent) : Socket->SendVectored(vecs, numVecs, bytesSent);
+		if (result != ELinkStreamSocketResult::Ok)
+		{
+			break;
+		}
+
+		const int64 pending = PendingSendBytes.Subtract(bytesSent) - bytesSent;
+		if (pending <= Settings.SendLowWatermark && bSendBackpressured && bSendBackpressured.AtomicSet(false))
+		{
+			NotifySendBackpressure(false);
+		}
+
+		// Release every message that is now completely written, in plan order; a short write leaves the rest for the next call.
+		SendBatchOffset += bytesSent;
+		PartialLane = INDEX_NONE;
+		int32 laneDone[LinkStreamNumLanes] = {};
+		for (int32 planIndex = 0; planIndex < numPlanned; planIndex++)
+		{
+			const int32 lane = planLanes[planIndex];
+			const FLinkStreamOutgoingMessage& message = LaneBatches[lane][laneDone[lane]];
+			const int32 messageSize = message.GetWireSize();
+			if (SendBatchOffset < messageSize)
+			{
+				// Bytes of it are on the wire, so it has to be finished before anything else is written.
+				if (SendBatchOffset > 0)
+				{
+					PartialLane = lane;
+				}
+				break;
+			}
+			SendBatchOffset -= messageSize;
+			laneDone[lane]++;
+
+			LaneVirtualTime[lane] += 1.0 / Settings.LaneWeights[lane];
+			FLaneCounters& counters = LaneCounters[lane];
+			counters.QueuedMessages.Decrement();
+			counters.QueuedBytes.Subtract(messageSize);
+			counters.SentMessages.Increment();
+		}
+
+		for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+		{
+			LaneBatches[lane].RemoveAt(0, laneDone[lane], false);
+		}
+	}
+
+	// Records the socket did not take must still get out once the batches are empty.
+	if (tls && result == ELinkStreamSocketResult::Ok)
+	{
+		result = tls->Flush(*Socket);
+	}
+
+	if (bCorked)
+	{
+		Socket->SetCork(false);
+	}
+	return result;
+}
+
+void FTcpSocketWorker::StageQueuedMessages()
+{
+	double minActiveTime = MAX_dbl;
+	for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+	{
+		if (LaneBatches[lane].Num() > 0)
+		{
+			minActiveTime = FMath::Min(minActiveTime, LaneVirtualTime[lane]);
+		}
+	}
+
+	for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+	{
+		const bool bWasIdle = LaneBatches[lane].Num() == 0;
+		Outboxes[lane].DequeueBatch(LaneBatches[lane], MaxMessagesPerWrite - LaneBatches[lane].Num());
+
+		// A lane coming back from idle starts level with the busy ones instead of cashing in the turns it skipped.
+		if (bWasIdle && LaneBatches[lane].Num() > 0)
+		{
+			LaneVirtualTime[lane] = minActiveTime == MAX_dbl ? 0.0 : FMath::Max(LaneVirtualTime[lane], minActiveTime);
+		}
+	}
+}
+
+int32 FTcpSocketWorker::PlanBatch(int32* OutLanes) const
+{
+	int32 numPlanned = 0;
+	int32 laneNext[LinkStreamNumLanes] = {};
+	double virtualTime[LinkStreamNumLanes];
+	FMemory::Memcpy(virtualTime, LaneVirtualTime, sizeof(virtualTime));
+
+	if (PartialLane != INDEX_NONE)
+	{
+		OutLanes[numPlanned++] = PartialLane;
+		laneNext[PartialLane] = 1;
+		virtualTime[PartialLane] += 1.0 / Settings.LaneWeights[PartialLane];
+	}
+
+	while (numPlanned < MaxMessagesPerWrite)
+	{
+		int32 bestLane = INDEX_NONE;
+		for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+		{
+			if (laneNext[lane] < LaneBatches[lane].Num() && (bestLane == INDEX_NONE || virtualTime[lane] < virtualTime[bestLane]))
+			{
+				bestLane = lane;
+			}
+		}
+		if (bestLane == INDEX_NONE)
+		{
+			break;
+		}
+
+		OutLanes[numPlanned++] = bestLane;
+		laneNext[bestLane]++;
+		virtualTime[bestLane] += 1.0 / Settings.LaneWeights[bestLane];
+	}
+	return numPlanned;
+}
+
+void FTcpSocketWorker::DropQueuedMessages()
+{
+	int64 dropped = 0;
+	for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+	{
+		int64 laneDropped = 0;
+		int32 laneCount = LaneBatches[lane].Num();
+		for (const FLinkStreamOutgoingMessage& message : LaneBatches[lane])
+		{
+			laneDropped += message.GetWireSize();
+		}
+		LaneBatches[lane].Reset();
+
+		FLinkStreamOutgoingMessage message;
+		while (Outboxes[lane].Dequeue(message))
+		{
+			laneDropped += message.GetWireSize();
+			laneCount++;
+		}
+
+		LaneCounters[lane].QueuedMessages.Subtract(laneCount);
+		LaneCounters[lane].QueuedBytes.Subtract(laneDropped);
+		dropped += laneDropped;
+	}
+
+	const int64 pending = PendingSendBytes.Subtract(dropped) - dropped;
+	if (pending <= Settings.SendLowWatermark && bSendBackpressured && bSendBackpressured.AtomicSet(false))
+	{
+		NotifySendBackpressure(false);
+	}
+}
+
+bool FTcpSocketWorker::ServiceHeartbeat(double Now)
+{
+	// Nothing arrives while reads are paused; the idle clock restarts when they resume.
+	if (!bReceivePaused && Heartbeat.IsIdle(Now))
+	{
+		const int32 workerId = id;
+		const float timeout = Settings.IdleTimeout;
+		AsyncTask(ENamedThreads::GameThread, [workerId, timeout]() {
+			ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: nothing received for %.1f s (IdleTimeout). Closing it."), workerId, timeout), true);
+		});
+		return false;
+	}
+
+	// Over UDP a lost ping is simply superseded by the next one, so it is not worth a retransmission.
+	uint32 sequence = 0;
+	if (Heartbeat.PreparePing(Now, sequence)
+		&& AddToOutbox(FLinkStreamBuffer(), ELinkStreamPriority::Control, FLinkStreamEnvelope(ELinkStreamMessageKind::Ping, sequence), ELinkStreamDelivery::Unreliable))
+	{
+		Heartbeat.OnPingSent(Now);
 	}
+	return true;
 }
 
-void FTcpSocketWorker::Start()
+bool FTcpSocketWorker::HandleHeartbeat(const FLinkStreamBuffer& Message)
 {
-	check(!Thread && "Thread wasn't null at the start!");
-	check(FPlatformProcess::SupportsMultithreading() && "This platform doesn't support multithreading!");	
-	if (Thread)
+	FLinkStreamEnvelope envelope;
+	if (FLinkStreamEnvelope::Decode(Message.GetData(), Message.Num(), envelope) == 0 || !envelope.IsHeartbeat())
 	{
-		UE_LOG(LogTemp, Log, TEXT("Log: Thread isn't null. It's: %s"), *Thread->GetThreadName());
+		return false;
 	}
-	Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("FTcpSocketWorker %s:%d"), *ipAddress, port), 128 * 1024, TPri_Normal);
-	UE_LOG(LogTemp, Log, TEXT("Log: Created thread"));
+
+	if (envelope.Kind == ELinkStreamMessageKind::Ping)
+	{
+		AddToOutbox(FLinkStreamBuffer(), ELinkStreamPriority::Control, FLinkStreamEnvelope(ELinkStreamMessageKind::Pong, envelope.CorrelationId), ELinkStreamDelivery::Unreliable);
+		return true;
+	}
+
+	Heartbeat.OnPong(envelope.CorrelationId, FPlatformTime::Seconds());
+	return true;
 }
 
-void FTcpSocketWorker::AddToOutbox(TArray<uint8> Message)
+void FTcpSocketWorker::StartNegotiation()
 {
-	Outbox.Enqueue(Message);
+	Compressor.SetPeerFormats(0);
+	Delta.SetPeerDecodes(false);
+	bHelloSent = false;
+	Delta.Decoder.Reset();
+	{
+		FScopeLock lock(&Delta.Lock);
+		if (Delta.IsEnabled())
+		{
+			RewriteQueuedDeltas();
+		}
+		Delta.Encoder.Reset();
+	}
+	if (!Settings.bUseEnvelope || Inproc || (Settings.Compression == ELinkStreamCompression::None && !Delta.IsEnabled()))
+	{
+		return;
+	}
+
+	SendHello();
 }
 
-TArray<uint8> FTcpSocketWorker::ReadFromInbox()
+void FTcpSocketWorker::SendHello()
 {
-	TArray<uint8> msg;
-	Inbox.Dequeue(msg);
-	return msg;
+	FLinkStreamBuffer hello = FLinkStreamBuffer::Acquire(3);
+	hello.GetArray().Add(FLinkStreamCompression::GetDecodableFormats());
+	hello.GetArray().Add(FLinkStreamEnvelope::HelloDeltaDecoding);
+	hello.GetArray().Add(Delta.IsEnabled() ? (uint8)Delta.Encoder.GetKeySize() : 0);
+	bHelloSent = AddToOutbox(MoveTemp(hello), ELinkStreamPriority::Control, FLinkStreamEnvelope(ELinkStreamMessageKind::Hello, 0));
 }
 
-bool FTcpSocketWorker::Init()
+bool FTcpSocketWorker::HandleHello(const FLinkStreamBuffer& Message)
 {
-	bRun = true;
-	bConnected = false;
+	FLinkStreamEnvelope envelope;
+	const int32 envelopeSize = FLinkStreamEnvelope::Decode(Message.GetData(), Message.Num(), envelope);
+	if (envelopeSize == 0 || envelope.Kind != ELinkStreamMessageKind::Hello)
+	{
+		return false;
+	}
+
+	const uint8* payload = Message.GetData() + envelopeSize;
+	const int32 payloadSize = Message.Num() - envelopeSize;
+	Compressor.SetPeerFormats(payloadSize > 0 ? payload[0] : 0);
+	Delta.SetPeerDecodes(payloadSize > 1 && (payload[1] & FLinkStreamEnvelope::HelloDeltaDecoding) != 0);
+	Delta.Decoder.SetKeySize(payloadSize > 2 ? payload[2] : 0);
+	// A peer that does not compress itself still decodes, so the answer goes out whatever Compression is.
+	if (!bHelloSent && !Inproc)
+	{
+		SendHello();
+	}
 	return true;
 }
 
-uint32 FTcpSocketWorker::Run()
+bool FTcpSocketWorker::HandleResync(const FLinkStreamBuffer& Message)
 {
-	AsyncTask(ENamedThreads::GameThread, []() {	ALinkStreamConnection::PrintToConsole("Starting Tcp socket thread.", false); });
+	FLinkStreamEnvelope envelope;
+	const int32 envelopeSize = FLinkStreamEnvelope::Decode(Message.GetData(), Message.Num(), envelope);
+	if (envelopeSize == 0 || envelope.Kind != ELinkStreamMessageKind::Resync)
+	{
+		return false;
+	}
 
-	while (bRun)
+	Delta.CountResyncReceived();
+	const uint8* requestedKey = Message.GetData() + envelopeSize;
+	const int32 requestedKeySize = Message.Num() - envelopeSize;
+	FScopeLock lock(&Delta.Lock);
+	uint64 key = 0;
+	uint8 lane = 0;
+	const TArray<uint8>* baseline = requestedKeySize == Delta.Encoder.GetKeySize()
+		&& FLinkStreamDeltaEncoder::ReadKey(requestedKey, requestedKeySize, requestedKeySize, key) ? Delta.Encoder.FindBaseline(key, lane) : nullptr;
+	if (!baseline)
 	{
-		FDateTime timeBeginningOfTick = FDateTime::UtcNow();
+		return true;
+	}
 
-		if (!bConnected)
+	// The update the peer dropped is only recovered by sending the key's current state whole; waiting for the
+	// application's next message for the key could take forever.
+	TArray<uint8> newBaseline(*baseline);
+	FLinkStreamBuffer keyframe = FLinkStreamBuffer::Acquire(newBaseline.Num());
+	keyframe.GetArray().Append(newBaseline);
+	FLinkStreamEnvelope envelope(ELinkStreamMessageKind::Message, 0);
+	envelope.Flags = FLinkStreamEnvelope::KeyframeFlag;
+	if (!EnqueueOutgoing(keyframe, (ELinkStreamPriority)lane, envelope, ELinkStreamDelivery::ReliableOrdered, key))
+	{
+		// The lane is full; the application's next message for the key goes whole instead.
+		Delta.Encoder.Invalidate(requestedKey, requestedKeySize);
+		return true;
+	}
+	Delta.CountKeyframe(newBaseline.Num());
+	Delta.Encoder.Commit(MoveTemp(newBaseline), true, lane);
+	return true;
+}
+
+void FTcpSocketWorker::RewriteQueuedDeltas()
+{
+	int64 delta = 0;
+	for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+	{
+		// Everything queued so far moves to the worker's own batch, where it can be edited. Producers queueing new
+		// deltas are held off by Delta.Lock, and nothing else cares which side of the stage a message waits on.
+		TArray<FLinkStreamOutgoingMessage>& batch = LaneBatches[lane];
+		Outboxes[lane].DequeueBatch(batch, MAX_int32);
+
+		TMap<uint64, int32> lastIndex;
+		for (int32 index = 0; index < batch.Num(); index++)
 		{
-			Socket = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateSocket(NAME_Stream, TEXT("default"), false);
-			if (!Socket)
+			if (batch[index].DeltaFlags != 0)
 			{
-				return 0;
+				lastIndex.Add(batch[index].DeltaKey, index);
 			}
+		}
+		if (lastIndex.Num() == 0)
+		{
+			continue;
+		}
 
-			Socket->SetReceiveBufferSize(RecvBufferSize, ActualRecvBufferSize);
-			Socket->SetSendBufferSize(SendBufferSize, ActualSendBufferSize);
-
-			FIPv4Address ip;
-			FIPv4Address::Parse(ipAddress, ip);
-
-			TSharedRef<FInternetAddr> internetAddr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
-			internetAddr->SetIp(ip.Value);
-			internetAddr->SetPort(port);
-
-			bConnected = Socket->Connect(*internetAddr);
-			if (bConnected) 
+		// A delta is still good if a keyframe of its key goes out before it on the new link; the peer's new baseline
+		// starts there. Any other is encoded against a baseline the peer no longer has.
+		TSet<uint64> rooted;
+		int32 kept = 0;
+		int32 removed = 0;
+		int64 laneDelta = 0;
+		for (int32 index = 0; index < batch.Num(); index++)
+		{
+			FLinkStreamOutgoingMessage& message = batch[index];
+			if ((message.DeltaFlags & FLinkStreamEnvelope::DeltaFlag) != 0 && !rooted.Contains(message.DeltaKey))
 			{
-				AsyncTask(ENamedThreads::GameThread, [this]() {
-					ThreadSpawnerActor.Get()->ExecuteOnConnected(id, ThreadSpawnerActor);
-				});
+				uint8 baselineLane = 0;
+				const TArray<uint8>* baseline = lastIndex[message.DeltaKey] == index ? Delta.Encoder.FindBaseline(message.DeltaKey, baselineLane) : nullptr;
+				if (!baseline)
+				{
+					laneDelta -= message.GetWireSize();
+					removed++;
+					continue;
+				}
+
+				// The last message queued for the key left the encoder's baseline equal to its whole payload.
+				FLinkStreamOutgoingMessage keyframe;
+				keyframe.Payload = FLinkStreamBuffer::Acquire(baseline->Num());
+				keyframe.Payload.GetArray().Append(*baseline);
+				keyframe.DeltaFlags = FLinkStreamEnvelope::KeyframeFlag;
+				keyframe.DeltaKey = message.DeltaKey;
+				FLinkStreamEnvelope envelope(ELinkStreamMessageKind::Message, 0);
+				envelope.Flags = FLinkStreamEnvelope::KeyframeFlag;
+				PrepareOutgoing(envelope, ELinkStreamDelivery::ReliableOrdered, keyframe);
+				laneDelta += keyframe.GetWireSize() - message.GetWireSize();
+				message = MoveTemp(keyframe);
+				Delta.CountKeyframe(0);
 			}
-			else 
+			if (message.DeltaFlags & FLinkStreamEnvelope::KeyframeFlag)
 			{
-				AsyncTask(ENamedThreads::GameThread, []() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Couldn't connect to server. TcpSocketConnection.cpp: line %d"), __LINE__), true); });
-				bRun = false;				
+				rooted.Add(message.DeltaKey);
 			}
-			continue;
+			if (kept != index)
+			{
+				batch[kept] = MoveTemp(message);
+			}
+			kept++;
 		}
+		batch.SetNum(kept, false);
 
-		if (!Socket)
-		{
-			AsyncTask(ENamedThreads::GameThread, []() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Socket is null. TcpSocketConnection.cpp: line %d"), __LINE__), true); });
-			bRun = false;
-			continue;
-		}
+		LaneCounters[lane].QueuedMessages.Subtract(removed);
+		LaneCounters[lane].QueuedBytes.Add(laneDelta);
+		delta += laneDelta;
+	}
+
+	const int64 pending = PendingSendBytes.Add(delta) + delta;
+	if (pending <= Settings.SendLowWatermark && bSendBackpressured && bSendBackpressured.AtomicSet(false))
+	{
+		NotifySendBackpressure(false);
+	}
+}
+
+bool FTcpSocketWorker::ApplyIncomingDelta(FLinkStreamBuffer& Message)
+{
+	FLinkStreamEnvelope envelope;
+	const int32 envelopeSize = FLinkStreamEnvelope::Decode(Message.GetData(), Message.Num(), envelope);
+	if (envelopeSize == 0 || (envelope.Flags & (FLinkStreamEnvelope::DeltaFlag | FLinkStreamEnvelope::KeyframeFlag)) == 0)
+	{
+		return true;
+	}
+	if (envelope.Flags & FLinkStreamEnvelope::KeyframeFlag)
+	{
+		Delta.Decoder.StoreKeyframe(Message.GetData() + envelopeSize, Message.Num() - envelopeSize);
+		return true;
+	}
 
+	envelope.Flags &= ~FLinkStreamEnvelope::DeltaFlag;
+	uint8 envelopeBytes[FLinkStreamEnvelope::MaxSize];
+	const int32 newEnvelopeSize = envelope.Encode(envelopeBytes);
+	FLinkStreamBuffer restored;
+	restored.GetArray().Append(envelopeBytes, newEnvelopeSize);
+	TArray<uint8> key;
+	if (Delta.Decoder.Decode(Message.GetData() + envelopeSize, Message.Num() - envelopeSize, Settings.MaxFrameSize, restored.GetArray(), key))
+	{
+		Message = MoveTemp(restored);
+		return true;
+	}
 
-		Socket->SetNonBlocking(true); 
-		int32 t_BytesRead;
-		uint8 t_Dummy;
-		if (!Socket->Recv(&t_Dummy, 1, t_BytesRead, ESocketReceiveFlags::Peek))
+	// The peer answers with a keyframe of the key's current state. Deltas already in flight behind this one fail
+	// the same way and need no resync of their own.
+	if (key.Num() > 0)
+	{
+		if (!Delta.Decoder.ShouldRequestKeyframe(key))
 		{
-			bRun = false;
-			continue;
+			return false;
 		}
-		Socket->SetNonBlocking(false);
+		Delta.CountResyncSent();
+		AddToOutbox(FLinkStreamBuffer(MoveTemp(key)), ELinkStreamPriority::Control, FLinkStreamEnvelope(ELinkStreamMessageKind::Resync, 0));
+	}
+	else
+	{
+		const int32 workerId = id;
+		AsyncTask(ENamedThreads::GameThread, [workerId]() {
+			ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: dropped a delta with an unreadable header."), workerId), true);
+		});
+	}
+	return false;
+}
 
-	
-		while (!Outbox.IsEmpty())
-		{
-			TArray<uint8> toSend; 
-			Outbox.Dequeue(toSend);
+FLinkStreamCompressionStats FTcpSocketWorker::GetCompressionStats() const
+{
+	return Compressor.GetStats();
+}
 
-			if (!BlockingSend(toSend.GetData(), toSend.Num()))
-			{
-				
-				bRun = false;
-				UE_LOG(LogTemp, Log, TEXT("TCP send data failed !"));
-				continue;
-			}
-		}
+FLinkStreamDeltaStats FTcpSocketWorker::GetDeltaStats() const
+{
+	return Delta.GetStats();
+}
 
+FLinkStreamHeartbeatStats FTcpSocketWorker::GetHeartbeatStats() const
+{
+	return Heartbeat.GetStats(FPlatformTime::Seconds(), bConnected && !Inproc);
+}
 
-		uint32 PendingDataSize = 0;
-		TArray<uint8> receivedData;
+FLinkStreamInboxStats FTcpSocketWorker::GetInboxStats() const
+{
+	if (Inproc)
+	{
+		FLinkStreamInboxStats stats;
+		stats.QueuedMessages = Inproc->GetInboxCount();
+		return stats;
+	}
+	return Inbox.GetStats();
+}
 
-		int32 BytesReadTotal = 0;
-	
-		while (bRun)
+FLinkStreamLaneStats FTcpSocketWorker::GetLaneStats(ELinkStreamPriority Priority) const
+{
+	const FLaneCounters& counters = LaneCounters[(int32)Priority];
+	FLinkStreamLaneStats stats;
+	stats.Priority = Priority;
+	stats.QueuedMessages = counters.QueuedMessages.GetValue();
+	stats.QueuedBytes = counters.QueuedBytes.GetValue();
+	stats.PeakQueuedMessages = counters.PeakQueuedMessages.load(std::memory_order_relaxed);
+	stats.SentMessages = counters.SentMessages.GetValue();
+	return stats;
+}
+
+bool FTcpSocketWorker::ReceivePending()
+{
+	FLinkStreamTls* tls = Tls ? Tls->GetSession() : nullptr;
+	bool bOpen = true;
+	bool bReceived = false;
+	while (bRun && !Inbox.IsReceivePaused())
+	{
+		uint8* First;
+		uint8* Second;
+		int32 FirstSize;
+		int32 SecondSize;
+		RecvRing.GetWriteRegions(First, FirstSize, Second, SecondSize);
+
+		// In framed mode the ring always holds one maximum-size frame, so it can only be full if a complete frame is waiting.
+		int32 BytesRead = 0;
+		ELinkStreamSocketResult Result = ELinkStreamSocketResult::Ok;
+		if (FirstSize > 0)
 		{
-			if (!Socket->HasPendingData(PendingDataSize))
+			Result = tls ? tls->Recv(*Socket, First, FirstSize, BytesRead) : Socket->Recv(First, FirstSize, BytesRead);
+			if (tls && Tls->UpdateEstablished())
 			{
-				
-				break;
+				// Messages queued meanwhile can go now.
+				WakeWorker();
 			}
-
-			AsyncTask(ENamedThreads::GameThread, []() { ALinkStreamConnection::PrintToConsole("Pending data", false); });
-
-			receivedData.SetNumUninitialized(BytesReadTotal + PendingDataSize);
-
-			int32 BytesRead = 0;
-			if (!Socket->Recv(receivedData.GetData() + BytesReadTotal, PendingDataSize, BytesRead))
+			if (Result == ELinkStreamSocketResult::Error && tls && !tls->GetError().IsEmpty())
+			{
+				const int32 workerId = id;
+				const FString reason = tls->GetError();
+				AsyncTask(ENamedThreads::GameThread, [workerId, reason]() {
+					ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: TLS failed: %s. Closing connection."), workerId, *reason), true);
+				});
+			}
+			else if (Result == ELinkStreamSocketResult::Error)
 			{
-				// ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
-				// error code: (int32)SocketSubsystem->GetLastErrorCode()
 				AsyncTask(ENamedThreads::GameThread, []() {
 					ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("In progress read failed. TcpSocketConnection.cpp: line %d"), __LINE__), true);
 				});
+			}
+			if (Result == ELinkStreamSocketResult::Closed || Result == ELinkStreamSocketResult::Error)
+			{
+				bOpen = false;
 				break;
 			}
-			BytesReadTotal += BytesRead;
-
+			RecvRing.CommitWrite(BytesRead);
+			bReceived |= BytesRead > 0;
 		}
 
+		if (Settings.Framing != ELinkStreamFraming::None)
+		{
+			if (!ExtractFrames())
+			{
+				return false;
+			}
+		}
+		else if (RecvRing.Slack() == 0)
+		{
+			DeliverRawRing();
+		}
 
-		if (bRun && receivedData.Num() != 0)
+		// A read shorter than the region means the kernel buffer is now empty, so asking again would only return WouldBlock.
+		// Not so with TLS, which returns a record at a time while more may wait, on the socket or already taken off it.
+		if (Result == ELinkStreamSocketResult::WouldBlock || (!tls && BytesRead < FirstSize))
 		{
-			Inbox.Enqueue(receivedData);
-			AsyncTask(ENamedThreads::GameThread, [this]() {
-				ThreadSpawnerActor.Get()->ExecuteOnMessageReceived(id, ThreadSpawnerActor);
-			});			
+			break;
 		}
+	}
 
+	// Replies the full socket did not take go out with the next send.
+	if (tls && tls->HasPendingOutput())
+	{
+		WakeWorker();
+	}
 
-		FDateTime timeEndOfTick = FDateTime::UtcNow();
-		FTimespan tickDuration = timeEndOfTick - timeBeginningOfTick;
-		float secondsThisTickTook = tickDuration.GetTotalSeconds();
-		float timeToSleep = TimeBetweenTicks - secondsThisTickTook;
-		if (timeToSleep > 0.f)
+	if (Settings.Framing == ELinkStreamFraming::None)
+	{
+		DeliverRawRing();
+	}
+	if (bReceived)
+	{
+		Heartbeat.MarkReceived(FPlatformTime::Seconds());
+	}
+	return bOpen;
+}
+
+void FTcpSocketWorker::DeliverRawRing()
+{
+	if (RecvRing.IsEmpty())
+	{
+		return;
+	}
+
+	if (Settings.DispatchMode == ELinkStreamDispatchMode::PerMessage)
+	{
+		AsyncTask(ENamedThreads::GameThread, []() { ALinkStreamConnection::PrintToConsole("Pending data", false); });
+	}
+
+	const int32 Size = RecvRing.Num();
+	FLinkStreamBuffer receivedData = FLinkStreamBuffer::Acquire(Size);
+	receivedData.GetArray().SetNumUninitialized(Size, false);
+	RecvRing.Peek(receivedData.GetData(), Size);
+	RecvRing.Consume(Size);
+	DeliverMessage(MoveTemp(receivedData));
+}
+
+bool FTcpSocketWorker::ExtractFrames()
+{
+	for (;;)
+	{
+		FLinkStreamBuffer frame;
+		const ELinkStreamFrameResult result = FLinkStreamFraming::ReadFrame(Settings.Framing, RecvRing, Settings.MaxFrameSize + (Cipher ? FLinkStreamCipher::Overhead : 0), frame);
+		if (result == ELinkStreamFrameResult::Frame)
 		{
-			//AsyncTask(ENamedThreads::GameThread, [timeToSleep]() { ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Sleeping: %f seconds"), timeToSleep), false); });
-			FPlatformProcess::Sleep(timeToSleep);
+			if (Cipher && !Cipher->IsReady())
+			{
+				if (!CompleteEncryption(frame))
+				{
+					return false;
+				}
+				continue;
+			}
+			if (Cipher && !OpenFrame(frame))
+			{
+				return false;
+			}
+			DeliverMessage(MoveTemp(frame));
+			continue;
+		}
+
+		if (result == ELinkStreamFrameResult::FrameTooLarge || result == ELinkStreamFrameResult::InvalidHeader)
+		{
+			const int32 limit = Settings.MaxFrameSize;
+			AsyncTask(ENamedThreads::GameThread, [limit]() {
+				ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Received frame header is invalid or exceeds MaxFrameSize (%d). Closing connection."), limit), true);
+			});
+			return false;
 		}
+		return true;
 	}
+}
 
-	bConnected = false;
+void FTcpSocketWorker::StartTls()
+{
+	if (!Tls)
+	{
+		return;
+	}
 
-	AsyncTask(ENamedThreads::GameThread, [this]() {
-		ThreadSpawnerActor.Get()->ExecuteOnDisconnected(id, ThreadSpawnerActor);
-	});
+	FString error;
+	if (!Tls->Start(ipAddress, port, error))
+	{
+		const int32 workerId = id;
+		AsyncTask(ENamedThreads::GameThread, [workerId, error]() {
+			ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: could not start TLS: %s. Closing connection."), workerId, *error), true);
+		});
+		return;
+	}
+	WakeWorker();
+}
 
-	SocketShutdown();
-	if (Socket)
+FLinkStreamTlsStats FTcpSocketWorker::GetTlsStats() const
+{
+	return Tls ? Tls->GetStats() : FLinkStreamTlsStats();
+}
+
+void FTcpSocketWorker::StartEncryption()
+{
+	if (!Cipher)
 	{
-		delete Socket;
-		Socket = nullptr;
+		return;
 	}
-	
-	return 0;
+
+	if (!Cipher->QueueHandshake(Settings.Framing))
+	{
+		const int32 workerId = id;
+		AsyncTask(ENamedThreads::GameThread, [workerId]() {
+			ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: could not generate an encryption key; nothing will be sent."), workerId), true);
+		});
+		return;
+	}
+	WakeWorker();
 }
 
-void FTcpSocketWorker::Stop()
+bool FTcpSocketWorker::CompleteEncryption(const FLinkStreamBuffer& Handshake)
 {
-	bRun = false;
+	if (!Cipher->CompleteHandshake(Handshake.GetData(), Handshake.Num()))
+	{
+		const int32 workerId = id;
+		AsyncTask(ENamedThreads::GameThread, [workerId]() {
+			ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: the peer did not start an encrypted session; is bEncrypt set on both sides? Closing connection."), workerId), true);
+		});
+		return false;
+	}
+
+	// Messages queued meanwhile can go now.
+	WakeWorker();
+	return true;
 }
 
-void FTcpSocketWorker::Exit() 
+bool FTcpSocketWorker::OpenFrame(FLinkStreamBuffer& Frame)
 {
-	
+	if (!Cipher->Open(Frame.GetData(), Frame.Num()))
+	{
+		const int32 workerId = id;
+		AsyncTask(ENamedThreads::GameThread, [workerId]() {
+			ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: received a frame that failed authentication or was replayed; the keys differ or the stream was tampered with. Closing connection."), workerId), true);
+		});
+		return false;
+	}
+
+	TArray<uint8>& bytes = Frame.GetArray();
+	bytes.SetNum(bytes.Num() - FLinkStreamCipher::TagSize, false);
+	bytes.RemoveAt(0, FLinkStreamCipher::SequenceSize, false);
+	return true;
+}
+
+void FTcpSocketWorker::SealOutgoing(FLinkStreamOutgoingMessage& Message)
+{
+	if (Message.SharedPayload.IsValid())
+	{
+		FLinkStreamBuffer copy = FLinkStreamBuffer::Acquire(Message.SharedPayload->Num() + FLinkStreamCipher::TagSize);
+		copy.GetArray().Append(Message.SharedPayload->GetArray());
+		Message.Payload = MoveTemp(copy);
+		Message.SharedPayload.Reset();
+	}
+
+	uint8 tag[FLinkStreamCipher::TagSize];
+	uint8* sequence = Message.Header + Message.SealOffset;
+	uint8* envelope = sequence + FLinkStreamCipher::SequenceSize;
+	Cipher->Seal(sequence, envelope, (int32)(Message.Header + Message.HeaderSize - envelope), Message.Payload.GetData(), Message.Payload.Num(), tag);
+	Message.Payload.GetArray().Append(tag, FLinkStreamCipher::TagSize);
+	Message.bSealed = true;
 }
 
-bool FTcpSocketWorker::BlockingSend(const uint8* Data, int32 BytesToSend)
+void FTcpSocketWorker::UnsealStagedMessages()
 {
-	if (BytesToSend > 0)
+	// Only staged messages can have been sealed; the outboxes hold plaintext.
+	for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
 	{
-		int32 BytesSent = 0;
-		if (!Socket->Send(Data, BytesToSend, BytesSent))
+		for (FLinkStreamOutgoingMessage& message : LaneBatches[lane])
 		{
-			return false;
+			if (!message.bSealed)
+			{
+				continue;
+			}
+			TArray<uint8>& payload = message.Payload.GetArray();
+			payload.SetNum(payload.Num() - FLinkStreamCipher::TagSize, false);
+			uint8* sequence = message.Header + message.SealOffset;
+			uint8* envelope = sequence + FLinkStreamCipher::SequenceSize;
+			Cipher->Unseal(sequence, envelope, (int32)(message.Header + message.HeaderSize - envelope), payload.GetData(), payload.Num());
+			message.bSealed = false;
 		}
 	}
-	return true;
+}
+
+void FTcpSocketWorker::DeliverMessage(FLinkStreamBuffer&& Message)
+{
+	if (Settings.bUseEnvelope && (HandleHeartbeat(Message) || HandleHello(Message) || HandleResync(Message)))
+	{
+		return;
+	}
+	if (Settings.bUseEnvelope && !Compressor.Decompress(Message, Settings.MaxFrameSize))
+	{
+		const int32 workerId = id;
+		AsyncTask(ENamedThreads::GameThread, [workerId]() {
+			ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Connection %d: dropped a compressed message that failed to decompress."), workerId), true);
+		});
+		return;
+	}
+	if (Settings.bUseEnvelope && !ApplyIncomingDelta(Message))
+	{
+		return;
+	}
+	Heartbeat.MarkMessage(FPlatformTime::Seconds());
+
+	// Only plain messages carry a key. Requests and responses are each awaited, so none may stand in for another.
+	uint64 key = 0;
+	bool bKeyed = false;
+	if (Inbox.IsCoalescing())
+	{
+		FLinkStreamEnvelope envelope;
+		const int32 envelopeSize = Settings.bUseEnvelope ? FLinkStreamEnvelope::Decode(Message.GetData(), Message.Num(), envelope) : 0;
+		if (!Settings.bUseEnvelope || (envelopeSize > 0 && envelope.Kind == ELinkStreamMessageKind::Message))
+		{
+			bKeyed = Inbox.ReadKey(Message.GetData() + envelopeSize, Message.Num() - envelopeSize, key);
+		}
+	}
+
+	if (!Inbox.Push(MoveTemp(Message), bKeyed ? &key : nullptr))
+	{
+		return;
+	}
+
+	if (Settings.DispatchMode == ELinkStreamDispatchMode::Batched)
+	{
+		return;
+	}
+
+	PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerMessage(workerId); });
+}
+
+bool FTcpSocketWorker::UpdateReceivePause()
+{
+	const bool bPause = Inbox.IsReceivePaused();
+	if (bPause == bReceivePaused || !Socket)
+	{
+		return bPause;
+	}
+	bReceivePaused = bPause;
+
+	if (Reactor)
+	{
+		Reactor->SetReadPaused(this, bPause);
+	}
+	else if (Poller)
+	{
+		Poller->Modify(Socket->GetNative(), Socket, bPollingForWrite, !bPause);
+	}
+	if (!bPause)
+	{
+		Heartbeat.MarkReceived(FPlatformTime::Seconds());
+	}
+	return bPause;
 }
 
 void FTcpSocketWorker::SocketShutdown()
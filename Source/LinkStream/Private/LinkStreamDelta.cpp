@@ -0,0 +1,300 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamDelta.h"
+#include "LinkStreamFraming.h"
+#include "LinkStreamReader.h"
+#include "Misc/Crc.h"
+
+namespace LinkStreamDelta
+{
+	/** A changed span ends at the first run of this many unchanged bytes, which costs less to skip than to carry. */
+	static constexpr int32 MinSkip = 4;
+
+	static void AppendVarUInt(TArray<uint8>& Out, uint32 Value)
+	{
+		uint8 Bytes[FLinkStreamFraming::MaxHeaderSize];
+		Out.Append(Bytes, FLinkStreamFraming::EncodeHeader(ELinkStreamFraming::VarInt, Value, Bytes));
+	}
+}
+
+bool FLinkStreamDeltaEncoder::ReadKey(const uint8* Payload, int32 PayloadSize, int32 KeySize, uint64& OutKey)
+{
+	if (KeySize <= 0 || PayloadSize < KeySize)
+	{
+		return false;
+	}
+	OutKey = 0;
+	for (int32 Index = 0; Index < KeySize; Index++)
+	{
+		OutKey |= (uint64)Payload[Index] << (8 * Index);
+	}
+	return true;
+}
+
+void FLinkStreamDeltaEncoder::Configure(int32 InKeySize, int32 InKeyframeInterval)
+{
+	KeySize = FMath::Clamp(InKeySize, 1, 8);
+	KeyframeInterval = FMath::Max(1, InKeyframeInterval);
+	Baselines.Reset();
+}
+
+bool FLinkStreamDeltaEncoder::Encode(const uint8* Data, int32 Size, FLinkStreamBuffer& OutDelta) const
+{
+	uint64 Key = 0;
+	const FBaseline* Baseline = ReadKey(Data, Size, KeySize, Key) ? Baselines.Find(Key) : nullptr;
+	if (!Baseline || Baseline->DeltasSinceKeyframe + 1 >= KeyframeInterval)
+	{
+		return false;
+	}
+
+	const uint8* Base = Baseline->Payload.GetData();
+	const int32 BaseSize = Baseline->Payload.Num();
+	auto XorAt = [Data, Base, BaseSize](int32 Index) { return (uint8)(Data[Index] ^ (Index < BaseSize ? Base[Index] : 0)); };
+
+	FLinkStreamBuffer Delta = FLinkStreamBuffer::Acquire(Size);
+	TArray<uint8>& Out = Delta.GetArray();
+	Out.Add((uint8)KeySize);
+	Out.Append(Data, KeySize);
+	for (int32 Shift = 0; Shift < 32; Shift += 8)
+	{
+		Out.Add((uint8)(Baseline->Crc >> Shift));
+	}
+	LinkStreamDelta::AppendVarUInt(Out, (uint32)Size);
+
+	// The key is the same in both, so the scan starts after it. Trailing unchanged bytes need no op at all.
+	int32 Index = KeySize;
+	while (Index < Size)
+	{
+		const int32 SkipStart = Index;
+		while (Index < Size && XorAt(Index) == 0)
+		{
+			Index++;
+		}
+		if (Index == Size)
+		{
+			break;
+		}
+
+		const int32 SpanStart = Index;
+		int32 Unchanged = 0;
+		while (Index < Size && Unchanged < LinkStreamDelta::MinSkip)
+		{
+			Unchanged = XorAt(Index) == 0 ? Unchanged + 1 : 0;
+			Index++;
+		}
+		Index -= Unchanged;
+
+		LinkStreamDelta::AppendVarUInt(Out, (uint32)(SpanStart - SkipStart));
+		LinkStreamDelta::AppendVarUInt(Out, (uint32)(Index - SpanStart));
+		const int32 SpanOffset = Out.AddUninitialized(Index - SpanStart);
+		for (int32 SpanIndex = SpanStart; SpanIndex < Index; SpanIndex++)
+		{
+			Out[SpanOffset + SpanIndex - SpanStart] = XorAt(SpanIndex);
+		}
+
+		if (Out.Num() >= Size)
+		{
+			return false;
+		}
+	}
+
+	OutDelta = MoveTemp(Delta);
+	return true;
+}
+
+void FLinkStreamDeltaEncoder::Commit(TArray<uint8>&& Payload, bool bKeyframe, uint8 Channel)
+{
+	uint64 Key = 0;
+	if (!ReadKey(Payload.GetData(), Payload.Num(), KeySize, Key))
+	{
+		return;
+	}
+
+	FBaseline* Baseline = Baselines.Find(Key);
+	if (!Baseline)
+	{
+		if (Baselines.Num() >= MaxBaselines)
+		{
+			return;
+		}
+		Baseline = &Baselines.Add(Key);
+	}
+	Baseline->Crc = FCrc::MemCrc32(Payload.GetData(), Payload.Num());
+	Baseline->Payload = MoveTemp(Payload);
+	Baseline->DeltasSinceKeyframe = bKeyframe ? 0 : Baseline->DeltasSinceKeyframe + 1;
+	Baseline->Channel = Channel;
+}
+
+const TArray<uint8>* FLinkStreamDeltaEncoder::FindBaseline(uint64 Key, uint8& OutChannel) const
+{
+	const FBaseline* Baseline = Baselines.Find(Key);
+	if (!Baseline)
+	{
+		return nullptr;
+	}
+	OutChannel = Baseline->Channel;
+	return &Baseline->Payload;
+}
+
+void FLinkStreamDeltaEncoder::Invalidate(const uint8* Key, int32 InKeySize)
+{
+	uint64 KeyValue = 0;
+	if (InKeySize == KeySize && ReadKey(Key, InKeySize, KeySize, KeyValue))
+	{
+		Baselines.Remove(KeyValue);
+	}
+}
+
+void FLinkStreamDeltaDecoder::StoreKeyframe(const uint8* Data, int32 Size)
+{
+	uint64 Key = 0;
+	if (!FLinkStreamDeltaEncoder::ReadKey(Data, Size, KeySize, Key))
+	{
+		return;
+	}
+	AwaitingKeyframe.Remove(Key);
+
+	TArray<uint8>* Baseline = Baselines.Find(Key);
+	if (!Baseline)
+	{
+		if (Baselines.Num() >= FLinkStreamDeltaEncoder::MaxBaselines)
+		{
+			return;
+		}
+		Baseline = &Baselines.Add(Key);
+	}
+	Baseline->Reset(Size);
+	Baseline->Append(Data, Size);
+}
+
+bool FLinkStreamDeltaDecoder::ShouldRequestKeyframe(const TArray<uint8>& Key)
+{
+	uint64 KeyValue = 0;
+	if (!FLinkStreamDeltaEncoder::ReadKey(Key.GetData(), Key.Num(), Key.Num(), KeyValue))
+	{
+		return false;
+	}
+	if (AwaitingKeyframe.Num() >= FLinkStreamDeltaEncoder::MaxBaselines)
+	{
+		return true;
+	}
+	bool bAlreadyAwaiting = false;
+	AwaitingKeyframe.Add(KeyValue, &bAlreadyAwaiting);
+	return !bAlreadyAwaiting;
+}
+
+bool FLinkStreamDeltaDecoder::Decode(const uint8* Delta, int32 Size, int32 MaxSize, TArray<uint8>& OutMessage, TArray<uint8>& OutKey)
+{
+	OutKey.Reset();
+	FLinkStreamReader Reader(MakeArrayView(Delta, Size));
+	uint8 DeltaKeySize = 0;
+	TArrayView<const uint8> KeyBytes;
+	uint32 Crc = 0;
+	uint64 NewSize = 0;
+	uint64 Key = 0;
+	if (!Reader.ReadInteger(DeltaKeySize) || DeltaKeySize < 1 || DeltaKeySize > 8 || !Reader.ReadSpan(DeltaKeySize, KeyBytes)
+		|| !Reader.ReadInteger(Crc) || !Reader.ReadVarUInt(NewSize) || NewSize < DeltaKeySize || NewSize > (uint64)MaxSize)
+	{
+		return false;
+	}
+	FLinkStreamDeltaEncoder::ReadKey(KeyBytes.GetData(), DeltaKeySize, DeltaKeySize, Key);
+
+	TArray<uint8>* Baseline = DeltaKeySize == KeySize ? Baselines.Find(Key) : nullptr;
+	if (!Baseline || FCrc::MemCrc32(Baseline->GetData(), Baseline->Num()) != Crc)
+	{
+		Baselines.Remove(Key);
+		OutKey.Append(KeyBytes.GetData(), KeyBytes.Num());
+		return false;
+	}
+
+	const int32 Start = OutMessage.Num();
+	OutMessage.AddUninitialized((int32)NewSize);
+	uint8* Dest = OutMessage.GetData() + Start;
+	const int32 Kept = FMath::Min((int32)NewSize, Baseline->Num());
+	FMemory::Memcpy(Dest, Baseline->GetData(), Kept);
+	FMemory::Memzero(Dest + Kept, (int32)NewSize - Kept);
+
+	int32 Position = DeltaKeySize;
+	while (!Reader.IsAtEnd())
+	{
+		uint64 Skip = 0;
+		uint64 Count = 0;
+		TArrayView<const uint8> Span;
+		if (!Reader.ReadVarUInt(Skip) || !Reader.ReadVarUInt(Count) || Skip + Count > NewSize - Position || !Reader.ReadSpan((int32)Count, Span))
+		{
+			// Whatever garbled the delta, the baseline can no longer be trusted either.
+			OutMessage.SetNum(Start, false);
+			Baselines.Remove(Key);
+			OutKey.Append(KeyBytes.GetData(), KeyBytes.Num());
+			return false;
+		}
+
+		Position += (int32)Skip;
+		for (int32 Index = 0; Index < Span.Num(); Index++)
+		{
+			Dest[Position + Index] ^= Span[Index];
+		}
+		Position += Span.Num();
+	}
+
+	Baseline->Reset((int32)NewSize);
+	Baseline->Append(Dest, (int32)NewSize);
+	return true;
+}
+
+void FLinkStreamDeltaSession::Configure(bool bInEnabled, int32 KeySize, int32 KeyframeInterval)
+{
+	bEnabled = bInEnabled;
+	Encoder.Configure(KeySize, KeyframeInterval);
+}
+
+void FLinkStreamDeltaSession::CountDelta(int32 RawSize, int32 EncodedSize)
+{
+	DeltaMessages.Increment();
+	RawBytes.Add(RawSize);
+	EncodedBytes.Add(EncodedSize);
+}
+
+void FLinkStreamDeltaSession::CountKeyframe(int32 Size)
+{
+	Keyframes.Increment();
+	RawBytes.Add(Size);
+	EncodedBytes.Add(Size);
+}
+
+FLinkStreamDeltaStats FLinkStreamDeltaSession::GetStats() const
+{
+	FLinkStreamDeltaStats stats;
+	stats.bNegotiated = IsNegotiated();
+	stats.DeltaMessages = DeltaMessages.GetValue();
+	stats.Keyframes = Keyframes.GetValue();
+	stats.RawBytes = RawBytes.GetValue();
+	stats.EncodedBytes = EncodedBytes.GetValue();
+	stats.BytesSaved = stats.RawBytes - stats.EncodedBytes;
+	stats.ResyncsReceived = ResyncsReceived.GetValue();
+	stats.ResyncsSent = ResyncsSent.GetValue();
+	return stats;
+}
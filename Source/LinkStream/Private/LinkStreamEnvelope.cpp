@@ -0,0 +1,77 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamEnvelope.h"
+#include "LinkStreamFraming.h"
+
+int32 FLinkStreamEnvelope::Encode(uint8 OutBytes[MaxSize]) const
+{
+	OutBytes[0] = Marker | ((Flags & 0x0F) << 3) | ((uint8)Kind & 0x07);
+	if (!HasCorrelationId())
+	{
+		return 1;
+	}
+	return 1 + FLinkStreamFraming::EncodeHeader(ELinkStreamFraming::VarInt, CorrelationId, OutBytes + 1);
+}
+
+int32 FLinkStreamEnvelope::Decode(const uint8* Bytes, int32 NumBytes, FLinkStreamEnvelope& OutEnvelope)
+{
+	if (NumBytes < 1 || (Bytes[0] & Marker) == 0)
+	{
+		return 0;
+	}
+
+	const uint8 KindBits = Bytes[0] & 0x07;
+	if (KindBits > (uint8)ELinkStreamMessageKind::Resync)
+	{
+		return 0;
+	}
+	OutEnvelope.Kind = (ELinkStreamMessageKind)KindBits;
+	OutEnvelope.Flags = (Bytes[0] >> 3) & 0x0F;
+	OutEnvelope.CorrelationId = 0;
+	if (!OutEnvelope.HasCorrelationId())
+	{
+		return 1;
+	}
+
+	for (int32 Index = 1; Index < MaxSize; Index++)
+	{
+		if (Index >= NumBytes)
+		{
+			return 0;
+		}
+		// The fifth varint byte holds the top 4 bits of the ID; anything above overflows it.
+		if (Index == MaxSize - 1 && Bytes[Index] > 0x0F)
+		{
+			return 0;
+		}
+		OutEnvelope.CorrelationId |= (uint32)(Bytes[Index] & 0x7F) << (7 * (Index - 1));
+		if ((Bytes[Index] & 0x80) == 0)
+		{
+			return Index + 1;
+		}
+	}
+	return 0;
+}
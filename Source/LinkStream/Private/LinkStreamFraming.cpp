@@ -0,0 +1,235 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamFraming.h"
+
+void FLinkStreamRingBuffer::Init(int32 InCapacity)
+{
+	const int32 RoundedCapacity = (int32)FMath::RoundUpToPowerOfTwo((uint32)FMath::Max(InCapacity, 64));
+	Data.SetNumUninitialized(RoundedCapacity);
+	Mask = RoundedCapacity - 1;
+	Head = 0;
+	Count = 0;
+}
+
+int32 FLinkStreamRingBuffer::GetWriteRegions(uint8*& OutFirst, int32& OutFirstSize, uint8*& OutSecond, int32& OutSecondSize)
+{
+	OutFirst = nullptr;
+	OutSecond = nullptr;
+	OutFirstSize = 0;
+	OutSecondSize = 0;
+
+	const int32 Free = Slack();
+	if (Free == 0)
+	{
+		return 0;
+	}
+
+	const int32 Tail = (Head + Count) & Mask;
+	const int32 UntilEnd = Data.Num() - Tail;
+
+	OutFirst = Data.GetData() + Tail;
+	OutFirstSize = FMath::Min(Free, UntilEnd);
+	if (OutFirstSize == Free)
+	{
+		return 1;
+	}
+
+	OutSecond = Data.GetData();
+	OutSecondSize = Free - OutFirstSize;
+	return 2;
+}
+
+void FLinkStreamRingBuffer::CommitWrite(int32 NumBytes)
+{
+	check(NumBytes >= 0 && NumBytes <= Slack());
+	Count += NumBytes;
+}
+
+int32 FLinkStreamRingBuffer::Write(const uint8* Src, int32 NumBytes)
+{
+	uint8* First;
+	uint8* Second;
+	int32 FirstSize;
+	int32 SecondSize;
+	GetWriteRegions(First, FirstSize, Second, SecondSize);
+
+	const int32 ToFirst = FMath::Min(NumBytes, FirstSize);
+	const int32 ToSecond = FMath::Min(NumBytes - ToFirst, SecondSize);
+	if (ToFirst > 0)
+	{
+		FMemory::Memcpy(First, Src, ToFirst);
+	}
+	if (ToSecond > 0)
+	{
+		FMemory::Memcpy(Second, Src + ToFirst, ToSecond);
+	}
+
+	CommitWrite(ToFirst + ToSecond);
+	return ToFirst + ToSecond;
+}
+
+bool FLinkStreamRingBuffer::Peek(uint8* Dst, int32 NumBytes, int32 Offset) const
+{
+	if (NumBytes < 0 || Offset < 0 || Offset + NumBytes > Count)
+	{
+		return false;
+	}
+
+	const int32 Start = (Head + Offset) & Mask;
+	const int32 UntilEnd = Data.Num() - Start;
+	const int32 FirstPart = FMath::Min(NumBytes, UntilEnd);
+
+	FMemory::Memcpy(Dst, Data.GetData() + Start, FirstPart);
+	if (FirstPart < NumBytes)
+	{
+		FMemory::Memcpy(Dst + FirstPart, Data.GetData(), NumBytes - FirstPart);
+	}
+	return true;
+}
+
+void FLinkStreamRingBuffer::Consume(int32 NumBytes)
+{
+	check(NumBytes >= 0 && NumBytes <= Count);
+	Head = (Head + NumBytes) & Mask;
+	Count -= NumBytes;
+	if (Count == 0)
+	{
+		Head = 0;
+	}
+}
+
+void FLinkStreamRingBuffer::Reset()
+{
+	Head = 0;
+	Count = 0;
+}
+
+int32 FLinkStreamFraming::EncodeHeader(ELinkStreamFraming Framing, uint32 PayloadSize, uint8 OutHeader[MaxHeaderSize])
+{
+	switch (Framing)
+	{
+	case ELinkStreamFraming::UInt32:
+		OutHeader[0] = (uint8)(PayloadSize);
+		OutHeader[1] = (uint8)(PayloadSize >> 8);
+		OutHeader[2] = (uint8)(PayloadSize >> 16);
+		OutHeader[3] = (uint8)(PayloadSize >> 24);
+		return 4;
+
+	case ELinkStreamFraming::VarInt:
+	{
+		int32 Size = 0;
+		do
+		{
+			uint8 Byte = PayloadSize & 0x7F;
+			PayloadSize >>= 7;
+			if (PayloadSize != 0)
+			{
+				Byte |= 0x80;
+			}
+			OutHeader[Size++] = Byte;
+		} while (PayloadSize != 0);
+		return Size;
+	}
+
+	default:
+		return 0;
+	}
+}
+
+ELinkStreamFrameResult FLinkStreamFraming::DecodeHeader(ELinkStreamFraming Framing, const FLinkStreamRingBuffer& Ring, int32 MaxFrameSize, int32& OutHeaderSize, int32& OutPayloadSize)
+{
+	uint32 Length = 0;
+
+	if (Framing == ELinkStreamFraming::UInt32)
+	{
+		if (Ring.Num() < 4)
+		{
+			return ELinkStreamFrameResult::NeedMoreData;
+		}
+		Length = (uint32)Ring.PeekByte(0)
+			| ((uint32)Ring.PeekByte(1) << 8)
+			| ((uint32)Ring.PeekByte(2) << 16)
+			| ((uint32)Ring.PeekByte(3) << 24);
+		OutHeaderSize = 4;
+	}
+	else if (Framing == ELinkStreamFraming::VarInt)
+	{
+		int32 Index = 0;
+		for (;;)
+		{
+			if (Index >= MaxHeaderSize)
+			{
+				return ELinkStreamFrameResult::InvalidHeader;
+			}
+			if (Index >= Ring.Num())
+			{
+				return ELinkStreamFrameResult::NeedMoreData;
+			}
+			const uint8 Byte = Ring.PeekByte(Index);
+			// The fifth byte holds the top 4 bits; more would overflow, and a continuation bit has nowhere to go.
+			if (Index == MaxHeaderSize - 1 && Byte > 0x0F)
+			{
+				return ELinkStreamFrameResult::InvalidHeader;
+			}
+			Length |= (uint32)(Byte & 0x7F) << (7 * Index);
+			Index++;
+			if ((Byte & 0x80) == 0)
+			{
+				break;
+			}
+		}
+		OutHeaderSize = Index;
+	}
+	else
+	{
+		return ELinkStreamFrameResult::InvalidHeader;
+	}
+
+	if (Length > (uint32)MaxFrameSize)
+	{
+		return ELinkStreamFrameResult::FrameTooLarge;
+	}
+
+	OutPayloadSize = (int32)Length;
+	return Ring.Num() - OutHeaderSize >= OutPayloadSize ? ELinkStreamFrameResult::Frame : ELinkStreamFrameResult::NeedMoreData;
+}
+
+ELinkStreamFrameResult FLinkStreamFraming::ReadFrame(ELinkStreamFraming Framing, FLinkStreamRingBuffer& Ring, int32 MaxFrameSize, FLinkStreamBuffer& OutFrame)
+{
+	int32 HeaderSize = 0;
+	int32 PayloadSize = 0;
+	const ELinkStreamFrameResult Result = DecodeHeader(Framing, Ring, MaxFrameSize, HeaderSize, PayloadSize);
+	if (Result != ELinkStreamFrameResult::Frame)
+	{
+		return Result;
+	}
+
+	OutFrame = FLinkStreamBuffer::Acquire(PayloadSize);
+	OutFrame.GetArray().SetNumUninitialized(PayloadSize, false);
+	Ring.Peek(OutFrame.GetData(), PayloadSize, HeaderSize);
+	Ring.Consume(HeaderSize + PayloadSize);
+	return ELinkStreamFrameResult::Frame;
+}
@@ -0,0 +1,122 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamHeartbeat.h"
+
+void FLinkStreamHeartbeat::Configure(float InInterval, float InIdleTimeout)
+{
+	Interval = InInterval;
+	IdleTimeout = InIdleTimeout;
+}
+
+void FLinkStreamHeartbeat::Reset(double Now)
+{
+	LastReceiveTime.store(Now, std::memory_order_relaxed);
+	LastMessageTime = Now;
+	NextPingAt = Now + Interval;
+	PingSentAt = 0.0;
+	SkippedPings = 0;
+}
+
+bool FLinkStreamHeartbeat::IsIdle(double Now) const
+{
+	return IdleTimeout > 0.f && Now - LastReceiveTime.load(std::memory_order_relaxed) >= IdleTimeout;
+}
+
+bool FLinkStreamHeartbeat::PreparePing(double Now, uint32& OutSequence)
+{
+	if (Interval <= 0.f || Now < NextPingAt)
+	{
+		return false;
+	}
+	NextPingAt = Now + Interval;
+
+	// Messages arriving anyway prove the peer is alive; every fourth ping still goes out so the round-trip time stays current.
+	if (Now - LastMessageTime < Interval && ++SkippedPings < 4)
+	{
+		return false;
+	}
+	SkippedPings = 0;
+
+	PingSequence = PingSequence == MAX_uint32 ? 1 : PingSequence + 1;
+	OutSequence = PingSequence;
+	return true;
+}
+
+void FLinkStreamHeartbeat::OnPingSent(double Now)
+{
+	PingSentAt = Now;
+	PingsSent.Increment();
+}
+
+void FLinkStreamHeartbeat::OnPong(uint32 Sequence, double Now)
+{
+	if (Sequence != PingSequence || PingSentAt <= 0.0)
+	{
+		return;
+	}
+
+	const float rtt = (float)((Now - PingSentAt) * 1000.0);
+	PingSentAt = 0.0;
+	PongsReceived.Increment();
+
+	LastRttMs.store(rtt, std::memory_order_relaxed);
+	const float smoothed = SmoothedRttMs.load(std::memory_order_relaxed);
+	SmoothedRttMs.store(smoothed < 0.f ? rtt : smoothed + (rtt - smoothed) / 8.f, std::memory_order_relaxed);
+	const float minRtt = MinRttMs.load(std::memory_order_relaxed);
+	if (minRtt < 0.f || rtt < minRtt)
+	{
+		MinRttMs.store(rtt, std::memory_order_relaxed);
+	}
+}
+
+double FLinkStreamHeartbeat::GetNextTime() const
+{
+	double next = MAX_dbl;
+	if (IdleTimeout > 0.f)
+	{
+		next = LastReceiveTime.load(std::memory_order_relaxed) + IdleTimeout;
+	}
+	if (Interval > 0.f)
+	{
+		next = FMath::Min(next, NextPingAt);
+	}
+	return next;
+}
+
+FLinkStreamHeartbeatStats FLinkStreamHeartbeat::GetStats(double Now, bool bLinkUp) const
+{
+	FLinkStreamHeartbeatStats stats;
+	stats.RoundTripTimeMs = SmoothedRttMs.load(std::memory_order_relaxed);
+	stats.LastRoundTripTimeMs = LastRttMs.load(std::memory_order_relaxed);
+	stats.MinRoundTripTimeMs = MinRttMs.load(std::memory_order_relaxed);
+	if (bLinkUp)
+	{
+		stats.SecondsSinceLastReceive = (float)(Now - LastReceiveTime.load(std::memory_order_relaxed));
+	}
+	stats.PingsSent = PingsSent.GetValue();
+	stats.PongsReceived = PongsReceived.GetValue();
+	return stats;
+}
@@ -0,0 +1,174 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamInbox.h"
+
+void FLinkStreamInbox::Configure(int32 InLimit, ELinkStreamInboxOverflow InOverflow, int32 InKeySize)
+{
+	Limit = FMath::Max(InLimit, 0);
+	Overflow = InOverflow;
+	KeySize = FMath::Clamp(InKeySize, 1, 8);
+	if (Limit > 0 && Overflow != ELinkStreamInboxOverflow::PauseReceive)
+	{
+		Slots.SetNum(Limit);
+		KeySlots.Reserve(Overflow == ELinkStreamInboxOverflow::Coalesce ? Limit : 0);
+	}
+}
+
+bool FLinkStreamInbox::ReadKey(const uint8* Payload, int32 PayloadSize, uint64& OutKey) const
+{
+	if (PayloadSize < KeySize)
+	{
+		return false;
+	}
+	OutKey = 0;
+	for (int32 Index = 0; Index < KeySize; Index++)
+	{
+		OutKey |= (uint64)Payload[Index] << (8 * Index);
+	}
+	return true;
+}
+
+bool FLinkStreamInbox::Push(FLinkStreamBuffer&& Message, const uint64* Key)
+{
+	if (Limit == 0 || Overflow == ELinkStreamInboxOverflow::PauseReceive)
+	{
+		Queue.Enqueue(MoveTemp(Message));
+		const int32 Queued = Count.fetch_add(1) + 1;
+		UpdatePeak(Queued);
+		if (Limit > 0 && Queued >= Limit && !bReceivePaused.load())
+		{
+			bReceivePaused.store(true);
+			ReceivePauses.Increment();
+
+			// The consumer may have drained past the resume mark before the flag was up, and would not clear it.
+			if (Count.load() <= Limit / 2)
+			{
+				bReceivePaused.store(false);
+			}
+		}
+		return true;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	const bool bKeyed = Key != nullptr && Overflow == ELinkStreamInboxOverflow::Coalesce;
+	if (bKeyed)
+	{
+		if (const int32* Waiting = KeySlots.Find(*Key))
+		{
+			Slots[*Waiting].Message = MoveTemp(Message);
+			CoalescedMessages.Increment();
+			return false;
+		}
+	}
+
+	if (Count.load() == Limit)
+	{
+		if (Overflow == ELinkStreamInboxOverflow::DropNewest)
+		{
+			DroppedMessages.Increment();
+			return false;
+		}
+		EvictOldest();
+	}
+
+	const int32 Tail = (Head + Count.load()) % Limit;
+	FSlot& Slot = Slots[Tail];
+	Slot.Message = MoveTemp(Message);
+	Slot.bKeyed = bKeyed;
+	if (bKeyed)
+	{
+		Slot.Key = *Key;
+		KeySlots.Add(*Key, Tail);
+	}
+	UpdatePeak(Count.fetch_add(1) + 1);
+	return true;
+}
+
+bool FLinkStreamInbox::Pop(FLinkStreamBuffer& OutMessage, bool& bOutResumed)
+{
+	bOutResumed = false;
+	if (Count.load() == 0)
+	{
+		return false;
+	}
+
+	if (Limit == 0 || Overflow == ELinkStreamInboxOverflow::PauseReceive)
+	{
+		if (!Queue.Dequeue(OutMessage))
+		{
+			return false;
+		}
+		const int32 Queued = Count.fetch_sub(1) - 1;
+		bOutResumed = Queued <= Limit / 2 && bReceivePaused.load() && bReceivePaused.exchange(false);
+		return true;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	FSlot& Slot = Slots[Head];
+	OutMessage = MoveTemp(Slot.Message);
+	if (Slot.bKeyed)
+	{
+		KeySlots.Remove(Slot.Key);
+		Slot.bKeyed = false;
+	}
+	Head = (Head + 1) % Limit;
+	Count.fetch_sub(1);
+	return true;
+}
+
+void FLinkStreamInbox::EvictOldest()
+{
+	FSlot& Slot = Slots[Head];
+	Slot.Message.Release();
+	if (Slot.bKeyed)
+	{
+		KeySlots.Remove(Slot.Key);
+		Slot.bKeyed = false;
+	}
+	Head = (Head + 1) % Limit;
+	Count.fetch_sub(1);
+	DroppedMessages.Increment();
+}
+
+void FLinkStreamInbox::UpdatePeak(int32 Queued)
+{
+	// Only the producer raises the peak, so a plain compare is enough.
+	if (Queued > PeakCount.load(std::memory_order_relaxed))
+	{
+		PeakCount.store(Queued, std::memory_order_relaxed);
+	}
+}
+
+FLinkStreamInboxStats FLinkStreamInbox::GetStats() const
+{
+	FLinkStreamInboxStats Stats;
+	Stats.QueuedMessages = Count.load();
+	Stats.PeakQueuedMessages = PeakCount.load(std::memory_order_relaxed);
+	Stats.DroppedMessages = DroppedMessages.GetValue();
+	Stats.CoalescedMessages = CoalescedMessages.GetValue();
+	Stats.ReceivePauses = ReceivePauses.GetValue();
+	return Stats;
+}
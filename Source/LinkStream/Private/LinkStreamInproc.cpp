@@ -0,0 +1,247 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamInproc.h"
+#include "LinkStream.h"
+#include "LinkStreamConnection.h"
+#include "Async/Async.h"
+
+static const TCHAR* InprocScheme = TEXT("inproc://");
+
+FLinkStreamInprocEndpoint::FLinkStreamInprocEndpoint(const FString& InName)
+	: Name(InName)
+{
+}
+
+bool FLinkStreamInprocEndpoint::IsInprocAddress(const FString& Address)
+{
+	return Address.StartsWith(InprocScheme, ESearchCase::IgnoreCase);
+}
+
+FLinkStreamInprocEndpoint* FLinkStreamInprocEndpoint::FindOrCreate(const FString& Address)
+{
+	if (!IsInprocAddress(Address))
+	{
+		return nullptr;
+	}
+	return FindOrCreateByName(Address.RightChop(FCString::Strlen(InprocScheme)));
+}
+
+FLinkStreamInprocEndpoint* FLinkStreamInprocEndpoint::FindOrCreateByName(const FString& Name)
+{
+	if (Name.IsEmpty())
+	{
+		return nullptr;
+	}
+	return &FLinkStreamModule::Get().FindOrCreateInprocEndpoint(Name);
+}
+
+bool FLinkStreamInprocEndpoint::Attach(ILinkStreamWorkerOwner* InOwner, int32 InWorkerId, const FTcpSocketWorkerSettings& Settings)
+{
+	check(IsInGameThread());
+	if (bAttached)
+	{
+		return false;
+	}
+
+	// Replies meant for the previous connection must not reach this one, nor its unread sends the runtime.
+	ResetQueues();
+
+	bPerMessageDispatch = Settings.DispatchMode == ELinkStreamDispatchMode::PerMessage;
+	MaxFrameSize = Settings.Framing != ELinkStreamFraming::None ? Settings.MaxFrameSize : MAX_int32;
+	SendHighWatermark = Settings.SendHighWatermark;
+	SendLowWatermark = Settings.SendLowWatermark;
+	SendCapacity = FMath::Max(1, Settings.OutboxCapacity);
+	InboxLimit = Settings.InboxLimit;
+
+	OwnerObject = InOwner ? InOwner->GetWorkerOwnerObject() : nullptr;
+	Owner = InOwner;
+	WorkerId = InWorkerId;
+	bAttached = true;
+	++AttachSerial;
+	return true;
+}
+
+void FLinkStreamInprocEndpoint::Detach(const ILinkStreamWorkerOwner* InOwner, int32 InWorkerId)
+{
+	check(IsInGameThread());
+	if (!IsAttachedTo(InOwner, InWorkerId))
+	{
+		return;
+	}
+
+	bAttached = false;
+	OwnerObject.Reset();
+	Owner = nullptr;
+	WorkerId = INDEX_NONE;
+	++AttachSerial;
+	ResetQueues();
+}
+
+void FLinkStreamInprocEndpoint::ResetQueues()
+{
+	FLinkStreamBuffer stale;
+	while (ToNative.Dequeue(stale))
+	{
+		InboxCount.Decrement();
+	}
+
+	{
+		FScopeLock lock(&ToManagedLock);
+		while (ToManaged.Dequeue(stale))
+		{
+		}
+		SendCount.Reset();
+		PendingSendBytes.Reset();
+	}
+	bSendBackpressured = false;
+}
+
+void FLinkStreamInprocEndpoint::PostToOwner(TUniqueFunction<void(ILinkStreamWorkerOwner&, int32)>&& Call)
+{
+	const uint32 serial = AttachSerial.load();
+	AsyncTask(ENamedThreads::GameThread, [this, serial, Call = MoveTemp(Call)]() {
+		if (bAttached && Owner && serial == AttachSerial.load() && OwnerObject.IsValid())
+		{
+			Call(*Owner, WorkerId);
+		}
+	});
+}
+
+bool FLinkStreamInprocEndpoint::Reserve(int32 Count)
+{
+	// Claimed optimistically and handed back on overflow, so concurrent senders never overshoot the capacity together.
+	const int32 queued = SendCount.Add(Count) + Count;
+	if (queued <= SendCapacity)
+	{
+		return true;
+	}
+
+	SendCount.Subtract(Count);
+	if (!bSendBackpressured.exchange(true))
+	{
+		PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerSendBackpressure(workerId, true); });
+	}
+	return false;
+}
+
+void FLinkStreamInprocEndpoint::Send(FLinkStreamBuffer&& Message)
+{
+	const int64 messageSize = Message.Num();
+	ToManaged.Enqueue(MoveTemp(Message));
+
+	const int64 pending = PendingSendBytes.Add(messageSize) + messageSize;
+	const int32 highWatermark = SendHighWatermark;
+	if (highWatermark > 0 && pending >= highWatermark && !bSendBackpressured.exchange(true))
+	{
+		PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerSendBackpressure(workerId, true); });
+	}
+}
+
+bool FLinkStreamInprocEndpoint::Receive(FLinkStreamBuffer& OutMessage)
+{
+	if (!ToNative.Dequeue(OutMessage))
+	{
+		return false;
+	}
+	InboxCount.Decrement();
+	return true;
+}
+
+bool FLinkStreamInprocEndpoint::ManagedSend(const uint8* Data, int32 Size)
+{
+	if (!bAttached || Size < 0 || (Size > 0 && !Data) || Size > MaxFrameSize)
+	{
+		return false;
+	}
+
+	// Claimed before queuing and handed back when over the limit, as Reserve does for the other direction.
+	const int32 limit = InboxLimit;
+	if (InboxCount.Increment() > limit && limit > 0)
+	{
+		InboxCount.Decrement();
+		return false;
+	}
+
+	FLinkStreamBuffer message = FLinkStreamBuffer::Acquire(Size);
+	message.GetArray().Append(Data, Size);
+	ToNative.Enqueue(MoveTemp(message));
+
+	// Batched connections drain the inbox from Tick, so only per-message dispatch needs a game-thread task.
+	if (bPerMessageDispatch)
+	{
+		PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerMessage(workerId); });
+	}
+	return true;
+}
+
+const uint8* FLinkStreamInprocEndpoint::ManagedReceive(int32& OutSize)
+{
+	ManagedCurrent.Release();
+	int64 pending = 0;
+	int32 queued = 0;
+	{
+		FScopeLock lock(&ToManagedLock);
+		if (!ToManaged.Dequeue(ManagedCurrent))
+		{
+			OutSize = 0;
+			return nullptr;
+		}
+
+		OutSize = ManagedCurrent.Num();
+		pending = PendingSendBytes.Add(-OutSize) - OutSize;
+		queued = SendCount.Decrement();
+	}
+
+	// Released once the bytes are down to SendLowWatermark and half the slots are free again, so a full queue does not flap.
+	if (bSendBackpressured && pending <= SendLowWatermark && queued <= SendCapacity / 2 && bSendBackpressured.exchange(false))
+	{
+		PostToOwner([](ILinkStreamWorkerOwner& owner, int32 workerId) { owner.OnWorkerSendBackpressure(workerId, false); });
+	}
+	return ManagedCurrent.GetData();
+}
+
+void FLinkStreamInprocEndpoint::ManagedClose()
+{
+	ManagedCurrent.Release();
+
+	const uint32 serial = AttachSerial.load();
+	AsyncTask(ENamedThreads::GameThread, [this, serial]() {
+		if (!bAttached || serial != AttachSerial.load())
+		{
+			return;
+		}
+
+		// Detached first, so the worker does not report the disconnect a second time when its owner drops it.
+		ILinkStreamWorkerOwner* owner = Owner;
+		const int32 workerId = WorkerId;
+		const bool bOwnerAlive = owner && OwnerObject.IsValid();
+		Detach(owner, workerId);
+		if (bOwnerAlive)
+		{
+			owner->OnWorkerDisconnected(workerId);
+		}
+	});
+}
@@ -0,0 +1,317 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamListener.h"
+#include "LinkStream.h"
+#include "LinkStreamAcceptor.h"
+#include "LinkStreamTls.h"
+#include "Async/Async.h"
+#include "Misc/ScopeRWLock.h"
+
+ALinkStreamListener::ALinkStreamListener()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+void ALinkStreamListener::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+	StopListening();
+	DisconnectAllSessions();
+}
+
+void ALinkStreamListener::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (DispatchMode == ELinkStreamDispatchMode::Batched)
+	{
+		ALinkStreamConnection::DispatchWorkerInboxes(Sessions, [this](int32 SessionId, FLinkStreamBuffer& Message) { MessageReceivedDelegate.ExecuteIfBound(SessionId, Message.GetArray()); },
+			MaxMessagesPerFrame, MaxDispatchTimeMs, NextDispatchIndex);
+	}
+}
+
+bool ALinkStreamListener::Listen(const FString& BindAddress, int32 Port, const FTcpSocketDisconnectDelegate& OnSessionDisconnected, const FTcpSocketConnectDelegate& OnSessionConnected,
+	const FTcpSocketReceivedMessageDelegate& OnMessageReceived, int32& BoundPort)
+{
+	BoundPort = 0;
+	if (Acceptor.IsValid())
+	{
+		ALinkStreamConnection::PrintToConsole(TEXT("Listen: already listening. Call StopListening first."), true);
+		return false;
+	}
+
+	SessionDisconnectedDelegate = OnSessionDisconnected;
+	SessionConnectedDelegate = OnSessionConnected;
+	MessageReceivedDelegate = OnMessageReceived;
+
+	FTcpSocketWorkerSettings settings;
+	settings.RecvBufferSize = ReceiveBufferSize;
+	settings.SendBufferSize = SendBufferSize;
+	settings.Backend = ELinkStreamBackend::Reactor;
+	settings.DispatchMode = DispatchMode;
+	settings.Framing = Framing;
+	settings.MaxFrameSize = MaxFrameSize;
+	settings.bNoDelay = bNoDelay;
+	settings.SendHighWatermark = SendHighWatermark;
+	settings.SendLowWatermark = FMath::Min(SendLowWatermark, SendHighWatermark);
+	settings.LaneWeights[(int32)ELinkStreamPriority::Control] = ControlLaneWeight;
+	settings.LaneWeights[(int32)ELinkStreamPriority::Interactive] = InteractiveLaneWeight;
+	settings.LaneWeights[(int32)ELinkStreamPriority::Bulk] = BulkLaneWeight;
+	settings.OutboxCapacity = OutboxCapacity;
+	settings.MaxPendingSendBytes = MaxPendingSendBytes;
+	settings.IdleTimeout = IdleTimeout;
+	settings.bTcpKeepAlive = bTcpKeepAlive;
+	settings.TcpKeepAliveIdle = TcpKeepAliveIdle;
+	settings.TcpKeepAliveInterval = TcpKeepAliveInterval;
+	settings.TcpKeepAliveProbes = TcpKeepAliveProbes;
+	settings.InboxLimit = InboxLimit;
+	settings.InboxOverflow = InboxOverflow;
+	settings.CoalesceKeySize = CoalesceKeySize;
+	settings.bEncrypt = bEncrypt;
+	settings.EncryptionKey = EncryptionKey;
+	settings.bTls = bTls;
+	if (bTls)
+	{
+		FString certificate;
+		FString privateKey;
+		if (!FLinkStreamTlsContext::LoadPemFile(TlsCertificateFile, certificate) || !FLinkStreamTlsContext::LoadPemFile(TlsPrivateKeyFile, privateKey))
+		{
+			ALinkStreamConnection::PrintToConsole(TEXT("Listen: bTls needs TlsCertificateFile and TlsPrivateKeyFile, and one could not be read."), true);
+			return false;
+		}
+
+		FString error;
+		settings.TlsServerContext = FLinkStreamTlsContext::CreateServer(certificate, privateKey, error);
+		if (!settings.TlsServerContext.IsValid())
+		{
+			ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Listen: could not set up TLS: %s."), *error), true);
+			return false;
+		}
+		if (bEncrypt)
+		{
+			ALinkStreamConnection::PrintToConsole(TEXT("Listen: bTls already encrypts sessions; bEncrypt is ignored."), true);
+		}
+	}
+	else if (bEncrypt && Framing == ELinkStreamFraming::None)
+	{
+		ALinkStreamConnection::PrintToConsole(TEXT("Listen: bEncrypt needs Framing; not listening."), true);
+		return false;
+	}
+
+	// Sessions are created on a reactor thread; the map is only touched here, on the game thread.
+	TWeakObjectPtr<ALinkStreamListener> weakThis(this);
+	Acceptor = MakeShareable(new FLinkStreamAcceptor(this, settings, MaxSessions, LiveSessions, NextSessionId,
+		[weakThis](int32 sessionId, const TSharedRef<FTcpSocketWorker>& session) {
+			TSharedRef<FTcpSocketWorker> sessionRef = session;
+			AsyncTask(ENamedThreads::GameThread, [weakThis, sessionId, sessionRef]() {
+				if (weakThis.IsValid())
+				{
+					FWriteScopeLock writeLock(weakThis->SessionsLock);
+					weakThis->Sessions.Add(sessionId, sessionRef);
+				}
+				else
+				{
+					sessionRef->Stop();
+				}
+			});
+		}));
+
+	if (!Acceptor->Start(BindAddress, Port, Backlog))
+	{
+		ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Listen: could not listen on %s:%d."), *BindAddress, Port), true);
+		Acceptor.Reset();
+		return false;
+	}
+
+	BoundPort = Acceptor->GetPort();
+	return true;
+}
+
+void ALinkStreamListener::StopListening()
+{
+	if (Acceptor.IsValid())
+	{
+		Acceptor->Stop();
+		NextSessionId = Acceptor->GetNextSessionId();
+		Acceptor.Reset();
+	}
+}
+
+void ALinkStreamListener::DisconnectSession(int32 SessionId)
+{
+	TSharedRef<FTcpSocketWorker>* session = Sessions.Find(SessionId);
+	if (session)
+	{
+		(*session)->Stop();
+		FWriteScopeLock writeLock(SessionsLock);
+		Sessions.Remove(SessionId);
+	}
+}
+
+void ALinkStreamListener::DisconnectAllSessions()
+{
+	for (auto& session : Sessions)
+	{
+		session.Value->Stop();
+	}
+	FWriteScopeLock writeLock(SessionsLock);
+	Sessions.Empty();
+}
+
+bool ALinkStreamListener::SendData(int32 SessionId, TArray<uint8> DataToSend, ELinkStreamPriority Priority)
+{
+	const TSharedPtr<FTcpSocketWorker> session = FindSession(SessionId);
+	if (!session.IsValid() || !session->isConnected())
+	{
+		UE_LOG(LogLinkStream, Log, TEXT("Log: Session %d isn't connected"), SessionId);
+		return false;
+	}
+
+	// The session's copies of the limits, taken at Listen, agree with what its worker enforces.
+	const int32 maxMessageSize = session->GetMaxMessageSize();
+	if (maxMessageSize > 0 && DataToSend.Num() > maxMessageSize)
+	{
+		ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("SendData: message of %d bytes exceeds MaxFrameSize (%d)."), DataToSend.Num(), maxMessageSize), true);
+		return false;
+	}
+	const int32 maxPending = session->GetMaxPendingSendBytes();
+	const int64 pending = session->GetPendingSendBytes();
+	if (maxPending > 0 && pending + DataToSend.Num() > maxPending)
+	{
+		ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("SendData: session %d already has %lld unsent bytes (MaxPendingSendBytes %d)."), SessionId, pending, maxPending), true);
+		return false;
+	}
+
+	if (!session->AddToOutbox(FLinkStreamBuffer(MoveTemp(DataToSend)), Priority))
+	{
+		ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("SendData: lane %d of session %d is full (OutboxCapacity %d)."), (int32)Priority, SessionId, session->GetOutboxCapacity()), true);
+		return false;
+	}
+	return true;
+}
+
+TSharedPtr<FTcpSocketWorker> ALinkStreamListener::FindSession(int32 SessionId) const
+{
+	FReadScopeLock readLock(SessionsLock);
+	const TSharedRef<FTcpSocketWorker>* session = Sessions.Find(SessionId);
+	return session ? TSharedPtr<FTcpSocketWorker>(*session) : TSharedPtr<FTcpSocketWorker>();
+}
+
+bool ALinkStreamListener::SendWriter(int32 SessionId, FLinkStreamWriter& Writer, ELinkStreamPriority Priority)
+{
+	return SendData(SessionId, Writer.Release(), Priority);
+}
+
+bool ALinkStreamListener::IsListening() const
+{
+	return Acceptor.IsValid();
+}
+
+bool ALinkStreamListener::IsSessionConnected(int32 SessionId) const
+{
+	const TSharedPtr<FTcpSocketWorker> session = FindSession(SessionId);
+	return session.IsValid() && session->isConnected();
+}
+
+TArray<int32> ALinkStreamListener::GetSessionIds() const
+{
+	TArray<int32> ids;
+	Sessions.GetKeys(ids);
+	return ids;
+}
+
+int64 ALinkStreamListener::GetPendingSendBytes(int32 SessionId) const
+{
+	const TSharedPtr<FTcpSocketWorker> session = FindSession(SessionId);
+	return session.IsValid() ? session->GetPendingSendBytes() : 0;
+}
+
+TArray<FLinkStreamLaneStats> ALinkStreamListener::GetLaneStats(int32 SessionId) const
+{
+	TArray<FLinkStreamLaneStats> stats;
+	if (const TSharedPtr<FTcpSocketWorker> session = FindSession(SessionId))
+	{
+		for (int32 lane = 0; lane < LinkStreamNumLanes; lane++)
+		{
+			stats.Add(session->GetLaneStats((ELinkStreamPriority)lane));
+		}
+	}
+	return stats;
+}
+
+FLinkStreamHeartbeatStats ALinkStreamListener::GetHeartbeatStats(int32 SessionId) const
+{
+	const TSharedPtr<FTcpSocketWorker> session = FindSession(SessionId);
+	return session.IsValid() ? session->GetHeartbeatStats() : FLinkStreamHeartbeatStats();
+}
+
+FLinkStreamInboxStats ALinkStreamListener::GetInboxStats(int32 SessionId) const
+{
+	const TSharedPtr<FTcpSocketWorker> session = FindSession(SessionId);
+	return session.IsValid() ? session->GetInboxStats() : FLinkStreamInboxStats();
+}
+
+FLinkStreamTlsStats ALinkStreamListener::GetTlsStats(int32 SessionId) const
+{
+	const TSharedPtr<FTcpSocketWorker> session = FindSession(SessionId);
+	return session.IsValid() ? session->GetTlsStats() : FLinkStreamTlsStats();
+}
+
+void ALinkStreamListener::OnWorkerConnected(int32 WorkerId)
+{
+	SessionConnectedDelegate.ExecuteIfBound(WorkerId);
+}
+
+void ALinkStreamListener::OnWorkerDisconnected(int32 WorkerId)
+{
+	{
+		FWriteScopeLock writeLock(SessionsLock);
+		Sessions.Remove(WorkerId);
+	}
+	LiveSessions->Decrement();
+	SessionDisconnectedDelegate.ExecuteIfBound(WorkerId);
+}
+
+void ALinkStreamListener::OnWorkerMessage(int32 WorkerId)
+{
+	TSharedRef<FTcpSocketWorker>* session = Sessions.Find(WorkerId);
+	if (!session)
+	{
+		return;
+	}
+
+	FLinkStreamBuffer msg;
+	if ((*session)->TryReadFromInbox(msg))
+	{
+		MessageReceivedDelegate.ExecuteIfBound(WorkerId, msg.GetArray());
+	}
+}
+
+void ALinkStreamListener::OnWorkerSendBackpressure(int32 WorkerId, bool bBackpressured)
+{
+	OnSendBackpressure.Broadcast(WorkerId, bBackpressured);
+}
@@ -0,0 +1,182 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamPoller.h"
+#include "HAL/PlatformProcess.h"
+
+#if PLATFORM_LINUX
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+FLinkStreamPoller::~FLinkStreamPoller()
+{
+#if PLATFORM_LINUX
+	if (EpollFd != -1)
+	{
+		close(EpollFd);
+		EpollFd = -1;
+	}
+#endif
+}
+
+#if PLATFORM_LINUX
+
+bool FLinkStreamPoller::Init()
+{
+	EpollFd = epoll_create1(EPOLL_CLOEXEC);
+	return EpollFd != -1;
+}
+
+static uint32 GetEpollMask(bool bWantWrite, bool bWantRead)
+{
+	return (bWantRead ? EPOLLIN | EPOLLRDHUP : 0) | (bWantWrite ? EPOLLOUT : 0);
+}
+
+bool FLinkStreamPoller::Add(FLinkStreamNativeSocket Socket, void* UserData, bool bWantWrite, bool bWantRead)
+{
+	LINKSTREAM_COUNT_SYSCALL(Control, 1);
+	epoll_event Event;
+	Event.events = GetEpollMask(bWantWrite, bWantRead);
+	Event.data.ptr = UserData;
+	return epoll_ctl(EpollFd, EPOLL_CTL_ADD, Socket, &Event) == 0;
+}
+
+bool FLinkStreamPoller::Modify(FLinkStreamNativeSocket Socket, void* UserData, bool bWantWrite, bool bWantRead)
+{
+	LINKSTREAM_COUNT_SYSCALL(Control, 1);
+	epoll_event Event;
+	Event.events = GetEpollMask(bWantWrite, bWantRead);
+	Event.data.ptr = UserData;
+	return epoll_ctl(EpollFd, EPOLL_CTL_MOD, Socket, &Event) == 0;
+}
+
+void FLinkStreamPoller::Remove(FLinkStreamNativeSocket Socket)
+{
+	LINKSTREAM_COUNT_SYSCALL(Control, 1);
+	epoll_event Event;
+	epoll_ctl(EpollFd, EPOLL_CTL_DEL, Socket, &Event);
+}
+
+int32 FLinkStreamPoller::Wait(TArray<FLinkStreamPollEvent>& OutEvents, int32 TimeoutMs)
+{
+	LINKSTREAM_COUNT_SYSCALL(Poll, 1);
+	epoll_event Events[64];
+	const int Count = epoll_wait(EpollFd, Events, UE_ARRAY_COUNT(Events), TimeoutMs);
+
+	OutEvents.Reset();
+	for (int Index = 0; Index < Count; Index++)
+	{
+		FLinkStreamPollEvent& Out = OutEvents.AddDefaulted_GetRef();
+		Out.UserData = Events[Index].data.ptr;
+		Out.bReadable = (Events[Index].events & (EPOLLIN | EPOLLRDHUP)) != 0;
+		Out.bWritable = (Events[Index].events & EPOLLOUT) != 0;
+		Out.bError = (Events[Index].events & (EPOLLERR | EPOLLHUP)) != 0;
+	}
+	return OutEvents.Num();
+}
+
+#else
+
+#if PLATFORM_WINDOWS
+#define LINKSTREAM_POLL WSAPoll
+#else
+#define LINKSTREAM_POLL poll
+#endif
+
+bool FLinkStreamPoller::Init()
+{
+	return true;
+}
+
+bool FLinkStreamPoller::Add(FLinkStreamNativeSocket Socket, void* UserData, bool bWantWrite, bool bWantRead)
+{
+	FLinkStreamPollFd& Fd = Fds.AddZeroed_GetRef();
+	Fd.fd = Socket;
+	Fd.events = (bWantRead ? POLLIN : 0) | (bWantWrite ? POLLOUT : 0);
+	UserDatas.Add(UserData);
+	return true;
+}
+
+bool FLinkStreamPoller::Modify(FLinkStreamNativeSocket Socket, void* UserData, bool bWantWrite, bool bWantRead)
+{
+	for (int32 Index = 0; Index < Fds.Num(); Index++)
+	{
+		if (Fds[Index].fd == Socket)
+		{
+			Fds[Index].events = (bWantRead ? POLLIN : 0) | (bWantWrite ? POLLOUT : 0);
+			UserDatas[Index] = UserData;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FLinkStreamPoller::Remove(FLinkStreamNativeSocket Socket)
+{
+	for (int32 Index = 0; Index < Fds.Num(); Index++)
+	{
+		if (Fds[Index].fd == Socket)
+		{
+			Fds.RemoveAtSwap(Index);
+			UserDatas.RemoveAtSwap(Index);
+			return;
+		}
+	}
+}
+
+int32 FLinkStreamPoller::Wait(TArray<FLinkStreamPollEvent>& OutEvents, int32 TimeoutMs)
+{
+	OutEvents.Reset();
+	if (Fds.Num() == 0)
+	{
+		if (TimeoutMs > 0)
+		{
+			FPlatformProcess::Sleep(TimeoutMs / 1000.f);
+		}
+		return 0;
+	}
+
+	LINKSTREAM_COUNT_SYSCALL(Poll, 1);
+	const int Count = LINKSTREAM_POLL(Fds.GetData(), Fds.Num(), TimeoutMs);
+	for (int32 Index = 0; Index < Fds.Num() && OutEvents.Num() < Count; Index++)
+	{
+		const int32 Revents = Fds[Index].revents;
+		if (Revents == 0)
+		{
+			continue;
+		}
+
+		FLinkStreamPollEvent& Out = OutEvents.AddDefaulted_GetRef();
+		Out.UserData = UserDatas[Index];
+		Out.bReadable = (Revents & POLLIN) != 0;
+		Out.bWritable = (Revents & POLLOUT) != 0;
+		Out.bError = (Revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+	}
+	return OutEvents.Num();
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LinkStreamSocket.h"
+
+#if PLATFORM_WINDOWS
+typedef WSAPOLLFD FLinkStreamPollFd;
+#elif !PLATFORM_LINUX
+#include <poll.h>
+typedef struct pollfd FLinkStreamPollFd;
+#endif
+
+struct FLinkStreamPollEvent
+{
+	void* UserData = nullptr;
+	bool bReadable = false;
+	bool bWritable = false;
+	bool bError = false;
+};
+
+/** Readiness notification over a set of sockets. epoll on Linux, poll/WSAPoll elsewhere. Not thread-safe. */
+class FLinkStreamPoller
+{
+public:
+	FLinkStreamPoller() = default;
+	~FLinkStreamPoller();
+
+	FLinkStreamPoller(const FLinkStreamPoller&) = delete;
+	FLinkStreamPoller& operator=(const FLinkStreamPoller&) = delete;
+
+	bool Init();
+
+	/** Without bWantRead only writability, errors and hang-ups are reported. */
+	bool Add(FLinkStreamNativeSocket Socket, void* UserData, bool bWantWrite, bool bWantRead = true);
+	bool Modify(FLinkStreamNativeSocket Socket, void* UserData, bool bWantWrite, bool bWantRead = true);
+	void Remove(FLinkStreamNativeSocket Socket);
+
+	/** Blocks for up to TimeoutMs (-1 = forever) and fills OutEvents. Returns the number of events. */
+	int32 Wait(TArray<FLinkStreamPollEvent>& OutEvents, int32 TimeoutMs);
+
+private:
+#if PLATFORM_LINUX
+	int EpollFd = -1;
+#else
+	TArray<FLinkStreamPollFd> Fds;
+	TArray<void*> UserDatas;
+#endif
+};
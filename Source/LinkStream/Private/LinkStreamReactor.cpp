@@ -0,0 +1,315 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamReactor.h"
+#include "LinkStream.h"
+#include "LinkStreamPoller.h"
+#include "LinkStreamSocket.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformTime.h"
+
+FLinkStreamReactor::FLinkStreamReactor(int32 InIndex)
+	: Index(InIndex)
+	, Poller(MakeUnique<FLinkStreamPoller>())
+	, Wakeup(MakeUnique<FLinkStreamWakeup>())
+{
+}
+
+FLinkStreamReactor::~FLinkStreamReactor()
+{
+	Stop();
+	if (Thread)
+	{
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+}
+
+bool FLinkStreamReactor::Start()
+{
+	check(!Thread && "Reactor was already started!");
+	if (!Poller->Init() || !Wakeup->Init() || !Poller->Add(Wakeup->GetNative(), Wakeup.Get(), false))
+	{
+		UE_LOG(LogLinkStream, Error, TEXT("LinkStream: reactor %d could not create its poller."), Index);
+		return false;
+	}
+
+	bRun = true;
+	Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("LinkStreamReactor %d"), Index), 128 * 1024, TPri_Normal);
+	return Thread != nullptr;
+}
+
+void FLinkStreamReactor::Register(TSharedRef<ILinkStreamReactorHandler> Handler)
+{
+	NumHandlers.Increment();
+	PendingHandlers.Enqueue(Handler);
+	Wake();
+}
+
+void FLinkStreamReactor::Wake(ILinkStreamReactorHandler* Handler)
+{
+	if (Handler && !Handler->bWakeQueued.exchange(true))
+	{
+		WokenHandlers.Enqueue(Handler);
+	}
+	Wakeup->Signal();
+}
+
+bool FLinkStreamReactor::Watch(ILinkStreamReactorHandler* Handler, const FLinkStreamSocket& Socket, bool bWantWrite)
+{
+	const FLinkStreamNativeHandle NativeHandle = (FLinkStreamNativeHandle)Socket.GetNative();
+	if (FWatch* Existing = Watches.Find(Handler))
+	{
+		if (Existing->Socket == NativeHandle)
+		{
+			if (Existing->bWantWrite == bWantWrite)
+			{
+				return true;
+			}
+			Existing->bWantWrite = bWantWrite;
+			return Poller->Modify(Socket.GetNative(), Handler, bWantWrite, Existing->bWantRead);
+		}
+		Unwatch(Handler);
+	}
+
+	if (!Poller->Add(Socket.GetNative(), Handler, bWantWrite))
+	{
+		return false;
+	}
+	FWatch& NewWatch = Watches.Add(Handler);
+	NewWatch.Socket = NativeHandle;
+	NewWatch.bWantWrite = bWantWrite;
+	NewWatch.bWantRead = true;
+	return true;
+}
+
+bool FLinkStreamReactor::SetReadPaused(ILinkStreamReactorHandler* Handler, bool bPaused)
+{
+	FWatch* Existing = Watches.Find(Handler);
+	if (!Existing || Existing->bWantRead == !bPaused)
+	{
+		return Existing != nullptr;
+	}
+	Existing->bWantRead = !bPaused;
+	return Poller->Modify((FLinkStreamNativeSocket)Existing->Socket, Handler, Existing->bWantWrite, Existing->bWantRead);
+}
+
+void FLinkStreamReactor::Unwatch(ILinkStreamReactorHandler* Handler)
+{
+	FWatch Removed;
+	if (Watches.RemoveAndCopyValue(Handler, Removed))
+	{
+		Poller->Remove((FLinkStreamNativeSocket)Removed.Socket);
+	}
+}
+
+void FLinkStreamReactor::WakeAt(ILinkStreamReactorHandler* Handler, double Seconds)
+{
+	const double* Armed = Deadlines.Find(Handler);
+	if (Armed && *Armed <= Seconds)
+	{
+		return;
+	}
+	// The later entry this replaces stays in the heap and is skipped when it comes up.
+	Deadlines.Add(Handler, Seconds);
+	Timers.HeapPush(FTimer{ Seconds, Handler });
+}
+
+int32 FLinkStreamReactor::GetTimeoutMs()
+{
+	while (Timers.Num() > 0)
+	{
+		const FTimer& Top = Timers.HeapTop();
+		const double* Armed = Deadlines.Find(Top.Handler);
+		if (Armed && *Armed == Top.Deadline)
+		{
+			return FMath::Max(0, FMath::CeilToInt((Top.Deadline - FPlatformTime::Seconds()) * 1000.0));
+		}
+		Timers.HeapPopDiscard();
+	}
+	return -1;
+}
+
+void FLinkStreamReactor::CollectReady()
+{
+	ILinkStreamReactorHandler* Woken = nullptr;
+	while (WokenHandlers.Dequeue(Woken))
+	{
+		// Only attached handlers are known to be alive.
+		if (Handlers.Contains(Woken))
+		{
+			Woken->bWakeQueued = false;
+			Ready.Add(Woken);
+		}
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	while (Timers.Num() > 0 && Timers.HeapTop().Deadline <= Now)
+	{
+		FTimer Expired;
+		Timers.HeapPop(Expired);
+		const double* Armed = Deadlines.Find(Expired.Handler);
+		if (Armed && *Armed == Expired.Deadline)
+		{
+			Deadlines.Remove(Expired.Handler);
+			Ready.Add(Expired.Handler);
+		}
+	}
+}
+
+uint32 FLinkStreamReactor::Run()
+{
+	TArray<FLinkStreamPollEvent> Events;
+	Events.Reserve(64);
+	TArray<ILinkStreamReactorHandler*> ToTick;
+
+	while (bRun)
+	{
+		AttachPending();
+
+		Poller->Wait(Events, Ready.Num() > 0 ? 0 : GetTimeoutMs());
+		for (const FLinkStreamPollEvent& Event : Events)
+		{
+			if (Event.UserData == Wakeup.Get())
+			{
+				Wakeup->Drain();
+				continue;
+			}
+
+			ILinkStreamReactorHandler* Handler = static_cast<ILinkStreamReactorHandler*>(Event.UserData);
+			// A handler can unwatch itself while handling an earlier event of the same batch.
+			if (Watches.Contains(Handler))
+			{
+				Handler->OnReactorEvent(Event.bReadable, Event.bWritable, Event.bError);
+				Ready.Add(Handler);
+			}
+		}
+		CollectReady();
+
+		// Ticks may wake handlers or arm timers; those land in the next loop.
+		ToTick = Ready.Array();
+		Ready.Reset();
+		for (ILinkStreamReactorHandler* Handler : ToTick)
+		{
+			TSharedPtr<ILinkStreamReactorHandler>* Owned = Handlers.Find(Handler);
+			if (Owned && !Handler->OnReactorTick())
+			{
+				// Held until detached, as removing it from the map may release the last reference.
+				TSharedPtr<ILinkStreamReactorHandler> Detached = MoveTemp(*Owned);
+				Unwatch(Handler);
+				Handler->OnReactorDetach();
+				Handlers.Remove(Handler);
+				Deadlines.Remove(Handler);
+				NumHandlers.Decrement();
+			}
+		}
+	}
+
+	DetachAll();
+	return 0;
+}
+
+void FLinkStreamReactor::Stop()
+{
+	bRun = false;
+	if (Thread)
+	{
+		Wake();
+	}
+}
+
+void FLinkStreamReactor::AttachPending()
+{
+	TSharedPtr<ILinkStreamReactorHandler> Handler;
+	while (PendingHandlers.Dequeue(Handler))
+	{
+		// A Wake queued before the handler got here may have been skipped, leaving the flag set.
+		Handler->bWakeQueued = false;
+		Handlers.Add(Handler.Get(), Handler);
+		Handler->OnReactorAttach(*this);
+		Ready.Add(Handler.Get());
+	}
+}
+
+void FLinkStreamReactor::DetachAll()
+{
+	AttachPending();
+	for (const TPair<ILinkStreamReactorHandler*, TSharedPtr<ILinkStreamReactorHandler>>& Handler : Handlers)
+	{
+		Unwatch(Handler.Key);
+		Handler.Value->OnReactorDetach();
+	}
+	NumHandlers.Subtract(Handlers.Num());
+	Handlers.Empty();
+	Ready.Reset();
+	Timers.Reset();
+	Deadlines.Reset();
+}
+
+FLinkStreamReactorPool::FLinkStreamReactorPool(int32 NumThreads)
+{
+	if (NumThreads <= 0)
+	{
+		NumThreads = FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() / 2);
+	}
+
+	for (int32 Index = 0; Index < NumThreads; Index++)
+	{
+		TUniquePtr<FLinkStreamReactor> Reactor = MakeUnique<FLinkStreamReactor>(Index);
+		if (Reactor->Start())
+		{
+			Reactors.Add(MoveTemp(Reactor));
+		}
+	}
+	UE_LOG(LogLinkStream, Log, TEXT("LinkStream: started %d reactor thread(s)."), Reactors.Num());
+}
+
+FLinkStreamReactorPool::~FLinkStreamReactorPool()
+{
+	// Destroying a reactor joins its thread, which detaches every handler still attached.
+	Reactors.Empty();
+}
+
+FLinkStreamReactor* FLinkStreamReactorPool::Register(TSharedRef<ILinkStreamReactorHandler> Handler)
+{
+	if (Reactors.Num() == 0)
+	{
+		UE_LOG(LogLinkStream, Error, TEXT("LinkStream: no reactor thread is running, the connection cannot be serviced."));
+		return nullptr;
+	}
+
+	FLinkStreamReactor* Best = Reactors[0].Get();
+	for (const TUniquePtr<FLinkStreamReactor>& Reactor : Reactors)
+	{
+		if (Reactor->GetNumHandlers() < Best->GetNumHandlers())
+		{
+			Best = Reactor.Get();
+		}
+	}
+	Best->Register(Handler);
+	return Best;
+}
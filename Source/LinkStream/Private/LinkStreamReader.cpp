@@ -0,0 +1,277 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamReader.h"
+
+FLinkStreamReader::FLinkStreamReader(TArrayView<const uint8> InView)
+	: ExternalData(InView.GetData())
+	, ExternalSize(InView.Num())
+	, bExternal(true)
+{
+}
+
+FLinkStreamReader::FLinkStreamReader(TArray<uint8>&& InBuffer)
+	: Buffer(MoveTemp(InBuffer))
+{
+}
+
+bool FLinkStreamReader::Require(int32 NumBytes)
+{
+	if (NumBytes < 0 || NumBytes > GetRemaining())
+	{
+		bError = true;
+		return false;
+	}
+	return true;
+}
+
+bool FLinkStreamReader::Seek(int32 NewOffset)
+{
+	if (NewOffset < 0 || NewOffset > Num())
+	{
+		bError = true;
+		return false;
+	}
+	Offset = NewOffset;
+	return true;
+}
+
+bool FLinkStreamReader::Skip(int32 NumBytes)
+{
+	if (!Require(NumBytes))
+	{
+		return false;
+	}
+	Offset += NumBytes;
+	return true;
+}
+
+bool FLinkStreamReader::ReadFloat(float& OutValue, ELinkStreamByteOrder ByteOrder)
+{
+	uint32 Bits = 0;
+	const bool bOk = ReadInteger(Bits, ByteOrder);
+	FMemory::Memcpy(&OutValue, &Bits, sizeof(float));
+	return bOk;
+}
+
+bool FLinkStreamReader::ReadDouble(double& OutValue, ELinkStreamByteOrder ByteOrder)
+{
+	uint64 Bits = 0;
+	const bool bOk = ReadInteger(Bits, ByteOrder);
+	FMemory::Memcpy(&OutValue, &Bits, sizeof(double));
+	return bOk;
+}
+
+bool FLinkStreamReader::ReadBool(bool& OutValue)
+{
+	uint8 Byte = 0;
+	const bool bOk = ReadInteger(Byte);
+	OutValue = Byte != 0;
+	return bOk;
+}
+
+bool FLinkStreamReader::ReadVarUInt(uint64& OutValue)
+{
+	OutValue = 0;
+	const uint8* Bytes = GetData() + Offset;
+	const int32 Available = FMath::Min(GetRemaining(), 10);
+
+	uint64 Value = 0;
+	for (int32 Index = 0; Index < Available; Index++)
+	{
+		// The tenth byte holds only the top bit of a uint64.
+		if (Index == 9 && Bytes[Index] > 0x01)
+		{
+			break;
+		}
+		Value |= (uint64)(Bytes[Index] & 0x7F) << (7 * Index);
+		if ((Bytes[Index] & 0x80) == 0)
+		{
+			Offset += Index + 1;
+			OutValue = Value;
+			return true;
+		}
+	}
+
+	bError = true;
+	return false;
+}
+
+bool FLinkStreamReader::ReadString(FString& OutValue, int32 ByteLength)
+{
+	OutValue.Reset();
+	if (!Require(ByteLength))
+	{
+		return false;
+	}
+
+	if (ByteLength > 0)
+	{
+		FUTF8ToTCHAR Convert((const ANSICHAR*)(GetData() + Offset), ByteLength);
+		OutValue = FString(Convert.Length(), Convert.Get());
+	}
+	Offset += ByteLength;
+	return true;
+}
+
+bool FLinkStreamReader::ReadLengthPrefixedString(FString& OutValue)
+{
+	const int32 Start = Offset;
+	uint64 Length = 0;
+	if (!ReadVarUInt(Length) || Length > (uint64)GetRemaining() || !ReadString(OutValue, (int32)Length))
+	{
+		Offset = Start;
+		bError = true;
+		return false;
+	}
+	return true;
+}
+
+bool FLinkStreamReader::ReadSpan(int32 NumBytes, TArrayView<const uint8>& OutSpan)
+{
+	if (!Require(NumBytes))
+	{
+		OutSpan = TArrayView<const uint8>();
+		return false;
+	}
+	OutSpan = TArrayView<const uint8>(GetData() + Offset, NumBytes);
+	Offset += NumBytes;
+	return true;
+}
+
+bool FLinkStreamReader::ReadBytes(int32 NumBytes, TArray<uint8>& OutBytes)
+{
+	TArrayView<const uint8> Span;
+	if (!ReadSpan(NumBytes, Span))
+	{
+		return false;
+	}
+	OutBytes.Append(Span.GetData(), Span.Num());
+	return true;
+}
+
+FLinkStreamReader ULinkStreamReaderLibrary::MakeReader(TArray<uint8>& Message)
+{
+	return FLinkStreamReader(MoveTemp(Message));
+}
+
+bool ULinkStreamReaderLibrary::ReadByte(FLinkStreamReader& Reader, uint8& Value)
+{
+	return Reader.ReadInteger(Value);
+}
+
+bool ULinkStreamReaderLibrary::ReadInt8(FLinkStreamReader& Reader, int32& Value)
+{
+	int8 Result = 0;
+	const bool bOk = Reader.ReadInteger(Result);
+	Value = Result;
+	return bOk;
+}
+
+bool ULinkStreamReaderLibrary::ReadInt16(FLinkStreamReader& Reader, int32& Value, ELinkStreamByteOrder ByteOrder)
+{
+	int16 Result = 0;
+	const bool bOk = Reader.ReadInteger(Result, ByteOrder);
+	Value = Result;
+	return bOk;
+}
+
+bool ULinkStreamReaderLibrary::ReadUInt16(FLinkStreamReader& Reader, int32& Value, ELinkStreamByteOrder ByteOrder)
+{
+	uint16 Result = 0;
+	const bool bOk = Reader.ReadInteger(Result, ByteOrder);
+	Value = Result;
+	return bOk;
+}
+
+bool ULinkStreamReaderLibrary::ReadInt32(FLinkStreamReader& Reader, int32& Value, ELinkStreamByteOrder ByteOrder)
+{
+	return Reader.ReadInteger(Value, ByteOrder);
+}
+
+bool ULinkStreamReaderLibrary::ReadUInt32(FLinkStreamReader& Reader, int64& Value, ELinkStreamByteOrder ByteOrder)
+{
+	uint32 Result = 0;
+	const bool bOk = Reader.ReadInteger(Result, ByteOrder);
+	Value = Result;
+	return bOk;
+}
+
+bool ULinkStreamReaderLibrary::ReadInt64(FLinkStreamReader& Reader, int64& Value, ELinkStreamByteOrder ByteOrder)
+{
+	return Reader.ReadInteger(Value, ByteOrder);
+}
+
+bool ULinkStreamReaderLibrary::ReadUInt64(FLinkStreamReader& Reader, int64& Value, ELinkStreamByteOrder ByteOrder)
+{
+	uint64 Result = 0;
+	const bool bOk = Reader.ReadInteger(Result, ByteOrder);
+	Value = (int64)Result;
+	return bOk;
+}
+
+bool ULinkStreamReaderLibrary::ReadFloat(FLinkStreamReader& Reader, float& Value, ELinkStreamByteOrder ByteOrder)
+{
+	return Reader.ReadFloat(Value, ByteOrder);
+}
+
+bool ULinkStreamReaderLibrary::ReadDouble(FLinkStreamReader& Reader, double& Value, ELinkStreamByteOrder ByteOrder)
+{
+	return Reader.ReadDouble(Value, ByteOrder);
+}
+
+bool ULinkStreamReaderLibrary::ReadBool(FLinkStreamReader& Reader, bool& Value)
+{
+	return Reader.ReadBool(Value);
+}
+
+bool ULinkStreamReaderLibrary::ReadVarInt(FLinkStreamReader& Reader, int64& Value)
+{
+	uint64 Result = 0;
+	const bool bOk = Reader.ReadVarUInt(Result);
+	Value = (int64)Result;
+	return bOk;
+}
+
+bool ULinkStreamReaderLibrary::ReadString(FLinkStreamReader& Reader, int32 ByteLength, FString& Value)
+{
+	return Reader.ReadString(Value, ByteLength);
+}
+
+bool ULinkStreamReaderLibrary::ReadLengthPrefixedString(FLinkStreamReader& Reader, FString& Value)
+{
+	return Reader.ReadLengthPrefixedString(Value);
+}
+
+bool ULinkStreamReaderLibrary::ReadBytes(FLinkStreamReader& Reader, int32 NumBytes, TArray<uint8>& Value)
+{
+	Value.Reset();
+	return Reader.ReadBytes(NumBytes, Value);
+}
+
+bool ULinkStreamReaderLibrary::Skip(FLinkStreamReader& Reader, int32 NumBytes)
+{
+	return Reader.Skip(NumBytes);
+}
@@ -0,0 +1,549 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamSocket.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+
+#if !PLATFORM_WINDOWS
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#if PLATFORM_LINUX
+#include <sys/eventfd.h>
+#endif
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <mstcpip.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+#if PLATFORM_WINDOWS
+#define LINKSTREAM_CLOSE_SOCKET closesocket
+#define LINKSTREAM_SOCKET_ERROR SOCKET_ERROR
+typedef int FLinkStreamSockLen;
+#else
+#define LINKSTREAM_CLOSE_SOCKET close
+#define LINKSTREAM_SOCKET_ERROR -1
+typedef socklen_t FLinkStreamSockLen;
+#endif
+
+#if PLATFORM_LINUX
+#define LINKSTREAM_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define LINKSTREAM_SEND_FLAGS 0
+#endif
+
+FLinkStreamSyscallCounters FLinkStreamSocket::Syscalls;
+
+void FLinkStreamSocket::StartupPlatform()
+{
+#if PLATFORM_WINDOWS
+	WSADATA WsaData;
+	WSAStartup(MAKEWORD(2, 2), &WsaData);
+#endif
+}
+
+void FLinkStreamSocket::ShutdownPlatform()
+{
+#if PLATFORM_WINDOWS
+	WSACleanup();
+#endif
+}
+
+FLinkStreamSocket::~FLinkStreamSocket()
+{
+	Close();
+}
+
+bool FLinkStreamSocket::Create()
+{
+	Close();
+	Native = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#if PLATFORM_MAC
+	if (IsValid())
+	{
+		int NoSigPipe = 1;
+		setsockopt(Native, SOL_SOCKET, SO_NOSIGPIPE, &NoSigPipe, sizeof(NoSigPipe));
+	}
+#endif
+	return IsValid();
+}
+
+bool FLinkStreamSocket::CreateDatagram()
+{
+	Close();
+	Native = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	return IsValid();
+}
+
+void FLinkStreamSocket::Close()
+{
+	if (IsValid())
+	{
+		LINKSTREAM_CLOSE_SOCKET(Native);
+		Native = LINKSTREAM_INVALID_SOCKET;
+	}
+}
+
+bool FLinkStreamSocket::SetNonBlocking(bool bNonBlocking)
+{
+	LINKSTREAM_COUNT_SYSCALL(Control, PLATFORM_WINDOWS ? 1 : 2);
+#if PLATFORM_WINDOWS
+	u_long Value = bNonBlocking ? 1 : 0;
+	return ioctlsocket(Native, FIONBIO, &Value) == 0;
+#else
+	const int Flags = fcntl(Native, F_GETFL, 0);
+	if (Flags == -1)
+	{
+		return false;
+	}
+	return fcntl(Native, F_SETFL, bNonBlocking ? (Flags | O_NONBLOCK) : (Flags & ~O_NONBLOCK)) != -1;
+#endif
+}
+
+bool FLinkStreamSocket::SetNoDelay(bool bNoDelay)
+{
+	LINKSTREAM_COUNT_SYSCALL(Control, 1);
+	int Value = bNoDelay ? 1 : 0;
+	return setsockopt(Native, IPPROTO_TCP, TCP_NODELAY, (const char*)&Value, sizeof(Value)) == 0;
+}
+
+bool FLinkStreamSocket::SetCork(bool bCork)
+{
+#if PLATFORM_LINUX
+	LINKSTREAM_COUNT_SYSCALL(Control, 1);
+	int Value = bCork ? 1 : 0;
+	return setsockopt(Native, IPPROTO_TCP, TCP_CORK, &Value, sizeof(Value)) == 0;
+#elif PLATFORM_MAC
+	LINKSTREAM_COUNT_SYSCALL(Control, 1);
+	int Value = bCork ? 1 : 0;
+	return setsockopt(Native, IPPROTO_TCP, TCP_NOPUSH, &Value, sizeof(Value)) == 0;
+#else
+	return false;
+#endif
+}
+
+bool FLinkStreamSocket::SetKeepAlive(int32 IdleSeconds, int32 IntervalSeconds, int32 ProbeCount)
+{
+	IdleSeconds = FMath::Max(1, IdleSeconds);
+	IntervalSeconds = FMath::Max(1, IntervalSeconds);
+	ProbeCount = FMath::Max(1, ProbeCount);
+#if PLATFORM_WINDOWS
+	LINKSTREAM_COUNT_SYSCALL(Control, 1);
+	tcp_keepalive Values;
+	Values.onoff = 1;
+	Values.keepalivetime = (ULONG)IdleSeconds * 1000;
+	Values.keepaliveinterval = (ULONG)IntervalSeconds * 1000;
+	DWORD BytesReturned = 0;
+	return WSAIoctl(Native, SIO_KEEPALIVE_VALS, &Values, sizeof(Values), nullptr, 0, &BytesReturned, nullptr, nullptr) == 0;
+#else
+	LINKSTREAM_COUNT_SYSCALL(Control, 4);
+	int Value = 1;
+	bool bOk = setsockopt(Native, SOL_SOCKET, SO_KEEPALIVE, &Value, sizeof(Value)) == 0;
+#if PLATFORM_MAC
+	bOk &= setsockopt(Native, IPPROTO_TCP, TCP_KEEPALIVE, &IdleSeconds, sizeof(IdleSeconds)) == 0;
+#else
+	bOk &= setsockopt(Native, IPPROTO_TCP, TCP_KEEPIDLE, &IdleSeconds, sizeof(IdleSeconds)) == 0;
+#endif
+	bOk &= setsockopt(Native, IPPROTO_TCP, TCP_KEEPINTVL, &IntervalSeconds, sizeof(IntervalSeconds)) == 0;
+	bOk &= setsockopt(Native, IPPROTO_TCP, TCP_KEEPCNT, &ProbeCount, sizeof(ProbeCount)) == 0;
+	return bOk;
+#endif
+}
+
+void FLinkStreamSocket::SetBufferSizes(int32 RecvSize, int32 SendSize, int32& OutActualRecvSize, int32& OutActualSendSize)
+{
+	LINKSTREAM_COUNT_SYSCALL(Control, 4);
+	int Value = RecvSize;
+	setsockopt(Native, SOL_SOCKET, SO_RCVBUF, (const char*)&Value, sizeof(Value));
+	Value = SendSize;
+	setsockopt(Native, SOL_SOCKET, SO_SNDBUF, (const char*)&Value, sizeof(Value));
+
+	FLinkStreamSockLen Len = sizeof(Value);
+	OutActualRecvSize = getsockopt(Native, SOL_SOCKET, SO_RCVBUF, (char*)&Value, &Len) == 0 ? Value : RecvSize;
+	Len = sizeof(Value);
+	OutActualSendSize = getsockopt(Native, SOL_SOCKET, SO_SNDBUF, (char*)&Value, &Len) == 0 ? Value : SendSize;
+}
+
+bool FLinkStreamSocket::Connect(const FString& IpAddress, int32 Port)
+{
+	FIPv4Address Ip;
+	FIPv4Address::Parse(IpAddress, Ip);
+
+	sockaddr_in Addr;
+	FMemory::Memzero(Addr);
+	Addr.sin_family = AF_INET;
+	Addr.sin_addr.s_addr = htonl(Ip.Value);
+	Addr.sin_port = htons((uint16)Port);
+
+	if (connect(Native, (const sockaddr*)&Addr, sizeof(Addr)) == 0)
+	{
+		return true;
+	}
+#if PLATFORM_WINDOWS
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EINPROGRESS;
+#endif
+}
+
+ELinkStreamSocketResult FLinkStreamSocket::FinishConnect()
+{
+	LINKSTREAM_COUNT_SYSCALL(Control, 2);
+	int Error = 0;
+	FLinkStreamSockLen Len = sizeof(Error);
+	if (getsockopt(Native, SOL_SOCKET, SO_ERROR, (char*)&Error, &Len) != 0 || Error != 0)
+	{
+		return ELinkStreamSocketResult::Error;
+	}
+
+	// SO_ERROR is also 0 while the handshake is still running; a connected socket has a peer.
+	sockaddr_in Peer;
+	Len = sizeof(Peer);
+	if (getpeername(Native, (sockaddr*)&Peer, &Len) != 0)
+	{
+#if PLATFORM_WINDOWS
+		const bool bStillConnecting = WSAGetLastError() == WSAENOTCONN;
+#else
+		const bool bStillConnecting = errno == ENOTCONN;
+#endif
+		return bStillConnecting ? ELinkStreamSocketResult::WouldBlock : ELinkStreamSocketResult::Error;
+	}
+	return ELinkStreamSocketResult::Ok;
+}
+
+ELinkStreamSocketResult FLinkStreamSocket::Send(const uint8* Data, int32 Size, int32& OutBytesSent)
+{
+	OutBytesSent = 0;
+	LINKSTREAM_COUNT_SYSCALL(Send, 1);
+	const int Result = send(Native, (const char*)Data, Size, LINKSTREAM_SEND_FLAGS);
+	if (Result == LINKSTREAM_SOCKET_ERROR)
+	{
+		return IsWouldBlockError() ? ELinkStreamSocketResult::WouldBlock : ELinkStreamSocketResult::Error;
+	}
+	OutBytesSent = Result;
+	return ELinkStreamSocketResult::Ok;
+}
+
+ELinkStreamSocketResult FLinkStreamSocket::SendVectored(const FLinkStreamIoVec* Vecs, int32 NumVecs, int32& OutBytesSent)
+{
+	OutBytesSent = 0;
+	NumVecs = FMath::Min(NumVecs, MaxIoVecs);
+	if (NumVecs <= 0)
+	{
+		return ELinkStreamSocketResult::Ok;
+	}
+	LINKSTREAM_COUNT_SYSCALL(Send, 1);
+
+#if PLATFORM_WINDOWS
+	WSABUF Buffers[MaxIoVecs];
+	for (int32 Index = 0; Index < NumVecs; Index++)
+	{
+		Buffers[Index].buf = (CHAR*)Vecs[Index].Data;
+		Buffers[Index].len = (ULONG)Vecs[Index].Size;
+	}
+
+	DWORD BytesSent = 0;
+	if (WSASend(Native, Buffers, (DWORD)NumVecs, &BytesSent, 0, nullptr, nullptr) == LINKSTREAM_SOCKET_ERROR)
+	{
+		return IsWouldBlockError() ? ELinkStreamSocketResult::WouldBlock : ELinkStreamSocketResult::Error;
+	}
+	OutBytesSent = (int32)BytesSent;
+#else
+	struct iovec Buffers[MaxIoVecs];
+	for (int32 Index = 0; Index < NumVecs; Index++)
+	{
+		Buffers[Index].iov_base = (void*)Vecs[Index].Data;
+		Buffers[Index].iov_len = (size_t)Vecs[Index].Size;
+	}
+
+	struct msghdr Message = {};
+	Message.msg_iov = Buffers;
+	Message.msg_iovlen = NumVecs;
+
+	const ssize_t Result = sendmsg(Native, &Message, LINKSTREAM_SEND_FLAGS);
+	if (Result < 0)
+	{
+		return IsWouldBlockError() ? ELinkStreamSocketResult::WouldBlock : ELinkStreamSocketResult::Error;
+	}
+	OutBytesSent = (int32)Result;
+#endif
+	return ELinkStreamSocketResult::Ok;
+}
+
+ELinkStreamSocketResult FLinkStreamSocket::Recv(uint8* Data, int32 Size, int32& OutBytesRead, bool bPeek)
+{
+	OutBytesRead = 0;
+	LINKSTREAM_COUNT_SYSCALL(Recv, 1);
+	const int Result = recv(Native, (char*)Data, Size, bPeek ? MSG_PEEK : 0);
+	if (Result == 0)
+	{
+		return ELinkStreamSocketResult::Closed;
+	}
+	if (Result == LINKSTREAM_SOCKET_ERROR)
+	{
+		return IsWouldBlockError() ? ELinkStreamSocketResult::WouldBlock : ELinkStreamSocketResult::Error;
+	}
+	OutBytesRead = Result;
+	return ELinkStreamSocketResult::Ok;
+}
+
+bool FLinkStreamSocket::HasPendingData(uint32& OutPendingDataSize)
+{
+	LINKSTREAM_COUNT_SYSCALL(Control, 1);
+#if PLATFORM_WINDOWS
+	u_long Value = 0;
+	const bool bOk = ioctlsocket(Native, FIONREAD, &Value) == 0;
+#else
+	int Value = 0;
+	const bool bOk = ioctl(Native, FIONREAD, &Value) == 0;
+#endif
+	OutPendingDataSize = bOk ? (uint32)Value : 0;
+	return bOk && OutPendingDataSize > 0;
+}
+
+bool FLinkStreamSocket::Listen(const FString& IpAddress, int32 Port, int32 Backlog)
+{
+	FIPv4Address Ip;
+	FIPv4Address::Parse(IpAddress, Ip);
+
+	int ReuseAddr = 1;
+	setsockopt(Native, SOL_SOCKET, SO_REUSEADDR, (const char*)&ReuseAddr, sizeof(ReuseAddr));
+
+	sockaddr_in Addr;
+	FMemory::Memzero(Addr);
+	Addr.sin_family = AF_INET;
+	Addr.sin_addr.s_addr = htonl(Ip.Value);
+	Addr.sin_port = htons((uint16)Port);
+
+	return bind(Native, (const sockaddr*)&Addr, sizeof(Addr)) == 0 && listen(Native, Backlog) == 0;
+}
+
+bool FLinkStreamSocket::Bind(const FString& IpAddress, int32 Port)
+{
+	FIPv4Address Ip;
+	FIPv4Address::Parse(IpAddress, Ip);
+
+	sockaddr_in Addr;
+	FMemory::Memzero(Addr);
+	Addr.sin_family = AF_INET;
+	Addr.sin_addr.s_addr = htonl(Ip.Value);
+	Addr.sin_port = htons((uint16)Port);
+
+	return bind(Native, (const sockaddr*)&Addr, sizeof(Addr)) == 0;
+}
+
+ELinkStreamSocketResult FLinkStreamSocket::SendTo(const uint8* Data, int32 Size, const FLinkStreamSocketAddress& To)
+{
+	sockaddr_in Addr;
+	FMemory::Memzero(Addr);
+	Addr.sin_family = AF_INET;
+	Addr.sin_addr.s_addr = htonl(To.Ip);
+	Addr.sin_port = htons(To.Port);
+
+	LINKSTREAM_COUNT_SYSCALL(Send, 1);
+	if (sendto(Native, (const char*)Data, Size, LINKSTREAM_SEND_FLAGS, (const sockaddr*)&Addr, sizeof(Addr)) == LINKSTREAM_SOCKET_ERROR)
+	{
+		return IsWouldBlockError() ? ELinkStreamSocketResult::WouldBlock : ELinkStreamSocketResult::Error;
+	}
+	return ELinkStreamSocketResult::Ok;
+}
+
+ELinkStreamSocketResult FLinkStreamSocket::RecvFrom(uint8* Data, int32 Size, int32& OutBytesRead, FLinkStreamSocketAddress& OutFrom)
+{
+	OutBytesRead = 0;
+	sockaddr_in Addr;
+	FLinkStreamSockLen Len = sizeof(Addr);
+
+	LINKSTREAM_COUNT_SYSCALL(Recv, 1);
+	const int Result = recvfrom(Native, (char*)Data, Size, 0, (sockaddr*)&Addr, &Len);
+	if (Result == LINKSTREAM_SOCKET_ERROR)
+	{
+		return IsWouldBlockError() ? ELinkStreamSocketResult::WouldBlock : ELinkStreamSocketResult::Error;
+	}
+	OutFrom.Ip = ntohl(Addr.sin_addr.s_addr);
+	OutFrom.Port = ntohs(Addr.sin_port);
+	OutBytesRead = Result;
+	return ELinkStreamSocketResult::Ok;
+}
+
+bool FLinkStreamSocket::Accept(FLinkStreamSocket& OutClient, FLinkStreamSocketAddress* OutPeer)
+{
+	sockaddr_in Addr;
+	FLinkStreamSockLen Len = sizeof(Addr);
+	const FLinkStreamNativeSocket Client = accept(Native, (sockaddr*)&Addr, &Len);
+	if (Client == LINKSTREAM_INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	if (OutPeer)
+	{
+		OutPeer->Ip = ntohl(Addr.sin_addr.s_addr);
+		OutPeer->Port = ntohs(Addr.sin_port);
+	}
+
+	OutClient.Close();
+	OutClient.Native = Client;
+#if PLATFORM_MAC
+	int NoSigPipe = 1;
+	setsockopt(Client, SOL_SOCKET, SO_NOSIGPIPE, &NoSigPipe, sizeof(NoSigPipe));
+#endif
+	return true;
+}
+
+int32 FLinkStreamSocket::GetLocalPort() const
+{
+	sockaddr_in Addr;
+	FLinkStreamSockLen Len = sizeof(Addr);
+	if (getsockname(Native, (sockaddr*)&Addr, &Len) != 0)
+	{
+		return 0;
+	}
+	return ntohs(Addr.sin_port);
+}
+
+bool FLinkStreamSocket::IsWouldBlockError()
+{
+#if PLATFORM_WINDOWS
+	const int Error = WSAGetLastError();
+	return Error == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+FLinkStreamWakeup::~FLinkStreamWakeup()
+{
+#if !PLATFORM_WINDOWS
+	if (ReadFd != -1)
+	{
+		close(ReadFd);
+	}
+	if (WriteFd != -1 && WriteFd != ReadFd)
+	{
+		close(WriteFd);
+	}
+#endif
+}
+
+bool FLinkStreamWakeup::Init()
+{
+#if PLATFORM_LINUX
+	ReadFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	WriteFd = ReadFd;
+	return ReadFd != -1;
+#elif PLATFORM_WINDOWS
+	// Windows cannot poll a pipe or event together with sockets, so wake through a connected loopback pair.
+	FLinkStreamSocket Listener;
+	if (!Listener.Create() || !Listener.Listen(TEXT("127.0.0.1"), 0, 1))
+	{
+		return false;
+	}
+	if (!WriteEnd.Create() || !WriteEnd.Connect(TEXT("127.0.0.1"), Listener.GetLocalPort()) || !Listener.Accept(ReadEnd))
+	{
+		return false;
+	}
+	WriteEnd.SetNoDelay(true);
+	ReadEnd.SetNonBlocking(true);
+	WriteEnd.SetNonBlocking(true);
+	return true;
+#else
+	int Fds[2];
+	if (pipe(Fds) != 0)
+	{
+		return false;
+	}
+	ReadFd = Fds[0];
+	WriteFd = Fds[1];
+	fcntl(ReadFd, F_SETFL, fcntl(ReadFd, F_GETFL, 0) | O_NONBLOCK);
+	fcntl(WriteFd, F_SETFL, fcntl(WriteFd, F_GETFL, 0) | O_NONBLOCK);
+	return true;
+#endif
+}
+
+void FLinkStreamWakeup::Signal()
+{
+	if (bSignaled.exchange(true))
+	{
+		return;
+	}
+
+#if PLATFORM_LINUX
+	LINKSTREAM_COUNT_SYSCALL(Poll, 1);
+	const uint64 One = 1;
+	const ssize_t Written = write(WriteFd, &One, sizeof(One));
+	(void)Written;
+#elif PLATFORM_WINDOWS
+	const uint8 Byte = 1;
+	int32 BytesSent = 0;
+	WriteEnd.Send(&Byte, 1, BytesSent);
+#else
+	LINKSTREAM_COUNT_SYSCALL(Poll, 1);
+	const uint8 Byte = 1;
+	const ssize_t Written = write(WriteFd, &Byte, 1);
+	(void)Written;
+#endif
+}
+
+void FLinkStreamWakeup::Drain()
+{
+	uint8 Buffer[64];
+#if PLATFORM_WINDOWS
+	int32 BytesRead = 0;
+	while (ReadEnd.Recv(Buffer, sizeof(Buffer), BytesRead) == ELinkStreamSocketResult::Ok)
+	{
+	}
+#else
+	do
+	{
+		LINKSTREAM_COUNT_SYSCALL(Poll, 1);
+	} while (read(ReadFd, Buffer, sizeof(Buffer)) > 0);
+#endif
+
+	// Cleared only once the fd is empty: a Signal racing the reads above would otherwise leave the flag set with
+	// nothing to read, and every later Signal would return without waking the poller. One racing the store writes
+	// again, or finds work that the caller looks at next anyway.
+	bSignaled = false;
+}
+
+FLinkStreamNativeSocket FLinkStreamWakeup::GetNative() const
+{
+#if PLATFORM_WINDOWS
+	return ReadEnd.GetNative();
+#else
+	return ReadFd;
+#endif
+}
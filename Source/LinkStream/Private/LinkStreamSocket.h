@@ -0,0 +1,200 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+typedef SOCKET FLinkStreamNativeSocket;
+#define LINKSTREAM_INVALID_SOCKET INVALID_SOCKET
+#else
+typedef int FLinkStreamNativeSocket;
+#define LINKSTREAM_INVALID_SOCKET -1
+#endif
+
+enum class ELinkStreamSocketResult : uint8
+{
+	Ok,
+	/** The non-blocking call could not make progress; wait for readiness and retry. */
+	WouldBlock,
+	/** The peer closed the stream in an orderly way. */
+	Closed,
+	Error
+};
+
+/** Process-wide socket syscall counts, so changes to the I/O paths can be measured. Incremented with relaxed ordering. */
+struct FLinkStreamSyscallCounters
+{
+	std::atomic<int64> Recv{ 0 };
+	std::atomic<int64> Send{ 0 };
+	/** fcntl, ioctl (including the FIONREAD query), setsockopt, getsockopt and epoll_ctl. */
+	std::atomic<int64> Control{ 0 };
+	/** Poller waits and wakeup signals and drains. */
+	std::atomic<int64> Poll{ 0 };
+};
+
+#define LINKSTREAM_COUNT_SYSCALL(Kind, Count) FLinkStreamSocket::Syscalls.Kind.fetch_add(Count, std::memory_order_relaxed)
+
+/** An IPv4 endpoint in host byte order, as reported by RecvFrom. */
+struct FLinkStreamSocketAddress
+{
+	uint32 Ip = 0;
+	uint16 Port = 0;
+
+	bool operator==(const FLinkStreamSocketAddress& Other) const { return Ip == Other.Ip && Port == Other.Port; }
+	bool operator!=(const FLinkStreamSocketAddress& Other) const { return !(*this == Other); }
+
+	/** Dotted-quad form of Ip, without the port. */
+	FString IpToString() const { return FString::Printf(TEXT("%u.%u.%u.%u"), (Ip >> 24) & 0xFF, (Ip >> 16) & 0xFF, (Ip >> 8) & 0xFF, Ip & 0xFF); }
+};
+
+/** One contiguous region of a gathered send. */
+struct FLinkStreamIoVec
+{
+	const uint8* Data = nullptr;
+	int32 Size = 0;
+};
+
+/**
+ * Thin wrapper over a native TCP or UDP socket.
+ * FSocket hides the descriptor, which the reactor needs to register with epoll/poll, so LinkStream talks to the OS directly.
+ */
+class FLinkStreamSocket
+{
+public:
+	FLinkStreamSocket() = default;
+	~FLinkStreamSocket();
+
+	FLinkStreamSocket(const FLinkStreamSocket&) = delete;
+	FLinkStreamSocket& operator=(const FLinkStreamSocket&) = delete;
+
+	static FLinkStreamSyscallCounters Syscalls;
+
+	/** Initializes the platform socket library. Called once by the module. */
+	static void StartupPlatform();
+	static void ShutdownPlatform();
+
+	bool Create();
+
+	/** Creates a UDP socket instead. Connect on it only sets the peer, after which Send and Recv carry one datagram each. */
+	bool CreateDatagram();
+	void Close();
+	bool IsValid() const { return Native != LINKSTREAM_INVALID_SOCKET; }
+	FLinkStreamNativeSocket GetNative() const { return Native; }
+
+	bool SetNonBlocking(bool bNonBlocking);
+	bool SetNoDelay(bool bNoDelay);
+
+	/** Holds back partial segments until uncorked (TCP_CORK on Linux, TCP_NOPUSH on Mac). Returns false where unsupported. */
+	bool SetCork(bool bCork);
+	void SetBufferSizes(int32 RecvSize, int32 SendSize, int32& OutActualRecvSize, int32& OutActualSendSize);
+
+	/**
+	 * Enables TCP keepalive: the kernel probes the peer after IdleSeconds without traffic, every IntervalSeconds,
+	 * and drops the connection after ProbeCount unanswered probes. Windows always uses its own probe count.
+	 */
+	bool SetKeepAlive(int32 IdleSeconds, int32 IntervalSeconds, int32 ProbeCount);
+
+	/** Connects to an IPv4 address. On a non-blocking socket returns true while the connect is in progress; see FinishConnect. */
+	bool Connect(const FString& IpAddress, int32 Port);
+
+	/** Returns Ok once a non-blocking connect has completed, WouldBlock while it is still pending. */
+	ELinkStreamSocketResult FinishConnect();
+
+	ELinkStreamSocketResult Send(const uint8* Data, int32 Size, int32& OutBytesSent);
+
+	/** Most regions SendVectored passes to the kernel in one call. Extra regions are ignored. */
+	static constexpr int32 MaxIoVecs = 64;
+
+	/** Writes several regions with one syscall (sendmsg/WSASend). May write fewer bytes than requested. */
+	ELinkStreamSocketResult SendVectored(const FLinkStreamIoVec* Vecs, int32 NumVecs, int32& OutBytesSent);
+	ELinkStreamSocketResult Recv(uint8* Data, int32 Size, int32& OutBytesRead, bool bPeek = false);
+
+	/** Number of bytes that can be read without blocking (FIONREAD). */
+	bool HasPendingData(uint32& OutPendingDataSize);
+
+	/** Binds to an IPv4 address and starts listening. Port 0 picks an ephemeral port, see GetLocalPort. */
+	bool Listen(const FString& IpAddress, int32 Port, int32 Backlog);
+
+	/** Binds without listening, for datagram sockets. Port 0 picks an ephemeral port. */
+	bool Bind(const FString& IpAddress, int32 Port);
+
+	/** Datagram sockets that are not connected: sends one datagram to To. */
+	ELinkStreamSocketResult SendTo(const uint8* Data, int32 Size, const FLinkStreamSocketAddress& To);
+
+	/** Datagram sockets: reads one datagram and reports its sender. A datagram longer than Size is truncated. */
+	ELinkStreamSocketResult RecvFrom(uint8* Data, int32 Size, int32& OutBytesRead, FLinkStreamSocketAddress& OutFrom);
+
+	/** Listening sockets: takes the next pending connection. OutPeer, if given, receives the client's address. */
+	bool Accept(FLinkStreamSocket& OutClient, FLinkStreamSocketAddress* OutPeer = nullptr);
+	int32 GetLocalPort() const;
+
+private:
+	static bool IsWouldBlockError();
+
+	FLinkStreamNativeSocket Native = LINKSTREAM_INVALID_SOCKET;
+};
+
+/**
+ * Wakes a thread blocked in a poller from any other thread.
+ * eventfd on Linux, a pipe on other POSIX platforms and a loopback socket pair on Windows.
+ * Signals are coalesced so a burst of Signal calls costs one syscall until the owner drains.
+ */
+class FLinkStreamWakeup
+{
+public:
+	FLinkStreamWakeup() = default;
+	~FLinkStreamWakeup();
+
+	FLinkStreamWakeup(const FLinkStreamWakeup&) = delete;
+	FLinkStreamWakeup& operator=(const FLinkStreamWakeup&) = delete;
+
+	bool Init();
+
+	/** Thread-safe. */
+	void Signal();
+
+	/** Consumes pending signals. Call from the waiting thread after the poller reports readability, before looking for work. */
+	void Drain();
+
+	/** Handle to register with a poller for readability. */
+	FLinkStreamNativeSocket GetNative() const;
+
+private:
+	std::atomic<bool> bSignaled{ false };
+#if PLATFORM_WINDOWS
+	FLinkStreamSocket ReadEnd;
+	FLinkStreamSocket WriteEnd;
+#else
+	int ReadFd = -1;
+	int WriteFd = -1;
+#endif
+};
@@ -0,0 +1,428 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamStructCodec.h"
+#include "LinkStreamConnection.h"
+#include "Misc/ScopeRWLock.h"
+#include "UObject/UnrealType.h"
+#include "UObject/EnumProperty.h"
+
+#if !PLATFORM_LITTLE_ENDIAN
+#error "FLinkStreamStructCodec copies fixed-size fields as they are in memory, which is only the wire format on little-endian platforms."
+#endif
+
+enum class ELinkStreamCodecOp : uint8
+{
+	/** Numbers and enums laid out back to back in memory: Size bytes copied as they are. */
+	Copy,
+	Bool,
+	String,
+	Name,
+	/** A TArray. Size is the element stride and Element the plan for one element. */
+	Array
+};
+
+struct FLinkStreamStructPlan;
+
+struct FLinkStreamCodecOp
+{
+	ELinkStreamCodecOp Kind = ELinkStreamCodecOp::Copy;
+	int32 Offset = 0;
+	int32 Size = 0;
+
+	/** Bool: the FBoolProperty, which knows the bit of a bitfield. Array: the FArrayProperty, which constructs elements. */
+	const FProperty* Property = nullptr;
+	TSharedPtr<const FLinkStreamStructPlan, ESPMode::ThreadSafe> Element;
+};
+
+struct FLinkStreamStructPlan
+{
+	TArray<FLinkStreamCodecOp> Ops;
+
+	/** Smallest encoding of a value. An array count needing more bytes than are left is rejected before anything is allocated. */
+	int32 MinWireSize = 0;
+
+	/** Set if the struct holds a property the codec cannot encode. The plan is then never run. */
+	FString Error;
+
+	/** What the plan was compiled from. A Blueprint struct recompiled in the editor gets new properties, and a new plan. */
+	const FProperty* FirstProperty = nullptr;
+	int32 StructureSize = 0;
+
+	/** True if a value of Stride bytes is nothing but one copy, so an array of them is copied in one go. */
+	bool IsFlat(int32 Stride) const
+	{
+		return Ops.Num() == 1 && Ops[0].Kind == ELinkStreamCodecOp::Copy && Ops[0].Offset == 0 && Ops[0].Size == Stride;
+	}
+};
+
+typedef TSharedPtr<const FLinkStreamStructPlan, ESPMode::ThreadSafe> FLinkStreamStructPlanPtr;
+
+static bool AddStructToPlan(FLinkStreamStructPlan& Plan, const UStruct* Struct, int32 BaseOffset);
+
+static void AddCopyToPlan(FLinkStreamStructPlan& Plan, int32 Offset, int32 Size)
+{
+	Plan.MinWireSize += Size;
+	if (Plan.Ops.Num() > 0)
+	{
+		FLinkStreamCodecOp& Last = Plan.Ops.Last();
+		if (Last.Kind == ELinkStreamCodecOp::Copy && Last.Offset + Last.Size == Offset)
+		{
+			Last.Size += Size;
+			return;
+		}
+	}
+	FLinkStreamCodecOp& Op = Plan.Ops.AddDefaulted_GetRef();
+	Op.Kind = ELinkStreamCodecOp::Copy;
+	Op.Offset = Offset;
+	Op.Size = Size;
+}
+
+/** Adds the ops for one value of Property stored at Offset. */
+static bool AddValueToPlan(FLinkStreamStructPlan& Plan, const FProperty* Property, int32 Offset)
+{
+	if (Property->IsA<FBoolProperty>() || Property->IsA<FStrProperty>() || Property->IsA<FNameProperty>())
+	{
+		FLinkStreamCodecOp& Op = Plan.Ops.AddDefaulted_GetRef();
+		Op.Kind = Property->IsA<FBoolProperty>() ? ELinkStreamCodecOp::Bool : Property->IsA<FStrProperty>() ? ELinkStreamCodecOp::String : ELinkStreamCodecOp::Name;
+		Op.Offset = Offset;
+		Op.Property = Property;
+		Plan.MinWireSize += 1;
+		return true;
+	}
+
+	if (Property->IsA<FNumericProperty>() || Property->IsA<FEnumProperty>())
+	{
+		AddCopyToPlan(Plan, Offset, Property->ElementSize);
+		return true;
+	}
+
+	if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+	{
+		return AddStructToPlan(Plan, StructProperty->Struct, Offset);
+	}
+
+	if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+	{
+		TSharedRef<FLinkStreamStructPlan, ESPMode::ThreadSafe> Element = MakeShared<FLinkStreamStructPlan, ESPMode::ThreadSafe>();
+		if (!AddValueToPlan(*Element, ArrayProperty->Inner, 0))
+		{
+			Plan.Error = Element->Error;
+			return false;
+		}
+		if (Element->MinWireSize == 0)
+		{
+			Plan.Error = FString::Printf(TEXT("%s holds elements that encode to nothing"), *Property->GetName());
+			return false;
+		}
+
+		FLinkStreamCodecOp& Op = Plan.Ops.AddDefaulted_GetRef();
+		Op.Kind = ELinkStreamCodecOp::Array;
+		Op.Offset = Offset;
+		Op.Size = ArrayProperty->Inner->ElementSize;
+		Op.Property = Property;
+		Op.Element = Element;
+		Plan.MinWireSize += 1;
+		return true;
+	}
+
+	Plan.Error = FString::Printf(TEXT("%s is a %s, which cannot be serialized"), *Property->GetName(), *Property->GetClass()->GetName());
+	return false;
+}
+
+static bool AddStructToPlan(FLinkStreamStructPlan& Plan, const UStruct* Struct, int32 BaseOffset)
+{
+	for (TFieldIterator<FProperty> It(Struct); It; ++It)
+	{
+		const FProperty* Property = *It;
+		for (int32 Index = 0; Index < Property->ArrayDim; Index++)
+		{
+			if (!AddValueToPlan(Plan, Property, BaseOffset + Property->GetOffset_ForInternal() + Index * Property->ElementSize))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/** The cached plan for Struct, compiled on first use. */
+static FLinkStreamStructPlanPtr FindStructPlan(const UScriptStruct* Struct)
+{
+	struct FPlanCache
+	{
+		FRWLock Lock;
+		TMap<const UScriptStruct*, FLinkStreamStructPlanPtr> Plans;
+	};
+	static FPlanCache Cache;
+
+	{
+		FReadScopeLock ReadLock(Cache.Lock);
+		const FLinkStreamStructPlanPtr* Found = Cache.Plans.Find(Struct);
+		if (Found && (*Found)->FirstProperty == Struct->PropertyLink && (*Found)->StructureSize == Struct->GetStructureSize())
+		{
+			return *Found;
+		}
+	}
+
+	TSharedRef<FLinkStreamStructPlan, ESPMode::ThreadSafe> Plan = MakeShared<FLinkStreamStructPlan, ESPMode::ThreadSafe>();
+	Plan->FirstProperty = Struct->PropertyLink;
+	Plan->StructureSize = Struct->GetStructureSize();
+	if (!AddStructToPlan(*Plan, Struct, 0))
+	{
+		Plan->Ops.Reset();
+		ALinkStreamConnection::PrintToConsole(FString::Printf(TEXT("Struct %s cannot be serialized: %s."), *Struct->GetName(), *Plan->Error), true);
+	}
+
+	FWriteScopeLock WriteLock(Cache.Lock);
+	Cache.Plans.Add(Struct, Plan);
+	return Plan;
+}
+
+static void WriteWithPlan(const FLinkStreamStructPlan& Plan, const uint8* Value, FLinkStreamWriter& Writer)
+{
+	for (const FLinkStreamCodecOp& Op : Plan.Ops)
+	{
+		const uint8* Field = Value + Op.Offset;
+		switch (Op.Kind)
+		{
+		case ELinkStreamCodecOp::Copy:
+			Writer.WriteBytes(Field, Op.Size);
+			break;
+
+		case ELinkStreamCodecOp::Bool:
+			Writer.WriteBool(static_cast<const FBoolProperty*>(Op.Property)->GetPropertyValue(Field));
+			break;
+
+		case ELinkStreamCodecOp::String:
+			Writer.WriteLengthPrefixedString(*reinterpret_cast<const FString*>(Field));
+			break;
+
+		case ELinkStreamCodecOp::Name:
+			Writer.WriteLengthPrefixedString(reinterpret_cast<const FName*>(Field)->ToString());
+			break;
+
+		case ELinkStreamCodecOp::Array:
+		{
+			const FScriptArray& Array = *reinterpret_cast<const FScriptArray*>(Field);
+			const int32 Count = Array.Num();
+			const uint8* Elements = static_cast<const uint8*>(Array.GetData());
+			Writer.WriteVarUInt((uint64)Count);
+			if (Op.Element->IsFlat(Op.Size))
+			{
+				Writer.WriteBytes(Elements, Count * Op.Size);
+				break;
+			}
+			for (int32 Index = 0; Index < Count; Index++)
+			{
+				WriteWithPlan(*Op.Element, Elements + Index * Op.Size, Writer);
+			}
+			break;
+		}
+		}
+	}
+}
+
+static bool ReadWithPlan(const FLinkStreamStructPlan& Plan, uint8* Value, FLinkStreamReader& Reader)
+{
+	for (const FLinkStreamCodecOp& Op : Plan.Ops)
+	{
+		uint8* Field = Value + Op.Offset;
+		switch (Op.Kind)
+		{
+		case ELinkStreamCodecOp::Copy:
+		{
+			TArrayView<const uint8> Span;
+			if (!Reader.ReadSpan(Op.Size, Span))
+			{
+				return false;
+			}
+			FMemory::Memcpy(Field, Span.GetData(), Op.Size);
+			break;
+		}
+
+		case ELinkStreamCodecOp::Bool:
+		{
+			bool bValue = false;
+			if (!Reader.ReadBool(bValue))
+			{
+				return false;
+			}
+			static_cast<const FBoolProperty*>(Op.Property)->SetPropertyValue(Field, bValue);
+			break;
+		}
+
+		case ELinkStreamCodecOp::String:
+			if (!Reader.ReadLengthPrefixedString(*reinterpret_cast<FString*>(Field)))
+			{
+				return false;
+			}
+			break;
+
+		case ELinkStreamCodecOp::Name:
+		{
+			FString Name;
+			if (!Reader.ReadLengthPrefixedString(Name) || Name.Len() >= NAME_SIZE)
+			{
+				return false;
+			}
+
+			// Names are never freed, so bytes from the peer only look up existing ones rather than growing the table.
+			const FName Found(*Name, FNAME_Find);
+			if (Found.IsNone() && !Name.IsEmpty() && !Name.Equals(TEXT("None"), ESearchCase::IgnoreCase))
+			{
+				return false;
+			}
+			*reinterpret_cast<FName*>(Field) = Found;
+			break;
+		}
+
+		case ELinkStreamCodecOp::Array:
+		{
+			uint64 Count = 0;
+			if (!Reader.ReadVarUInt(Count))
+			{
+				return false;
+			}
+			// A count promising more bytes than are left fails as the short read it is, before anything is allocated.
+			if (Count > (uint64)Reader.GetRemaining() / Op.Element->MinWireSize)
+			{
+				Reader.Skip(Reader.GetRemaining() + 1);
+				return false;
+			}
+
+			FScriptArrayHelper Array(static_cast<const FArrayProperty*>(Op.Property), Field);
+			Array.Resize((int32)Count);
+			if (Count == 0)
+			{
+				break;
+			}
+			uint8* Elements = Array.GetRawPtr(0);
+			if (Op.Element->IsFlat(Op.Size))
+			{
+				TArrayView<const uint8> Span;
+				if (!Reader.ReadSpan((int32)Count * Op.Size, Span))
+				{
+					return false;
+				}
+				FMemory::Memcpy(Elements, Span.GetData(), Span.Num());
+				break;
+			}
+			for (int32 Index = 0; Index < (int32)Count; Index++)
+			{
+				if (!ReadWithPlan(*Op.Element, Elements + Index * Op.Size, Reader))
+				{
+					return false;
+				}
+			}
+			break;
+		}
+		}
+	}
+	return true;
+}
+
+bool FLinkStreamStructCodec::Serialize(const UScriptStruct* Struct, const void* Value, FLinkStreamWriter& Writer)
+{
+	if (!Struct || !Value)
+	{
+		return false;
+	}
+	const FLinkStreamStructPlanPtr Plan = FindStructPlan(Struct);
+	if (!Plan->Error.IsEmpty())
+	{
+		return false;
+	}
+
+	Writer.Reserve(Writer.Num() + Plan->MinWireSize);
+	WriteWithPlan(*Plan, static_cast<const uint8*>(Value), Writer);
+	return true;
+}
+
+bool FLinkStreamStructCodec::Deserialize(const UScriptStruct* Struct, void* OutValue, FLinkStreamReader& Reader)
+{
+	if (!Struct || !OutValue)
+	{
+		return false;
+	}
+	const FLinkStreamStructPlanPtr Plan = FindStructPlan(Struct);
+	if (!Plan->Error.IsEmpty())
+	{
+		return false;
+	}
+
+	const int32 Start = Reader.GetOffset();
+	if (!ReadWithPlan(*Plan, static_cast<uint8*>(OutValue), Reader))
+	{
+		Reader.Seek(Start);
+		return false;
+	}
+	return true;
+}
+
+bool ULinkStreamStructLibrary::SerializeStruct(FLinkStreamWriter& Writer, const int32& Value)
+{
+	// Only reachable through the custom thunk.
+	checkNoEntry();
+	return false;
+}
+
+bool ULinkStreamStructLibrary::DeserializeStruct(FLinkStreamReader& Reader, int32& Value)
+{
+	checkNoEntry();
+	return false;
+}
+
+DEFINE_FUNCTION(ULinkStreamStructLibrary::execSerializeStruct)
+{
+	P_GET_STRUCT_REF(FLinkStreamWriter, Writer);
+
+	Stack.MostRecentProperty = nullptr;
+	Stack.MostRecentPropertyAddress = nullptr;
+	Stack.StepCompiledIn<FStructProperty>(nullptr);
+	const FStructProperty* ValueProperty = CastField<FStructProperty>(Stack.MostRecentProperty);
+	const void* Value = Stack.MostRecentPropertyAddress;
+	P_FINISH;
+
+	P_NATIVE_BEGIN;
+	*(bool*)RESULT_PARAM = ValueProperty && FLinkStreamStructCodec::Serialize(ValueProperty->Struct, Value, Writer);
+	P_NATIVE_END;
+}
+
+DEFINE_FUNCTION(ULinkStreamStructLibrary::execDeserializeStruct)
+{
+	P_GET_STRUCT_REF(FLinkStreamReader, Reader);
+
+	Stack.MostRecentProperty = nullptr;
+	Stack.MostRecentPropertyAddress = nullptr;
+	Stack.StepCompiledIn<FStructProperty>(nullptr);
+	const FStructProperty* ValueProperty = CastField<FStructProperty>(Stack.MostRecentProperty);
+	void* Value = Stack.MostRecentPropertyAddress;
+	P_FINISH;
+
+	P_NATIVE_BEGIN;
+	*(bool*)RESULT_PARAM = ValueProperty && FLinkStreamStructCodec::Deserialize(ValueProperty->Struct, Value, Reader);
+	P_NATIVE_END;
+}
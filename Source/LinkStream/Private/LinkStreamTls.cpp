@@ -0,0 +1,567 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamTls.h"
+#include "LinkStreamConnection.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+#if WITH_SSL
+#include "Ssl.h"
+#include "Interfaces/ISslManager.h"
+#endif
+
+#define UI UI_ST
+THIRD_PARTY_INCLUDES_START
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+THIRD_PARTY_INCLUDES_END
+#undef UI
+
+namespace LinkStreamTls
+{
+	/** Set on server contexts so TLS 1.2 session IDs are only resumed by the context that issued them. */
+	static constexpr uint8 SessionIdContext[] = { 'L', 'i', 'n', 'k', 'S', 't', 'r', 'e', 'a', 'm' };
+
+	static FCriticalSection ClientContextsLock;
+	static TMap<FString, TWeakPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe>> ClientContexts;
+
+	/** Takes the oldest error off this thread's OpenSSL error queue, and clears the rest. */
+	static FString PopError(const TCHAR* Fallback)
+	{
+		const unsigned long Code = ERR_get_error();
+		ERR_clear_error();
+		if (Code == 0)
+		{
+			return Fallback;
+		}
+		char Buffer[256];
+		ERR_error_string_n(Code, Buffer, sizeof(Buffer));
+		return UTF8_TO_TCHAR(Buffer);
+	}
+
+	/** Creates a context through the engine's SSL module, TLS 1.2 at least and never compressed. */
+	static SSL_CTX* NewContext(bool bAddCertificates)
+	{
+#if WITH_SSL
+		FSslContextCreateOptions Options;
+		Options.MinimumProtocol = ESslTlsProtocol::TLSv1_2;
+		Options.bAllowCompression = false;
+		Options.bAddCertificates = bAddCertificates;
+		return FSslModule::Get().GetSslManager().CreateSslContext(Options);
+#else
+		SSL_CTX* Context = SSL_CTX_new(TLS_method());
+		if (Context)
+		{
+			SSL_CTX_set_min_proto_version(Context, TLS1_2_VERSION);
+			SSL_CTX_set_options(Context, SSL_OP_NO_COMPRESSION);
+			if (bAddCertificates)
+			{
+				SSL_CTX_set_default_verify_paths(Context);
+			}
+		}
+		return Context;
+#endif
+	}
+
+	static void FreeContext(SSL_CTX* Context)
+	{
+#if WITH_SSL
+		FSslModule::Get().GetSslManager().DestroySslContext(Context);
+#else
+		SSL_CTX_free(Context);
+#endif
+	}
+
+	/** Client contexts hand every resumable session to the context, under the key of the connection it came from. */
+	static int OnNewSession(SSL* Ssl, SSL_SESSION* Session)
+	{
+		FLinkStreamTls* Tls = static_cast<FLinkStreamTls*>(SSL_get_app_data(Ssl));
+		FLinkStreamTlsContext* Context = static_cast<FLinkStreamTlsContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(Ssl)));
+		if (!Tls || !Context || !SSL_SESSION_is_resumable(Session))
+		{
+			return 0;
+		}
+		Context->StoreSession(Tls->GetSessionKey(), Session);
+		return 1;
+	}
+}
+
+FLinkStreamTlsContext::FLinkStreamTlsContext(SSL_CTX* InContext, bool bInServer, bool bInVerifyPeer)
+	: Context(InContext)
+	, bServer(bInServer)
+	, bVerifyPeer(bInVerifyPeer)
+{
+	SSL_CTX_set_app_data(Context, this);
+}
+
+FLinkStreamTlsContext::~FLinkStreamTlsContext()
+{
+	ForgetSessions();
+	LinkStreamTls::FreeContext(Context);
+}
+
+TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> FLinkStreamTlsContext::CreateServer(const FString& CertificatePem, const FString& PrivateKeyPem, FString& OutError)
+{
+	SSL_CTX* Context = LinkStreamTls::NewContext(false);
+	if (!Context)
+	{
+		OutError = LinkStreamTls::PopError(TEXT("could not create an SSL context"));
+		return nullptr;
+	}
+	TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> Result = MakeShareable(new FLinkStreamTlsContext(Context, true, false));
+
+	const FTCHARToUTF8 Certificate(*CertificatePem);
+	BIO* CertificateBio = BIO_new_mem_buf(Certificate.Get(), Certificate.Length());
+	X509* Leaf = PEM_read_bio_X509(CertificateBio, nullptr, nullptr, nullptr);
+	bool bLoaded = Leaf && SSL_CTX_use_certificate(Context, Leaf) == 1;
+	X509_free(Leaf);
+
+	// The rest of the chain goes out with the leaf, so clients need to trust only the root.
+	while (bLoaded)
+	{
+		X509* Intermediate = PEM_read_bio_X509(CertificateBio, nullptr, nullptr, nullptr);
+		if (!Intermediate)
+		{
+			// Running out of certificates leaves a "no start line" error behind.
+			ERR_clear_error();
+			break;
+		}
+		if (SSL_CTX_add_extra_chain_cert(Context, Intermediate) != 1)
+		{
+			X509_free(Intermediate);
+			bLoaded = false;
+		}
+	}
+	BIO_free(CertificateBio);
+	if (!bLoaded)
+	{
+		OutError = FString::Printf(TEXT("the certificate does not load: %s"), *LinkStreamTls::PopError(TEXT("no PEM certificate found")));
+		return nullptr;
+	}
+
+	const FTCHARToUTF8 PrivateKey(*PrivateKeyPem);
+	BIO* KeyBio = BIO_new_mem_buf(PrivateKey.Get(), PrivateKey.Length());
+	EVP_PKEY* Key = PEM_read_bio_PrivateKey(KeyBio, nullptr, nullptr, nullptr);
+	BIO_free(KeyBio);
+	bLoaded = Key && SSL_CTX_use_PrivateKey(Context, Key) == 1 && SSL_CTX_check_private_key(Context) == 1;
+	EVP_PKEY_free(Key);
+	if (!bLoaded)
+	{
+		OutError = FString::Printf(TEXT("the private key does not load or does not match the certificate: %s"), *LinkStreamTls::PopError(TEXT("no PEM private key found")));
+		return nullptr;
+	}
+
+	// TLS 1.3 tickets are on by default; this lets TLS 1.2 clients resume by session ID as well.
+	SSL_CTX_set_session_id_context(Context, LinkStreamTls::SessionIdContext, sizeof(LinkStreamTls::SessionIdContext));
+	return Result;
+}
+
+TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> FLinkStreamTlsContext::FindOrCreateClient(bool bVerifyPeer, const FString& TrustedPem, FString& OutError)
+{
+	const FString CacheKey = FString::Printf(TEXT("%d|%s"), bVerifyPeer ? 1 : 0, *TrustedPem);
+	FScopeLock Lock(&LinkStreamTls::ClientContextsLock);
+	if (const TWeakPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe>* Cached = LinkStreamTls::ClientContexts.Find(CacheKey))
+	{
+		if (TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> Existing = Cached->Pin())
+		{
+			return Existing;
+		}
+	}
+
+	SSL_CTX* Context = LinkStreamTls::NewContext(bVerifyPeer);
+	if (!Context)
+	{
+		OutError = LinkStreamTls::PopError(TEXT("could not create an SSL context"));
+		return nullptr;
+	}
+	TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> Result = MakeShareable(new FLinkStreamTlsContext(Context, false, bVerifyPeer));
+
+	if (!TrustedPem.IsEmpty())
+	{
+		const FTCHARToUTF8 Trusted(*TrustedPem);
+		BIO* TrustedBio = BIO_new_mem_buf(Trusted.Get(), Trusted.Length());
+		X509_STORE* Store = SSL_CTX_get_cert_store(Context);
+		int32 NumTrusted = 0;
+		while (X509* Certificate = PEM_read_bio_X509(TrustedBio, nullptr, nullptr, nullptr))
+		{
+			// Fails only for a certificate the store already holds.
+			X509_STORE_add_cert(Store, Certificate);
+			X509_free(Certificate);
+			NumTrusted++;
+		}
+		BIO_free(TrustedBio);
+		ERR_clear_error();
+		if (NumTrusted == 0)
+		{
+			OutError = TEXT("the trusted certificates hold no PEM certificate");
+			return nullptr;
+		}
+	}
+
+	SSL_CTX_set_verify(Context, bVerifyPeer ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, nullptr);
+
+	// OpenSSL's own cache is keyed by session ID, which TLS 1.3 clients never look up by; sessions are kept per peer here instead.
+	SSL_CTX_set_session_cache_mode(Context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(Context, &LinkStreamTls::OnNewSession);
+
+	LinkStreamTls::ClientContexts.Add(CacheKey, Result);
+	return Result;
+}
+
+bool FLinkStreamTlsContext::LoadPemFile(const FString& Path, FString& OutPem)
+{
+	const FString FullPath = FPaths::IsRelative(Path) ? FPaths::Combine(FPaths::ProjectDir(), Path) : Path;
+	return !Path.IsEmpty() && FFileHelper::LoadFileToString(OutPem, *FullPath);
+}
+
+void FLinkStreamTlsContext::ApplySession(SSL* Ssl, const FString& Key)
+{
+	FScopeLock Lock(&SessionsLock);
+	if (SSL_SESSION* const* Session = Sessions.Find(Key))
+	{
+		SSL_set_session(Ssl, *Session);
+	}
+}
+
+void FLinkStreamTlsContext::StoreSession(const FString& Key, SSL_SESSION* Session)
+{
+	FScopeLock Lock(&SessionsLock);
+	SSL_SESSION*& Stored = Sessions.FindOrAdd(Key, nullptr);
+	if (Stored)
+	{
+		SSL_SESSION_free(Stored);
+	}
+	Stored = Session;
+}
+
+bool FLinkStreamTlsContext::HasSession(const FString& Key) const
+{
+	FScopeLock Lock(&SessionsLock);
+	return Sessions.Contains(Key);
+}
+
+void FLinkStreamTlsContext::ForgetSessions()
+{
+	FScopeLock Lock(&SessionsLock);
+	for (const TPair<FString, SSL_SESSION*>& Session : Sessions)
+	{
+		SSL_SESSION_free(Session.Value);
+	}
+	Sessions.Empty();
+}
+
+FLinkStreamTls::FLinkStreamTls(const TSharedRef<FLinkStreamTlsContext, ESPMode::ThreadSafe>& InContext, const FString& InServerName, const FString& InSessionKey)
+	: Context(InContext)
+	, ServerName(InServerName)
+	, SessionKey(InSessionKey)
+{
+}
+
+FLinkStreamTls::~FLinkStreamTls()
+{
+	if (Ssl)
+	{
+		SSL_free(Ssl);
+	}
+}
+
+bool FLinkStreamTls::Start()
+{
+	ERR_clear_error();
+	Ssl = SSL_new(Context->GetNative());
+	ReadBio = BIO_new(BIO_s_mem());
+	WriteBio = BIO_new(BIO_s_mem());
+	if (!Ssl || !ReadBio || !WriteBio)
+	{
+		BIO_free(ReadBio);
+		BIO_free(WriteBio);
+		ReadBio = WriteBio = nullptr;
+		Fail(SSL_ERROR_SSL);
+		return false;
+	}
+
+	// An empty read buffer means no record has arrived yet, not that the peer is gone.
+	BIO_set_mem_eof_return(ReadBio, -1);
+	SSL_set_bio(Ssl, ReadBio, WriteBio);
+	SSL_set_app_data(Ssl, this);
+
+	if (Context->IsServer())
+	{
+		SSL_set_accept_state(Ssl);
+		return true;
+	}
+
+	SSL_set_connect_state(Ssl);
+	const FTCHARToUTF8 Name(*ServerName);
+	X509_VERIFY_PARAM* Param = SSL_get0_param(Ssl);
+	if (X509_VERIFY_PARAM_set1_ip_asc(Param, Name.Get()) != 1)
+	{
+		// Not an IP address, so it is a host name: sent for virtual hosting and matched against the certificate.
+		ERR_clear_error();
+		SSL_set_tlsext_host_name(Ssl, Name.Get());
+		if (Context->VerifiesPeer())
+		{
+			SSL_set1_host(Ssl, Name.Get());
+		}
+	}
+	Context->ApplySession(Ssl, SessionKey);
+
+	const int Result = SSL_do_handshake(Ssl);
+	CollectOutput();
+	if (Result <= 0 && SSL_get_error(Ssl, Result) != SSL_ERROR_WANT_READ)
+	{
+		Fail(SSL_get_error(Ssl, Result));
+		return false;
+	}
+	return true;
+}
+
+bool FLinkStreamTls::IsEstablished() const
+{
+	return Ssl && SSL_is_init_finished(Ssl);
+}
+
+bool FLinkStreamTls::WasResumed() const
+{
+	return Ssl && SSL_session_reused(Ssl);
+}
+
+const char* FLinkStreamTls::GetProtocol() const
+{
+	return Ssl ? SSL_get_version(Ssl) : "";
+}
+
+const char* FLinkStreamTls::GetCipherName() const
+{
+	return Ssl ? SSL_get_cipher_name(Ssl) : "";
+}
+
+bool FLinkStreamTls::HasBufferedInput() const
+{
+	return Ssl && (SSL_pending(Ssl) > 0 || BIO_ctrl_pending(ReadBio) > 0);
+}
+
+ELinkStreamSocketResult FLinkStreamTls::Recv(FLinkStreamSocket& Socket, uint8* Data, int32 Size, int32& OutBytesRead)
+{
+	OutBytesRead = 0;
+	for (;;)
+	{
+		ERR_clear_error();
+		const int Result = SSL_read(Ssl, Data, Size);
+		CollectOutput();
+		if (Result > 0)
+		{
+			OutBytesRead = Result;
+			return ELinkStreamSocketResult::Ok;
+		}
+
+		const int SslError = SSL_get_error(Ssl, Result);
+		if (SslError == SSL_ERROR_ZERO_RETURN)
+		{
+			return ELinkStreamSocketResult::Closed;
+		}
+		if (SslError != SSL_ERROR_WANT_READ)
+		{
+			return Fail(SslError);
+		}
+
+		// Handshake replies go out before waiting on the peer, which may be waiting on them. A full socket keeps them for the next send.
+		if (Flush(Socket) == ELinkStreamSocketResult::Error)
+		{
+			return ELinkStreamSocketResult::Error;
+		}
+
+		int32 Received = 0;
+		const ELinkStreamSocketResult SocketResult = Socket.Recv(Incoming, sizeof(Incoming), Received);
+		if (SocketResult != ELinkStreamSocketResult::Ok)
+		{
+			return SocketResult;
+		}
+		BIO_write(ReadBio, Incoming, Received);
+	}
+}
+
+ELinkStreamSocketResult FLinkStreamTls::SendVectored(FLinkStreamSocket& Socket, const FLinkStreamIoVec* Vecs, int32 NumVecs, int32& OutBytesSent)
+{
+	OutBytesSent = 0;
+	ELinkStreamSocketResult Result = Flush(Socket);
+	if (Result != ELinkStreamSocketResult::Ok)
+	{
+		return Result;
+	}
+
+	Staging.Reset();
+	for (int32 Index = 0; Index < NumVecs && Staging.Num() < MaxWriteSize; Index++)
+	{
+		Staging.Append(Vecs[Index].Data, FMath::Min(Vecs[Index].Size, MaxWriteSize - Staging.Num()));
+	}
+	if (Staging.Num() == 0)
+	{
+		return ELinkStreamSocketResult::Ok;
+	}
+
+	// The write buffer is memory, so everything is taken at once.
+	ERR_clear_error();
+	const int Written = SSL_write(Ssl, Staging.GetData(), Staging.Num());
+	CollectOutput();
+	if (Written <= 0)
+	{
+		return Fail(SSL_get_error(Ssl, Written));
+	}
+	OutBytesSent = Written;
+
+	Result = Flush(Socket);
+	return Result == ELinkStreamSocketResult::WouldBlock ? ELinkStreamSocketResult::Ok : Result;
+}
+
+ELinkStreamSocketResult FLinkStreamTls::Flush(FLinkStreamSocket& Socket)
+{
+	CollectOutput();
+	while (OutputOffset < Output.Num())
+	{
+		int32 Sent = 0;
+		const ELinkStreamSocketResult Result = Socket.Send(Output.GetData() + OutputOffset, Output.Num() - OutputOffset, Sent);
+		if (Result != ELinkStreamSocketResult::Ok)
+		{
+			return Result;
+		}
+		OutputOffset += Sent;
+	}
+	Output.Reset();
+	OutputOffset = 0;
+	return ELinkStreamSocketResult::Ok;
+}
+
+void FLinkStreamTls::CollectOutput()
+{
+	const int32 Pending = (int32)BIO_ctrl_pending(WriteBio);
+	if (Pending <= 0)
+	{
+		return;
+	}
+	if (OutputOffset == Output.Num())
+	{
+		Output.Reset();
+		OutputOffset = 0;
+	}
+	const int32 Start = Output.Num();
+	Output.AddUninitialized(Pending);
+	BIO_read(WriteBio, Output.GetData() + Start, Pending);
+}
+
+ELinkStreamSocketResult FLinkStreamTls::Fail(int32 SslError)
+{
+	Error = LinkStreamTls::PopError(*FString::Printf(TEXT("SSL error %d"), SslError));
+	if (Ssl)
+	{
+		const long VerifyResult = SSL_get_verify_result(Ssl);
+		if (VerifyResult != X509_V_OK)
+		{
+			Error += FString::Printf(TEXT(" (%s)"), UTF8_TO_TCHAR(X509_verify_cert_error_string(VerifyResult)));
+		}
+	}
+	return ELinkStreamSocketResult::Error;
+}
+
+FLinkStreamTlsConnection::FLinkStreamTlsConnection(const TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe>& InContext, bool bInVerifyPeer, const FString& InTrustedCertificates, const FString& InServerName)
+	: Context(InContext)
+	, bVerifyPeer(bInVerifyPeer)
+	, TrustedCertificates(InTrustedCertificates)
+	, ServerName(InServerName)
+{
+}
+
+bool FLinkStreamTlsConnection::Start(const FString& Host, int32 Port, FString& OutError)
+{
+	Reset();
+
+	// The client context loads the certificate bundle, so it is found here on the I/O thread rather than in Connect.
+	if (!Context.IsValid())
+	{
+		Context = FLinkStreamTlsContext::FindOrCreateClient(bVerifyPeer, TrustedCertificates, OutError);
+		if (!Context.IsValid())
+		{
+			return false;
+		}
+	}
+
+	Session = MakeUnique<FLinkStreamTls>(Context.ToSharedRef(), ServerName.IsEmpty() ? Host : ServerName, FString::Printf(TEXT("%s:%d"), *Host, Port));
+	if (!Session->Start())
+	{
+		OutError = Session->GetError();
+		Session.Reset();
+		return false;
+	}
+	HandshakeStart = FPlatformTime::Seconds();
+	return true;
+}
+
+void FLinkStreamTlsConnection::Reset()
+{
+	Session.Reset();
+	bEstablished = false;
+}
+
+bool FLinkStreamTlsConnection::UpdateEstablished()
+{
+	if (!Session || bEstablished || !Session->IsEstablished())
+	{
+		return false;
+	}
+
+	const bool bWasResumed = Session->WasResumed();
+	HandshakeMs.store((float)((FPlatformTime::Seconds() - HandshakeStart) * 1000.0), std::memory_order_relaxed);
+	Protocol.store(Session->GetProtocol(), std::memory_order_relaxed);
+	CipherName.store(Session->GetCipherName(), std::memory_order_relaxed);
+	bResumed = bWasResumed;
+	bEstablished = true;
+	Handshakes.Increment();
+	if (bWasResumed)
+	{
+		ResumedHandshakes.Increment();
+	}
+	return true;
+}
+
+FLinkStreamTlsStats FLinkStreamTlsConnection::GetStats() const
+{
+	FLinkStreamTlsStats Stats;
+	Stats.bEstablished = bEstablished;
+	if (Stats.bEstablished)
+	{
+		Stats.bResumed = bResumed;
+		Stats.Protocol = UTF8_TO_TCHAR(Protocol.load(std::memory_order_relaxed));
+		Stats.CipherSuite = UTF8_TO_TCHAR(CipherName.load(std::memory_order_relaxed));
+	}
+	Stats.HandshakeTimeMs = HandshakeMs.load(std::memory_order_relaxed);
+	Stats.Handshakes = Handshakes.GetValue();
+	Stats.ResumedHandshakes = ResumedHandshakes.GetValue();
+	return Stats;
+}
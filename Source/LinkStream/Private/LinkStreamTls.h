@@ -0,0 +1,233 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "LinkStreamSocket.h"
+#include <atomic>
+
+struct ssl_ctx_st;
+struct ssl_st;
+struct ssl_session_st;
+struct bio_st;
+struct FLinkStreamTlsStats;
+
+/**
+ * An SSL_CTX made by the engine's SSL module, shared by every connection configured alike.
+ *
+ * A server context belongs to a listener and holds its certificate and the keys of the session tickets it issues, so
+ * any of its sessions can resume a ticket another one handed out. Client contexts are shared per trust configuration
+ * and keep the newest session per host:port, so a reconnect resumes instead of repeating the full handshake. They
+ * live while a connection or anyone else holds them. Thread-safe.
+ */
+class FLinkStreamTlsContext
+{
+public:
+	/**
+	 * Presents the PEM certificate chain CertificatePem, leaf first, signed for the private key in PrivateKeyPem.
+	 * Returns null with OutError set if either does not load. Any thread.
+	 */
+	static TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> CreateServer(const FString& CertificatePem, const FString& PrivateKeyPem, FString& OutError);
+
+	/**
+	 * The client context that trusts the engine's certificate bundle plus the PEM certificates in TrustedPem, created
+	 * on first use. Without bVerifyPeer any certificate is accepted, which still encrypts but lets an attacker in the
+	 * middle read along. Returns null with OutError set on failure. Any thread; the first call loads the bundle.
+	 */
+	static TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> FindOrCreateClient(bool bVerifyPeer, const FString& TrustedPem, FString& OutError);
+
+	/** Reads a PEM file, resolving a relative Path against the project directory. Game thread or any thread that may touch the disk. */
+	static bool LoadPemFile(const FString& Path, FString& OutPem);
+
+	~FLinkStreamTlsContext();
+
+	FLinkStreamTlsContext(const FLinkStreamTlsContext&) = delete;
+	FLinkStreamTlsContext& operator=(const FLinkStreamTlsContext&) = delete;
+
+	bool IsServer() const { return bServer; }
+	bool VerifiesPeer() const { return bVerifyPeer; }
+	struct ssl_ctx_st* GetNative() const { return Context; }
+
+	/** Client only: offers the session stored under Key, if any, for resumption on Ssl. */
+	void ApplySession(struct ssl_st* Ssl, const FString& Key);
+
+	/** Client only: keeps Session, whose reference this takes over, as the one to offer for Key. */
+	void StoreSession(const FString& Key, struct ssl_session_st* Session);
+
+	bool HasSession(const FString& Key) const;
+
+	/** Drops every stored session, so the next handshake of each peer is a full one. */
+	void ForgetSessions();
+
+private:
+	FLinkStreamTlsContext(struct ssl_ctx_st* InContext, bool bInServer, bool bInVerifyPeer);
+
+	struct ssl_ctx_st* Context;
+	bool bServer;
+	bool bVerifyPeer;
+
+	TMap<FString, struct ssl_session_st*> Sessions;
+	mutable FCriticalSection SessionsLock;
+};
+
+/**
+ * TLS over one connection's socket, driven by the worker that services it.
+ *
+ * OpenSSL only ever sees memory buffers, so the worker keeps its non-blocking loop and the socket syscalls stay its
+ * own: Recv pulls records off the socket until there is plaintext to return, SendVectored turns plaintext into
+ * records, and the handshake advances inside both. Ciphertext the socket does not take is kept and written first the
+ * next time, which is what Flush does on its own.
+ *
+ * Not thread-safe: only the worker servicing the connection calls it.
+ */
+class FLinkStreamTls
+{
+public:
+	/** Most plaintext SendVectored encrypts per call, four full records, which bounds the ciphertext kept for a full socket. */
+	static constexpr int32 MaxWriteSize = 4 * 16384;
+
+	/**
+	 * Client connections check the certificate against ServerName, a host name or IP address, and offer the session
+	 * stored under SessionKey. Servers ignore both.
+	 */
+	FLinkStreamTls(const TSharedRef<FLinkStreamTlsContext, ESPMode::ThreadSafe>& InContext, const FString& InServerName, const FString& InSessionKey);
+	~FLinkStreamTls();
+
+	FLinkStreamTls(const FLinkStreamTls&) = delete;
+	FLinkStreamTls& operator=(const FLinkStreamTls&) = delete;
+
+	/** Queues the client hello, or readies a server for one. Returns false with GetError set if the session could not be set up. */
+	bool Start();
+
+	bool IsEstablished() const;
+
+	/** Whether the handshake resumed an earlier session rather than running in full. */
+	bool WasResumed() const;
+
+	/** Protocol and cipher suite names, static strings owned by OpenSSL. Only meaningful once established. */
+	const char* GetProtocol() const;
+	const char* GetCipherName() const;
+
+	/**
+	 * Returns up to Size bytes of plaintext, reading records from Socket until some is available. As with
+	 * FLinkStreamSocket::Recv, WouldBlock means the socket is drained and Closed that the peer is gone. Error means
+	 * TLS failed, the handshake included, and the link must be closed.
+	 */
+	ELinkStreamSocketResult Recv(FLinkStreamSocket& Socket, uint8* Data, int32 Size, int32& OutBytesRead);
+
+	/**
+	 * Encrypts up to MaxWriteSize bytes of Vecs into records and writes them. OutBytesSent counts the plaintext taken,
+	 * which may all be counted while some of its records still wait for the socket. WouldBlock, with nothing taken,
+	 * when records from before still do not fit.
+	 */
+	ELinkStreamSocketResult SendVectored(FLinkStreamSocket& Socket, const FLinkStreamIoVec* Vecs, int32 NumVecs, int32& OutBytesSent);
+
+	/** Writes records still waiting, the handshake's included. Ok once none is left. */
+	ELinkStreamSocketResult Flush(FLinkStreamSocket& Socket);
+
+	bool HasPendingOutput() const { return OutputOffset < Output.Num(); }
+
+	/** Whether data already taken off the socket awaits Recv. The socket raises no readable event for it. */
+	bool HasBufferedInput() const;
+
+	const FString& GetSessionKey() const { return SessionKey; }
+
+	/** Why the last call returned Error, from OpenSSL's error queue and the certificate check. */
+	const FString& GetError() const { return Error; }
+
+private:
+	/** Moves the records OpenSSL produced into Output. */
+	void CollectOutput();
+
+	/** Records why an OpenSSL call failed with SslError and returns Error. */
+	ELinkStreamSocketResult Fail(int32 SslError);
+
+	TSharedRef<FLinkStreamTlsContext, ESPMode::ThreadSafe> Context;
+	FString ServerName;
+	FString SessionKey;
+	FString Error;
+
+	struct ssl_st* Ssl = nullptr;
+
+	/** Owned by Ssl. Records from the socket go into ReadBio, records for it come out of WriteBio. */
+	struct bio_st* ReadBio = nullptr;
+	struct bio_st* WriteBio = nullptr;
+
+	/** Records waiting for the socket, from OutputOffset on. */
+	TArray<uint8> Output;
+	int32 OutputOffset = 0;
+
+	/** The plaintext of one SendVectored call, gathered so it fills whole records. */
+	TArray<uint8> Staging;
+
+	/** One recv's worth of records, a full record and its header. */
+	uint8 Incoming[16384 + 512];
+};
+
+/**
+ * TLS of one connection across its links. The context and the sessions it keeps outlive reconnects; the FLinkStreamTls
+ * of a link lives until Reset. Driven by the worker; GetStats may be called from any thread.
+ */
+class FLinkStreamTlsConnection
+{
+public:
+	/** InContext is the listener's for accepted sessions. Clients pass null and find theirs on the first Start. */
+	FLinkStreamTlsConnection(const TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe>& InContext, bool bInVerifyPeer, const FString& InTrustedCertificates, const FString& InServerName);
+
+	/** Starts the session of a link to Host:Port that just came up. Returns false with OutError set if TLS could not start. */
+	bool Start(const FString& Host, int32 Port, FString& OutError);
+
+	/** Drops the session of a link that went down. */
+	void Reset();
+
+	/** The current link's session, null if there is none. */
+	FLinkStreamTls* GetSession() const { return Session.Get(); }
+
+	/** Records how the handshake went the first time it is found complete, and returns true then. */
+	bool UpdateEstablished();
+
+	FLinkStreamTlsStats GetStats() const;
+
+private:
+	TSharedPtr<FLinkStreamTlsContext, ESPMode::ThreadSafe> Context;
+	bool bVerifyPeer;
+	FString TrustedCertificates;
+	FString ServerName;
+	TUniquePtr<FLinkStreamTls> Session;
+
+	/** Worker only: when the current link's handshake started. */
+	double HandshakeStart = 0.0;
+
+	/** The names are static strings owned by OpenSSL. */
+	std::atomic<bool> bEstablished{ false };
+	std::atomic<bool> bResumed{ false };
+	std::atomic<float> HandshakeMs{ -1.f };
+	std::atomic<const char*> Protocol{ nullptr };
+	std::atomic<const char*> CipherName{ nullptr };
+	FThreadSafeCounter64 Handshakes;
+	FThreadSafeCounter64 ResumedHandshakes;
+};
@@ -0,0 +1,759 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamUdp.h"
+
+static const TCHAR* UdpScheme = TEXT("udp://");
+
+namespace LinkStreamUdp
+{
+	static constexpr uint32 Magic = 0x3155534C; // "LSU1"
+
+	enum class EPacketType : uint8
+	{
+		Connect = 1,
+		Accept = 2,
+		Data = 3,
+		Close = 4
+	};
+
+	static constexpr double HandshakeInterval = 0.25;
+	static constexpr double InitialRetransmitTimeout = 0.3;
+	static constexpr double MinRetransmitTimeout = 0.05;
+	static constexpr double MaxRetransmitTimeout = 2.0;
+
+	/** Retransmission timeouts in a row, without any acknowledgement, after which the peer counts as gone. */
+	static constexpr int32 MaxConsecutiveTimeouts = 10;
+
+	static constexpr int32 PacketThreshold = 3;
+	static constexpr int32 InitialWindow = 10 * FLinkStreamUdpSession::MaxDatagramSize;
+	static constexpr int32 MinWindow = 2 * FLinkStreamUdpSession::MaxDatagramSize;
+
+	/** Unreliable messages still missing fragments after this long are given up. */
+	static constexpr double ReassemblyTimeout = 1.0;
+
+	/** Furthest a reliable sequence may run ahead of the lowest one not yet raised. */
+	static constexpr uint32 MaxReliableWindow = 1 << 16;
+
+	static void Write32(uint8* Out, uint32 Value)
+	{
+		Out[0] = (uint8)Value;
+		Out[1] = (uint8)(Value >> 8);
+		Out[2] = (uint8)(Value >> 16);
+		Out[3] = (uint8)(Value >> 24);
+	}
+
+	static void Write16(uint8* Out, uint16 Value)
+	{
+		Out[0] = (uint8)Value;
+		Out[1] = (uint8)(Value >> 8);
+	}
+
+	static void Write64(uint8* Out, uint64 Value)
+	{
+		Write32(Out, (uint32)Value);
+		Write32(Out + 4, (uint32)(Value >> 32));
+	}
+
+	static uint32 Read32(const uint8* In)
+	{
+		return (uint32)In[0] | ((uint32)In[1] << 8) | ((uint32)In[2] << 16) | ((uint32)In[3] << 24);
+	}
+
+	static uint16 Read16(const uint8* In)
+	{
+		return (uint16)(In[0] | (In[1] << 8));
+	}
+
+	static uint64 Read64(const uint8* In)
+	{
+		return (uint64)Read32(In) | ((uint64)Read32(In + 4) << 32);
+	}
+
+	/** Wrap-safe: true if A comes before B. */
+	static bool IsBefore(uint32 A, uint32 B)
+	{
+		return (int32)(A - B) < 0;
+	}
+}
+
+bool FLinkStreamUdpSession::IsUdpAddress(const FString& Address)
+{
+	return Address.StartsWith(UdpScheme, ESearchCase::IgnoreCase);
+}
+
+FString FLinkStreamUdpSession::GetHost(const FString& Address)
+{
+	return IsUdpAddress(Address) ? Address.RightChop(FCString::Strlen(UdpScheme)) : Address;
+}
+
+FLinkStreamUdpSession::FLinkStreamUdpSession(bool bInInitiator, int32 InMaxMessageSize, FSendDatagram&& InSendDatagram, FDeliverMessage&& InDeliverMessage)
+	: bInitiator(bInInitiator)
+	, MaxMessageSize(FMath::Clamp(InMaxMessageSize, 1, FragmentSize * (int32)MAX_uint16))
+	, SendDatagram(MoveTemp(InSendDatagram))
+	, DeliverMessage(MoveTemp(InDeliverMessage))
+	, CongestionWindow(LinkStreamUdp::InitialWindow)
+{
+	CongestionWindowBytes = CongestionWindow;
+}
+
+void FLinkStreamUdpSession::Start(double Now)
+{
+	if (!bInitiator)
+	{
+		State = EState::Handshaking;
+		return;
+	}
+
+	// The token tells this session's packets from those of an earlier one between the same ports.
+	Token = ((uint32)(FPlatformTime::Cycles64() ^ (UPTRINT)this) * 2654435761u) | 1u;
+	State = EState::Handshaking;
+	SendHandshake((uint8)LinkStreamUdp::EPacketType::Connect);
+	NextHandshakeAt = Now + LinkStreamUdp::HandshakeInterval;
+}
+
+void FLinkStreamUdpSession::Close()
+{
+	if (State == EState::Connected || (State == EState::Handshaking && bInitiator))
+	{
+		SendClose();
+	}
+	State = EState::Closed;
+}
+
+bool FLinkStreamUdpSession::Queue(FLinkStreamOutgoingMessage&& Message, ELinkStreamDelivery Delivery)
+{
+	const int32 size = Message.HeaderSize + Message.GetPayloadSize();
+	if (size > MaxMessageSize)
+	{
+		return false;
+	}
+
+	const uint32 messageId = NextMessageId++;
+	FSendMessage& entry = SendMessages.Add(messageId);
+	entry.Message = MoveTemp(Message);
+	entry.Delivery = Delivery;
+	entry.Sequence = NextSequence[(int32)Delivery]++;
+	entry.Size = size;
+	entry.NumFragments = FMath::Max(1, FMath::DivideAndRoundUp(size, FragmentSize));
+	if (IsReliable((int32)Delivery))
+	{
+		entry.Acked.Init(false, entry.NumFragments);
+	}
+
+	NewMessages.Add(messageId);
+	UnsentBytes += size;
+	return true;
+}
+
+bool FLinkStreamUdpSession::Service(double Now)
+{
+	if (State == EState::Closed)
+	{
+		return false;
+	}
+
+	if (State == EState::Handshaking)
+	{
+		if (bInitiator && Now >= NextHandshakeAt)
+		{
+			SendHandshake((uint8)LinkStreamUdp::EPacketType::Connect);
+			NextHandshakeAt = Now + LinkStreamUdp::HandshakeInterval;
+		}
+		return true;
+	}
+	if (State != EState::Connected)
+	{
+		return true;
+	}
+
+	// Nothing acknowledged for a whole timeout: everything in flight is presumed lost and the window collapses.
+	if (SentPackets.Num() > 0 && Now >= FMath::Max(LastAckTime, SentPackets[0].SentAt) + GetRetransmitTimeout())
+	{
+		if (++ConsecutiveTimeouts > LinkStreamUdp::MaxConsecutiveTimeouts)
+		{
+			State = EState::Closed;
+			return false;
+		}
+		for (FSentPacket& packet : SentPackets)
+		{
+			OnPacketLost(packet, Now);
+		}
+		SentPackets.Reset();
+		CongestionWindow = LinkStreamUdp::MinWindow;
+		CongestionWindowBytes = CongestionWindow;
+		LastAckTime = Now;
+	}
+
+	for (auto it = Reassemblies.CreateIterator(); it; ++it)
+	{
+		if (!IsReliable((int32)(it.Key() >> 32)) && Now - it.Value().StartedAt > LinkStreamUdp::ReassemblyTimeout)
+		{
+			it.RemoveCurrent();
+		}
+	}
+
+	SendPending(Now);
+	return true;
+}
+
+double FLinkStreamUdpSession::GetNextTimer() const
+{
+	if (State == EState::Handshaking)
+	{
+		return bInitiator ? NextHandshakeAt : MAX_dbl;
+	}
+	if (State != EState::Connected || SentPackets.Num() == 0)
+	{
+		return MAX_dbl;
+	}
+	return FMath::Max(LastAckTime, SentPackets[0].SentAt) + GetRetransmitTimeout();
+}
+
+double FLinkStreamUdpSession::GetRetransmitTimeout() const
+{
+	const double timeout = bHasRtt ? FMath::Clamp(SmoothedRtt + 4.0 * RttVariance, LinkStreamUdp::MinRetransmitTimeout, LinkStreamUdp::MaxRetransmitTimeout) : LinkStreamUdp::InitialRetransmitTimeout;
+	return timeout * (double)(1 << FMath::Min(ConsecutiveTimeouts, 5));
+}
+
+FLinkStreamUdpStats FLinkStreamUdpSession::GetStats() const
+{
+	FLinkStreamUdpStats stats;
+	stats.PacketsSent = PacketsSent.GetValue();
+	stats.PacketsReceived = PacketsReceived.GetValue();
+	stats.PacketsLost = PacketsLost.GetValue();
+	stats.FragmentsRetransmitted = FragmentsRetransmitted.GetValue();
+	stats.SmoothedRttMs = SmoothedRttMs.load(std::memory_order_relaxed);
+	stats.CongestionWindow = CongestionWindowBytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void FLinkStreamUdpSession::SendHandshake(uint8 Type)
+{
+	uint8 packet[9];
+	packet[0] = Type;
+	LinkStreamUdp::Write32(packet + 1, LinkStreamUdp::Magic);
+	LinkStreamUdp::Write32(packet + 5, Token);
+	SendDatagram(packet, sizeof(packet));
+}
+
+void FLinkStreamUdpSession::SendClose()
+{
+	uint8 packet[5];
+	packet[0] = (uint8)LinkStreamUdp::EPacketType::Close;
+	LinkStreamUdp::Write32(packet + 1, Token);
+	SendDatagram(packet, sizeof(packet));
+}
+
+void FLinkStreamUdpSession::SendPending(double Now)
+{
+	uint8 packet[MaxDatagramSize];
+	for (;;)
+	{
+		int32 size = DataHeaderSize;
+		FSentPacket sent;
+		if (BytesInFlight < CongestionWindow)
+		{
+			while (WriteNextFrame(packet, size, sent))
+			{
+			}
+		}
+
+		const bool bHasFrames = size > DataHeaderSize;
+		if (!bHasFrames && !bAckPending)
+		{
+			return;
+		}
+
+		const uint32 number = bHasFrames ? NextPacketNumber++ : 0;
+		packet[0] = (uint8)LinkStreamUdp::EPacketType::Data;
+		LinkStreamUdp::Write32(packet + 1, Token);
+		LinkStreamUdp::Write32(packet + 5, number);
+		LinkStreamUdp::Write32(packet + 9, LargestReceived);
+		LinkStreamUdp::Write64(packet + 13, ReceivedBits);
+		SendDatagram(packet, size);
+		PacketsSent.Increment();
+		bAckPending = false;
+
+		if (!bHasFrames)
+		{
+			return;
+		}
+		sent.Number = number;
+		sent.SentAt = Now;
+		sent.Size = size;
+		BytesInFlight += size;
+		SentPackets.Add(MoveTemp(sent));
+	}
+}
+
+bool FLinkStreamUdpSession::WriteNextFrame(uint8* Packet, int32& InOutSize, FSentPacket& OutSent)
+{
+	const int32 room = MaxDatagramSize - InOutSize - FrameHeaderSize;
+
+	while (Retransmits.Num() > 0)
+	{
+		const FFragmentRef fragment = Retransmits[0];
+		const FSendMessage* message = SendMessages.Find(fragment.MessageId);
+		if (!message || message->Acked[fragment.Fragment])
+		{
+			Retransmits.RemoveAt(0, 1, false);
+			continue;
+		}
+
+		const int32 length = FMath::Min(FragmentSize, message->Size - fragment.Fragment * FragmentSize);
+		if (length > room)
+		{
+			return false;
+		}
+		WriteFrame(Packet, InOutSize, *message, fragment.Fragment);
+		OutSent.Fragments.Add(fragment);
+		FragmentsRetransmitted.Increment();
+		Retransmits.RemoveAt(0, 1, false);
+		return true;
+	}
+
+	if (NewMessages.Num() == 0)
+	{
+		return false;
+	}
+
+	const uint32 messageId = NewMessages[0];
+	FSendMessage& message = SendMessages.FindChecked(messageId);
+	const int32 fragment = message.NextFragment;
+	const int32 length = FMath::Min(FragmentSize, message.Size - fragment * FragmentSize);
+	if (length > room)
+	{
+		return false;
+	}
+
+	WriteFrame(Packet, InOutSize, message, fragment);
+	UnsentBytes -= length;
+	message.NextFragment++;
+	const bool bLastFragment = message.NextFragment == message.NumFragments;
+	if (bLastFragment)
+	{
+		NewMessages.RemoveAt(0, 1, false);
+	}
+
+	if (IsReliable((int32)message.Delivery))
+	{
+		OutSent.Fragments.Add({ messageId, fragment });
+	}
+	else if (bLastFragment)
+	{
+		// Unreliable messages are never resent, so they are done with once every fragment is out.
+		SendMessages.Remove(messageId);
+	}
+	return true;
+}
+
+void FLinkStreamUdpSession::WriteFrame(uint8* Packet, int32& InOutSize, const FSendMessage& Message, int32 Fragment) const
+{
+	const int32 offset = Fragment * FragmentSize;
+	const int32 length = FMath::Min(FragmentSize, Message.Size - offset);
+
+	uint8* frame = Packet + InOutSize;
+	frame[0] = (uint8)Message.Delivery;
+	LinkStreamUdp::Write32(frame + 1, Message.Sequence);
+	LinkStreamUdp::Write16(frame + 5, (uint16)Fragment);
+	LinkStreamUdp::Write16(frame + 7, (uint16)Message.NumFragments);
+	LinkStreamUdp::Write16(frame + 9, (uint16)length);
+
+	// The fragment may straddle the envelope header and the payload.
+	uint8* out = frame + FrameHeaderSize;
+	const int32 headerSize = Message.Message.HeaderSize;
+	int32 copied = 0;
+	if (offset < headerSize)
+	{
+		copied = FMath::Min(length, headerSize - offset);
+		FMemory::Memcpy(out, Message.Message.Header + offset, copied);
+	}
+	if (copied < length)
+	{
+		FMemory::Memcpy(out + copied, Message.Message.GetPayloadData() + (offset + copied - headerSize), length - copied);
+	}
+	InOutSize += FrameHeaderSize + length;
+}
+
+void FLinkStreamUdpSession::ReceiveDatagram(const uint8* Data, int32 Size, double Now)
+{
+	if (Size < 5 || State == EState::Closed || State == EState::Idle)
+	{
+		return;
+	}
+
+	switch ((LinkStreamUdp::EPacketType)Data[0])
+	{
+	case LinkStreamUdp::EPacketType::Connect:
+		if (!bInitiator && Size >= 9 && LinkStreamUdp::Read32(Data + 1) == LinkStreamUdp::Magic)
+		{
+			// The first Connect picks the peer. Repeats mean the Accept was lost, so it is sent again.
+			const uint32 token = LinkStreamUdp::Read32(Data + 5);
+			if (State == EState::Handshaking)
+			{
+				Token = token;
+				State = EState::Connected;
+				LastAckTime = Now;
+			}
+			if (token == Token)
+			{
+				SendHandshake((uint8)LinkStreamUdp::EPacketType::Accept);
+			}
+		}
+		return;
+
+	case LinkStreamUdp::EPacketType::Accept:
+		if (bInitiator && State == EState::Handshaking && Size >= 9 && LinkStreamUdp::Read32(Data + 1) == LinkStreamUdp::Magic && LinkStreamUdp::Read32(Data + 5) == Token)
+		{
+			State = EState::Connected;
+			LastAckTime = Now;
+		}
+		return;
+
+	case LinkStreamUdp::EPacketType::Close:
+		if (LinkStreamUdp::Read32(Data + 1) == Token && State == EState::Connected)
+		{
+			State = EState::Closed;
+		}
+		return;
+
+	case LinkStreamUdp::EPacketType::Data:
+		break;
+
+	default:
+		return;
+	}
+
+	if (Size < DataHeaderSize || LinkStreamUdp::Read32(Data + 1) != Token)
+	{
+		return;
+	}
+	if (State == EState::Handshaking)
+	{
+		// Data from the responder means it accepted, even if its Accept was lost.
+		if (!bInitiator)
+		{
+			return;
+		}
+		State = EState::Connected;
+		LastAckTime = Now;
+	}
+
+	PacketsReceived.Increment();
+	OnAcks(LinkStreamUdp::Read32(Data + 9), LinkStreamUdp::Read64(Data + 13), Now);
+
+	const uint32 number = LinkStreamUdp::Read32(Data + 5);
+	if (number == 0)
+	{
+		return;
+	}
+
+	// Duplicates are acknowledged again, since the peer may have missed the first acknowledgement.
+	bAckPending = true;
+	if (RecordReceived(number))
+	{
+		ReceiveFrames(Data + DataHeaderSize, Size - DataHeaderSize, Now);
+	}
+}
+
+bool FLinkStreamUdpSession::RecordReceived(uint32 Number)
+{
+	if (LinkStreamUdp::IsBefore(LargestReceived, Number))
+	{
+		const uint32 shift = Number - LargestReceived;
+		ReceivedBits = shift >= 64 ? 0 : ReceivedBits << shift;
+		if (shift <= 64)
+		{
+			ReceivedBits |= 1ull << (shift - 1);
+		}
+		LargestReceived = Number;
+		return true;
+	}
+
+	const uint32 distance = LargestReceived - Number;
+	if (distance == 0)
+	{
+		return false;
+	}
+	if (distance > 64)
+	{
+		// Too old to tell; the frames are deduplicated by sequence anyway.
+		return true;
+	}
+	const uint64 bit = 1ull << (distance - 1);
+	if (ReceivedBits & bit)
+	{
+		return false;
+	}
+	ReceivedBits |= bit;
+	return true;
+}
+
+void FLinkStreamUdpSession::ReceiveFrames(const uint8* Data, int32 Size, double Now)
+{
+	int32 offset = 0;
+	while (offset + FrameHeaderSize <= Size)
+	{
+		const uint8* frame = Data + offset;
+		const int32 channel = frame[0];
+		const uint32 sequence = LinkStreamUdp::Read32(frame + 1);
+		const int32 fragment = LinkStreamUdp::Read16(frame + 5);
+		const int32 numFragments = LinkStreamUdp::Read16(frame + 7);
+		const int32 length = LinkStreamUdp::Read16(frame + 9);
+		offset += FrameHeaderSize + length;
+
+		// A malformed frame leaves the rest of the packet unreadable.
+		if (offset > Size || channel > (int32)ELinkStreamDelivery::Unreliable || fragment >= numFragments
+			|| length > FragmentSize || (fragment < numFragments - 1 && length != FragmentSize))
+		{
+			return;
+		}
+		// The smallest message these fragments could make up.
+		if ((int64)(numFragments - 1) * FragmentSize + (fragment == numFragments - 1 ? length : 1) > MaxMessageSize)
+		{
+			continue;
+		}
+		ReceiveFragment(channel, sequence, fragment, numFragments, frame + FrameHeaderSize, length, Now);
+	}
+}
+
+void FLinkStreamUdpSession::ReceiveFragment(int32 Channel, uint32 Sequence, int32 Fragment, int32 NumFragments, const uint8* Bytes, int32 Length, double Now)
+{
+	if (IsReliable(Channel))
+	{
+		const uint32 ahead = Sequence - NextExpected[Channel];
+		if (LinkStreamUdp::IsBefore(Sequence, NextExpected[Channel]) || ahead >= LinkStreamUdp::MaxReliableWindow)
+		{
+			return;
+		}
+		if (Channel == (int32)ELinkStreamDelivery::ReliableOrdered ? OrderedAhead.Contains(Sequence) : UnorderedAhead.Contains(Sequence))
+		{
+			return;
+		}
+	}
+
+	if (NumFragments == 1)
+	{
+		FLinkStreamBuffer message = FLinkStreamBuffer::Acquire(Length);
+		message.GetArray().Append(Bytes, Length);
+		CompleteMessage(Channel, Sequence, MoveTemp(message));
+		return;
+	}
+
+	const uint64 key = ((uint64)Channel << 32) | Sequence;
+	FReassembly* reassembly = Reassemblies.Find(key);
+	if (!reassembly)
+	{
+		reassembly = &Reassemblies.Add(key);
+		reassembly->Data = FLinkStreamBuffer::Acquire(NumFragments * FragmentSize);
+		reassembly->Data.GetArray().SetNumUninitialized(NumFragments * FragmentSize);
+		reassembly->Received.Init(false, NumFragments);
+		reassembly->NumFragments = NumFragments;
+		reassembly->StartedAt = Now;
+	}
+	if (reassembly->NumFragments != NumFragments || reassembly->Received[Fragment])
+	{
+		return;
+	}
+
+	FMemory::Memcpy(reassembly->Data.GetData() + Fragment * FragmentSize, Bytes, Length);
+	reassembly->Received[Fragment] = true;
+	reassembly->NumReceived++;
+	if (Fragment == NumFragments - 1)
+	{
+		reassembly->LastFragmentSize = Length;
+	}
+	if (reassembly->NumReceived < NumFragments)
+	{
+		return;
+	}
+
+	FLinkStreamBuffer message = MoveTemp(reassembly->Data);
+	message.GetArray().SetNum((NumFragments - 1) * FragmentSize + reassembly->LastFragmentSize, false);
+	Reassemblies.Remove(key);
+	CompleteMessage(Channel, Sequence, MoveTemp(message));
+}
+
+void FLinkStreamUdpSession::CompleteMessage(int32 Channel, uint32 Sequence, FLinkStreamBuffer&& Message)
+{
+	switch ((ELinkStreamDelivery)Channel)
+	{
+	case ELinkStreamDelivery::Unreliable:
+		DeliverMessage(MoveTemp(Message));
+		break;
+
+	case ELinkStreamDelivery::ReliableUnordered:
+	{
+		DeliverMessage(MoveTemp(Message));
+		uint32& next = NextExpected[Channel];
+		if (Sequence != next)
+		{
+			UnorderedAhead.Add(Sequence);
+			break;
+		}
+		next++;
+		while (UnorderedAhead.Remove(next) > 0)
+		{
+			next++;
+		}
+		break;
+	}
+
+	case ELinkStreamDelivery::ReliableOrdered:
+	{
+		uint32& next = NextExpected[Channel];
+		if (Sequence != next)
+		{
+			OrderedAhead.Add(Sequence, MoveTemp(Message));
+			break;
+		}
+		DeliverMessage(MoveTemp(Message));
+		next++;
+		while (FLinkStreamBuffer* waiting = OrderedAhead.Find(next))
+		{
+			DeliverMessage(MoveTemp(*waiting));
+			OrderedAhead.Remove(next);
+			next++;
+		}
+		break;
+	}
+	}
+}
+
+void FLinkStreamUdpSession::OnAcks(uint32 Largest, uint64 AckBits, double Now)
+{
+	if (SentPackets.Num() == 0)
+	{
+		return;
+	}
+
+	bool bAnyAcked = false;
+	for (int32 index = 0; index < SentPackets.Num(); )
+	{
+		FSentPacket& packet = SentPackets[index];
+		const uint32 distance = Largest - packet.Number;
+		const bool bAcked = distance == 0 || (!LinkStreamUdp::IsBefore(Largest, packet.Number) && distance <= 64 && (AckBits & (1ull << (distance - 1))) != 0);
+		if (!bAcked)
+		{
+			index++;
+			continue;
+		}
+
+		if (distance == 0)
+		{
+			UpdateRtt(Now - packet.SentAt);
+		}
+		for (const FFragmentRef& fragment : packet.Fragments)
+		{
+			OnFragmentAcked(fragment);
+		}
+
+		// Window growth stops while recovering from a loss: packets sent before it say nothing about the new window.
+		BytesInFlight -= packet.Size;
+		if (packet.SentAt > RecoveryStartTime)
+		{
+			CongestionWindow += CongestionWindow < SlowStartThreshold ? packet.Size : FMath::Max(1, MaxDatagramSize * packet.Size / CongestionWindow);
+		}
+		if (LinkStreamUdp::IsBefore(LargestAcked, packet.Number))
+		{
+			LargestAcked = packet.Number;
+		}
+		bAnyAcked = true;
+		SentPackets.RemoveAt(index, 1, false);
+	}
+	if (!bAnyAcked)
+	{
+		return;
+	}
+
+	LastAckTime = Now;
+	ConsecutiveTimeouts = 0;
+
+	// Lost: overtaken by PacketThreshold acknowledged packets, or by one acknowledged packet and 9/8 of a round trip.
+	const double lossDelay = 1.125 * FMath::Max(SmoothedRtt, LatestRtt);
+	for (int32 index = 0; index < SentPackets.Num(); )
+	{
+		FSentPacket& packet = SentPackets[index];
+		if (LinkStreamUdp::IsBefore(packet.Number, LargestAcked)
+			&& ((int32)(LargestAcked - packet.Number) >= LinkStreamUdp::PacketThreshold || Now - packet.SentAt > FMath::Max(lossDelay, 0.001)))
+		{
+			OnPacketLost(packet, Now);
+			SentPackets.RemoveAt(index, 1, false);
+			continue;
+		}
+		index++;
+	}
+	CongestionWindowBytes = CongestionWindow;
+}
+
+void FLinkStreamUdpSession::OnFragmentAcked(const FFragmentRef& Fragment)
+{
+	FSendMessage* message = SendMessages.Find(Fragment.MessageId);
+	if (!message || message->Acked[Fragment.Fragment])
+	{
+		return;
+	}
+	message->Acked[Fragment.Fragment] = true;
+	if (++message->NumAcked == message->NumFragments)
+	{
+		SendMessages.Remove(Fragment.MessageId);
+	}
+}
+
+void FLinkStreamUdpSession::OnPacketLost(FSentPacket& Packet, double Now)
+{
+	PacketsLost.Increment();
+	BytesInFlight -= Packet.Size;
+	for (const FFragmentRef& fragment : Packet.Fragments)
+	{
+		Retransmits.Add(fragment);
+	}
+
+	// One loss event per round trip: the packets lost alongside this one were sent before the window was cut.
+	if (Packet.SentAt > RecoveryStartTime)
+	{
+		RecoveryStartTime = Now;
+		CongestionWindow = FMath::Max(CongestionWindow / 2, LinkStreamUdp::MinWindow);
+		SlowStartThreshold = CongestionWindow;
+	}
+}
+
+void FLinkStreamUdpSession::UpdateRtt(double Sample)
+{
+	LatestRtt = Sample;
+	if (!bHasRtt)
+	{
+		SmoothedRtt = Sample;
+		RttVariance = Sample / 2.0;
+		bHasRtt = true;
+	}
+	else
+	{
+		RttVariance += (FMath::Abs(SmoothedRtt - Sample) - RttVariance) / 4.0;
+		SmoothedRtt += (Sample - SmoothedRtt) / 8.0;
+	}
+	SmoothedRttMs.store((float)(SmoothedRtt * 1000.0), std::memory_order_relaxed);
+}
@@ -0,0 +1,251 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "LinkStreamBuffer.h"
+#include "LinkStreamConnection.h"
+#include <atomic>
+
+/** Counters of one UDP session. */
+struct FLinkStreamUdpStats
+{
+	int64 PacketsSent = 0;
+	int64 PacketsReceived = 0;
+
+	/** Packets declared lost, by the reordering threshold or a retransmission timeout. */
+	int64 PacketsLost = 0;
+	int64 FragmentsRetransmitted = 0;
+
+	/** -1 until the first acknowledgement. */
+	float SmoothedRttMs = -1.f;
+	int32 CongestionWindow = 0;
+};
+
+/**
+ * Messages over one UDP flow: the transport behind udp:// connections, and the peer side of the benchmarks.
+ * Each message picks a delivery mode. Reliable messages are retransmitted until acknowledged; ordered ones
+ * are held back until every earlier ordered message is in, unordered ones are raised as soon as they are
+ * complete, so a loss only delays the messages it hit.
+ *
+ * Wire format, little-endian. Every datagram starts with a type byte:
+ *   Connect  magic:u32 token:u32                          sent by the initiator until answered
+ *   Accept   magic:u32 token:u32                          the responder's answer, echoing the token
+ *   Data     token:u32 packet:u32 largest:u32 acks:u64 frame*
+ *   Close    token:u32
+ * A frame is channel:u8 sequence:u32 fragment:u16 fragments:u16 length:u16 bytes, the channel being the
+ * ELinkStreamDelivery and the sequence counted per channel. Messages longer than FragmentSize are split.
+ * largest is the highest packet number received and bit i of acks stands for largest - 1 - i, so every
+ * packet repeats the fate of the previous 65 and a lost acknowledgement costs nothing. Packet 0 carries
+ * acknowledgements only and is not itself acknowledged.
+ *
+ * A packet is lost once one sent PacketThreshold later is acknowledged, or once nothing is acknowledged for
+ * a retransmission timeout; its reliable fragments go out again in new packets. Congestion control is NewReno
+ * counted in bytes: slow start, then one datagram more per round trip, halved at most once per round trip of losses.
+ *
+ * Not thread-safe: the thread that drives a session is the only one to call it, GetStats excepted.
+ */
+class FLinkStreamUdpSession
+{
+public:
+	/** Writes one datagram to the peer. Failures need no handling; the datagram counts as lost. */
+	typedef TFunction<void(const uint8* Data, int32 Size)> FSendDatagram;
+
+	/** Takes every complete message, the sender's envelope still in front of it. */
+	typedef TFunction<void(FLinkStreamBuffer&& Message)> FDeliverMessage;
+
+	/** Largest datagram sent. Small enough to cross any path without IP fragmentation. */
+	static constexpr int32 MaxDatagramSize = 1200;
+
+	static constexpr int32 DataHeaderSize = 1 + 4 + 4 + 4 + 8;
+	static constexpr int32 FrameHeaderSize = 1 + 4 + 2 + 2 + 2;
+
+	/** Bytes of a message carried by every fragment but its last. */
+	static constexpr int32 FragmentSize = MaxDatagramSize - DataHeaderSize - FrameHeaderSize;
+
+	/** True if Address uses the udp:// scheme. */
+	static bool IsUdpAddress(const FString& Address);
+
+	/** Address without its udp:// scheme. */
+	static FString GetHost(const FString& Address);
+
+	/**
+	 * Initiators open the session; responders wait for a Connect. Messages longer than InMaxMessageSize,
+	 * envelope included, are refused when queued and dropped when received.
+	 */
+	FLinkStreamUdpSession(bool bInInitiator, int32 InMaxMessageSize, FSendDatagram&& InSendDatagram, FDeliverMessage&& InDeliverMessage);
+
+	void Start(double Now);
+
+	/** Tells the peer the session ends, once and without waiting for an answer. */
+	void Close();
+
+	void ReceiveDatagram(const uint8* Data, int32 Size, double Now);
+
+	/** Takes Message whole; its header and payload are sent back to back. Returns false, leaving it untouched, if it is too long. */
+	bool Queue(FLinkStreamOutgoingMessage&& Message, ELinkStreamDelivery Delivery);
+
+	/** True while less than a congestion window of new data waits, so callers can keep the rest in their own, prioritised, queues. */
+	bool WantsMore() const { return UnsentBytes < CongestionWindow; }
+
+	/** Runs the timers and sends acknowledgements, retransmissions and new data as far as the congestion window allows. False once the peer is gone. */
+	bool Service(double Now);
+
+	/** When Service next has work of its own, MAX_dbl if only a datagram or a queued message can give it some. */
+	double GetNextTimer() const;
+
+	bool IsConnected() const { return State == EState::Connected; }
+	bool IsClosed() const { return State == EState::Closed; }
+
+	/** Any thread. */
+	FLinkStreamUdpStats GetStats() const;
+
+private:
+	enum class EState : uint8
+	{
+		Idle,
+		Handshaking,
+		Connected,
+		Closed
+	};
+
+	struct FFragmentRef
+	{
+		uint32 MessageId;
+		int32 Fragment;
+	};
+
+	struct FSendMessage
+	{
+		FLinkStreamOutgoingMessage Message;
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered;
+		uint32 Sequence = 0;
+		int32 Size = 0;
+		int32 NumFragments = 0;
+
+		/** First fragment never sent. */
+		int32 NextFragment = 0;
+
+		/** Reliable messages only. The message is released once every fragment is acknowledged. */
+		TBitArray<> Acked;
+		int32 NumAcked = 0;
+	};
+
+	struct FSentPacket
+	{
+		uint32 Number = 0;
+		double SentAt = 0.0;
+		int32 Size = 0;
+
+		/** Reliable fragments it carried, resent if it is lost. */
+		TArray<FFragmentRef, TInlineAllocator<4>> Fragments;
+	};
+
+	struct FReassembly
+	{
+		FLinkStreamBuffer Data;
+		TBitArray<> Received;
+		int32 NumFragments = 0;
+		int32 NumReceived = 0;
+		int32 LastFragmentSize = 0;
+		double StartedAt = 0.0;
+	};
+
+	bool IsReliable(int32 Channel) const { return Channel != (int32)ELinkStreamDelivery::Unreliable; }
+
+	void SendHandshake(uint8 Type);
+	void SendClose();
+
+	/** Sends as many packets as the congestion window and the queues allow, and an acknowledgement if one is owed. */
+	void SendPending(double Now);
+
+	/** Writes the next frame that fits into Packet, retransmissions first. Returns false if none does. */
+	bool WriteNextFrame(uint8* Packet, int32& InOutSize, FSentPacket& OutSent);
+
+	void WriteFrame(uint8* Packet, int32& InOutSize, const FSendMessage& Message, int32 Fragment) const;
+
+	void OnAcks(uint32 Largest, uint64 AckBits, double Now);
+	void OnFragmentAcked(const FFragmentRef& Fragment);
+	void OnPacketLost(FSentPacket& Packet, double Now);
+	void UpdateRtt(double Sample);
+	double GetRetransmitTimeout() const;
+
+	/** Marks Number received. Returns false if it was already. */
+	bool RecordReceived(uint32 Number);
+
+	void ReceiveFrames(const uint8* Data, int32 Size, double Now);
+	void ReceiveFragment(int32 Channel, uint32 Sequence, int32 Fragment, int32 NumFragments, const uint8* Bytes, int32 Length, double Now);
+	void CompleteMessage(int32 Channel, uint32 Sequence, FLinkStreamBuffer&& Message);
+
+	bool bInitiator;
+	int32 MaxMessageSize;
+	FSendDatagram SendDatagram;
+	FDeliverMessage DeliverMessage;
+
+	EState State = EState::Idle;
+	uint32 Token = 0;
+	double NextHandshakeAt = 0.0;
+
+	/** Sending. Messages are keyed by a session-wide ID; sequences are counted per channel. */
+	TMap<uint32, FSendMessage> SendMessages;
+	TArray<uint32> NewMessages;
+	TArray<FFragmentRef> Retransmits;
+	TArray<FSentPacket> SentPackets;
+	uint32 NextMessageId = 1;
+	uint32 NextSequence[3] = {};
+	uint32 NextPacketNumber = 1;
+	int32 UnsentBytes = 0;
+
+	/** Loss recovery and congestion control. */
+	uint32 LargestAcked = 0;
+	double LastAckTime = 0.0;
+	double SmoothedRtt = 0.0;
+	double RttVariance = 0.0;
+	double LatestRtt = 0.0;
+	bool bHasRtt = false;
+	int32 ConsecutiveTimeouts = 0;
+	int32 BytesInFlight = 0;
+	int32 CongestionWindow;
+	int32 SlowStartThreshold = MAX_int32;
+	double RecoveryStartTime = -1.0;
+
+	/** Receiving. NextExpected holds, per reliable channel, the lowest sequence not yet raised. */
+	uint32 LargestReceived = 0;
+	uint64 ReceivedBits = 0;
+	bool bAckPending = false;
+	uint32 NextExpected[2] = {};
+	TSet<uint32> UnorderedAhead;
+	TMap<uint32, FLinkStreamBuffer> OrderedAhead;
+	TMap<uint64, FReassembly> Reassemblies;
+
+	FThreadSafeCounter64 PacketsSent;
+	FThreadSafeCounter64 PacketsReceived;
+	FThreadSafeCounter64 PacketsLost;
+	FThreadSafeCounter64 FragmentsRetransmitted;
+	std::atomic<float> SmoothedRttMs{ -1.f };
+	std::atomic<int32> CongestionWindowBytes{ 0 };
+};
@@ -0,0 +1,166 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "LinkStreamWriter.h"
+
+void FLinkStreamWriter::WriteFloat(float Value, ELinkStreamByteOrder ByteOrder)
+{
+	uint32 Bits;
+	FMemory::Memcpy(&Bits, &Value, sizeof(float));
+	WriteInteger(Bits, ByteOrder);
+}
+
+void FLinkStreamWriter::WriteDouble(double Value, ELinkStreamByteOrder ByteOrder)
+{
+	uint64 Bits;
+	FMemory::Memcpy(&Bits, &Value, sizeof(double));
+	WriteInteger(Bits, ByteOrder);
+}
+
+void FLinkStreamWriter::WriteVarUInt(uint64 Value)
+{
+	do
+	{
+		uint8 Byte = Value & 0x7F;
+		Value >>= 7;
+		if (Value != 0)
+		{
+			Byte |= 0x80;
+		}
+		Buffer.Add(Byte);
+	} while (Value != 0);
+}
+
+int32 FLinkStreamWriter::GetUTF8Length(const FString& Value)
+{
+	return Value.Len() > 0 ? FPlatformString::ConvertedLength<UTF8CHAR>(*Value, Value.Len()) : 0;
+}
+
+void FLinkStreamWriter::WriteString(const FString& Value)
+{
+	const int32 Length = GetUTF8Length(Value);
+	if (Length == 0)
+	{
+		return;
+	}
+
+	// Convert straight into the message, no scratch buffer.
+	UTF8CHAR* Dest = (UTF8CHAR*)(Buffer.GetData() + Buffer.AddUninitialized(Length));
+	FPlatformString::Convert(Dest, Length, *Value, Value.Len());
+}
+
+void FLinkStreamWriter::WriteLengthPrefixedString(const FString& Value)
+{
+	const int32 Length = GetUTF8Length(Value);
+	WriteVarUInt((uint64)Length);
+	if (Length > 0)
+	{
+		UTF8CHAR* Dest = (UTF8CHAR*)(Buffer.GetData() + Buffer.AddUninitialized(Length));
+		FPlatformString::Convert(Dest, Length, *Value, Value.Len());
+	}
+}
+
+void FLinkStreamWriter::WriteBytes(const uint8* Data, int32 NumBytes)
+{
+	if (NumBytes > 0)
+	{
+		Buffer.Append(Data, NumBytes);
+	}
+}
+
+FLinkStreamWriter ULinkStreamWriterLibrary::MakeWriter(int32 Capacity)
+{
+	return FLinkStreamWriter(FMath::Max(Capacity, 0));
+}
+
+void ULinkStreamWriterLibrary::WriteByte(FLinkStreamWriter& Writer, uint8 Value)
+{
+	Writer.WriteInteger(Value);
+}
+
+void ULinkStreamWriterLibrary::WriteInt8(FLinkStreamWriter& Writer, int32 Value)
+{
+	Writer.WriteInteger((int8)Value);
+}
+
+void ULinkStreamWriterLibrary::WriteInt16(FLinkStreamWriter& Writer, int32 Value, ELinkStreamByteOrder ByteOrder)
+{
+	Writer.WriteInteger((int16)Value, ByteOrder);
+}
+
+void ULinkStreamWriterLibrary::WriteUInt16(FLinkStreamWriter& Writer, int32 Value, ELinkStreamByteOrder ByteOrder)
+{
+	Writer.WriteInteger((uint16)Value, ByteOrder);
+}
+
+void ULinkStreamWriterLibrary::WriteInt32(FLinkStreamWriter& Writer, int32 Value, ELinkStreamByteOrder ByteOrder)
+{
+	Writer.WriteInteger(Value, ByteOrder);
+}
+
+void ULinkStreamWriterLibrary::WriteUInt32(FLinkStreamWriter& Writer, int64 Value, ELinkStreamByteOrder ByteOrder)
+{
+	Writer.WriteInteger((uint32)Value, ByteOrder);
+}
+
+void ULinkStreamWriterLibrary::WriteInt64(FLinkStreamWriter& Writer, int64 Value, ELinkStreamByteOrder ByteOrder)
+{
+	Writer.WriteInteger(Value, ByteOrder);
+}
+
+void ULinkStreamWriterLibrary::WriteFloat(FLinkStreamWriter& Writer, float Value, ELinkStreamByteOrder ByteOrder)
+{
+	Writer.WriteFloat(Value, ByteOrder);
+}
+
+void ULinkStreamWriterLibrary::WriteDouble(FLinkStreamWriter& Writer, double Value, ELinkStreamByteOrder ByteOrder)
+{
+	Writer.WriteDouble(Value, ByteOrder);
+}
+
+void ULinkStreamWriterLibrary::WriteBool(FLinkStreamWriter& Writer, bool Value)
+{
+	Writer.WriteBool(Value);
+}
+
+void ULinkStreamWriterLibrary::WriteVarInt(FLinkStreamWriter& Writer, int64 Value)
+{
+	Writer.WriteVarUInt((uint64)Value);
+}
+
+void ULinkStreamWriterLibrary::WriteString(FLinkStreamWriter& Writer, const FString& Value)
+{
+	Writer.WriteString(Value);
+}
+
+void ULinkStreamWriterLibrary::WriteLengthPrefixedString(FLinkStreamWriter& Writer, const FString& Value)
+{
+	Writer.WriteLengthPrefixedString(Value);
+}
+
+void ULinkStreamWriterLibrary::WriteBytes(FLinkStreamWriter& Writer, const TArray<uint8>& Value)
+{
+	Writer.WriteBytes(Value.GetData(), Value.Num());
+}
@@ -26,12 +26,39 @@
 #pragma once
 
 #include "Modules/ModuleManager.h"
+#include "Misc/ScopeLock.h"
+
+LINKSTREAM_API DECLARE_LOG_CATEGORY_EXTERN(LogLinkStream, Log, All);
+
+class FLinkStreamReactorPool;
+class FLinkStreamBufferPool;
+class FLinkStreamInprocEndpoint;
 
 class FLinkStreamModule : public IModuleInterface
 {
 public:
+	FLinkStreamModule();
+	virtual ~FLinkStreamModule();
 
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+	static FLinkStreamModule& Get();
+
+	/** Recycled message buffers shared by every connection. Valid between StartupModule and ShutdownModule. */
+	FLinkStreamBufferPool& GetBufferPool() { return *BufferPool; }
+
+	/** Shared I/O threads for connections on the Reactor backend. Created on first use. */
+	FLinkStreamReactorPool& GetReactorPool();
+
+	/** The in-process endpoint called Name, created on first use. Endpoints live until ShutdownModule. */
+	FLinkStreamInprocEndpoint& FindOrCreateInprocEndpoint(const FString& Name);
+
+private:
+	TUniquePtr<FLinkStreamReactorPool> ReactorPool;
+	TUniquePtr<FLinkStreamBufferPool> BufferPool;
+	FCriticalSection ReactorPoolLock;
+	TMap<FString, TUniquePtr<FLinkStreamInprocEndpoint>> InprocEndpoints;
+	FCriticalSection InprocLock;
 };
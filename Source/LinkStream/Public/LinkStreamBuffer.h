@@ -0,0 +1,180 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include <atomic>
+#include "LinkStreamBuffer.generated.h"
+
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamBufferPoolStats
+{
+	GENERATED_BODY()
+
+	/** Acquisitions served from a pooled allocation. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Buffers")
+	int64 Hits = 0;
+
+	/** Acquisitions that had to allocate. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Buffers")
+	int64 Misses = 0;
+
+	/** Buffers that went back into the pool. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Buffers")
+	int64 Returned = 0;
+
+	/** Buffers freed instead of pooled because they were too small, too large or their size class was full. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Buffers")
+	int64 Discarded = 0;
+
+	/** Bytes currently idle in the pool. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Buffers")
+	int64 PooledBytes = 0;
+
+	/** Largest PooledBytes seen so far. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Buffers")
+	int64 HighWaterBytes = 0;
+};
+
+/**
+ * Size-classed free lists of byte arrays, owned by FLinkStreamModule.
+ * Classes are powers of two from 64 B to 1 MB. An array goes back to the largest class its capacity covers,
+ * so an allocation made anywhere (a Blueprint array, a writer) can be recycled by the receive path and vice versa.
+ */
+class LINKSTREAM_API FLinkStreamBufferPool
+{
+public:
+	static constexpr int32 MinClassShift = 6;
+	static constexpr int32 MaxClassShift = 20;
+	static constexpr int32 NumClasses = MaxClassShift - MinClassShift + 1;
+
+	FLinkStreamBufferPool();
+	~FLinkStreamBufferPool();
+
+	/** The module's pool. Null before the module starts and after it shuts down. */
+	static FLinkStreamBufferPool* Get() { return Instance; }
+
+	/** Returns an empty array whose capacity is at least MinCapacity. Thread-safe. */
+	TArray<uint8> AcquireArray(int32 MinCapacity);
+
+	/** Takes an array's allocation back. Thread-safe. */
+	void ReleaseArray(TArray<uint8>&& Array);
+
+	FLinkStreamBufferPoolStats GetStats() const;
+
+private:
+	friend class FLinkStreamModule;
+	static FLinkStreamBufferPool* Instance;
+
+	struct FSizeClass
+	{
+		FCriticalSection Lock;
+		TArray<TArray<uint8>> Free;
+		int32 MaxFree = 0;
+	};
+
+	FSizeClass Classes[NumClasses];
+
+	std::atomic<int64> Hits{ 0 };
+	std::atomic<int64> Misses{ 0 };
+	std::atomic<int64> Returned{ 0 };
+	std::atomic<int64> Discarded{ 0 };
+	std::atomic<int64> PooledBytes{ 0 };
+	std::atomic<int64> HighWaterBytes{ 0 };
+};
+
+/**
+ * Move-only handle to a message buffer. The allocation goes back to the module's pool when the handle dies,
+ * so a message travels producer -> outbox -> socket, or socket -> inbox -> handler, without being copied.
+ */
+class LINKSTREAM_API FLinkStreamBuffer
+{
+public:
+	FLinkStreamBuffer() = default;
+
+	/** Adopts an existing allocation. */
+	explicit FLinkStreamBuffer(TArray<uint8>&& InData)
+		: Data(MoveTemp(InData))
+	{
+	}
+
+	FLinkStreamBuffer(FLinkStreamBuffer&& Other) = default;
+
+	FLinkStreamBuffer& operator=(FLinkStreamBuffer&& Other)
+	{
+		if (this != &Other)
+		{
+			Release();
+			Data = MoveTemp(Other.Data);
+		}
+		return *this;
+	}
+
+	FLinkStreamBuffer(const FLinkStreamBuffer&) = delete;
+	FLinkStreamBuffer& operator=(const FLinkStreamBuffer&) = delete;
+
+	~FLinkStreamBuffer()
+	{
+		Release();
+	}
+
+	/** An empty buffer with room for at least MinCapacity bytes, from the pool when possible. */
+	static FLinkStreamBuffer Acquire(int32 MinCapacity)
+	{
+		return FLinkStreamBuffer(AcquireArray(MinCapacity));
+	}
+
+	/** Same as Acquire, for code that needs a plain array (for example a writer). */
+	static TArray<uint8> AcquireArray(int32 MinCapacity);
+
+	TArray<uint8>& GetArray() { return Data; }
+	const TArray<uint8>& GetArray() const { return Data; }
+	uint8* GetData() { return Data.GetData(); }
+	const uint8* GetData() const { return Data.GetData(); }
+	int32 Num() const { return Data.Num(); }
+
+	/** Gives up the allocation without returning it to the pool. */
+	TArray<uint8> Detach() { return MoveTemp(Data); }
+
+	/** Returns the allocation to the pool now. */
+	void Release();
+
+	/** Freezes Buffer for sharing. See FLinkStreamSharedBuffer. */
+	static TSharedRef<const FLinkStreamBuffer, ESPMode::ThreadSafe> Share(FLinkStreamBuffer&& Buffer)
+	{
+		return MakeShared<const FLinkStreamBuffer, ESPMode::ThreadSafe>(MoveTemp(Buffer));
+	}
+
+private:
+	TArray<uint8> Data;
+};
+
+/**
+ * An immutable message buffer that any number of queued messages, on any number of connections, point at.
+ * The allocation goes back to the pool once the last of them has been written or dropped.
+ */
+typedef TSharedRef<const FLinkStreamBuffer, ESPMode::ThreadSafe> FLinkStreamSharedBuffer;
@@ -0,0 +1,134 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "LinkStreamBuffer.h"
+#include "LinkStreamEnvelope.h"
+#include <atomic>
+#include "LinkStreamCompression.generated.h"
+
+/** Payload compression of an enveloped connection. The value is carried in the low two flag bits of each message's envelope. */
+UENUM(BlueprintType)
+enum class ELinkStreamCompression : uint8
+{
+	None,
+	/** Fastest, with a modest ratio. Suits most game traffic. */
+	LZ4,
+	/** Slower, with a better ratio on text such as JSON metadata. Every platform can decode it. */
+	Zlib,
+	/** The best ratio for its speed, but only peers built with Unreal can decode it. */
+	Oodle
+};
+
+/** Compression work of one connection, for tuning CompressionThreshold on real traffic. */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamCompressionStats
+{
+	GENERATED_BODY()
+
+	/** True once the peer confirmed it decodes the connection's Compression format. Nothing is compressed before. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	bool bNegotiated = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	int64 CompressedMessages = 0;
+
+	/** Messages at or above the threshold that did not shrink and were sent as they were. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	int64 IncompressibleMessages = 0;
+
+	/** Payload bytes of the compressed messages before and after compression. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	int64 UncompressedBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	int64 CompressedBytes = 0;
+
+	/** CompressedBytes / UncompressedBytes. 1 until something was compressed. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	float Ratio = 1.f;
+
+	/** Time spent compressing, incompressible attempts included, in milliseconds. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	float CompressTimeMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	int64 DecompressedMessages = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Compression")
+	float DecompressTimeMs = 0.f;
+};
+
+/**
+ * Payload compression through the engine's FCompression. A compressed payload is the original size as a varint
+ * followed by the compressed bytes, so the receiver allocates once and can refuse oversized payloads up front.
+ */
+struct LINKSTREAM_API FLinkStreamCompression
+{
+	/** Bit N is set for every format N this build can decode. Announced to the peer during negotiation. */
+	static uint8 GetDecodableFormats();
+
+	/** Compresses Size bytes of Data into OutPayload. Returns false if the format is unavailable or the result is not smaller. */
+	static bool Compress(ELinkStreamCompression Format, const uint8* Data, int32 Size, FLinkStreamBuffer& OutPayload);
+
+	/** Appends the original bytes of a payload made by Compress to OutMessage. Fails on a corrupt payload or one that would exceed MaxSize. */
+	static bool Decompress(ELinkStreamCompression Format, const uint8* Data, int32 Size, int32 MaxSize, TArray<uint8>& OutMessage);
+};
+
+/** Compression of one enveloped connection: the format the peer agreed to, and the counters behind its stats. */
+class LINKSTREAM_API FLinkStreamCompressor
+{
+public:
+	void Configure(ELinkStreamCompression InFormat, int32 InThreshold);
+
+	/** Formats the peer announced it decodes, one bit per ELinkStreamCompression. 0 until its hello arrives. */
+	void SetPeerFormats(uint8 Formats) { PeerFormats.store(Formats, std::memory_order_relaxed); }
+
+	/** Returns Message compressed and flags InOutEnvelope if it is due and shrinks, otherwise an empty buffer. Any thread. */
+	FLinkStreamBuffer Compress(const FLinkStreamBuffer& Message, FLinkStreamEnvelope& InOutEnvelope);
+
+	/** Restores a compressed message to its envelope with the flags cleared followed by the original payload. Returns false if it is corrupt. */
+	bool Decompress(FLinkStreamBuffer& Message, int32 MaxSize);
+
+	FLinkStreamCompressionStats GetStats() const;
+
+private:
+	bool IsNegotiated() const { return Format != ELinkStreamCompression::None && (PeerFormats.load(std::memory_order_relaxed) & (1 << (uint8)Format)) != 0; }
+
+	ELinkStreamCompression Format = ELinkStreamCompression::None;
+	int32 Threshold = 0;
+	std::atomic<uint8> PeerFormats{ 0 };
+
+	FThreadSafeCounter64 CompressedMessages;
+	FThreadSafeCounter64 IncompressibleMessages;
+	FThreadSafeCounter64 UncompressedBytes;
+	FThreadSafeCounter64 CompressedBytes;
+	FThreadSafeCounter64 CompressCycles;
+	FThreadSafeCounter64 DecompressedMessages;
+	FThreadSafeCounter64 DecompressCycles;
+};
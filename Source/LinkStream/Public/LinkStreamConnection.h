@@ -28,17 +28,266 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "HAL/Runnable.h"
+#include "HAL/CriticalSection.h"
 #include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
 #include "Containers/Queue.h"
+#include "Containers/ArrayView.h"
+#include "Async/Future.h"
+#include "Engine/LatentActionManager.h"
+#include "Math/RandomStream.h"
 #include "UObject/WeakObjectPtrTemplates.h"
+#include "LinkStreamBuffer.h"
+#include "LinkStreamEnvelope.h"
+#include "LinkStreamFraming.h"
+#include "LinkStreamInbox.h"
+#include "LinkStreamCompression.h"
+#include "LinkStreamDelta.h"
+#include "LinkStreamHeartbeat.h"
+#include "LinkStreamInproc.h"
+#include "LinkStreamMpscQueue.h"
+#include "LinkStreamReactor.h"
+#include "LinkStreamWriter.h"
+#include <atomic>
 #include "LinkStreamConnection.generated.h"
 
 DECLARE_DYNAMIC_DELEGATE_OneParam(FTcpSocketDisconnectDelegate, int32, ConnectionId);
 DECLARE_DYNAMIC_DELEGATE_OneParam(FTcpSocketConnectDelegate, int32, ConnectionId);
 DECLARE_DYNAMIC_DELEGATE_TwoParams(FTcpSocketReceivedMessageDelegate, int32, ConnectionId, UPARAM(ref) TArray<uint8>&, Message);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FLinkStreamSendBackpressureDelegate, int32, ConnectionId, bool, bBackpressured);
 
+UENUM(BlueprintType)
+enum class ELinkStreamConnectionState : uint8
+{
+	/** A connect attempt is in flight. */
+	Connecting,
+	Connected,
+	/** The link dropped or an attempt failed, and the worker is waiting out its backoff before trying again. */
+	Reconnecting,
+	/** The connection could not be established and will not be retried. */
+	Failed,
+	/** The connection was closed and will not be retried. */
+	Disconnected
+};
+
+UENUM(BlueprintType)
+enum class ELinkStreamReconnectOutbox : uint8
+{
+	/** Messages not yet fully written when the link dropped are sent again, from their first byte, once reconnected. */
+	Replay,
+	/** Messages not yet fully written when the link dropped are discarded. Messages queued while reconnecting are kept. */
+	Drop
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FLinkStreamConnectionStateDelegate, int32, ConnectionId, ELinkStreamConnectionState, State);
+
+UENUM(BlueprintType)
+enum class ELinkStreamRequestResult : uint8
+{
+	Success,
+	/** No response arrived within the request's timeout. */
+	TimedOut,
+	/** The connection closed or dropped before the response arrived. */
+	Disconnected,
+	/** The request could not be queued: unknown or closed connection, no envelope, or too large. */
+	SendFailed
+};
+
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamResponse
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Request")
+	int32 ConnectionId = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Request")
+	int32 RequestId = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Request")
+	ELinkStreamRequestResult Result = ELinkStreamRequestResult::SendFailed;
+
+	/** The response payload, envelope removed. Empty unless Result is Success. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Request")
+	TArray<uint8> Payload;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FLinkStreamResponseDelegate, const FLinkStreamResponse&, Response);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FLinkStreamRequestDelegate, int32, ConnectionId, int32, RequestId, const TArray<uint8>&, Message);
+
+UENUM(BlueprintType)
+enum class ELinkStreamBackend : uint8
+{
+	/** Every connection owns a worker thread that polls its socket every TimeBetweenTicks. */
+	Thread,
+	/** Connections are multiplexed over the module's shared reactor threads. */
+	Reactor
+};
+
+UENUM(BlueprintType)
+enum class ELinkStreamWakeMode : uint8
+{
+	/** The worker sleeps TimeBetweenTicks between polls. Latency is bounded by the timer. */
+	Polled,
+	/** The worker blocks until the socket is readable or a message is queued. Latency is bounded by the kernel. */
+	EventDriven
+};
+
+UENUM(BlueprintType)
+enum class ELinkStreamDispatchMode : uint8
+{
+	/** Every received message posts its own game-thread task that raises OnMessageReceived. */
+	PerMessage,
+	/** Workers only queue. Tick drains every connection's inbox once per frame within the dispatch budget. */
+	Batched
+};
+
+UENUM(BlueprintType)
+enum class ELinkStreamFlushMode : uint8
+{
+	/** Queued messages are written as soon as the worker wakes. */
+	Immediate,
+	/** Messages queued during a frame are gathered and written once, after every actor has ticked. */
+	PerFrame
+};
+
+/** Outbound lanes. Each has its own queue; a message never waits behind one of a lower lane that has not started. */
+UENUM(BlueprintType)
+enum class ELinkStreamPriority : uint8
+{
+	/** Small, time-critical messages such as transaction signatures. */
+	Control,
+	Interactive,
+	/** Telemetry, assets and anything else that can wait. */
+	Bulk
+};
+
+constexpr int32 LinkStreamNumLanes = 3;
+
+/** Bytes an encrypted connection adds in front of a frame (the sequence number) and behind it (the GCM tag). */
+constexpr int32 LinkStreamSealPrefixSize = 8;
+constexpr int32 LinkStreamSealTagSize = 16;
+
+/** What a udp:// connection guarantees for a message. TCP and inproc connections deliver everything reliably and in order. */
+UENUM(BlueprintType)
+enum class ELinkStreamDelivery : uint8
+{
+	/** Retransmitted until acknowledged, and raised in the order it was sent. A loss holds back later messages. */
+	ReliableOrdered,
+	/** Retransmitted until acknowledged, and raised as soon as it is complete. */
+	ReliableUnordered,
+	/** Sent once. Lost, or raised as soon as it is complete. Use it for state that the next message supersedes. */
+	Unreliable
+};
+
+/** Queue depth and throughput of one outbound lane of a connection. */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamLaneStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	ELinkStreamPriority Priority = ELinkStreamPriority::Interactive;
+
+	/** Messages queued and not yet completely written. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	int32 QueuedMessages = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	int64 QueuedBytes = 0;
+
+	/** Highest QueuedMessages seen since the connection was opened. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	int32 PeakQueuedMessages = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	int64 SentMessages = 0;
+};
+
+/** The TLS session of one connection, and how its handshakes went. */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamTlsStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Security")
+	bool bEstablished = false;
+
+	/** Whether the current session resumed an earlier one instead of running the full handshake. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Security")
+	bool bResumed = false;
+
+	/** Such as TLSv1.3. Empty until established. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Security")
+	FString Protocol;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Security")
+	FString CipherSuite;
+
+	/** From link-up to the end of the latest handshake, in milliseconds. -1 until one completes. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Security")
+	float HandshakeTimeMs = -1.f;
+
+	/** Handshakes completed since the connection was opened, one per link-up, and how many of them resumed. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Security")
+	int64 Handshakes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Security")
+	int64 ResumedHandshakes = 0;
+};
+
+/** Socket syscalls made by every LinkStream connection in the process since startup. */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamSyscallStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	int64 Recv = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	int64 Send = 0;
+
+	/** fcntl, ioctl, setsockopt, getsockopt and epoll_ctl. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	int64 Control = 0;
+
+	/** Poller waits and wakeup signals and drains. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Stats")
+	int64 Poll = 0;
+
+	int64 GetTotal() const { return Recv + Send + Control + Poll; }
+};
+
+/** Game-thread side of FTcpSocketWorker. Implemented by the actors that own workers. */
+class ILinkStreamWorkerOwner
+{
+public:
+	virtual ~ILinkStreamWorkerOwner() {}
+
+	/** The object whose lifetime gates every callback. Callbacks are dropped once it is gone. */
+	virtual UObject* GetWorkerOwnerObject() = 0;
+
+	virtual void OnWorkerConnected(int32 WorkerId) = 0;
+	virtual void OnWorkerDisconnected(int32 WorkerId) = 0;
+	virtual void OnWorkerMessage(int32 WorkerId) = 0;
+	virtual void OnWorkerSendBackpressure(int32 WorkerId, bool bBackpressured) = 0;
+
+	/** Raised on every connection-state transition. Optional. */
+	virtual void OnWorkerStateChanged(int32 WorkerId, ELinkStreamConnectionState State) {}
+};
+
+/**
+ * Client connections to LinkStream peers, each serviced by an FTcpSocketWorker.
+ *
+ * Threading. Safe from any thread: SendData, SendWriter, SendDataBatch, BroadcastData, SendResponse, isConnected,
+ * GetConnectionState, GetPendingSendBytes, GetLaneStats, GetHeartbeatStats, GetInboxStats, GetCompressionStats, GetDeltaStats, GetTlsStats and the static helpers. Everything else is game thread
+ * only: Connect, Disconnect, the SendRequest family, GetPendingInboxCount and property changes. Delegates and
+ * events are always raised on the game thread.
+ */
 UCLASS(Blueprintable, BlueprintType)
-class LINKSTREAM_API ALinkStreamConnection : public AActor
+class LINKSTREAM_API ALinkStreamConnection : public AActor, public ILinkStreamWorkerOwner
 {
 	GENERATED_BODY()
 	
@@ -53,17 +302,76 @@ protected:
 public:	
 	virtual void Tick(float DeltaTime) override;
 
+	/**
+	 * ipAddress may also be inproc://<name> to reach the hosted .NET runtime without a socket, in which case port is ignored,
+	 * or udp://<host> to speak the LinkStream UDP protocol, serviced by the reactor whatever Backend says. Game thread.
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Socket")
 	void Connect(const FString& ipAddress, int32 port, 
 		const FTcpSocketDisconnectDelegate& OnDisconnected, const FTcpSocketConnectDelegate& OnConnected,
 		const FTcpSocketReceivedMessageDelegate& OnMessageReceived, int32& ConnectionId);
 
+	/** Game thread. */
 	UFUNCTION(BlueprintCallable, Category = "Socket")
 	void Disconnect(int32 ConnectionId);
 
 
+	/**
+	 * Priority picks the outbound lane. Messages within a lane keep their order; across lanes they do not.
+	 * Delivery only matters on udp:// connections, where ordering holds among ReliableOrdered messages only.
+	 * Any thread: concurrent senders share the lane's lock-free outbox. Fails if the lane holds OutboxCapacity messages.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Socket")
+	bool SendData(int32 ConnectionId, TArray<uint8> DataToSend, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive,
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	/** Sends the message built in Writer. The buffer is moved, not copied, so Writer is empty afterwards. Any thread. */
+	UFUNCTION(BlueprintCallable, Category = "Socket")
+	bool SendWriter(int32 ConnectionId, UPARAM(ref) FLinkStreamWriter& Writer, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive,
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	/**
+	 * Queues Messages back to back on one lane with a single claim on its outbox, so no other sender's message lands
+	 * between them. All or nothing: on failure Messages are left as they were. Any thread.
+	 */
+	bool SendDataBatch(int32 ConnectionId, TArrayView<FLinkStreamBuffer> Messages, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive,
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	/**
+	 * Sends one message to every connection in ConnectionIds. The payload is stored once and shared by every
+	 * recipient's queue, so the cost does not grow with its size times the recipients. Returns how many connections
+	 * queued it; the others are logged like a failed SendData. Any thread.
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Socket")
-	bool SendData(int32 ConnectionId, TArray<uint8> DataToSend);
+	int32 BroadcastData(const TArray<int32>& ConnectionIds, TArray<uint8> DataToSend, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive,
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	/** BroadcastData for C++, with a payload made by FLinkStreamBuffer::Share that may also be broadcast again later. Any thread. */
+	int32 BroadcastShared(TArrayView<const int32> ConnectionIds, const FLinkStreamSharedBuffer& Payload, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive,
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	/**
+	 * Sends Data as a request and returns its correlation ID, or 0 if it could not be queued. The outcome is raised
+	 * as OnResponseReceived. Any number of requests may be in flight on one connection. Needs bUseEnvelope. Game thread.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Socket|Request")
+	int32 SendRequest(int32 ConnectionId, TArray<uint8> Data, float TimeoutSeconds = 10.f, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive);
+
+	/** Sends Data as a request and resumes on the exec pin matching the outcome. Game thread. */
+	UFUNCTION(BlueprintCallable, Category = "Socket|Request", meta = (Latent, LatentInfo = "LatentInfo", ExpandEnumAsExecs = "Result"))
+	void SendRequestAndWait(int32 ConnectionId, TArray<uint8> Data, float TimeoutSeconds, ELinkStreamPriority Priority, TArray<uint8>& Response, ELinkStreamRequestResult& Result, FLatentActionInfo LatentInfo);
+
+	/** SendRequest for C++. Game thread. The future is fulfilled on the game thread; OnResponseReceived is raised as well. */
+	TFuture<FLinkStreamResponse> SendRequestAsync(int32 ConnectionId, TArray<uint8> Data, float TimeoutSeconds = 10.f,
+		ELinkStreamPriority Priority = ELinkStreamPriority::Interactive, int32* OutRequestId = nullptr);
+
+	/** Answers a request raised by OnRequestReceived. Any thread. */
+	UFUNCTION(BlueprintCallable, Category = "Socket|Request")
+	bool SendResponse(int32 ConnectionId, int32 RequestId, TArray<uint8> Data, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive);
+
+	/** Requests sent by this actor and not yet answered, timed out or failed. Game thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Request")
+	int32 GetPendingRequestCount() const { return PendingRequests.Num(); }
 
 	
 	//UFUNCTION(Category = "Socket")	
@@ -75,11 +383,31 @@ public:
 	//UFUNCTION(Category = "Socket")
 	void ExecuteOnMessageReceived(int32 ConnectionId, TWeakObjectPtr<ALinkStreamConnection> thisObj);
 
+	void ExecuteOnSendBackpressure(int32 ConnectionId, bool bBackpressured, TWeakObjectPtr<ALinkStreamConnection> thisObj);
+
+	void ExecuteOnConnectionStateChanged(int32 ConnectionId, ELinkStreamConnectionState State, TWeakObjectPtr<ALinkStreamConnection> thisObj);
+
+	/** Raised on every state transition of a connection. Reconnecting is raised once per outage, not once per attempt. */
+	UPROPERTY(BlueprintAssignable, Category = "Socket|Connect")
+	FLinkStreamConnectionStateDelegate OnConnectionStateChanged;
+
+	/** Raised once for every SendRequest: on the response, its timeout, or the loss of its connection. */
+	UPROPERTY(BlueprintAssignable, Category = "Socket|Request")
+	FLinkStreamResponseDelegate OnResponseReceived;
+
+	/** Raised for requests sent by the peer. Answer them with SendResponse. */
+	UPROPERTY(BlueprintAssignable, Category = "Socket|Request")
+	FLinkStreamRequestDelegate OnRequestReceived;
+
+	/** Raised with true when a connection's unsent bytes reach SendHighWatermark, and with false once they drain to SendLowWatermark. */
+	UPROPERTY(BlueprintAssignable, Category = "Socket|Send")
+	FLinkStreamSendBackpressureDelegate OnSendBackpressure;
+
 	/*UFUNCTION(BlueprintPure, meta = (DisplayName = "Append Bytes", CommutativeAssociativeBinaryOperator = "true"), Category = "Socket")
 	static TArray<uint8> Concat_BytesBytes(const TArray<uint8>& A, const TArray<uint8>& B);*/
 
 	UFUNCTION(BlueprintPure, meta = (DisplayName = "Append Bytes", CommutativeAssociativeBinaryOperator = "true"), Category = "Socket")
-	static TArray<uint8> Concat_BytesBytes(TArray<uint8> A, TArray<uint8> B);
+	static TArray<uint8> Concat_BytesBytes(const TArray<uint8>& A, const TArray<uint8>& B);
 
 	UFUNCTION(BlueprintPure, meta = (DisplayName = "Int To Bytes", CompactNodeTitle = "->", Keywords = "cast convert", BlueprintAutocast), Category = "Socket")
 	static TArray<uint8> Conv_IntToBytes(int32 InInt);
@@ -93,26 +421,96 @@ public:
 	UFUNCTION(BlueprintPure, meta = (DisplayName = "Byte To Bytes", CompactNodeTitle = "->", Keywords = "cast convert", BlueprintAutocast), Category = "Socket")
 	static TArray<uint8> Conv_ByteToBytes(uint8 InByte);
 
+	/**
+	 * The Message_Read nodes read at ReadOffset and advance it, leaving the bytes in place. Once the whole message has been
+	 * read it is emptied and ReadOffset goes back to 0, so a chain of reads costs one pass over the message.
+	 */
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Int", Keywords = "read int"), Category = "Socket")
-	static int32 Message_ReadInt(UPARAM(ref) TArray<uint8>& Message);
+	static int32 Message_ReadInt(UPARAM(ref) TArray<uint8>& Message, UPARAM(ref) int32& ReadOffset);
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Byte", Keywords = "read byte int8 uint8"), Category = "Socket")
-	static uint8 Message_ReadByte(UPARAM(ref) TArray<uint8>& Message);
+	static uint8 Message_ReadByte(UPARAM(ref) TArray<uint8>& Message, UPARAM(ref) int32& ReadOffset);
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Bytes", Keywords = "read bytes"), Category = "Socket")
-	static bool Message_ReadBytes(int32 NumBytes, UPARAM(ref) TArray<uint8>& Message, TArray<uint8>& ReturnArray);
+	static bool Message_ReadBytes(int32 NumBytes, UPARAM(ref) TArray<uint8>& Message, UPARAM(ref) int32& ReadOffset, TArray<uint8>& ReturnArray);
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Float", Keywords = "read float"), Category = "Socket")
-	static float Message_ReadFloat(UPARAM(ref) TArray<uint8>& Message);
+	static float Message_ReadFloat(UPARAM(ref) TArray<uint8>& Message, UPARAM(ref) int32& ReadOffset);
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read String", Keywords = "read string"), Category = "Socket")
-	static FString Message_ReadString(UPARAM(ref) TArray<uint8>& Message, int32 StringLength);
+	static FString Message_ReadString(UPARAM(ref) TArray<uint8>& Message, UPARAM(ref) int32& ReadOffset, int32 StringLength);
 
+	/** Any thread. */
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket")
 	bool isConnected(int32 ConnectionId);
 
+	/** Failed for an unknown ConnectionId. Any thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Connect")
+	ELinkStreamConnectionState GetConnectionState(int32 ConnectionId) const;
+
+	/** Bytes queued on a connection and not yet accepted by the kernel, framing headers included. Any thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Send")
+	int64 GetPendingSendBytes(int32 ConnectionId) const;
+
+	/** One entry per lane, Control first. Empty for an unknown ConnectionId. Inproc connections have a single queue and report nothing. Any thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Stats")
+	TArray<FLinkStreamLaneStats> GetLaneStats(int32 ConnectionId) const;
+
+	/** Round-trip time and liveness of a connection. Defaults for an unknown ConnectionId or an inproc connection. Any thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Heartbeat")
+	FLinkStreamHeartbeatStats GetHeartbeatStats(int32 ConnectionId) const;
+
+	/** Messages received by every connection of this actor and not yet raised as OnMessageReceived. Game thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Dispatch")
+	int32 GetPendingInboxCount() const;
+
+	/** Depth, drops and coalesces of a connection's inbox. Inproc connections report their depth only. Any thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Dispatch")
+	FLinkStreamInboxStats GetInboxStats(int32 ConnectionId) const;
+
+	/** Whether compression was negotiated on a connection, and what it saved at what cost. Defaults for an unknown ConnectionId. Any thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Compression")
+	FLinkStreamCompressionStats GetCompressionStats(int32 ConnectionId) const;
+
+	/** Bandwidth saved by delta encoding on a connection, and how often baselines were rebuilt. Defaults for an unknown ConnectionId. Any thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Delta")
+	FLinkStreamDeltaStats GetDeltaStats(int32 ConnectionId) const;
+
+	/** Whether a connection's TLS session is up, whether it was resumed, and how long its handshake took. Defaults for an unknown ConnectionId. Any thread. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Security")
+	FLinkStreamTlsStats GetTlsStats(int32 ConnectionId) const;
+
+	/** Any thread. Off the game thread errors go to the output log only, never the message log. */
 	static void PrintToConsole(FString Str, bool Error);
 
+	/**
+	 * Hands queued messages to Deliver round robin across Workers, one per worker per pass, within the budget.
+	 * InOutNextIndex carries the starting worker across frames. Returns true if the budget ran out.
+	 */
+	static bool DispatchWorkerInboxes(TMap<int32, TSharedRef<class FTcpSocketWorker>>& Workers, TFunctionRef<void(int32, FLinkStreamBuffer&)> Deliver,
+		int32 MaxMessages, float MaxTimeMs, int32& InOutNextIndex);
+
+	/** ILinkStreamWorkerOwner implementation */
+	virtual UObject* GetWorkerOwnerObject() override { return this; }
+	virtual void OnWorkerConnected(int32 WorkerId) override;
+	virtual void OnWorkerDisconnected(int32 WorkerId) override;
+	virtual void OnWorkerMessage(int32 WorkerId) override;
+	virtual void OnWorkerSendBackpressure(int32 WorkerId, bool bBackpressured) override;
+	virtual void OnWorkerStateChanged(int32 WorkerId, ELinkStreamConnectionState State) override;
+
+	/** Hit/miss counters and high-water mark of the module's message buffer pool. */
+	UFUNCTION(BlueprintPure, Category = "Socket|Buffers")
+	static FLinkStreamBufferPoolStats GetBufferPoolStats();
+
+	UFUNCTION(BlueprintPure, Category = "Socket|Stats")
+	static FLinkStreamSyscallStats GetSyscallStats();
+
+	/** Drops the first NumBytes of a message, such as the envelope in front of its payload. */
+	static void ConsumeMessageFront(TArray<uint8>& Message, int32 NumBytes);
+
+	/** Moves ReadOffset to NewOffset after a Message_Read node, emptying the message once all of it has been read. */
+	static void AdvanceMessageRead(TArray<uint8>& Message, int32& ReadOffset, int32 NewOffset);
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket")
 	int32 SendBufferSize = 16384;
 
@@ -122,63 +520,700 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket")
 	float TimeBetweenTicks = 0.008f;
 
+	/** How connections opened by this actor are serviced. Read when Connect is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket")
+	ELinkStreamBackend Backend = ELinkStreamBackend::Thread;
+
+	/** How a Thread backend worker waits for work. Reactor connections are always event driven. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket")
+	ELinkStreamWakeMode WakeMode = ELinkStreamWakeMode::EventDriven;
+
+	/** Seconds a connect attempt may take before it counts as failed. 0 waits for the OS timeout. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Connect", meta = (ClampMin = "0"))
+	float ConnectTimeout = 5.f;
+
+	/** Retries failed connects and dropped links with exponential backoff instead of ending the connection. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Connect")
+	bool bAutoReconnect = false;
+
+	/** Delay before the first retry, in seconds. Doubles with every failed attempt. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Connect", meta = (ClampMin = "0", EditCondition = "bAutoReconnect"))
+	float ReconnectInitialDelay = 0.5f;
+
+	/** Longest delay between retries, in seconds. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Connect", meta = (ClampMin = "0", EditCondition = "bAutoReconnect"))
+	float ReconnectMaxDelay = 30.f;
+
+	/** Fraction of each delay that is randomized, so clients of a restarted server do not retry in lockstep. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Connect", meta = (ClampMin = "0", ClampMax = "1", EditCondition = "bAutoReconnect"))
+	float ReconnectJitter = 0.5f;
+
+	/** Retries per outage before the connection fails. 0 retries forever. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Connect", meta = (ClampMin = "0", EditCondition = "bAutoReconnect"))
+	int32 MaxReconnectAttempts = 0;
+
+	/** What happens to unsent messages when the link drops. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Connect", meta = (EditCondition = "bAutoReconnect"))
+	ELinkStreamReconnectOutbox ReconnectOutbox = ELinkStreamReconnectOutbox::Replay;
+
+	/** How received messages reach the game thread. Read when Connect is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch")
+	ELinkStreamDispatchMode DispatchMode = ELinkStreamDispatchMode::PerMessage;
+
+	/** Batched mode: most messages raised per frame across all connections. 0 means no limit. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch", meta = (ClampMin = "0"))
+	int32 MaxMessagesPerFrame = 256;
+
+	/** Batched mode: most time spent raising messages per frame, in milliseconds. 0 means no limit. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch", meta = (ClampMin = "0"))
+	float MaxDispatchTimeMs = 2.f;
+
+	/** Batched mode: total of messages left queued at the end of a frame because the budget ran out. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Socket|Dispatch")
+	int64 DeferredMessageCount = 0;
+
+	/**
+	 * Most received messages a connection holds for the game thread before InboxOverflow applies, so a hitch cannot
+	 * grow memory without bound. 0 means no limit. On inproc connections the managed side's sends fail at the limit,
+	 * whatever InboxOverflow says. Read when Connect is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch", meta = (ClampMin = "0"))
+	int32 InboxLimit = 0;
+
+	/** What happens to received messages while a connection's inbox is at InboxLimit. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch")
+	ELinkStreamInboxOverflow InboxOverflow = ELinkStreamInboxOverflow::PauseReceive;
+
+	/**
+	 * Coalesce mode: bytes at the front of a payload, after the envelope, that identify what it updates. Requests and
+	 * responses are never coalesced, nor are payloads shorter than the key.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch", meta = (ClampMin = "1", ClampMax = "8"))
+	int32 CoalesceKeySize = 4;
+
+	/** When queued messages are written to the socket. Read when Connect is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send")
+	ELinkStreamFlushMode FlushMode = ELinkStreamFlushMode::Immediate;
+
+	/** Disables Nagle's algorithm so small messages leave at once. Latency first. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send")
+	bool bNoDelay = false;
+
+	/** Corks the socket while a batch is written so it leaves in full segments. Throughput first. No effect on Windows. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send")
+	bool bCork = false;
+
+	/** Unsent bytes at which OnSendBackpressure(true) is raised. 0 disables backpressure events. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "0"))
+	int32 SendHighWatermark = 1024 * 1024;
+
+	/** Unsent bytes at which OnSendBackpressure(false) is raised after backpressure began. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "0"))
+	int32 SendLowWatermark = 256 * 1024;
+
+	/** Hard cap on unsent bytes per connection. SendData fails instead of queuing past it. 0 means no limit. Read when Connect is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "0"))
+	int32 MaxPendingSendBytes = 16 * 1024 * 1024;
+
+	/**
+	 * Share of messages each lane gets while several have messages waiting: with 16/4/1, Bulk still sends one message
+	 * for every 16 Control and 4 Interactive ones, so no lane starves. Read when Connect is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "1"))
+	int32 ControlLaneWeight = 16;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "1"))
+	int32 InteractiveLaneWeight = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "1"))
+	int32 BulkLaneWeight = 1;
+
+	/**
+	 * Most messages each lane of a connection holds before SendData fails. Rounded up to a power of two. An inproc
+	 * connection's single queue holds this many in total. Read when Connect is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "2"))
+	int32 OutboxCapacity = 1024;
+
+	/** How the byte stream is cut into messages. With a framed mode every OnMessageReceived carries exactly one complete message. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Framing")
+	ELinkStreamFraming Framing = ELinkStreamFraming::None;
+
+	/** Largest payload accepted in framed mode, in bytes. A peer announcing a bigger frame is disconnected. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Framing", meta = (ClampMin = "1"))
+	int32 MaxFrameSize = 1024 * 1024;
+
+	/**
+	 * Prefixes every message with a LinkStream envelope so requests and responses can be told apart and matched.
+	 * Needed by SendRequest. Both peers must agree, and the stream must be framed. Read when Connect is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Request")
+	bool bUseEnvelope = false;
+
+	/**
+	 * Seconds between heartbeats. A ping is sent only when nothing else arrived during the interval, plus every fourth
+	 * interval to keep the round-trip time current. The peer's worker answers it. Needs bUseEnvelope. 0 disables.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "0"))
+	float HeartbeatInterval = 0.f;
+
+	/**
+	 * Seconds without receiving anything after which the link counts as dead: it is closed, or reconnected with
+	 * bAutoReconnect. With heartbeats, a few intervals. 0 disables. Read when Connect is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "0"))
+	float IdleTimeout = 0.f;
+
+	/** Lets the kernel probe quiet links, so a vanished peer is noticed even by a connection that neither sends nor pings. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat")
+	bool bTcpKeepAlive = false;
+
+	/** Seconds of silence before the first keepalive probe. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "1", EditCondition = "bTcpKeepAlive"))
+	int32 TcpKeepAliveIdle = 30;
+
+	/** Seconds between unanswered probes. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "1", EditCondition = "bTcpKeepAlive"))
+	int32 TcpKeepAliveInterval = 5;
+
+	/** Unanswered probes before the kernel drops the link. Ignored on Windows. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "1", EditCondition = "bTcpKeepAlive"))
+	int32 TcpKeepAliveProbes = 3;
+
+	/**
+	 * Compresses sent messages of at least CompressionThreshold bytes, each flagged in its envelope so small and
+	 * incompressible messages still go out as they are. Needs bUseEnvelope. The format is offered to the peer on
+	 * link-up, and nothing is compressed until it confirms it can decode it, so older peers keep working.
+	 * Batches and broadcasts are never compressed. Received messages are decompressed whatever this is set to.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Compression")
+	ELinkStreamCompression Compression = ELinkStreamCompression::None;
+
+	/** Smallest payload worth compressing, in bytes. Below a few hundred bytes the envelope flag rarely pays for the CPU time. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Compression", meta = (ClampMin = "1"))
+	int32 CompressionThreshold = 1024;
+
+	/**
+	 * Sends each plain message as a delta against the previous one with the same key, the first DeltaKeySize bytes of
+	 * its payload, so periodic state costs only the bytes that changed. Needs bUseEnvelope, and applies to
+	 * ReliableOrdered sends only; keep a key's updates on one lane. Used once the peer confirms it decodes deltas.
+	 * A delta the peer cannot apply is dropped there and the key's next message goes whole. Read when Connect is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Delta")
+	bool bDeltaEncoding = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Delta", meta = (ClampMin = "1", ClampMax = "8", EditCondition = "bDeltaEncoding"))
+	int32 DeltaKeySize = 4;
+
+	/** Every this many messages per key, one goes whole, bounding how long a lost baseline goes unnoticed. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Delta", meta = (ClampMin = "1", EditCondition = "bDeltaEncoding"))
+	int32 DeltaKeyframeInterval = 32;
+
+	/**
+	 * Encrypts and authenticates every frame with AES-256-GCM under keys agreed afresh on each link-up. Frames are
+	 * numbered, and a replayed or altered one closes the connection. Both peers must agree, and the stream must be
+	 * framed; Connect fails for unframed, udp:// and inproc:// connections rather than sending in the clear. Read
+	 * when Connect is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security")
+	bool bEncrypt = false;
+
+	/**
+	 * Secret both peers know, mixed into the session keys. Without one the keys still defeat eavesdropping, but not an
+	 * attacker who sits in the middle from the first byte.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security", meta = (EditCondition = "bEncrypt"))
+	FString EncryptionKey;
+
+	/**
+	 * Speaks TLS 1.2 or later over TCP connections, for peers reached across a network, such as a remote signing
+	 * service or an ALinkStreamListener with bTls. The handshake runs on the connection's I/O thread once the socket
+	 * is connected, and messages queued meanwhile wait for it. Reconnects to the same address resume the previous
+	 * session, skipping the certificate exchange. Takes the place of bEncrypt. Connect fails for udp:// and inproc://
+	 * addresses rather than sending in the clear. Read when Connect is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security")
+	bool bTls = false;
+
+	/** Name the server's certificate must be issued to. Empty means the address passed to Connect. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security", meta = (EditCondition = "bTls"))
+	FString TlsServerName;
+
+	/**
+	 * Checks the server's certificate against the engine's certificate bundle and TlsTrustedCertificateFile. Turning it
+	 * off still encrypts, but lets anyone who can intercept the connection pose as the server.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security", meta = (EditCondition = "bTls"))
+	bool bTlsVerifyPeer = true;
+
+	/** PEM file of certificates trusted besides the engine's bundle, such as a self-signed server certificate. Relative to the project directory. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security", meta = (EditCondition = "bTls"))
+	FString TlsTrustedCertificateFile;
+
 private:
+	/** Changed on the game thread only, under TcpWorkersLock, so game-thread reads need no lock and other threads take it shared. */
 	TMap<int32, TSharedRef<class FTcpSocketWorker>> TcpWorkers;
+	mutable FRWLock TcpWorkersLock;
+
+	/** Any thread. The returned worker stays valid even if the game thread disconnects it meanwhile. */
+	TSharedPtr<class FTcpSocketWorker> FindWorker(int32 ConnectionId) const;
+
+	/**
+	 * Refuses a connection whose settings cannot be honoured, without starting a worker: logs Reason and raises
+	 * OnConnectionStateChanged with Failed and then the disconnect delegate, as a connection that could not be
+	 * established does.
+	 */
+	void FailConnect(int32 ConnectionId, const FString& Reason);
+
+	/** Checks a message of MessageSize bytes against the worker's MaxFrameSize and, together with PendingBytes more, its MaxPendingSendBytes. */
+	bool CanQueue(int32 ConnectionId, const class FTcpSocketWorker& Worker, int32 MessageSize, int64 PendingBytes = 0) const;
 
 	FTcpSocketDisconnectDelegate DisconnectedDelegate;
 	FTcpSocketConnectDelegate ConnectedDelegate;
 	FTcpSocketReceivedMessageDelegate MessageReceivedDelegate;
 
 	int32 NextConnectionId = 0;
+
+	/** Connection the next batched dispatch starts with, so a busy connection cannot starve the others. */
+	int32 NextDispatchIndex = 0;
+
+	struct FPendingRequest
+	{
+		int32 ConnectionId = 0;
+		double Deadline = 0.0;
+		TPromise<FLinkStreamResponse> Promise;
+	};
+
+	/** Requests awaiting a response, by correlation ID. IDs are unique per actor, across its connections. */
+	TMap<int32, FPendingRequest> PendingRequests;
+	int32 NextRequestId = 1;
+
+	/** Earliest deadline in PendingRequests, so Tick only walks the map when something can have expired. */
+	double NextRequestDeadline = MAX_dbl;
+
+	void DispatchInboxes();
+
+	/** Raises a received message according to its envelope, if the connection uses one. */
+	void DeliverMessage(int32 ConnectionId, FLinkStreamBuffer& Message);
+
+	/** Queues a message after the checks shared by every send. */
+	bool QueueMessage(int32 ConnectionId, TArray<uint8>&& Data, ELinkStreamPriority Priority, const FLinkStreamEnvelope& Envelope,
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	int32 BeginRequest(int32 ConnectionId, TArray<uint8>&& Data, float TimeoutSeconds, ELinkStreamPriority Priority, TFuture<FLinkStreamResponse>* OutFuture);
+
+	/** Fulfils a pending request and raises OnResponseReceived. */
+	void CompleteRequest(int32 RequestId, ELinkStreamRequestResult Result, TArray<uint8>&& Payload = TArray<uint8>());
+
+	/** Fails the requests of ConnectionId still waiting for a response. */
+	void FailPendingRequests(int32 ConnectionId);
+
+	void ExpirePendingRequests();
+
+	/** PerFrame flush mode: asks every worker to write what was queued this frame. */
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	FDelegateHandle PostActorTickHandle;
 };
 
-class FTcpSocketWorker : public FRunnable, public TSharedFromThis<FTcpSocketWorker>
+struct FTcpSocketWorkerSettings
+{
+	int32 RecvBufferSize = 16384;
+	int32 SendBufferSize = 16384;
+	float TimeBetweenTicks = 0.008f;
+	ELinkStreamBackend Backend = ELinkStreamBackend::Thread;
+	ELinkStreamWakeMode WakeMode = ELinkStreamWakeMode::EventDriven;
+	ELinkStreamDispatchMode DispatchMode = ELinkStreamDispatchMode::PerMessage;
+	ELinkStreamFraming Framing = ELinkStreamFraming::None;
+	int32 MaxFrameSize = 1024 * 1024;
+	ELinkStreamFlushMode FlushMode = ELinkStreamFlushMode::Immediate;
+	bool bNoDelay = false;
+	bool bCork = false;
+	int32 SendHighWatermark = 1024 * 1024;
+	int32 SendLowWatermark = 256 * 1024;
+	float ConnectTimeout = 5.f;
+	bool bAutoReconnect = false;
+	float ReconnectInitialDelay = 0.5f;
+	float ReconnectMaxDelay = 30.f;
+	float ReconnectJitter = 0.5f;
+	int32 MaxReconnectAttempts = 0;
+	ELinkStreamReconnectOutbox ReconnectOutbox = ELinkStreamReconnectOutbox::Replay;
+	bool bUseEnvelope = false;
+	int32 LaneWeights[LinkStreamNumLanes] = { 16, 4, 1 };
+	int32 OutboxCapacity = 1024;
+	int32 MaxPendingSendBytes = 0;
+	float HeartbeatInterval = 0.f;
+	float IdleTimeout = 0.f;
+	bool bTcpKeepAlive = false;
+	int32 TcpKeepAliveIdle = 30;
+	int32 TcpKeepAliveInterval = 5;
+	int32 TcpKeepAliveProbes = 3;
+	int32 InboxLimit = 0;
+	ELinkStreamInboxOverflow InboxOverflow = ELinkStreamInboxOverflow::PauseReceive;
+	int32 CoalesceKeySize = 4;
+	ELinkStreamCompression Compression = ELinkStreamCompression::None;
+	int32 CompressionThreshold = 1024;
+	bool bDeltaEncoding = false;
+	int32 DeltaKeySize = 4;
+	int32 DeltaKeyframeInterval = 32;
+	bool bEncrypt = false;
+	FString EncryptionKey;
+	bool bTls = false;
+	FString TlsServerName;
+	bool bTlsVerifyPeer = true;
+
+	/** PEM certificates trusted besides the engine's bundle, the contents of TlsTrustedCertificateFile. */
+	FString TlsTrustedCertificates;
+
+	/** Set by a listener: accepted sessions present its certificate. Clients leave it unset. */
+	TSharedPtr<class FLinkStreamTlsContext, ESPMode::ThreadSafe> TlsServerContext;
+};
+
+/** A queued outgoing message. The length prefix and envelope are kept inline so neither copies the payload. */
+struct FLinkStreamOutgoingMessage
+{
+	FLinkStreamBuffer Payload;
+
+	/** Set instead of Payload by a broadcast, whose recipients all point at the same buffer. */
+	TSharedPtr<const FLinkStreamBuffer, ESPMode::ThreadSafe> SharedPayload;
+
+	uint8 Header[FLinkStreamFraming::MaxHeaderSize + LinkStreamSealPrefixSize + FLinkStreamEnvelope::MaxSize];
+	int32 HeaderSize = 0;
+	ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered;
+
+	/** Encrypted connections: where the sequence number goes in Header, INDEX_NONE otherwise. Sealed in place just before writing. */
+	int32 SealOffset = INDEX_NONE;
+	bool bSealed = false;
+
+	/** Delta encoded connections: the envelope's DeltaFlag or KeyframeFlag, and the key the payload belongs to. */
+	uint8 DeltaFlags = 0;
+	uint64 DeltaKey = 0;
+
+	const uint8* GetPayloadData() const { return SharedPayload.IsValid() ? SharedPayload->GetData() : Payload.GetData(); }
+	int32 GetPayloadSize() const { return SharedPayload.IsValid() ? SharedPayload->Num() : Payload.Num(); }
+
+	/** Bytes the message takes on the wire, the tag of a message still to be sealed included. */
+	int32 GetWireSize() const { return HeaderSize + GetPayloadSize() + (SealOffset != INDEX_NONE && !bSealed ? LinkStreamSealTagSize : 0); }
+};
+
+class FTcpSocketWorker : public FRunnable, public ILinkStreamReactorHandler, public TSharedFromThis<FTcpSocketWorker>
 {
 
 	FRunnableThread* Thread = nullptr;
 
 private:
-	class FSocket* Socket = nullptr;
+	class FLinkStreamSocket* Socket = nullptr;
 	FString ipAddress;
 	int port;
-	TWeakObjectPtr<ALinkStreamConnection> ThreadSpawnerActor;
+	TWeakObjectPtr<UObject> OwnerObject;
+	ILinkStreamWorkerOwner* Owner;
 	int32 id;
-	int32 RecvBufferSize;
-	int32 ActualRecvBufferSize;
-	int32 SendBufferSize;
-	int32 ActualSendBufferSize;
-	float TimeBetweenTicks;
+
+	/** As of Connect or Listen, with udp:// forced onto a reactor and every lane weight at least 1. */
+	const FTcpSocketWorkerSettings Settings;
+
+	int32 ActualRecvBufferSize = 0;
+	int32 ActualSendBufferSize = 0;
 	FThreadSafeBool bConnected = false;
+	std::atomic<ELinkStreamConnectionState> State{ ELinkStreamConnectionState::Connecting };
+
+	/** When the current connect attempt times out, and when the next one may start. 0 when not waiting. FPlatformTime::Seconds. */
+	double ConnectDeadline = 0.0;
+	double ReconnectAt = 0.0;
+
+	/** Failed attempts since the link was last up. */
+	int32 ReconnectAttempts = 0;
+	FRandomStream ReconnectRandom;
+	FThreadSafeBool bFlushRequested = false;
+
+	/** Bytes in the outboxes and lane batches not yet written, and whether the owner was told to back off. */
+	FThreadSafeCounter64 PendingSendBytes;
+	FThreadSafeBool bSendBackpressured = false;
+
+	/** Thread backend in event-driven mode: whether the poller currently waits for writability. */
+	bool bPollingForWrite = false;
+
+	FLinkStreamInbox Inbox;
+
+	/** Worker only: whether the socket is currently left unread because the inbox is full under PauseReceive. */
+	bool bReceivePaused = false;
+
+	/** One outbox per lane, indexed by ELinkStreamPriority. Any thread may produce; the worker consumes. */
+	TLinkStreamMpscQueue<FLinkStreamOutgoingMessage> Outboxes[LinkStreamNumLanes];
+
+	/** Receive buffer. In framed mode it is sized once so that the largest legal frame always fits. */
+	FLinkStreamRingBuffer RecvRing;
+
+	/** Thread backend in event-driven mode: waits on the socket and on Wakeup, which AddToOutbox and Stop signal. */
+	TUniquePtr<class FLinkStreamPoller> Poller;
+	TUniquePtr<class FLinkStreamWakeup> Wakeup;
+
+	/** Messages taken from each lane's outbox and not yet completely written. */
+	TArray<FLinkStreamOutgoingMessage> LaneBatches[LinkStreamNumLanes];
+
+	/** The lane whose first batched message a short write left half-sent, INDEX_NONE if none, and how many of its bytes are out. */
+	int32 PartialLane = INDEX_NONE;
+	int32 SendBatchOffset = 0;
+
+	/** Start-time fair queueing: every message written adds 1/weight to its lane, and the lowest lane goes next. */
+	double LaneVirtualTime[LinkStreamNumLanes] = {};
+
+	struct FLaneCounters
+	{
+		FThreadSafeCounter QueuedMessages;
+		FThreadSafeCounter64 QueuedBytes;
+		FThreadSafeCounter64 SentMessages;
+		std::atomic<int32> PeakQueuedMessages{ 0 };
+	};
+	FLaneCounters LaneCounters[LinkStreamNumLanes];
+
+	FLinkStreamHeartbeat Heartbeat;
+	FLinkStreamCompressor Compressor;
+	FLinkStreamDeltaSession Delta;
+
+	/** Worker only: whether this side's hello went out since the link came up. */
+	bool bHelloSent = false;
+
+	/** Reactor backend only: the reactor servicing this worker. */
+	FLinkStreamReactor* Reactor = nullptr;
+	bool bConnecting = false;
+
+	/** Set for inproc:// addresses. Messages go through the endpoint's queues and the worker runs no thread. */
+	FLinkStreamInprocEndpoint* Inproc = nullptr;
 
-	TQueue<TArray<uint8>, EQueueMode::Spsc> Inbox;
-	TQueue<TArray<uint8>, EQueueMode::Spsc> Outbox;
+	/** Set for udp:// addresses. The socket is a connected datagram socket and Udp turns messages into packets. */
+	bool bUdp = false;
+	TUniquePtr<class FLinkStreamUdpSession> Udp;
+
+	/** Set with bEncrypt on framed TCP connections. Nothing but the handshake is written until it is ready. */
+	TUniquePtr<class FLinkStreamCipher> Cipher;
+
+	/** Set with bTls on TCP connections. Nothing but the handshake is written until it completes. */
+	TUniquePtr<class FLinkStreamTlsConnection> Tls;
 
 public:
 
-	FTcpSocketWorker(FString inIp, const int32 inPort, TWeakObjectPtr<ALinkStreamConnection> InOwner, int32 inId, int32 inRecvBufferSize, int32 inSendBufferSize, float inTimeBetweenTicks);
+	/** InOwner may be null, in which case nothing is reported and messages are only queued. */
+	FTcpSocketWorker(FString inIp, const int32 inPort, ILinkStreamWorkerOwner* InOwner, int32 inId, const FTcpSocketWorkerSettings& InSettings);
 	virtual ~FTcpSocketWorker();
 
 	void Start();
 
+	/** Reactor backend only: services a socket returned by accept instead of connecting. Takes ownership of InSocket. */
+	void StartAccepted(class FLinkStreamSocket* InSocket);
+
+
+	bool AddToOutbox(TArray<uint8> Message);
+
+	/** Queues a message on the lane for Priority without copying it. Any thread. Returns false, leaving Message untouched, if the lane is full. */
+	bool AddToOutbox(FLinkStreamBuffer&& Message, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive, const FLinkStreamEnvelope& Envelope = FLinkStreamEnvelope(),
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	/** Queues Messages back to back on one lane, all or nothing. Any thread. */
+	bool AddBatchToOutbox(TArrayView<FLinkStreamBuffer> Messages, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive,
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	/** Queues a reference to Payload instead of taking a buffer. Any thread. Returns false if the lane is full. */
+	bool AddSharedToOutbox(const FLinkStreamSharedBuffer& Payload, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive,
+		ELinkStreamDelivery Delivery = ELinkStreamDelivery::ReliableOrdered);
+
+	FLinkStreamLaneStats GetLaneStats(ELinkStreamPriority Priority) const;
+
+	FLinkStreamHeartbeatStats GetHeartbeatStats() const;
 
-	void AddToOutbox(TArray<uint8> Message);
+	bool UsesEnvelope() const { return Settings.bUseEnvelope; }
+
+	bool IsInproc() const { return Inproc != nullptr; }
+
+	bool IsUdp() const { return bUdp; }
 
 
 	TArray<uint8> ReadFromInbox();
 
+	/** Dequeues the oldest received message. Returns false if the inbox is empty. */
+	bool TryReadFromInbox(FLinkStreamBuffer& OutMessage);
+
+	int32 GetInboxCount() const { return Inproc ? Inproc->GetInboxCount() : Inbox.Num(); }
+
+	FLinkStreamInboxStats GetInboxStats() const;
+
+	FLinkStreamCompressionStats GetCompressionStats() const;
+
+	FLinkStreamDeltaStats GetDeltaStats() const;
+
+	FLinkStreamTlsStats GetTlsStats() const;
+
+	/** PerFrame flush mode: lets the worker write everything queued so far. */
+	void RequestFlush();
+
+	int64 GetPendingSendBytes() const { return Inproc ? Inproc->GetPendingSendBytes() : PendingSendBytes.GetValue(); }
+
+	/** Send limits as of Connect or Listen, which the owner checks messages against. Any thread. */
+	int32 GetMaxMessageSize() const { return Settings.Framing != ELinkStreamFraming::None || bUdp ? Settings.MaxFrameSize : 0; }
+	int32 GetMaxPendingSendBytes() const { return Settings.MaxPendingSendBytes; }
+	int32 GetOutboxCapacity() const { return Settings.OutboxCapacity; }
+
 	virtual bool Init() override;
 	virtual uint32 Run() override;
 	virtual void Stop() override;
 	virtual void Exit() override;
 
+	virtual void OnReactorAttach(FLinkStreamReactor& InReactor) override;
+	virtual void OnReactorEvent(bool bReadable, bool bWritable, bool bError) override;
+	virtual bool OnReactorTick() override;
+	virtual void OnReactorDetach() override;
+
 	void SocketShutdown();
 
 
 	bool isConnected();
 
+	ELinkStreamConnectionState GetState() const;
+
+	/** True until the worker stops for good, including while it connects or waits to reconnect. Messages queued meanwhile are sent once connected. */
+	bool IsRunning() const;
+
 private:
 
-	bool BlockingSend(const uint8* Data, int32 BytesToSend);
+	/** Creates the socket and applies buffer sizes. */
+	bool OpenSocket();
+
+	/** Applies buffer sizes and TCP_NODELAY. */
+	void ConfigureSocket();
+
+	/** Runs Call on the game thread with the owner and this worker's id, if the owner is still alive. */
+	void PostToOwner(TUniqueFunction<void(ILinkStreamWorkerOwner&, int32)>&& Call);
+
+	/** True if queued messages may be written now: always in Immediate mode, once per request in PerFrame mode. */
+	bool ConsumeFlushRequest();
+
+	/** Posts OnSendBackpressure to the game thread. */
+	void NotifySendBackpressure(bool bBackpressured);
+
+	/** Builds the framing header and envelope of an outgoing message around the payload it already holds. */
+	void PrepareOutgoing(const FLinkStreamEnvelope& Envelope, ELinkStreamDelivery Delivery, FLinkStreamOutgoingMessage& InOutOutgoing) const;
+
+	/** Accounts for NumMessages just queued on Lane, raises backpressure if due, and wakes the worker. */
+	void OnQueued(int32 Lane, int32 NumMessages, int64 NumBytes);
+
+	/** Writes the lane batches, refilled from the outboxes when bTakeFromOutbox. Ok once everything was written. */
+	ELinkStreamSocketResult SendQueued(bool bTakeFromOutbox);
+
+	/** Moves queued messages into the lane batches, up to one write's worth per lane. */
+	void StageQueuedMessages();
+
+	/** Picks the lane of every message in the next vectored write, in write order, at most MaxIoVecs / 2. Returns how many were picked. */
+	int32 PlanBatch(int32* OutLanes) const;
+
+	/** Drops every unsent message and updates the counters. */
+	void DropQueuedMessages();
+
+	/** Sends queued messages without blocking, keeping the unwritten part of the batch for the next writable event. */
+	bool FlushOutboxNonBlocking();
+
+	void FinishConnecting();
+
+	/** Checks IdleTimeout and queues a ping if one is due. Returns false if the link is to be treated as dead. */
+	bool ServiceHeartbeat(double Now);
+
+	/** Answers pings and times pongs. Returns true if Message was a heartbeat, which is not queued to the inbox. */
+	bool HandleHeartbeat(const FLinkStreamBuffer& Message);
+
+	/** Announces the formats this side decodes to a link that just came up, and forgets what the previous peer announced. */
+	void StartNegotiation();
+
+	/** Queues a hello carrying the formats this side decodes. */
+	void SendHello();
+
+	/** Records the peer's formats and answers with this side's hello if it has not sent one. Returns true if Message was a hello. */
+	bool HandleHello(const FLinkStreamBuffer& Message);
+
+	/** Queues the current baseline of the key the peer asks a keyframe for. Returns true if Message was a resync request. */
+	bool HandleResync(const FLinkStreamBuffer& Message);
+
+	/** Worker only, Delta.Lock held: drops queued deltas the new link cannot apply, keyframing the last of each key. */
+	void RewriteQueuedDeltas();
+
+	/** Queues Message as a delta or keyframe. Returns false, leaving Message untouched, if the lane is full. */
+	bool AddDeltaToOutbox(FLinkStreamBuffer& Message, ELinkStreamPriority Priority, const FLinkStreamEnvelope& Envelope);
+
+	/** Envelopes Message if the connection uses envelopes and queues it for the managed side, which Inproc->Reserve made room for. */
+	void SendInproc(FLinkStreamBuffer&& Message, const FLinkStreamEnvelope& Envelope);
+
+	/** Compresses Message if due and queues it. Returns false, leaving Message untouched, if the lane is full. */
+	bool EnqueueOutgoing(FLinkStreamBuffer& Message, ELinkStreamPriority Priority, const FLinkStreamEnvelope& Envelope, ELinkStreamDelivery Delivery, uint64 DeltaKey = 0);
+
+	/** Keeps keyframes as baselines and rebuilds deltas in place. Returns false, having asked for a resync, if it cannot. */
+	bool ApplyIncomingDelta(FLinkStreamBuffer& Message);
+
+	/** Posts OnWorkerStateChanged if the state actually changed. */
+	void SetState(ELinkStreamConnectionState NewState);
+
+	/** Thread backend: opens the socket and waits for the connect to finish within ConnectTimeout, or until Stop. */
+	bool ConnectWithTimeout();
+
+	/** Reactor backend: opens the socket and starts a non-blocking connect. */
+	void StartConnecting();
+
+	/** udp:// only: creates the session and sends its first handshake. The socket is already connected. */
+	void StartUdpSession();
+
+	/** udp:// only: hands every datagram waiting on the socket to the session. */
+	void ReceiveDatagrams();
+
+	/** udp:// only: raises Connected, feeds the session from the lanes and runs its timers. Returns false if the peer is gone. */
+	bool ServiceUdp();
+
+	/** udp:// only: moves planned messages from the lane batches, refilled from the outboxes when bTakeFromOutbox, into the session while it wants more. */
+	void StageUdpMessages(bool bTakeFromOutbox);
+
+	/** Closes the socket, and resets receive state and the unsent part of the outbox for the next connection. */
+	void ResetConnection();
+
+	/** Schedules the next attempt and returns true if auto-reconnect allows it, otherwise raises Failed or Disconnected. */
+	bool HandleConnectionLost();
+
+	/** Thread backend: waits up to Seconds for the socket or a wakeup. */
+	void WaitFor(double Seconds);
+
+	/** Wakes whichever thread services this worker. */
+	void WakeWorker();
+
+	/** Blocks until the socket is readable or the worker is woken, for at most TimeoutMs (-1 = forever). */
+	void WaitForActivity(int32 TimeoutMs = -1);
+
+	/** Reads into RecvRing until the socket is drained and queues what arrived. Returns false if the stream must be closed. */
+	bool ReceivePending();
+
+	/** Queues every complete frame in RecvRing. Returns false on a malformed or oversized frame. */
+	bool ExtractFrames();
+
+	/** Encrypted connections: starts the handshake of a link that just came up. */
+	void StartEncryption();
+
+	/** Derives the session keys from the peer's handshake, its first frame. Returns false if the link must be closed. */
+	bool CompleteEncryption(const FLinkStreamBuffer& Handshake);
+
+	/** Decrypts a frame in place, leaving the plaintext message. Returns false if it is not authentic and the link must be closed. */
+	bool OpenFrame(FLinkStreamBuffer& Frame);
+
+	/** Encrypts a message in place, copying a shared payload first since other connections still read it. */
+	void SealOutgoing(FLinkStreamOutgoingMessage& Message);
+
+	/** Restores sealed but unwritten messages to plaintext when their link goes down, so the next link can seal them again. */
+	void UnsealStagedMessages();
+
+	/** TLS connections: starts the handshake of a link that just came up. If TLS cannot start, the next send closes the link. */
+	void StartTls();
+
+	/** Unframed mode: queues everything in RecvRing as one message. */
+	void DeliverRawRing();
+
+	/** Queues a complete message for the game thread and, in per-message mode, schedules its dispatch. */
+	void DeliverMessage(FLinkStreamBuffer&& Message);
+
+	/** Pauses or resumes reads as the inbox fills up and drains under PauseReceive. Returns true while paused. */
+	bool UpdateReceivePause();
 
 
 	FThreadSafeBool bRun = false;
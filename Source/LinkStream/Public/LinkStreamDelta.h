@@ -0,0 +1,204 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "LinkStreamBuffer.h"
+#include <atomic>
+#include "LinkStreamDelta.generated.h"
+
+/** Bandwidth delta encoding saved on one connection's sends, and how often the baselines had to be rebuilt. */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamDeltaStats
+{
+	GENERATED_BODY()
+
+	/** True once the peer confirmed it decodes deltas. Nothing is delta encoded before. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Delta")
+	bool bNegotiated = false;
+
+	/** Keyed messages sent as a delta against the previous payload for their key. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Delta")
+	int64 DeltaMessages = 0;
+
+	/** Keyed messages sent whole: the first for a key, every DeltaKeyframeInterval-th, after a resync, or when the delta was no smaller. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Delta")
+	int64 Keyframes = 0;
+
+	/** Payload bytes of the keyed messages before and after delta encoding. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Delta")
+	int64 RawBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Delta")
+	int64 EncodedBytes = 0;
+
+	/** RawBytes - EncodedBytes. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Delta")
+	int64 BytesSaved = 0;
+
+	/** Deltas the peer could not apply to its baseline, each answered by a keyframe for that key. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Delta")
+	int64 ResyncsReceived = 0;
+
+	/** Deltas from the peer dropped here because the baseline was missing or differed. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Delta")
+	int64 ResyncsSent = 0;
+};
+
+/**
+ * Sending half of delta encoding. Keeps the last payload queued per key, the first KeySize bytes of a payload, and
+ * encodes the next one as the XOR against it with runs of unchanged bytes skipped:
+ *
+ *   key size (1 byte) | key | CRC32 of the baseline (4 bytes) | payload size (varint) | { skip (varint) | count (varint) | count XOR bytes }...
+ *
+ * The CRC lets the receiver detect a baseline that diverged, for example after a replayed outbox, and ask for a keyframe.
+ * Not thread safe; the worker serializes encoding with queueing so deltas reach the wire in the order they were encoded.
+ */
+class LINKSTREAM_API FLinkStreamDeltaEncoder
+{
+public:
+	/** Keys tracked per side. Messages for further keys are sent whole and keep no baseline. */
+	static constexpr int32 MaxBaselines = 4096;
+
+	void Configure(int32 InKeySize, int32 InKeyframeInterval);
+
+	int32 GetKeySize() const { return KeySize; }
+
+	/**
+	 * Encodes Size bytes of Data against its key's baseline into OutDelta. Returns false if the message has to go whole
+	 * as a keyframe instead: no baseline, a keyframe is due, or the delta would be no smaller. Leaves the baseline as it is.
+	 */
+	bool Encode(const uint8* Data, int32 Size, FLinkStreamBuffer& OutDelta) const;
+
+	/**
+	 * Makes Payload the baseline of its key, once it was queued as a delta or keyframe. Channel is kept with it for
+	 * FindBaseline; the worker stores the lane the key's messages go out on.
+	 */
+	void Commit(TArray<uint8>&& Payload, bool bKeyframe, uint8 Channel = 0);
+
+	/** The baseline of Key and the channel it was committed with, or null if the key has none. */
+	const TArray<uint8>* FindBaseline(uint64 Key, uint8& OutChannel) const;
+
+	/** Forgets the baseline for Key, so that key's next message is a keyframe. */
+	void Invalidate(const uint8* Key, int32 InKeySize);
+
+	void Reset() { Baselines.Reset(); }
+
+	/** Reads the first KeySize bytes of a payload as a key. Returns false if the payload is shorter. */
+	static bool ReadKey(const uint8* Payload, int32 PayloadSize, int32 KeySize, uint64& OutKey);
+
+private:
+	struct FBaseline
+	{
+		TArray<uint8> Payload;
+		uint32 Crc = 0;
+		int32 DeltasSinceKeyframe = 0;
+		uint8 Channel = 0;
+	};
+
+	TMap<uint64, FBaseline> Baselines;
+	int32 KeySize = 4;
+	int32 KeyframeInterval = 32;
+};
+
+/** Receiving half of delta encoding. Worker only. */
+class LINKSTREAM_API FLinkStreamDeltaDecoder
+{
+public:
+	/** The sender's key size, announced in its hello. Keyframes arriving before it are not kept. */
+	void SetKeySize(int32 InKeySize) { KeySize = InKeySize; }
+
+	/** Keeps a keyframe as the baseline of its key. */
+	void StoreKeyframe(const uint8* Data, int32 Size);
+
+	/**
+	 * Appends the payload rebuilt from a delta to OutMessage and makes it the new baseline. Returns false, forgetting the
+	 * baseline and leaving the delta's key in OutKey, if the baseline is missing, differs from the sender's or does not
+	 * fit the delta. Returns false with OutKey empty if the delta's header is unreadable or announces more than MaxSize bytes.
+	 */
+	bool Decode(const uint8* Delta, int32 Size, int32 MaxSize, TArray<uint8>& OutMessage, TArray<uint8>& OutKey);
+
+	/**
+	 * True the first time a key fails to decode since its last keyframe. Deltas already in flight behind the failed one
+	 * fail too, and one resync is enough to get the keyframe that replaces them all.
+	 */
+	bool ShouldRequestKeyframe(const TArray<uint8>& Key);
+
+	void Reset()
+	{
+		Baselines.Reset();
+		AwaitingKeyframe.Reset();
+		KeySize = 0;
+	}
+
+private:
+	TMap<uint64, TArray<uint8>> Baselines;
+	TSet<uint64> AwaitingKeyframe;
+	int32 KeySize = 0;
+};
+
+/** Delta encoding of one connection: both halves, what the peer agreed to, and the counters behind its stats. */
+class LINKSTREAM_API FLinkStreamDeltaSession
+{
+public:
+	/** Baselines of what was queued per key. Lock covers encoding and queueing together. */
+	FLinkStreamDeltaEncoder Encoder;
+	FCriticalSection Lock;
+
+	/** Worker only: baselines of what the peer sent per key. */
+	FLinkStreamDeltaDecoder Decoder;
+
+	/** bInEnabled is whether this side encodes; it decodes whatever the peer sends either way. */
+	void Configure(bool bInEnabled, int32 KeySize, int32 KeyframeInterval);
+
+	bool IsEnabled() const { return bEnabled; }
+
+	/** Whether the peer's hello said it decodes deltas. False until it arrives. */
+	void SetPeerDecodes(bool bDecodes) { bPeerDecodes.store(bDecodes, std::memory_order_relaxed); }
+
+	/** True once this side encodes and the peer decodes. Any thread. */
+	bool IsNegotiated() const { return bEnabled && bPeerDecodes.load(std::memory_order_relaxed); }
+
+	void CountDelta(int32 RawSize, int32 EncodedSize);
+	void CountKeyframe(int32 Size);
+	void CountResyncReceived() { ResyncsReceived.Increment(); }
+	void CountResyncSent() { ResyncsSent.Increment(); }
+
+	FLinkStreamDeltaStats GetStats() const;
+
+private:
+	bool bEnabled = false;
+	std::atomic<bool> bPeerDecodes{ false };
+
+	FThreadSafeCounter64 DeltaMessages;
+	FThreadSafeCounter64 Keyframes;
+	FThreadSafeCounter64 RawBytes;
+	FThreadSafeCounter64 EncodedBytes;
+	FThreadSafeCounter64 ResyncsReceived;
+	FThreadSafeCounter64 ResyncsSent;
+};
@@ -0,0 +1,93 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** What a message is for. Carried in the low three bits of the envelope's first byte. */
+enum class ELinkStreamMessageKind : uint8
+{
+	/** A plain message, raised as OnMessageReceived. */
+	Message = 0,
+	/** Expects a Response carrying the same correlation ID. */
+	Request = 1,
+	/** Answers the Request with the same correlation ID. */
+	Response = 2,
+	/** Heartbeat. Answered by the receiving worker with a Pong carrying the same ID, never raised to the owner. */
+	Ping = 3,
+	Pong = 4,
+	/**
+	 * Negotiation, sent once per side on link-up. The payload is three bytes: the compression formats the sender
+	 * decodes, its feature bits (HelloDeltaDecoding) and its delta key size. Older peers send only the first. Never
+	 * raised to the owner.
+	 */
+	Hello = 5,
+	/** Asks the peer for a keyframe of the delta key in the payload, after a delta failed to apply. Never raised to the owner. */
+	Resync = 6
+};
+
+/**
+ * Header in front of every message on a connection with bUseEnvelope set.
+ *
+ * Byte 0 is 1FFFFKKK: the top bit marks an envelope (never set in the ASCII requests of the original protocol),
+ * F are payload transform flags (the low two hold the payload's ELinkStreamCompression, then DeltaFlag and KeyframeFlag),
+ * K is the kind. Every kind but Message follows it with the correlation ID as a LEB128 varint. The payload follows
+ * directly; framing still delimits the whole message.
+ */
+struct LINKSTREAM_API FLinkStreamEnvelope
+{
+	static constexpr uint8 Marker = 0x80;
+	static constexpr int32 MaxSize = 6;
+	static constexpr uint8 CompressionFlags = 0x03;
+	/** The payload is a delta against the previous payload with the same key. Applied after decompression. */
+	static constexpr uint8 DeltaFlag = 0x04;
+	/** The payload is whole and becomes the baseline that later deltas for its key apply to. */
+	static constexpr uint8 KeyframeFlag = 0x08;
+
+	/** Feature bit of a hello: the sender applies deltas. */
+	static constexpr uint8 HelloDeltaDecoding = 0x01;
+
+	ELinkStreamMessageKind Kind = ELinkStreamMessageKind::Message;
+	uint8 Flags = 0;
+	uint32 CorrelationId = 0;
+
+	FLinkStreamEnvelope() = default;
+	FLinkStreamEnvelope(ELinkStreamMessageKind InKind, uint32 InCorrelationId)
+		: Kind(InKind)
+		, CorrelationId(InCorrelationId)
+	{
+	}
+
+	bool HasCorrelationId() const { return Kind != ELinkStreamMessageKind::Message; }
+
+	bool IsHeartbeat() const { return Kind == ELinkStreamMessageKind::Ping || Kind == ELinkStreamMessageKind::Pong; }
+
+	/** Writes the envelope and returns its size. */
+	int32 Encode(uint8 OutBytes[MaxSize]) const;
+
+	/** Reads an envelope from the front of a message. Returns its size, or 0 if the bytes are not a valid envelope. */
+	static int32 Decode(const uint8* Bytes, int32 NumBytes, FLinkStreamEnvelope& OutEnvelope);
+};
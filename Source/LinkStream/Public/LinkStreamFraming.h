@@ -0,0 +1,102 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LinkStreamBuffer.h"
+#include "LinkStreamFraming.generated.h"
+
+UENUM(BlueprintType)
+enum class ELinkStreamFraming : uint8
+{
+	/** Raw stream. Whatever is read from the socket in one pass is delivered as one message. */
+	None,
+	/** Every message is prefixed with its length as a little-endian uint32. */
+	UInt32,
+	/** Every message is prefixed with its length as a LEB128 varint (1-5 bytes). */
+	VarInt
+};
+
+enum class ELinkStreamFrameResult : uint8
+{
+	/** A complete frame was extracted. */
+	Frame,
+	/** Not enough bytes buffered yet. */
+	NeedMoreData,
+	/** The header announced a frame larger than the allowed maximum. */
+	FrameTooLarge,
+	/** The header itself is malformed (varint longer than 5 bytes). */
+	InvalidHeader
+};
+
+/** Fixed-capacity byte ring used to reassemble frames on the worker thread. Never reallocates after Init. */
+class LINKSTREAM_API FLinkStreamRingBuffer
+{
+public:
+	void Init(int32 InCapacity);
+
+	int32 Num() const { return Count; }
+	int32 Capacity() const { return Data.Num(); }
+	int32 Slack() const { return Data.Num() - Count; }
+	bool IsEmpty() const { return Count == 0; }
+
+	/** Returns up to two contiguous free regions, in write order. Returns the number of regions. */
+	int32 GetWriteRegions(uint8*& OutFirst, int32& OutFirstSize, uint8*& OutSecond, int32& OutSecondSize);
+	void CommitWrite(int32 NumBytes);
+
+	/** Appends as many bytes as fit and returns how many were written. */
+	int32 Write(const uint8* Src, int32 NumBytes);
+
+	/** Copies NumBytes starting Offset bytes after the read position without consuming them. */
+	bool Peek(uint8* Dst, int32 NumBytes, int32 Offset = 0) const;
+	uint8 PeekByte(int32 Offset) const { return Data[(Head + Offset) & Mask]; }
+
+	void Consume(int32 NumBytes);
+	void Reset();
+
+private:
+	TArray<uint8> Data;
+	int32 Mask = 0;
+	int32 Head = 0;
+	int32 Count = 0;
+};
+
+/** Length-prefix encoding/decoding shared by the send and receive paths. */
+class LINKSTREAM_API FLinkStreamFraming
+{
+public:
+	/** Largest header any framing mode produces. */
+	static constexpr int32 MaxHeaderSize = 5;
+
+	/** Writes the length prefix for a payload of PayloadSize bytes. Returns the header size (0 for unframed). */
+	static int32 EncodeHeader(ELinkStreamFraming Framing, uint32 PayloadSize, uint8 OutHeader[MaxHeaderSize]);
+
+	/** Parses a header from the front of the ring. On success OutHeaderSize/OutPayloadSize describe the frame. */
+	static ELinkStreamFrameResult DecodeHeader(ELinkStreamFraming Framing, const FLinkStreamRingBuffer& Ring, int32 MaxFrameSize, int32& OutHeaderSize, int32& OutPayloadSize);
+
+	/** Extracts the next complete frame from Ring into a pooled OutFrame. OutFrame is only acquired once the frame is known to be valid and complete. */
+	static ELinkStreamFrameResult ReadFrame(ELinkStreamFraming Framing, FLinkStreamRingBuffer& Ring, int32 MaxFrameSize, FLinkStreamBuffer& OutFrame);
+};
@@ -0,0 +1,115 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include <atomic>
+#include "LinkStreamHeartbeat.generated.h"
+
+/** Liveness of one connection, measured from heartbeat echoes. */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamHeartbeatStats
+{
+	GENERATED_BODY()
+
+	/** Smoothed round-trip time in milliseconds, as TCP smooths it (1/8 gain). -1 until the first pong. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Heartbeat")
+	float RoundTripTimeMs = -1.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Heartbeat")
+	float LastRoundTripTimeMs = -1.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Heartbeat")
+	float MinRoundTripTimeMs = -1.f;
+
+	/** Seconds since anything arrived from the peer. -1 while not connected. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Heartbeat")
+	float SecondsSinceLastReceive = -1.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Heartbeat")
+	int64 PingsSent = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Heartbeat")
+	int64 PongsReceived = 0;
+};
+
+/** Idle and ping tracking of one connection. The worker sends the pings; GetStats may be called from any thread. */
+class LINKSTREAM_API FLinkStreamHeartbeat
+{
+public:
+	/** An Interval of 0 sends no pings, an IdleTimeout of 0 never gives up on a quiet link. */
+	void Configure(float InInterval, float InIdleTimeout);
+
+	/** Starts tracking a link that just came up. */
+	void Reset(double Now);
+
+	/** Bytes arrived, or reads resumed after a pause. */
+	void MarkReceived(double Now) { LastReceiveTime.store(Now, std::memory_order_relaxed); }
+
+	/** A message other than a heartbeat arrived. */
+	void MarkMessage(double Now) { LastMessageTime = Now; }
+
+	/** True once nothing arrived for IdleTimeout. */
+	bool IsIdle(double Now) const;
+
+	/** Returns true with the ID of the ping to send in OutSequence if one is due. */
+	bool PreparePing(double Now, uint32& OutSequence);
+
+	/** The ping PreparePing asked for was queued. */
+	void OnPingSent(double Now);
+
+	/** Times the pong to the newest ping. Pongs to a ping since superseded are ignored. */
+	void OnPong(uint32 Sequence, double Now);
+
+	/** Earliest time IsIdle or PreparePing may change their answer, MAX_dbl if never. */
+	double GetNextTime() const;
+
+	/** SecondsSinceLastReceive is only filled in while bLinkUp. */
+	FLinkStreamHeartbeatStats GetStats(double Now, bool bLinkUp) const;
+
+private:
+	float Interval = 0.f;
+	float IdleTimeout = 0.f;
+
+	std::atomic<double> LastReceiveTime{ 0.0 };
+
+	/** Worker only: when a message other than a heartbeat last arrived, and when the next ping is due. */
+	double LastMessageTime = 0.0;
+	double NextPingAt = 0.0;
+
+	/** Worker only: ID and send time of the newest ping, PingSentAt 0 once its pong arrived, and pings skipped in a row. */
+	uint32 PingSequence = 0;
+	double PingSentAt = 0.0;
+	int32 SkippedPings = 0;
+
+	/** In milliseconds, -1 until measured. */
+	std::atomic<float> LastRttMs{ -1.f };
+	std::atomic<float> SmoothedRttMs{ -1.f };
+	std::atomic<float> MinRttMs{ -1.f };
+	FThreadSafeCounter64 PingsSent;
+	FThreadSafeCounter64 PongsReceived;
+};
@@ -0,0 +1,157 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "LinkStreamBuffer.h"
+#include <atomic>
+#include "LinkStreamInbox.generated.h"
+
+/** What a connection does with received messages once its inbox holds InboxLimit of them. */
+UENUM(BlueprintType)
+enum class ELinkStreamInboxOverflow : uint8
+{
+	/**
+	 * The worker stops reading the socket until the game thread has drained the inbox to half the limit, and the
+	 * peer is slowed down by flow control. Nothing is lost; messages already read when the limit was hit still go in.
+	 */
+	PauseReceive,
+	/** The oldest waiting message makes room. */
+	DropOldest,
+	/** The arriving message is dropped. */
+	DropNewest,
+	/**
+	 * A message replaces the waiting one with the same key, the first CoalesceKeySize bytes of its payload, and takes
+	 * over its place in the queue, so only the latest value per key is raised. A new key past the limit drops the oldest message.
+	 */
+	Coalesce
+};
+
+/** Depth and losses of one connection's inbox. */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamInboxStats
+{
+	GENERATED_BODY()
+
+	/** Messages received and not yet raised. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Dispatch")
+	int32 QueuedMessages = 0;
+
+	/** Highest QueuedMessages seen since the connection was opened. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Dispatch")
+	int32 PeakQueuedMessages = 0;
+
+	/** Messages discarded by DropOldest or DropNewest, or by Coalesce to make room for a new key. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Dispatch")
+	int64 DroppedMessages = 0;
+
+	/** Messages replaced by a newer one with the same key before they were raised. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Dispatch")
+	int64 CoalescedMessages = 0;
+
+	/** Times PauseReceive stopped reading the socket. */
+	UPROPERTY(BlueprintReadOnly, Category = "Socket|Dispatch")
+	int64 ReceivePauses = 0;
+};
+
+/**
+ * Received messages of one connection waiting for the game thread. One producer, the worker, and one consumer.
+ *
+ * Unbounded, and with PauseReceive, it is a lock-free queue and the limit only raises the pause flag. The dropping
+ * and coalescing policies need to reach messages the consumer has not taken yet, so they keep a ring of exactly
+ * Limit slots under a lock that either side holds for no more than a move.
+ */
+class LINKSTREAM_API FLinkStreamInbox
+{
+public:
+	FLinkStreamInbox() = default;
+	FLinkStreamInbox(const FLinkStreamInbox&) = delete;
+	FLinkStreamInbox& operator=(const FLinkStreamInbox&) = delete;
+
+	/** InLimit 0 leaves the inbox unbounded. InKeySize is clamped to 1..8 bytes. Call before the inbox is shared. */
+	void Configure(int32 InLimit, ELinkStreamInboxOverflow InOverflow, int32 InKeySize);
+
+	/** True if Push wants a coalescing key with every message that has one. */
+	bool IsCoalescing() const { return Limit > 0 && Overflow == ELinkStreamInboxOverflow::Coalesce; }
+
+	/** Reads the coalescing key from the front of a payload, little endian. False if the payload is shorter than the key. */
+	bool ReadKey(const uint8* Payload, int32 PayloadSize, uint64& OutKey) const;
+
+	/**
+	 * Producer. Queues Message under the overflow policy; Key is null for messages that must never be coalesced.
+	 * Returns false if Message was dropped or merged into one already waiting, so there is nothing new to dispatch.
+	 */
+	bool Push(FLinkStreamBuffer&& Message, const uint64* Key = nullptr);
+
+	/** Consumer. bOutResumed is set when this read ended a receive pause, and the worker must be woken to read again. */
+	bool Pop(FLinkStreamBuffer& OutMessage, bool& bOutResumed);
+
+	/** Producer. True while PauseReceive wants the socket left unread. Pop clears it once the inbox is half drained. */
+	bool IsReceivePaused() const { return bReceivePaused.load(); }
+
+	/** Any thread. */
+	int32 Num() const { return Count.load(); }
+
+	/** Any thread. */
+	FLinkStreamInboxStats GetStats() const;
+
+private:
+	struct FSlot
+	{
+		FLinkStreamBuffer Message;
+		uint64 Key = 0;
+		bool bKeyed = false;
+	};
+
+	/** Bounded ring only: frees the oldest slot. Called with Lock held and the ring not empty. */
+	void EvictOldest();
+
+	void UpdatePeak(int32 Queued);
+
+	int32 Limit = 0;
+	ELinkStreamInboxOverflow Overflow = ELinkStreamInboxOverflow::PauseReceive;
+	int32 KeySize = 4;
+
+	/** Unbounded and PauseReceive. */
+	TQueue<FLinkStreamBuffer, EQueueMode::Spsc> Queue;
+	std::atomic<bool> bReceivePaused{ false };
+
+	/** Dropping and coalescing policies: Limit slots starting at Head, and the slot of every waiting key. */
+	FCriticalSection Lock;
+	TArray<FSlot> Slots;
+	int32 Head = 0;
+	TMap<uint64, int32> KeySlots;
+
+	/** Changed by both sides, under Lock in the ring modes. Compared against the pause flag without it. */
+	std::atomic<int32> Count{ 0 };
+	std::atomic<int32> PeakCount{ 0 };
+	FThreadSafeCounter64 DroppedMessages;
+	FThreadSafeCounter64 CoalescedMessages;
+	FThreadSafeCounter64 ReceivePauses;
+};
@@ -0,0 +1,142 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Containers/Queue.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+#include "LinkStreamBuffer.h"
+#include <atomic>
+
+class ILinkStreamWorkerOwner;
+struct FTcpSocketWorkerSettings;
+
+/**
+ * A named in-process channel between one LinkStream connection and the .NET runtime hosted by UnrealSOLNET.
+ * Connecting to inproc://<name> attaches the connection here instead of opening a socket. Messages cross in
+ * both directions over lock-free queues, whole and without length prefixes since the queues keep message boundaries.
+ *
+ * Endpoints live until the module shuts down, so the managed side may keep the pointer returned by Open.
+ * Native methods are called on the game thread. Managed methods may be called from any managed thread,
+ * except ManagedReceive, which assumes a single consumer.
+ */
+class LINKSTREAM_API FLinkStreamInprocEndpoint
+{
+public:
+	explicit FLinkStreamInprocEndpoint(const FString& InName);
+
+	/** True if Address uses the inproc:// scheme. */
+	static bool IsInprocAddress(const FString& Address);
+
+	/** Returns the endpoint an inproc:// address names, creating it on first use. Null for any other scheme. Thread-safe. */
+	static FLinkStreamInprocEndpoint* FindOrCreate(const FString& Address);
+
+	/** Same as FindOrCreate, taking the bare endpoint name. Thread-safe. */
+	static FLinkStreamInprocEndpoint* FindOrCreateByName(const FString& Name);
+
+	const FString& GetName() const { return Name; }
+
+	/** Binds a connection to this endpoint, dropping anything left queued in either direction. Fails if another connection is attached. */
+	bool Attach(ILinkStreamWorkerOwner* InOwner, int32 InWorkerId, const FTcpSocketWorkerSettings& Settings);
+
+	/** Unbinds the connection if it is the attached one and drops what is queued. Connection ids are only unique per owner, so both are compared. */
+	void Detach(const ILinkStreamWorkerOwner* InOwner, int32 InWorkerId);
+
+	bool IsAttachedTo(const ILinkStreamWorkerOwner* InOwner, int32 InWorkerId) const { return bAttached && Owner == InOwner && WorkerId == InWorkerId; }
+
+	/**
+	 * Claims room for Count messages to the managed side. The queue holds the connection's OutboxCapacity messages,
+	 * inproc having a single lane. Returns false, claiming nothing, if there is not room for all of them, and raises
+	 * OnWorkerSendBackpressure as a runtime falling SendHighWatermark behind does. Any thread.
+	 */
+	bool Reserve(int32 Count);
+
+	/** Queues a message Reserve made room for. Raises OnWorkerSendBackpressure when the runtime falls SendHighWatermark behind. Any thread. */
+	void Send(FLinkStreamBuffer&& Message);
+
+	/** Dequeues the oldest message sent by the managed side. Returns false if there is none. */
+	bool Receive(FLinkStreamBuffer& OutMessage);
+
+	int32 GetInboxCount() const { return InboxCount.GetValue(); }
+	int64 GetPendingSendBytes() const { return PendingSendBytes.GetValue(); }
+
+	/**
+	 * Managed side: copies Size bytes into a pooled buffer and queues it for the attached connection. False if no connection
+	 * is attached, the message is larger than MaxFrameSize or the connection's InboxLimit messages are already waiting.
+	 */
+	bool ManagedSend(const uint8* Data, int32 Size);
+
+	/**
+	 * Managed side: dequeues the next message for the runtime. The returned bytes stay valid until the next
+	 * ManagedReceive or ManagedClose. Returns null if nothing is queued.
+	 */
+	const uint8* ManagedReceive(int32& OutSize);
+
+	/** Managed side: the runtime stopped serving this endpoint. The attached connection is detached and raises OnDisconnected. */
+	void ManagedClose();
+
+private:
+	/** Runs Call on the game thread with the owner attached when it was posted, if it is still attached and alive. */
+	void PostToOwner(TUniqueFunction<void(ILinkStreamWorkerOwner&, int32)>&& Call);
+
+	/** Empties both queues and zeroes their counters. Game thread only. */
+	void ResetQueues();
+
+	FString Name;
+
+	/** Changed on the game thread only; ManagedSend reads bAttached from other threads. Owner may be null while attached, in which case nothing is reported. */
+	std::atomic<bool> bAttached{ false };
+	TWeakObjectPtr<UObject> OwnerObject;
+	ILinkStreamWorkerOwner* Owner = nullptr;
+	int32 WorkerId = INDEX_NONE;
+
+	/** Bumped on every Attach so callbacks posted for an earlier connection are dropped. */
+	std::atomic<uint32> AttachSerial{ 0 };
+
+	/** Copied from the attached connection's settings for the managed side. */
+	std::atomic<bool> bPerMessageDispatch{ true };
+	std::atomic<int32> MaxFrameSize{ 1024 * 1024 };
+	std::atomic<int32> SendHighWatermark{ 0 };
+	std::atomic<int32> SendLowWatermark{ 0 };
+	std::atomic<int32> SendCapacity{ 1024 };
+	std::atomic<int32> InboxLimit{ 0 };
+	std::atomic<bool> bSendBackpressured{ false };
+
+	/** Native to managed. Producers are connections, the consumer is ManagedReceive. SendCount includes reserved slots. */
+	TQueue<FLinkStreamBuffer, EQueueMode::Mpsc> ToManaged;
+	FThreadSafeCounter64 PendingSendBytes;
+	FThreadSafeCounter SendCount;
+	FLinkStreamBuffer ManagedCurrent;
+
+	/** Held while dequeuing ToManaged, which ResetQueues does from the game thread while the runtime may be receiving. */
+	FCriticalSection ToManagedLock;
+
+	/** Managed to native. Producers are managed threads, the consumer is the game thread. InboxCount includes messages being queued. */
+	TQueue<FLinkStreamBuffer, EQueueMode::Mpsc> ToNative;
+	FThreadSafeCounter InboxCount;
+};
@@ -0,0 +1,257 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "LinkStreamConnection.h"
+#include "LinkStreamListener.generated.h"
+
+/**
+ * Native server counterpart to ALinkStreamConnection.
+ * Connections are accepted on the module's reactor threads and kept open as sessions, each serviced by the reactors
+ * like a Reactor-backend connection. Session ids are passed where ALinkStreamConnection passes connection ids.
+ * SendData, SendWriter, IsSessionConnected, GetPendingSendBytes, GetLaneStats, GetHeartbeatStats, GetInboxStats and GetTlsStats are safe from any thread;
+ * the rest is game thread only.
+ */
+UCLASS(Blueprintable, BlueprintType)
+class LINKSTREAM_API ALinkStreamListener : public AActor, public ILinkStreamWorkerOwner
+{
+	GENERATED_BODY()
+
+public:
+	ALinkStreamListener();
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void Tick(float DeltaTime) override;
+
+	/** Starts accepting on BindAddress:Port. Port 0 picks a free port. BoundPort receives the port actually used. */
+	UFUNCTION(BlueprintCallable, Category = "Socket|Listener")
+	bool Listen(const FString& BindAddress, int32 Port,
+		const FTcpSocketDisconnectDelegate& OnSessionDisconnected, const FTcpSocketConnectDelegate& OnSessionConnected,
+		const FTcpSocketReceivedMessageDelegate& OnMessageReceived, int32& BoundPort);
+
+	/** Stops accepting new sessions. Open sessions stay up. */
+	UFUNCTION(BlueprintCallable, Category = "Socket|Listener")
+	void StopListening();
+
+	UFUNCTION(BlueprintCallable, Category = "Socket|Listener")
+	void DisconnectSession(int32 SessionId);
+
+	UFUNCTION(BlueprintCallable, Category = "Socket|Listener")
+	void DisconnectAllSessions();
+
+	/** Priority picks the outbound lane. Messages within a lane keep their order; across lanes they do not. Any thread. */
+	UFUNCTION(BlueprintCallable, Category = "Socket|Listener")
+	bool SendData(int32 SessionId, TArray<uint8> DataToSend, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive);
+
+	/** Sends the message built in Writer. The buffer is moved, not copied, so Writer is empty afterwards. Any thread. */
+	UFUNCTION(BlueprintCallable, Category = "Socket|Listener")
+	bool SendWriter(int32 SessionId, UPARAM(ref) FLinkStreamWriter& Writer, ELinkStreamPriority Priority = ELinkStreamPriority::Interactive);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Listener")
+	bool IsListening() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Listener")
+	bool IsSessionConnected(int32 SessionId) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Listener")
+	TArray<int32> GetSessionIds() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Listener")
+	int32 GetSessionCount() const { return Sessions.Num(); }
+
+	/** Bytes queued on a session and not yet accepted by the kernel, framing headers included. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Send")
+	int64 GetPendingSendBytes(int32 SessionId) const;
+
+	/** One entry per lane, Control first. Empty for an unknown SessionId. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Stats")
+	TArray<FLinkStreamLaneStats> GetLaneStats(int32 SessionId) const;
+
+	/** Only SecondsSinceLastReceive is filled in: sessions answer no pings of their own, as they carry no envelope. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Heartbeat")
+	FLinkStreamHeartbeatStats GetHeartbeatStats(int32 SessionId) const;
+
+	/** Depth, drops and coalesces of a session's inbox. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Dispatch")
+	FLinkStreamInboxStats GetInboxStats(int32 SessionId) const;
+
+	/** A session's TLS handshake, and whether the client resumed an earlier session. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Socket|Security")
+	FLinkStreamTlsStats GetTlsStats(int32 SessionId) const;
+
+	/** Raised with true when a session's unsent bytes reach SendHighWatermark, and with false once they drain to SendLowWatermark. */
+	UPROPERTY(BlueprintAssignable, Category = "Socket|Send")
+	FLinkStreamSendBackpressureDelegate OnSendBackpressure;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket")
+	int32 SendBufferSize = 16384;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket")
+	int32 ReceiveBufferSize = 16384;
+
+	/** Most sessions open at once. Further clients are accepted and closed straight away. 0 means no limit. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Listener", meta = (ClampMin = "0"))
+	int32 MaxSessions = 0;
+
+	/** Length of the kernel's queue of connections waiting to be accepted. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Listener", meta = (ClampMin = "1"))
+	int32 Backlog = 128;
+
+	/** How received messages reach the game thread. Read when Listen is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch")
+	ELinkStreamDispatchMode DispatchMode = ELinkStreamDispatchMode::PerMessage;
+
+	/** Batched mode: most messages raised per frame across all sessions. 0 means no limit. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch", meta = (ClampMin = "0"))
+	int32 MaxMessagesPerFrame = 256;
+
+	/** Batched mode: most time spent raising messages per frame, in milliseconds. 0 means no limit. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch", meta = (ClampMin = "0"))
+	float MaxDispatchTimeMs = 2.f;
+
+	/** See ALinkStreamConnection::InboxLimit. Applied to every session. Read when Listen is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch", meta = (ClampMin = "0"))
+	int32 InboxLimit = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch")
+	ELinkStreamInboxOverflow InboxOverflow = ELinkStreamInboxOverflow::PauseReceive;
+
+	/** Coalesce mode: bytes at the front of a message that identify what it updates. Sessions carry no envelope. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Dispatch", meta = (ClampMin = "1", ClampMax = "8"))
+	int32 CoalesceKeySize = 4;
+
+	/** Disables Nagle's algorithm on accepted sockets so small replies leave at once. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send")
+	bool bNoDelay = true;
+
+	/** Unsent bytes at which OnSendBackpressure(true) is raised. 0 disables backpressure events. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "0"))
+	int32 SendHighWatermark = 1024 * 1024;
+
+	/** Unsent bytes at which OnSendBackpressure(false) is raised after backpressure began. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "0"))
+	int32 SendLowWatermark = 256 * 1024;
+
+	/** Hard cap on unsent bytes per session. SendData fails instead of queuing past it. 0 means no limit. Read when Listen is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "0"))
+	int32 MaxPendingSendBytes = 16 * 1024 * 1024;
+
+	/** Share of messages each lane gets while several have messages waiting. See ALinkStreamConnection::ControlLaneWeight. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "1"))
+	int32 ControlLaneWeight = 16;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "1"))
+	int32 InteractiveLaneWeight = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "1"))
+	int32 BulkLaneWeight = 1;
+
+	/** Most messages each lane of a session holds before SendData fails. Rounded up to a power of two. Read when Listen is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Send", meta = (ClampMin = "2"))
+	int32 OutboxCapacity = 256;
+
+	/** How the byte stream is cut into messages. Must match what clients use. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Framing")
+	ELinkStreamFraming Framing = ELinkStreamFraming::UInt32;
+
+	/** Largest payload accepted in framed mode, in bytes. A client announcing a bigger frame is disconnected. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Framing", meta = (ClampMin = "1"))
+	int32 MaxFrameSize = 1024 * 1024;
+
+	/** Seconds without receiving anything after which a session is closed. 0 disables it. Read when Listen is called. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "0"))
+	float IdleTimeout = 0.f;
+
+	/** See ALinkStreamConnection::bTcpKeepAlive. Applied to every accepted socket. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat")
+	bool bTcpKeepAlive = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "1", EditCondition = "bTcpKeepAlive"))
+	int32 TcpKeepAliveIdle = 30;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "1", EditCondition = "bTcpKeepAlive"))
+	int32 TcpKeepAliveInterval = 5;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Heartbeat", meta = (ClampMin = "1", EditCondition = "bTcpKeepAlive"))
+	int32 TcpKeepAliveProbes = 3;
+
+	/** See ALinkStreamConnection::bEncrypt. Every session then expects an encrypted client. Needs Framing; Listen fails without it. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security")
+	bool bEncrypt = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security", meta = (EditCondition = "bEncrypt"))
+	FString EncryptionKey;
+
+	/**
+	 * Every session speaks TLS, presenting TlsCertificateFile. Session tickets let a returning client skip the full
+	 * handshake, for as long as this listener keeps listening. Takes the place of bEncrypt. Read when Listen is called.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security")
+	bool bTls = false;
+
+	/** PEM certificate chain, the server's certificate first. Relative to the project directory. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security", meta = (EditCondition = "bTls"))
+	FString TlsCertificateFile;
+
+	/** PEM private key of the certificate, unencrypted. Keep it out of packaged content. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket|Security", meta = (EditCondition = "bTls"))
+	FString TlsPrivateKeyFile;
+
+	/** ILinkStreamWorkerOwner implementation */
+	virtual UObject* GetWorkerOwnerObject() override { return this; }
+	virtual void OnWorkerConnected(int32 WorkerId) override;
+	virtual void OnWorkerDisconnected(int32 WorkerId) override;
+	virtual void OnWorkerMessage(int32 WorkerId) override;
+	virtual void OnWorkerSendBackpressure(int32 WorkerId, bool bBackpressured) override;
+
+private:
+	/** Changed on the game thread only, under SessionsLock, so game-thread reads need no lock and other threads take it shared. */
+	TMap<int32, TSharedRef<class FTcpSocketWorker>> Sessions;
+	mutable FRWLock SessionsLock;
+
+	/** Any thread. The returned session stays valid even if the game thread drops it meanwhile. */
+	TSharedPtr<class FTcpSocketWorker> FindSession(int32 SessionId) const;
+	TSharedPtr<class FLinkStreamAcceptor> Acceptor;
+
+	/** Sessions accepted and not yet disconnected, across every Listen call. Raised by the acceptor as it accepts, checked against MaxSessions. */
+	TSharedRef<FThreadSafeCounter> LiveSessions = MakeShared<FThreadSafeCounter>();
+
+	FTcpSocketDisconnectDelegate SessionDisconnectedDelegate;
+	FTcpSocketConnectDelegate SessionConnectedDelegate;
+	FTcpSocketReceivedMessageDelegate MessageReceivedDelegate;
+
+	/** First id the next Listen call hands out, so ids stay unique across StopListening and Listen. */
+	int32 NextSessionId = 0;
+
+	/** Session the next batched dispatch starts with. */
+	int32 NextDispatchIndex = 0;
+};
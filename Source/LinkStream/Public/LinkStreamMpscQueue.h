@@ -0,0 +1,217 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Bounded lock-free queue for any number of producers and a single consumer.
+ *
+ * The slots form a ring whose size is a power of two. Each slot carries a sequence number saying whose turn it is:
+ * equal to a position while that position may be written, one past it once written and not yet read. Producers
+ * claim positions with a compare-and-swap on the enqueue position and never wait on one another otherwise. The
+ * consumer only reads slots it has seen published. A full queue fails the enqueue; it never blocks or grows.
+ */
+template<typename T>
+class TLinkStreamMpscQueue
+{
+public:
+	TLinkStreamMpscQueue() = default;
+	TLinkStreamMpscQueue(const TLinkStreamMpscQueue&) = delete;
+	TLinkStreamMpscQueue& operator=(const TLinkStreamMpscQueue&) = delete;
+
+	~TLinkStreamMpscQueue()
+	{
+		delete[] Slots.load(std::memory_order_relaxed);
+	}
+
+	/** Sets the capacity, rounding InCapacity up to a power of two. The ring is allocated by the first enqueue. Call before the queue is shared. */
+	void Init(int32 InCapacity)
+	{
+		delete[] Slots.exchange(nullptr, std::memory_order_relaxed);
+		Capacity = FMath::RoundUpToPowerOfTwo((uint32)FMath::Max(InCapacity, 2));
+		Mask = Capacity - 1;
+		EnqueuePos.store(0, std::memory_order_relaxed);
+		DequeuePos.store(0, std::memory_order_relaxed);
+	}
+
+	int32 GetCapacity() const { return (int32)Capacity; }
+
+	/** Any thread. Returns false, leaving Item untouched, if the queue is full. */
+	bool Enqueue(T&& Item)
+	{
+		return EnqueueBatch(&Item, 1);
+	}
+
+	/**
+	 * Any thread. Claims Num consecutive slots with one compare-and-swap, so the items stay together and in order.
+	 * All or nothing: returns false, leaving Items untouched, if fewer than Num slots are free.
+	 */
+	bool EnqueueBatch(T* Items, int32 Num)
+	{
+		if (Num <= 0)
+		{
+			return true;
+		}
+		if ((uint32)Num > Capacity)
+		{
+			return false;
+		}
+
+		FSlot* slots = GetOrAllocateSlots();
+		uint64 pos = EnqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			// The consumer frees slots in order, so if the last slot needed is free, so are the ones before it.
+			const uint64 last = pos + Num - 1;
+			const int64 diff = (int64)(slots[last & Mask].Sequence.load(std::memory_order_acquire) - last);
+			if (diff == 0)
+			{
+				if (EnqueuePos.compare_exchange_weak(pos, pos + Num, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = EnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		for (int32 index = 0; index < Num; index++)
+		{
+			FSlot& slot = slots[(pos + index) & Mask];
+			slot.Value = MoveTemp(Items[index]);
+			slot.Sequence.store(pos + index + 1, std::memory_order_release);
+		}
+		return true;
+	}
+
+	/** Consumer only. Returns false if nothing has been published. */
+	bool Dequeue(T& OutItem)
+	{
+		FSlot* slots = Slots.load(std::memory_order_acquire);
+		if (!slots)
+		{
+			return false;
+		}
+		const uint64 pos = DequeuePos.load(std::memory_order_relaxed);
+		FSlot& slot = slots[pos & Mask];
+		if (slot.Sequence.load(std::memory_order_acquire) != pos + 1)
+		{
+			return false;
+		}
+		OutItem = MoveTemp(slot.Value);
+		slot.Sequence.store(pos + Capacity, std::memory_order_release);
+		DequeuePos.store(pos + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/** Consumer only. Appends up to MaxItems published items to Out, oldest first, and returns how many. */
+	template<typename AllocatorType>
+	int32 DequeueBatch(TArray<T, AllocatorType>& Out, int32 MaxItems)
+	{
+		FSlot* slots = Slots.load(std::memory_order_acquire);
+		if (!slots)
+		{
+			return 0;
+		}
+		uint64 pos = DequeuePos.load(std::memory_order_relaxed);
+		int32 count = 0;
+		while (count < MaxItems)
+		{
+			FSlot& slot = slots[pos & Mask];
+			if (slot.Sequence.load(std::memory_order_acquire) != pos + 1)
+			{
+				break;
+			}
+			Out.Add(MoveTemp(slot.Value));
+			slot.Sequence.store(pos + Capacity, std::memory_order_release);
+			pos++;
+			count++;
+		}
+		DequeuePos.store(pos, std::memory_order_relaxed);
+		return count;
+	}
+
+	/** Consumer only. True if the next item has not been published yet. */
+	bool IsEmpty() const
+	{
+		const FSlot* slots = Slots.load(std::memory_order_acquire);
+		const uint64 pos = DequeuePos.load(std::memory_order_relaxed);
+		return !slots || slots[pos & Mask].Sequence.load(std::memory_order_acquire) != pos + 1;
+	}
+
+	/** Any thread. Items claimed and not yet dequeued; only a snapshot while producers are active. */
+	int32 Num() const
+	{
+		const uint64 dequeuePos = DequeuePos.load(std::memory_order_relaxed);
+		const uint64 enqueuePos = EnqueuePos.load(std::memory_order_relaxed);
+		return enqueuePos > dequeuePos ? (int32)(enqueuePos - dequeuePos) : 0;
+	}
+
+private:
+	struct FSlot
+	{
+		std::atomic<uint64> Sequence{ 0 };
+		T Value;
+	};
+
+	/** Producers racing to allocate the ring keep whichever was published first. */
+	FSlot* GetOrAllocateSlots()
+	{
+		FSlot* slots = Slots.load(std::memory_order_acquire);
+		if (slots)
+		{
+			return slots;
+		}
+
+		FSlot* allocated = new FSlot[Capacity];
+		for (uint32 index = 0; index < Capacity; index++)
+		{
+			allocated[index].Sequence.store(index, std::memory_order_relaxed);
+		}
+		if (!Slots.compare_exchange_strong(slots, allocated, std::memory_order_acq_rel, std::memory_order_acquire))
+		{
+			delete[] allocated;
+			return slots;
+		}
+		return allocated;
+	}
+
+	std::atomic<FSlot*> Slots{ nullptr };
+	uint32 Capacity = 0;
+	uint32 Mask = 0;
+
+	/** Kept on separate cache lines: producers hammer EnqueuePos, the consumer owns DequeuePos. */
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> EnqueuePos{ 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> DequeuePos{ 0 };
+};
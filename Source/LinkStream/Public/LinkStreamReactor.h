@@ -0,0 +1,168 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Containers/Queue.h"
+#include <atomic>
+
+class FLinkStreamReactor;
+class FLinkStreamSocket;
+
+/** Native socket handle widened to a platform-neutral type so this header does not pull in socket headers. */
+typedef uint64 FLinkStreamNativeHandle;
+
+/** Anything driven by a reactor thread. Every method is called on the owning reactor thread. */
+class LINKSTREAM_API ILinkStreamReactorHandler
+{
+public:
+	virtual ~ILinkStreamReactorHandler() {}
+
+	/** Called once when the handler is picked up by its reactor. Sockets are opened and watched from here. */
+	virtual void OnReactorAttach(FLinkStreamReactor& Reactor) = 0;
+
+	/** Readiness reported for the socket this handler watches. */
+	virtual void OnReactorEvent(bool bReadable, bool bWritable, bool bError) = 0;
+
+	/** Called after attaching, and in every loop in which the handler had an event, called Wake or reached a WakeAt deadline. Returning false detaches the handler. */
+	virtual bool OnReactorTick() = 0;
+
+	/** Called once when the handler leaves the reactor, including on shutdown. */
+	virtual void OnReactorDetach() = 0;
+
+private:
+	friend class FLinkStreamReactor;
+
+	/** Set while the handler waits in its reactor's woken queue, so repeated Wakes queue it once. */
+	std::atomic<bool> bWakeQueued{ false };
+};
+
+/**
+ * One I/O thread multiplexing many sockets through readiness notification (epoll on Linux, poll elsewhere).
+ * The thread blocks until a socket is ready or Wake is called, so idle connections cost no CPU. A loop only ticks
+ * the handlers that had an event, were woken or reached a deadline, so its cost does not grow with idle handlers.
+ */
+class LINKSTREAM_API FLinkStreamReactor : public FRunnable
+{
+public:
+	explicit FLinkStreamReactor(int32 InIndex);
+	virtual ~FLinkStreamReactor();
+
+	bool Start();
+
+	/** Thread-safe. The handler is attached on the reactor thread during its next loop. */
+	void Register(TSharedRef<ILinkStreamReactorHandler> Handler);
+
+	int32 GetNumHandlers() const { return NumHandlers.GetValue(); }
+
+	/** Thread-safe. Makes the reactor run a loop that ticks Handler, so it can service newly queued work. Null just runs a loop. */
+	void Wake(ILinkStreamReactorHandler* Handler = nullptr);
+
+	/** Starts or updates readiness notification for Handler's socket. A new socket starts with reads watched. Reactor thread only. */
+	bool Watch(ILinkStreamReactorHandler* Handler, const FLinkStreamSocket& Socket, bool bWantWrite);
+
+	/** Stops or resumes read readiness for Handler's watched socket, keeping its write interest. Reactor thread only. */
+	bool SetReadPaused(ILinkStreamReactorHandler* Handler, bool bPaused);
+
+	/** Stops readiness notification for Handler. Reactor thread only. */
+	void Unwatch(ILinkStreamReactorHandler* Handler);
+
+	/**
+	 * Ticks Handler no later than Seconds (FPlatformTime::Seconds), so it can act on timeouts. A request lasts until it
+	 * fires and is kept only if earlier than the one pending; a handler still waiting re-arms from OnReactorTick.
+	 * Reactor thread only.
+	 */
+	void WakeAt(ILinkStreamReactorHandler* Handler, double Seconds);
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	void AttachPending();
+	void DetachAll();
+
+	/** Moves handlers from the woken queue and expired timers to Ready. */
+	void CollectReady();
+
+	/** Time until the earliest timer, for the poller. -1 when none is armed. */
+	int32 GetTimeoutMs();
+
+	struct FWatch
+	{
+		FLinkStreamNativeHandle Socket;
+		bool bWantWrite;
+		bool bWantRead;
+	};
+
+	int32 Index;
+	FRunnableThread* Thread = nullptr;
+	FThreadSafeBool bRun = false;
+	FThreadSafeCounter NumHandlers;
+
+	TUniquePtr<class FLinkStreamPoller> Poller;
+	TUniquePtr<class FLinkStreamWakeup> Wakeup;
+	TQueue<TSharedPtr<ILinkStreamReactorHandler>, EQueueMode::Mpsc> PendingHandlers;
+	TMap<ILinkStreamReactorHandler*, TSharedPtr<ILinkStreamReactorHandler>> Handlers;
+	TMap<ILinkStreamReactorHandler*, FWatch> Watches;
+
+	/** Handlers passed to Wake. Entries may name a handler that has detached since, so they are checked against Handlers. */
+	TQueue<ILinkStreamReactorHandler*, EQueueMode::Mpsc> WokenHandlers;
+
+	/** Handlers to tick at the end of the current loop. */
+	TSet<ILinkStreamReactorHandler*> Ready;
+
+	struct FTimer
+	{
+		double Deadline;
+		ILinkStreamReactorHandler* Handler;
+
+		bool operator<(const FTimer& Other) const { return Deadline < Other.Deadline; }
+	};
+
+	/** Min-heap of WakeAt requests. An entry is live only while Deadlines holds its deadline for its handler. */
+	TArray<FTimer> Timers;
+	TMap<ILinkStreamReactorHandler*, double> Deadlines;
+};
+
+/** The set of reactor threads shared by every LinkStream connection on the Reactor backend. Owned by FLinkStreamModule. */
+class LINKSTREAM_API FLinkStreamReactorPool
+{
+public:
+	/** NumThreads <= 0 picks half the logical cores. */
+	explicit FLinkStreamReactorPool(int32 NumThreads);
+	~FLinkStreamReactorPool();
+
+	/** Shards the handler onto the reactor with the fewest handlers and returns that reactor. Thread-safe. */
+	FLinkStreamReactor* Register(TSharedRef<ILinkStreamReactorHandler> Handler);
+
+	int32 Num() const { return Reactors.Num(); }
+
+private:
+	TArray<TUniquePtr<FLinkStreamReactor>> Reactors;
+};
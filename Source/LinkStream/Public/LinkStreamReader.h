@@ -0,0 +1,205 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include <type_traits>
+#include "LinkStreamReader.generated.h"
+
+UENUM(BlueprintType)
+enum class ELinkStreamByteOrder : uint8
+{
+	LittleEndian,
+	BigEndian
+};
+
+/**
+ * Cursor over a received message. Reads advance an offset and never move or copy the underlying bytes.
+ * A read that would run past the end fails, leaves the offset untouched and sets the error flag.
+ */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamReader
+{
+	GENERATED_BODY()
+
+	FLinkStreamReader() = default;
+
+	/** Reads from bytes owned by the caller, which must outlive the reader. */
+	explicit FLinkStreamReader(TArrayView<const uint8> InView);
+
+	/** Takes ownership of a message buffer without copying it. */
+	explicit FLinkStreamReader(TArray<uint8>&& InBuffer);
+
+	const uint8* GetData() const { return bExternal ? ExternalData : Buffer.GetData(); }
+	int32 Num() const { return bExternal ? ExternalSize : Buffer.Num(); }
+	int32 GetOffset() const { return Offset; }
+	int32 GetRemaining() const { return Num() - Offset; }
+	bool IsAtEnd() const { return Offset >= Num(); }
+	bool HasError() const { return bError; }
+
+	/** Moves the cursor to an absolute position. */
+	bool Seek(int32 NewOffset);
+	bool Skip(int32 NumBytes);
+
+	template <typename T>
+	bool ReadInteger(T& OutValue, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian)
+	{
+		static_assert(std::is_integral<T>::value, "ReadInteger expects an integer type");
+		typedef typename std::make_unsigned<T>::type FUnsigned;
+
+		OutValue = 0;
+		if (!Require(sizeof(T)))
+		{
+			return false;
+		}
+
+		const uint8* Bytes = GetData() + Offset;
+		FUnsigned Value = 0;
+		if (ByteOrder == ELinkStreamByteOrder::LittleEndian)
+		{
+			for (int32 Index = sizeof(T) - 1; Index >= 0; Index--)
+			{
+				Value = (FUnsigned)((Value << 8) | Bytes[Index]);
+			}
+		}
+		else
+		{
+			for (int32 Index = 0; Index < (int32)sizeof(T); Index++)
+			{
+				Value = (FUnsigned)((Value << 8) | Bytes[Index]);
+			}
+		}
+
+		Offset += sizeof(T);
+		OutValue = (T)Value;
+		return true;
+	}
+
+	bool ReadFloat(float& OutValue, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+	bool ReadDouble(double& OutValue, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+	bool ReadBool(bool& OutValue);
+
+	/** LEB128 unsigned varint, 1-10 bytes. */
+	bool ReadVarUInt(uint64& OutValue);
+
+	/** Reads ByteLength bytes of UTF-8. */
+	bool ReadString(FString& OutValue, int32 ByteLength);
+
+	/** Reads a varint byte length followed by that many bytes of UTF-8. */
+	bool ReadLengthPrefixedString(FString& OutValue);
+
+	/** Returns a view of the next NumBytes bytes without copying them. The view is valid as long as the reader's bytes are. */
+	bool ReadSpan(int32 NumBytes, TArrayView<const uint8>& OutSpan);
+
+	/** Appends the next NumBytes bytes to OutBytes. */
+	bool ReadBytes(int32 NumBytes, TArray<uint8>& OutBytes);
+
+private:
+	bool Require(int32 NumBytes);
+
+	/** Owned bytes. Unused while reading an external view. */
+	UPROPERTY()
+	TArray<uint8> Buffer;
+
+	UPROPERTY()
+	int32 Offset = 0;
+
+	const uint8* ExternalData = nullptr;
+	int32 ExternalSize = 0;
+	bool bExternal = false;
+	bool bError = false;
+};
+
+/** Blueprint access to FLinkStreamReader. Every read returns false and leaves the reader untouched if the message is too short. */
+UCLASS()
+class LINKSTREAM_API ULinkStreamReaderLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	/** Creates a reader over Message. The bytes are moved into the reader, so Message is empty afterwards. */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Make LinkStream Reader", Keywords = "read message cursor"), Category = "Socket|Reader")
+	static FLinkStreamReader MakeReader(UPARAM(ref) TArray<uint8>& Message);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Byte"), Category = "Socket|Reader")
+	static bool ReadByte(UPARAM(ref) FLinkStreamReader& Reader, uint8& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Int8"), Category = "Socket|Reader")
+	static bool ReadInt8(UPARAM(ref) FLinkStreamReader& Reader, int32& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Int16"), Category = "Socket|Reader")
+	static bool ReadInt16(UPARAM(ref) FLinkStreamReader& Reader, int32& Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read UInt16"), Category = "Socket|Reader")
+	static bool ReadUInt16(UPARAM(ref) FLinkStreamReader& Reader, int32& Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Int32"), Category = "Socket|Reader")
+	static bool ReadInt32(UPARAM(ref) FLinkStreamReader& Reader, int32& Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read UInt32"), Category = "Socket|Reader")
+	static bool ReadUInt32(UPARAM(ref) FLinkStreamReader& Reader, int64& Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Int64"), Category = "Socket|Reader")
+	static bool ReadInt64(UPARAM(ref) FLinkStreamReader& Reader, int64& Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	/** Blueprint has no unsigned 64-bit type; the bits are returned unchanged in an int64. */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read UInt64"), Category = "Socket|Reader")
+	static bool ReadUInt64(UPARAM(ref) FLinkStreamReader& Reader, int64& Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Float"), Category = "Socket|Reader")
+	static bool ReadFloat(UPARAM(ref) FLinkStreamReader& Reader, float& Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Double"), Category = "Socket|Reader")
+	static bool ReadDouble(UPARAM(ref) FLinkStreamReader& Reader, double& Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Bool"), Category = "Socket|Reader")
+	static bool ReadBool(UPARAM(ref) FLinkStreamReader& Reader, bool& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read VarInt"), Category = "Socket|Reader")
+	static bool ReadVarInt(UPARAM(ref) FLinkStreamReader& Reader, int64& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read String"), Category = "Socket|Reader")
+	static bool ReadString(UPARAM(ref) FLinkStreamReader& Reader, int32 ByteLength, FString& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Length-Prefixed String"), Category = "Socket|Reader")
+	static bool ReadLengthPrefixedString(UPARAM(ref) FLinkStreamReader& Reader, FString& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Read Bytes"), Category = "Socket|Reader")
+	static bool ReadBytes(UPARAM(ref) FLinkStreamReader& Reader, int32 NumBytes, TArray<uint8>& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Skip Bytes"), Category = "Socket|Reader")
+	static bool Skip(UPARAM(ref) FLinkStreamReader& Reader, int32 NumBytes);
+
+	UFUNCTION(BlueprintPure, meta = (DisplayName = "Get Read Offset"), Category = "Socket|Reader")
+	static int32 GetOffset(const FLinkStreamReader& Reader) { return Reader.GetOffset(); }
+
+	UFUNCTION(BlueprintPure, meta = (DisplayName = "Get Remaining Bytes"), Category = "Socket|Reader")
+	static int32 GetRemaining(const FLinkStreamReader& Reader) { return Reader.GetRemaining(); }
+
+	UFUNCTION(BlueprintPure, meta = (DisplayName = "Has Read Error"), Category = "Socket|Reader")
+	static bool HasError(const FLinkStreamReader& Reader) { return Reader.HasError(); }
+};
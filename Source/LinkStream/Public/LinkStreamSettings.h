@@ -36,4 +36,8 @@ public:
 	/** Post errors to message log. */
 	UPROPERTY(Config, EditAnywhere, Category = "LinkStream")
 	bool bPostErrorsToMessageLog;	
+
+	/** Number of shared I/O threads for connections on the Reactor backend. 0 uses half the logical cores. */
+	UPROPERTY(Config, EditAnywhere, Category = "LinkStream|Reactor", meta = (ClampMin = "0"))
+	int32 ReactorThreadCount = 0;
 };
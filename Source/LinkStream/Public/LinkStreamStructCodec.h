@@ -0,0 +1,86 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "LinkStreamReader.h"
+#include "LinkStreamWriter.h"
+#include "LinkStreamStructCodec.generated.h"
+
+/**
+ * Encodes any USTRUCT as its properties back to back, in declaration order, in the wire format of FLinkStreamWriter:
+ * numbers and enums little endian at their native size, bools as one byte, strings and names as a varint length and
+ * UTF-8, arrays as a varint count and their elements, nested structs inline. Both peers must agree on the struct.
+ *
+ * The first use of a struct type compiles its properties into a flat plan of offsets and sizes, in which adjacent
+ * fixed-size fields become a single copy, and caches it. Later calls run the plan without touching reflection.
+ * Object references, maps, sets and text are not supported; a struct holding one fails. Names are only looked up on
+ * read, never added to the name table, so a received name the process does not already know fails the read. Thread-safe.
+ */
+class LINKSTREAM_API FLinkStreamStructCodec
+{
+public:
+	/** Appends Value, an instance of Struct, to Writer. Returns false, writing nothing, if Struct holds an unsupported property. */
+	static bool Serialize(const UScriptStruct* Struct, const void* Value, FLinkStreamWriter& Writer);
+
+	/**
+	 * Reads an instance of Struct into OutValue, which must already be constructed. Returns false on a short or malformed
+	 * message, with the reader's offset left where it was and OutValue possibly partly overwritten.
+	 */
+	static bool Deserialize(const UScriptStruct* Struct, void* OutValue, FLinkStreamReader& Reader);
+
+	template <typename T>
+	static bool Serialize(const T& Value, FLinkStreamWriter& Writer)
+	{
+		return Serialize(T::StaticStruct(), &Value, Writer);
+	}
+
+	template <typename T>
+	static bool Deserialize(FLinkStreamReader& Reader, T& OutValue)
+	{
+		return Deserialize(T::StaticStruct(), &OutValue, Reader);
+	}
+};
+
+/** Blueprint access to FLinkStreamStructCodec. Both nodes take any struct. */
+UCLASS()
+class LINKSTREAM_API ULinkStreamStructLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	/** Appends every property of Value to Writer. Fails, writing nothing, for structs holding object references, maps, sets or text. */
+	UFUNCTION(BlueprintCallable, CustomThunk, meta = (DisplayName = "Serialize Struct", CustomStructureParam = "Value", Keywords = "write struct encode"), Category = "Socket|Writer")
+	static bool SerializeStruct(UPARAM(ref) FLinkStreamWriter& Writer, const int32& Value);
+
+	/** Reads Value as Serialize Struct wrote it. Fails, leaving the reader where it was, if the message is too short. */
+	UFUNCTION(BlueprintCallable, CustomThunk, meta = (DisplayName = "Deserialize Struct", CustomStructureParam = "Value", Keywords = "read struct decode"), Category = "Socket|Reader")
+	static bool DeserializeStruct(UPARAM(ref) FLinkStreamReader& Reader, int32& Value);
+
+	DECLARE_FUNCTION(execSerializeStruct);
+	DECLARE_FUNCTION(execDeserializeStruct);
+};
@@ -0,0 +1,166 @@
+/*
+ *  LinkStream
+ *  Copyright (c) 2024 Bifrost Inc.
+ *  Author: Nathan Martell
+ *
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LinkStreamBuffer.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "LinkStreamReader.h"
+#include <type_traits>
+#include "LinkStreamWriter.generated.h"
+
+/**
+ * Builds an outgoing message in one buffer. Reserve once, write typed values, then hand the buffer to SendData by move.
+ * The wire format mirrors FLinkStreamReader.
+ */
+USTRUCT(BlueprintType)
+struct LINKSTREAM_API FLinkStreamWriter
+{
+	GENERATED_BODY()
+
+	FLinkStreamWriter() = default;
+	/** Takes the buffer from the module's pool, so a writer that ends in SendWriter recycles its allocation. */
+	explicit FLinkStreamWriter(int32 InitialCapacity) : Buffer(FLinkStreamBuffer::AcquireArray(InitialCapacity)) {}
+
+	void Reserve(int32 Capacity)
+	{
+		if (Buffer.Max() == 0)
+		{
+			Buffer = FLinkStreamBuffer::AcquireArray(Capacity);
+		}
+		else
+		{
+			Buffer.Reserve(Capacity);
+		}
+	}
+	void Reset() { Buffer.Reset(); }
+
+	const uint8* GetData() const { return Buffer.GetData(); }
+	int32 Num() const { return Buffer.Num(); }
+	const TArray<uint8>& GetBuffer() const { return Buffer; }
+
+	/** Moves the finished message out. The writer is empty afterwards. */
+	TArray<uint8> Release() { return MoveTemp(Buffer); }
+
+	template <typename T>
+	void WriteInteger(T Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian)
+	{
+		static_assert(std::is_integral<T>::value, "WriteInteger expects an integer type");
+		typedef typename std::make_unsigned<T>::type FUnsigned;
+
+		const FUnsigned Bits = (FUnsigned)Value;
+		uint8* Bytes = Buffer.GetData() + Buffer.AddUninitialized(sizeof(T));
+		for (int32 Index = 0; Index < (int32)sizeof(T); Index++)
+		{
+			const int32 Shift = ByteOrder == ELinkStreamByteOrder::LittleEndian ? Index * 8 : ((int32)sizeof(T) - 1 - Index) * 8;
+			Bytes[Index] = (uint8)(Bits >> Shift);
+		}
+	}
+
+	void WriteFloat(float Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+	void WriteDouble(double Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+	void WriteBool(bool bValue) { Buffer.Add(bValue ? 1 : 0); }
+
+	/** LEB128 unsigned varint, 1-10 bytes. */
+	void WriteVarUInt(uint64 Value);
+
+	/** Writes the UTF-8 bytes of Value straight into the buffer, without a length. */
+	void WriteString(const FString& Value);
+
+	/** Writes a varint byte length followed by the UTF-8 bytes of Value. */
+	void WriteLengthPrefixedString(const FString& Value);
+
+	void WriteBytes(const uint8* Data, int32 NumBytes);
+	void WriteBytes(TArrayView<const uint8> Bytes) { WriteBytes(Bytes.GetData(), Bytes.Num()); }
+
+	/** Number of bytes WriteString produces for Value. */
+	static int32 GetUTF8Length(const FString& Value);
+
+private:
+	UPROPERTY()
+	TArray<uint8> Buffer;
+};
+
+/** Blueprint access to FLinkStreamWriter. */
+UCLASS()
+class LINKSTREAM_API ULinkStreamWriterLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	/** Creates a writer with room for Capacity bytes, so writes up to that size never reallocate. */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Make LinkStream Writer", Keywords = "write message builder"), Category = "Socket|Writer")
+	static FLinkStreamWriter MakeWriter(int32 Capacity = 256);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Byte"), Category = "Socket|Writer")
+	static void WriteByte(UPARAM(ref) FLinkStreamWriter& Writer, uint8 Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Int8"), Category = "Socket|Writer")
+	static void WriteInt8(UPARAM(ref) FLinkStreamWriter& Writer, int32 Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Int16"), Category = "Socket|Writer")
+	static void WriteInt16(UPARAM(ref) FLinkStreamWriter& Writer, int32 Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write UInt16"), Category = "Socket|Writer")
+	static void WriteUInt16(UPARAM(ref) FLinkStreamWriter& Writer, int32 Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Int32"), Category = "Socket|Writer")
+	static void WriteInt32(UPARAM(ref) FLinkStreamWriter& Writer, int32 Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write UInt32"), Category = "Socket|Writer")
+	static void WriteUInt32(UPARAM(ref) FLinkStreamWriter& Writer, int64 Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Int64"), Category = "Socket|Writer")
+	static void WriteInt64(UPARAM(ref) FLinkStreamWriter& Writer, int64 Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Float"), Category = "Socket|Writer")
+	static void WriteFloat(UPARAM(ref) FLinkStreamWriter& Writer, float Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Double"), Category = "Socket|Writer")
+	static void WriteDouble(UPARAM(ref) FLinkStreamWriter& Writer, double Value, ELinkStreamByteOrder ByteOrder = ELinkStreamByteOrder::LittleEndian);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Bool"), Category = "Socket|Writer")
+	static void WriteBool(UPARAM(ref) FLinkStreamWriter& Writer, bool Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write VarInt"), Category = "Socket|Writer")
+	static void WriteVarInt(UPARAM(ref) FLinkStreamWriter& Writer, int64 Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write String"), Category = "Socket|Writer")
+	static void WriteString(UPARAM(ref) FLinkStreamWriter& Writer, const FString& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Length-Prefixed String"), Category = "Socket|Writer")
+	static void WriteLengthPrefixedString(UPARAM(ref) FLinkStreamWriter& Writer, const FString& Value);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Bytes"), Category = "Socket|Writer")
+	static void WriteBytes(UPARAM(ref) FLinkStreamWriter& Writer, const TArray<uint8>& Value);
+
+	UFUNCTION(BlueprintPure, meta = (DisplayName = "Get Writer Size"), Category = "Socket|Writer")
+	static int32 GetSize(const FLinkStreamWriter& Writer) { return Writer.Num(); }
+
+	/** Copies the bytes written so far. Prefer Send Writer, which hands the buffer over without a copy. */
+	UFUNCTION(BlueprintPure, meta = (DisplayName = "Get Writer Bytes"), Category = "Socket|Writer")
+	static TArray<uint8> GetBytes(const FLinkStreamWriter& Writer) { return Writer.GetBuffer(); }
+};
@@ -281,16 +281,21 @@ namespace UnrealEngine.Runtime {
 
 										Assembly framework = plugin.loader.LoadAssembly(referencedAssembly);
 
-										
-											Type sharedClass = framework.GetType(frameworkAssemblyName + ".Shared");
+										Type sharedClass = framework.GetType(frameworkAssemblyName + ".Shared");
 
-										
-												plugin.userFunctions = (Dictionary<int, IntPtr>)sharedClass.GetMethod("Load", BindingFlags.NonPublic | BindingFlags.Static).Invoke(null, new object[] { sharedEvents, sharedFunctions, plugin.assembly });
+										// Both sides sum the sizes of their function tables, so a framework built against other native bindings is refused
+										if ((int)sharedClass.GetField("checksum", BindingFlags.NonPublic | BindingFlags.Static).GetValue(null) == sharedChecksum) {
+											plugin.userFunctions = (Dictionary<int, IntPtr>)sharedClass.GetMethod("Load", BindingFlags.NonPublic | BindingFlags.Static).Invoke(null, new object[] { sharedEvents, sharedFunctions, plugin.assembly });
 
-												Log(LogLevel.Display, "Framework loaded successfully for " + assembly);
+											Log(LogLevel.Display, "Framework loaded successfully for " + assembly);
 
-												return default;
-										
+											return default;
+										}
+
+										loadingFailed = true;
+										Exception("Framework loading failed, the function tables of UnrealEngine.Framework do not match the runtime's for " + assembly);
+
+										break;
 									}
 								}
 
@@ -219,6 +219,18 @@ void UnrealSOLNET::Module::StartupModule() {
 				checksum += head;
 			}
 
+			{
+				int32 head = 0;
+				Shared::Functions[position++] = Shared::InprocFunctions;
+
+				Shared::InprocFunctions[head++] = (void*)&UnrealSOLNETFramework::Inproc::Open;
+				Shared::InprocFunctions[head++] = (void*)&UnrealSOLNETFramework::Inproc::Send;
+				Shared::InprocFunctions[head++] = (void*)&UnrealSOLNETFramework::Inproc::Receive;
+				Shared::InprocFunctions[head++] = (void*)&UnrealSOLNETFramework::Inproc::Close;
+
+				checksum += head;
+			}
+
 
 			// Runtime pointers
 
@@ -25,6 +25,7 @@
 
 
 #include "UnrealSOLNET_Framework.h"
+#include "LinkStreamInproc.h"
 
 DEFINE_LOG_CATEGORY(LogUnrealManaged);
 
@@ -318,4 +319,22 @@ namespace UnrealSOLNETFramework {
 			return false;
 		}
 	}
+
+	namespace Inproc {
+		void* Open(const char* Name) {
+			return FLinkStreamInprocEndpoint::FindOrCreateByName(FString(UTF8_TO_TCHAR(Name)));
+		}
+
+		bool Send(void* Endpoint, const uint8* Data, int32 Size) {
+			return static_cast<FLinkStreamInprocEndpoint*>(Endpoint)->ManagedSend(Data, Size);
+		}
+
+		const uint8* Receive(void* Endpoint, int32* Size) {
+			return static_cast<FLinkStreamInprocEndpoint*>(Endpoint)->ManagedReceive(*Size);
+		}
+
+		void Close(void* Endpoint) {
+			static_cast<FLinkStreamInprocEndpoint*>(Endpoint)->ManagedClose();
+		}
+	}
 }
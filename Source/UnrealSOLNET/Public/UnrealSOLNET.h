@@ -275,6 +275,7 @@ namespace UnrealSOLNET {
 		static void* AssertFunctions[storageSize];
 		static void* DebugFunctions[storageSize];
 		static void* ObjectFunctions[storageSize];
+		static void* InprocFunctions[storageSize];
 
 
 		static void* RuntimeFunctions[2];
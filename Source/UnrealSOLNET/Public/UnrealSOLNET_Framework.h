@@ -176,5 +176,12 @@ namespace UnrealSOLNETFramework {
 		static bool SetString(UObject* Object, const char* Name, const char* Value);
 		static bool SetText(UObject* Object, const char* Name, const char* Value);
 	}
+
+	namespace Inproc {
+		static void* Open(const char* Name);
+		static bool Send(void* Endpoint, const uint8* Data, int32 Size);
+		static const uint8* Receive(void* Endpoint, int32* Size);
+		static void Close(void* Endpoint);
+	}
 	
 }
\ No newline at end of file
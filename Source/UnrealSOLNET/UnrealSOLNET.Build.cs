@@ -50,6 +50,7 @@ public class UnrealSOLNET : ModuleRules {
             "CoreUObject",
 			"Engine",
 			"InputCore",
+			"LinkStream",
             "Slate",
             "SlateCore"
         });